@@ -0,0 +1,311 @@
+#include "BenchmarkSuite.hpp"
+
+#include "../src/core/MetadataInfo.hpp"
+#include "../src/core/NewickIO.hpp"
+#include "../src/core/OptimizeLeafOrder.hpp"
+#include "../src/core/TextSearch.hpp"
+#include "../src/core/VisualTree.hpp"
+#include "../src/utils/ParsimonyCalculator.hpp"
+
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtDebug>
+
+#include <algorithm>
+#include <numeric>
+
+using namespace pygmy;
+using namespace utils;
+
+namespace
+{
+    /** Operations timed for each tree, in the order they are run. */
+    const char* OPERATIONS[] = {
+        "NewickIO::Write",
+        "NewickIO::Write (gzip)",
+        "NewickIO::Read",
+        "Tree::Clone",
+        "Tree::CalculateStatistics",
+        "VisualTree::Layout",
+        "VisualTree::LabelBoundingBoxes",
+        "VisualTree::Reroot",
+        "VisualTree::CollapseNodes",
+        "VisualTree::Undo (Reroot)",
+        "Tree::ProjectTree",
+        "TextSearch::FilterData",
+        "TextSearch::FilterData (regex)",
+        "ParsimonyCalculator::Calculate",
+        "OptimizeLeafOrder::SignificanceTest"
+    };
+
+    /** Trees with more leaves than this are not given a significance test, since each permutation reorders the entire tree. */
+    const uint MAX_SIGNIFICANCE_LEAVES = 10000;
+
+    /** Number of permutations performed by each significance test. */
+    const uint SIGNIFICANCE_ITERATIONS = 200;
+
+    void NoOp() {}
+}
+
+void BenchmarkSuite::Run()
+{
+    for(uint leaves : m_options.sizes)
+    {
+        for(const QString& shape : m_options.shapes)
+            RunTree(shape, leaves);
+    }
+}
+
+void BenchmarkSuite::RunTree(const QString& shape, uint leaves)
+{
+    uint depth = SyntheticTrees::ExpectedDepth(shape, leaves);
+    if(depth > m_options.maxDepth)
+    {
+        for(const char* name : OPERATIONS)
+            Skip(shape, leaves, name, QString("tree depth %1 exceeds maximum depth of %2").arg(depth).arg(m_options.maxDepth));
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    Tree<NodePhylo>::Ptr tree = m_generator.Generate(shape, leaves);
+    qDebug().noquote() << QString("Generated %1 tree with %2 leaves in %3 ms")
+                          .arg(shape).arg(tree->GetNumberOfLeaves()).arg(timer.elapsed());
+
+    NewickIO newickIO;
+    QString newickFile = QDir(m_options.tempDir).filePath(tree->GetName() + ".tre");
+    Time(shape, leaves, "NewickIO::Write",
+         [&]() { QFile::remove(newickFile); },
+         [&]() { newickIO.Write(tree, newickFile); },
+         NoOp);
+
+    Time(shape, leaves, "NewickIO::Write (gzip)",
+         [&]() { QFile::remove(newickFile + ".gz"); },
+         [&]() { newickIO.Write(tree, newickFile + ".gz"); },
+         [&]() { QFile::remove(newickFile + ".gz"); });
+
+    Tree<NodePhylo>::Ptr copy;
+    Time(shape, leaves, "NewickIO::Read",
+         [&]() { copy.reset(new Tree<NodePhylo>()); },
+         [&]() { newickIO.Read(copy, newickFile); },
+         [&]() { copy.reset(); });
+    QFile::remove(newickFile);
+
+    Time(shape, leaves, "Tree::Clone",
+         NoOp,
+         [&]() { copy = tree->Clone(); },
+         [&]() { copy.reset(); });
+
+    Time(shape, leaves, "Tree::CalculateStatistics",
+         NoOp,
+         [&]() { tree->CalculateStatistics(); },
+         NoOp);
+
+    VisualTreePtr visualTree;
+    Time(shape, leaves, "VisualTree::Layout",
+         [&]() { visualTree.reset(new VisualTree(tree)); },
+         [&]() { visualTree->Layout(); },
+         [&]() { visualTree.reset(); });
+
+    if(m_options.labels)
+    {
+        Time(shape, leaves, "VisualTree::LabelBoundingBoxes",
+             [&]() { visualTree.reset(new VisualTree(tree)); },
+             [&]() { visualTree->LabelBoundingBoxes(); },
+             [&]() { visualTree.reset(); });
+    }
+    else
+    {
+        Skip(shape, leaves, "VisualTree::LabelBoundingBoxes", "no OpenGL context available");
+    }
+
+    // reroot on the leaf drawn in the middle of the tree
+    NodePhylo* rerootNode = NULL;
+    Time(shape, leaves, "VisualTree::Reroot",
+         [&]() {
+             visualTree.reset(new VisualTree(tree));
+             visualTree->Layout();
+             std::vector<NodePhylo*> treeLeaves = visualTree->GetTree()->GetLeaves();
+             rerootNode = treeLeaves[treeLeaves.size() / 2];
+         },
+         [&]() { visualTree->Reroot(rerootNode); },
+         [&]() { visualTree.reset(); });
+
+    Time(shape, leaves, "VisualTree::CollapseNodes",
+         [&]() { visualTree.reset(new VisualTree(tree)); },
+         [&]() { visualTree->CollapseNodes(50.0f); },
+         [&]() { visualTree.reset(); });
+
+    Time(shape, leaves, "VisualTree::Undo (Reroot)",
+         [&]() {
+             visualTree.reset(new VisualTree(tree));
+             visualTree->Layout();
+             std::vector<NodePhylo*> treeLeaves = visualTree->GetTree()->GetLeaves();
+             visualTree->Reroot(treeLeaves[treeLeaves.size() / 2]);
+         },
+         [&]() { visualTree->Undo(); },
+         [&]() { visualTree.reset(); });
+
+    // project onto every other leaf
+    std::vector<QString> leafNames = tree->GetLeafNames();
+    std::vector<QString> projectNames;
+    Time(shape, leaves, "Tree::ProjectTree",
+         [&]() {
+             copy = tree->Clone();
+             projectNames.clear();
+             for(size_t i = 0; i < leafNames.size(); i += 2)
+                 projectNames.push_back(leafNames[i]);
+         },
+         [&]() { copy->ProjectTree(projectNames); },
+         [&]() { copy.reset(); });
+
+    TextSearch textSearch;
+    std::vector<NodePhylo*> treeLeaves = tree->GetLeaves();
+    for(NodePhylo* leaf : treeLeaves)
+        textSearch.Add(leaf->GetName(), leaf->GetId());
+    treeLeaves.clear();
+
+    Time(shape, leaves, "TextSearch::FilterData",
+         NoOp,
+         [&]() { textSearch.FilterData("t12", false, true); },
+         NoOp);
+
+    Time(shape, leaves, "TextSearch::FilterData (regex)",
+         NoOp,
+         [&]() { textSearch.FilterData("^T[0-9]*7$", true, false); },
+         NoOp);
+
+    ParsimonyCalculatorPtr parsimonyCalculator;
+    std::set<QString> characters = SyntheticTrees::MetadataCategories();
+    Time(shape, leaves, "ParsimonyCalculator::Calculate",
+         [&]() { parsimonyCalculator.reset(new ParsimonyCalculator()); },
+         [&]() { parsimonyCalculator->Calculate(tree, SyntheticTrees::MetadataField(), characters); },
+         [&]() { parsimonyCalculator.reset(); });
+
+    // test the association between the leaf order and metadata of a tree whose leaves were ordered by that metadata
+    if(leaves <= MAX_SIGNIFICANCE_LEAVES)
+    {
+        MetadataInfoPtr metadataInfo(new MetadataInfo());
+        OptimizeLeafOrder::SignificanceTestResults significance;
+        Time(shape, leaves, "OptimizeLeafOrder::SignificanceTest",
+             [&]() {
+                 copy = tree->Clone();
+                 metadataInfo->SetMetadata(copy);
+                 uint numCrossings;
+                 OptimizeLeafOrder::OptimizeLeafNodeOrdering(copy, metadataInfo, SyntheticTrees::MetadataField(), numCrossings, true);
+             },
+             [&]() { significance = OptimizeLeafOrder::SignificanceTest(copy->GetRootNode(), SIGNIFICANCE_ITERATIONS, 0, m_options.seed); },
+             [&]() { copy.reset(); });
+
+        BenchmarkResult& result = m_results.back();
+        result.values["iterations_per_second"] = significance.iterationsPerSecond;
+        result.values["p_value"] = significance.pValue;
+        qDebug().noquote() << QString("    %1 permutations per second, p-value %2")
+                              .arg(significance.iterationsPerSecond, 0, 'f', 1).arg(significance.pValue, 0, 'g', 3);
+    }
+    else
+    {
+        Skip(shape, leaves, "OptimizeLeafOrder::SignificanceTest",
+             QString("significance test is limited to trees with at most %1 leaves").arg(MAX_SIGNIFICANCE_LEAVES));
+    }
+}
+
+void BenchmarkSuite::Time(const QString& shape, uint leaves, const QString& name,
+                          std::function<void()> setup, std::function<void()> operation, std::function<void()> teardown)
+{
+    std::vector<double> times;
+    for(uint i = 0; i < m_options.repeats; ++i)
+    {
+        setup();
+
+        QElapsedTimer timer;
+        timer.start();
+        operation();
+        times.push_back(timer.nsecsElapsed() * 1e-6);
+
+        teardown();
+    }
+
+    BenchmarkResult result;
+    result.shape = shape;
+    result.leaves = leaves;
+    result.operation = name;
+    result.repeats = times.size();
+    result.minMs = result.medianMs = result.meanMs = 0;
+    if(!times.empty())
+    {
+        std::sort(times.begin(), times.end());
+        result.minMs = times.front();
+        result.medianMs = times[times.size() / 2];
+        result.meanMs = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+    }
+    m_results.push_back(result);
+
+    qDebug().noquote() << QString("  %1 %2 %3: %4 ms (min %5 ms)")
+                          .arg(shape).arg(leaves).arg(name).arg(result.medianMs, 0, 'f', 3).arg(result.minMs, 0, 'f', 3);
+}
+
+void BenchmarkSuite::Skip(const QString& shape, uint leaves, const QString& name, const QString& reason)
+{
+    BenchmarkResult result;
+    result.shape = shape;
+    result.leaves = leaves;
+    result.operation = name;
+    result.repeats = 0;
+    result.minMs = result.medianMs = result.meanMs = 0;
+    result.skipped = reason;
+    m_results.push_back(result);
+
+    qDebug().noquote() << QString("  %1 %2 %3: skipped (%4)").arg(shape).arg(leaves).arg(name).arg(reason);
+}
+
+bool BenchmarkSuite::WriteJson(const QString& filename) const
+{
+    QJsonArray results;
+    for(const BenchmarkResult& result : m_results)
+    {
+        QJsonObject entry;
+        entry["shape"] = result.shape;
+        entry["leaves"] = double(result.leaves);
+        entry["operation"] = result.operation;
+        entry["repeats"] = int(result.repeats);
+        if(result.skipped.isEmpty())
+        {
+            entry["min_ms"] = result.minMs;
+            entry["median_ms"] = result.medianMs;
+            entry["mean_ms"] = result.meanMs;
+        }
+        else
+        {
+            entry["skipped"] = result.skipped;
+        }
+
+        for(std::map<QString, double>::const_iterator it = result.values.begin(); it != result.values.end(); ++it)
+            entry[it->first] = it->second;
+
+        results.append(entry);
+    }
+
+    QJsonObject root;
+    root["format"] = QString("pygmy-benchmarks");
+    root["version"] = 1;
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["qt"] = QString(qVersion());
+    root["seed"] = double(m_options.seed);
+    root["repeats"] = int(m_options.repeats);
+    root["results"] = results;
+
+    QFile output(filename);
+    if(!output.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    output.write(QJsonDocument(root).toJson());
+    output.close();
+
+    return true;
+}
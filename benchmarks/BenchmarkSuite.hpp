@@ -0,0 +1,129 @@
+#ifndef BENCHMARKSUITE_HPP
+#define BENCHMARKSUITE_HPP
+
+#include "SyntheticTrees.hpp"
+
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace pygmy
+{
+
+/** Timing of a single operation on a single synthetic tree. */
+typedef struct sBENCHMARK_RESULT
+{
+    /** Shape of tree (e.g., balanced, yule). */
+    QString shape;
+
+    /** Number of leaves in tree. */
+    uint leaves;
+
+    /** Name of timed operation (e.g., NewickIO::Read). */
+    QString operation;
+
+    /** Number of timed repetitions. */
+    uint repeats;
+
+    /** Fastest, median and mean wall-clock time of all repetitions (in milliseconds). */
+    double minMs, medianMs, meanMs;
+
+    /** Reason the operation was not timed. Empty if the operation was timed. */
+    QString skipped;
+
+    /** Other figures reported by the operation (e.g., the p-value of a significance test), indexed by name. */
+    std::map<QString, double> values;
+} BenchmarkResult;
+
+/**
+ * @brief Time core tree operations on synthetic trees of increasing size.
+ *
+ * Every operation is run on a freshly prepared input so destructive operations
+ * (e.g., CollapseNodes) are not timed on an already modified tree. Only the
+ * operation itself is timed, not the preparation of its input.
+ */
+class BenchmarkSuite
+{
+public:
+    /** Parameters controlling which trees are generated and how often operations are repeated. */
+    typedef struct sOPTIONS
+    {
+        sOPTIONS(): repeats(3), seed(1), maxDepth(20000), labels(true) {}
+
+        /** Tree shapes to benchmark. */
+        QStringList shapes;
+
+        /** Number of leaves of the generated trees. */
+        std::vector<uint> sizes;
+
+        /** Number of timed repetitions of each operation. */
+        uint repeats;
+
+        /** Seed for the random tree generators. */
+        uint seed;
+
+        /** Trees deeper than this are skipped since several operations recurse once per level. */
+        uint maxDepth;
+
+        /** Flag indicating if label bounding boxes can be calculated (requires a current GL context). */
+        bool labels;
+
+        /** Directory used for temporary Newick files. */
+        QString tempDir;
+    } Options;
+
+public:
+    /**
+     * @brief Constructor.
+     * @param options Parameters of the benchmark run.
+     */
+    BenchmarkSuite(const Options& options): m_options(options), m_generator(options.seed) {}
+
+    /** Run all benchmarks. Progress is reported on stderr. */
+    void Run();
+
+    /** Get results of all benchmarks run so far. */
+    const std::vector<BenchmarkResult>& GetResults() const { return m_results; }
+
+    /**
+     * @brief Write results to a JSON file.
+     * @param filename File to write results to.
+     * @return True if the file was written successfully, else false.
+     */
+    bool WriteJson(const QString& filename) const;
+
+protected:
+    /** Run all benchmarks on a single tree. */
+    void RunTree(const QString& shape, uint leaves);
+
+    /**
+     * @brief Time an operation.
+     * @param shape Shape of tree the operation is run on.
+     * @param leaves Number of leaves in tree the operation is run on.
+     * @param name Name of operation.
+     * @param setup Prepare input of operation. Not timed.
+     * @param operation Operation to time.
+     * @param teardown Release input of operation. Not timed.
+     */
+    void Time(const QString& shape, uint leaves, const QString& name,
+              std::function<void()> setup, std::function<void()> operation, std::function<void()> teardown);
+
+    /** Record that an operation was not timed. */
+    void Skip(const QString& shape, uint leaves, const QString& name, const QString& reason);
+
+protected:
+    /** Parameters of benchmark run. */
+    Options m_options;
+
+    /** Generator of synthetic trees. */
+    SyntheticTrees m_generator;
+
+    /** Results of all benchmarks. */
+    std::vector<BenchmarkResult> m_results;
+};
+
+}
+
+#endif // BENCHMARKSUITE_HPP
@@ -0,0 +1,252 @@
+#include "SyntheticTrees.hpp"
+
+#include <stack>
+#include <utility>
+
+using namespace pygmy;
+using namespace utils;
+
+std::set<QString> SyntheticTrees::MetadataCategories()
+{
+    std::set<QString> categories;
+    categories.insert("A");
+    categories.insert("B");
+    categories.insert("C");
+    categories.insert("D");
+    return categories;
+}
+
+uint SyntheticTrees::ExpectedDepth(const QString& shape, uint leaves)
+{
+    if(shape == "caterpillar")
+        return leaves - 1;
+
+    if(shape == "balanced")
+    {
+        uint depth = 0;
+        while((1u << depth) < leaves && depth < 31)
+            depth++;
+        return depth;
+    }
+
+    return 0;
+}
+
+Tree<NodePhylo>::Ptr SyntheticTrees::Generate(const QString& shape, uint leaves)
+{
+    Tree<NodePhylo>::Ptr tree;
+    if(shape == "balanced")
+        tree = Balanced(leaves);
+    else if(shape == "caterpillar")
+        tree = Caterpillar(leaves);
+    else if(shape == "yule")
+        tree = Yule(leaves);
+    else if(shape == "coalescent")
+        tree = Coalescent(leaves);
+
+    if(tree)
+        tree->CalculateStatistics();
+
+    return tree;
+}
+
+Tree<NodePhylo>::Ptr SyntheticTrees::Balanced(uint leaves)
+{
+    uint id = 0;
+    NodePhylo* root = new NodePhylo(id++);
+    root->SetDistanceToParent(0.0f);
+
+    // split the leaves of each subtree as evenly as possible between two children
+    std::stack< std::pair<NodePhylo*, uint> > stack;
+    stack.push(std::make_pair(root, leaves));
+    while(!stack.empty())
+    {
+        NodePhylo* node = stack.top().first;
+        uint count = stack.top().second;
+        stack.pop();
+
+        if(count < 2)
+            continue;
+
+        NodePhylo* left = new NodePhylo(id++);
+        NodePhylo* right = new NodePhylo(id++);
+        left->SetDistanceToParent(1.0f);
+        right->SetDistanceToParent(1.0f);
+        node->AddChild(left);
+        node->AddChild(right);
+
+        stack.push(std::make_pair(right, count / 2));
+        stack.push(std::make_pair(left, count - count / 2));
+    }
+
+    Tree<NodePhylo>::Ptr tree(new Tree<NodePhylo>(root));
+    tree->SetName(QString("balanced_%1").arg(leaves));
+    Annotate(tree);
+    return tree;
+}
+
+Tree<NodePhylo>::Ptr SyntheticTrees::Caterpillar(uint leaves)
+{
+    uint id = 0;
+    NodePhylo* root = new NodePhylo(id++);
+    root->SetDistanceToParent(0.0f);
+
+    // each internal node has one leaf child and one internal child, except the last
+    NodePhylo* spine = root;
+    for(uint i = 0; i < leaves - 1; ++i)
+    {
+        NodePhylo* leaf = new NodePhylo(id++);
+        leaf->SetDistanceToParent(float(leaves - i - 1));
+        spine->AddChild(leaf);
+
+        NodePhylo* next = new NodePhylo(id++);
+        next->SetDistanceToParent(1.0f);
+        spine->AddChild(next);
+
+        spine = next;
+    }
+
+    Tree<NodePhylo>::Ptr tree(new Tree<NodePhylo>(root));
+    tree->SetName(QString("caterpillar_%1").arg(leaves));
+    Annotate(tree);
+    return tree;
+}
+
+Tree<NodePhylo>::Ptr SyntheticTrees::Yule(uint leaves)
+{
+    uint id = 0;
+    NodePhylo* root = new NodePhylo(id++);
+    root->SetDistanceToParent(0.0f);
+
+    // birth time of each node indexed by id; branch lengths are assigned once a
+    // lineage splits (or the process stops) so the cost is linear in tree size
+    std::vector<double> birthTime;
+    birthTime.reserve(2*leaves);
+    birthTime.push_back(0.0);
+
+    std::vector<NodePhylo*> lineages;
+    lineages.reserve(leaves);
+    lineages.push_back(root);
+
+    double time = 0.0;
+    while(lineages.size() < leaves)
+    {
+        std::exponential_distribution<double> waitingTime(double(lineages.size()));
+        time += waitingTime(m_rng);
+
+        std::uniform_int_distribution<size_t> pick(0, lineages.size()-1);
+        size_t index = pick(m_rng);
+        NodePhylo* parent = lineages[index];
+        if(!parent->IsRoot())
+            parent->SetDistanceToParent(float(time - birthTime[parent->GetId()]));
+
+        NodePhylo* left = new NodePhylo(id++);
+        NodePhylo* right = new NodePhylo(id++);
+        parent->AddChild(left);
+        parent->AddChild(right);
+        birthTime.push_back(time);
+        birthTime.push_back(time);
+
+        lineages[index] = left;
+        lineages.push_back(right);
+    }
+
+    // extend all extant lineages to the present
+    std::exponential_distribution<double> waitingTime(double(lineages.size()));
+    time += waitingTime(m_rng);
+    for(NodePhylo* leaf : lineages)
+        leaf->SetDistanceToParent(float(time - birthTime[leaf->GetId()]));
+
+    Tree<NodePhylo>::Ptr tree(new Tree<NodePhylo>(root));
+    tree->SetName(QString("yule_%1").arg(leaves));
+    Annotate(tree);
+    return tree;
+}
+
+Tree<NodePhylo>::Ptr SyntheticTrees::Coalescent(uint leaves)
+{
+    uint id = 0;
+
+    // height (time before present) of each node indexed by id
+    std::vector<double> height;
+    height.reserve(2*leaves);
+
+    std::vector<NodePhylo*> lineages;
+    lineages.reserve(leaves);
+    for(uint i = 0; i < leaves; ++i)
+    {
+        lineages.push_back(new NodePhylo(id++));
+        height.push_back(0.0);
+    }
+
+    double time = 0.0;
+    while(lineages.size() > 1)
+    {
+        double k = double(lineages.size());
+        std::exponential_distribution<double> waitingTime(0.5*k*(k-1));
+        time += waitingTime(m_rng);
+
+        // pick two distinct lineages and merge them
+        std::uniform_int_distribution<size_t> pickFirst(0, lineages.size()-1);
+        size_t first = pickFirst(m_rng);
+        std::swap(lineages[first], lineages.back());
+        NodePhylo* a = lineages.back();
+        lineages.pop_back();
+
+        std::uniform_int_distribution<size_t> pickSecond(0, lineages.size()-1);
+        size_t second = pickSecond(m_rng);
+        NodePhylo* b = lineages[second];
+
+        NodePhylo* parent = new NodePhylo(id++);
+        height.push_back(time);
+        a->SetDistanceToParent(float(time - height[a->GetId()]));
+        b->SetDistanceToParent(float(time - height[b->GetId()]));
+        parent->AddChild(a);
+        parent->AddChild(b);
+
+        lineages[second] = parent;
+    }
+
+    NodePhylo* root = lineages.front();
+    root->SetDistanceToParent(0.0f);
+
+    Tree<NodePhylo>::Ptr tree(new Tree<NodePhylo>(root));
+    tree->SetName(QString("coalescent_%1").arg(leaves));
+    Annotate(tree);
+    return tree;
+}
+
+void SyntheticTrees::Annotate(Tree<NodePhylo>::Ptr tree)
+{
+    std::set<QString> categorySet = MetadataCategories();
+    std::vector<QString> categories(categorySet.begin(), categorySet.end());
+    std::uniform_int_distribution<int> pickCategory(0, int(categories.size())-1);
+    std::uniform_int_distribution<int> pickBootstrap(0, 100);
+
+    // pre-order traversal so leaf names follow the order they will be drawn in
+    uint leafIndex = 0;
+    std::stack<NodePhylo*> stack;
+    stack.push(tree->GetRootNode());
+    while(!stack.empty())
+    {
+        NodePhylo* node = stack.top();
+        stack.pop();
+
+        if(node->IsLeaf())
+        {
+            node->SetName(QString("T%1").arg(leafIndex++));
+
+            std::map<QString, QString> metadata;
+            metadata[MetadataField()] = categories[pickCategory(m_rng)];
+            node->SetMetadata(metadata);
+        }
+        else
+        {
+            if(!node->IsRoot())
+                node->SetBootstrapToParent(pickBootstrap(m_rng));
+
+            for(int i = int(node->GetNumberOfChildren())-1; i >= 0; --i)
+                stack.push(node->GetChild(i));
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef SYNTHETICTREES_HPP
+#define SYNTHETICTREES_HPP
+
+#include "../src/core/NodePhylo.hpp"
+#include "../src/utils/Tree.hpp"
+
+#include <QString>
+#include <QStringList>
+#include <random>
+
+namespace pygmy
+{
+
+/**
+ * @brief Generate synthetic trees of a given shape and size.
+ *
+ * All generators are iterative so trees with millions of leaves can be built
+ * without exhausting the stack. Leaves are named "T<index>", internal nodes carry
+ * a bootstrap value in [0, 100] and every leaf has a categorical metadata field
+ * (see MetadataField()) so that parsimony and metadata labels can be exercised.
+ */
+class SyntheticTrees
+{
+public:
+    /**
+     * @brief Constructor.
+     * @param seed Seed for the random number generator.
+     */
+    SyntheticTrees(uint seed = 1) : m_rng(seed) {}
+
+    /** Names of all supported tree shapes. */
+    static QStringList Shapes() { return QStringList() << "balanced" << "caterpillar" << "yule" << "coalescent"; }
+
+    /** Name of the categorical metadata field assigned to leaves. */
+    static QString MetadataField() { return "Group"; }
+
+    /** Categories assigned to the metadata field of leaves. */
+    static std::set<QString> MetadataCategories();
+
+    /**
+     * @brief Depth of the deepest leaf for a tree of the given shape.
+     * @param shape Shape of tree.
+     * @param leaves Number of leaves in tree.
+     * @return Depth of the tree, or 0 if it is only known after generation.
+     */
+    static uint ExpectedDepth(const QString& shape, uint leaves);
+
+    /**
+     * @brief Generate a tree.
+     * @param shape One of the names returned by Shapes().
+     * @param leaves Number of leaves in tree (must be at least 2).
+     * @return Generated tree with statistics calculated, or a null pointer if the shape is unknown.
+     */
+    utils::Tree<NodePhylo>::Ptr Generate(const QString& shape, uint leaves);
+
+    // Note: the generators below do not calculate tree statistics. Many tree operations
+    // recurse once per level, so callers should check ExpectedDepth() before building
+    // very deep (e.g., caterpillar) trees.
+
+    /** Perfectly balanced bifurcating tree with unit branch lengths. */
+    utils::Tree<NodePhylo>::Ptr Balanced(uint leaves);
+
+    /** Maximally unbalanced (ladder) tree with unit branch lengths. */
+    utils::Tree<NodePhylo>::Ptr Caterpillar(uint leaves);
+
+    /** Random tree under a pure-birth (Yule) process. */
+    utils::Tree<NodePhylo>::Ptr Yule(uint leaves);
+
+    /** Random tree under the Kingman coalescent. */
+    utils::Tree<NodePhylo>::Ptr Coalescent(uint leaves);
+
+protected:
+    /** Assign names, bootstrap values and metadata to all nodes of a newly built tree. */
+    void Annotate(utils::Tree<NodePhylo>::Ptr tree);
+
+protected:
+    /** Random number generator shared by all generators. */
+    std::mt19937 m_rng;
+};
+
+}
+
+#endif // SYNTHETICTREES_HPP
@@ -0,0 +1,60 @@
+#-------------------------------------------------
+#
+# Benchmarks for core tree operations. Build and run with:
+#
+#   qmake benchmarks.pro && make && ./pygmy-benchmarks --output results.json
+#
+#-------------------------------------------------
+QT       += core gui opengl
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent
+
+TARGET = pygmy-benchmarks
+TEMPLATE = app
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += /usr/local/include /usr/local/include/freetype2
+
+LIBS += -L"/usr/local/lib" -lftgl -lz
+
+SOURCES += \
+    main.cpp \
+    BenchmarkSuite.cpp \
+    SyntheticTrees.cpp \
+    ../src/core/NewickIO.cpp \
+    ../src/core/TreeTokenizer.cpp \
+    ../src/utils/BufferedWriter.cpp \
+    ../src/utils/StreamReader.cpp \
+    ../src/utils/Colour.cpp \
+    ../src/utils/ColourMap.cpp \
+    ../src/utils/ColourMapDiscrete.cpp \
+    ../src/utils/ColourMapContinuous.cpp \
+    ../src/utils/Node.cpp \
+    ../src/utils/Point.cpp \
+    ../src/core/VisualLine.cpp \
+    ../src/core/VisualMarker.cpp \
+    ../src/core/VisualObject.cpp \
+    ../src/core/VisualRect.cpp \
+    ../src/core/VisualTree.cpp \
+    ../src/core/FoldedClades.cpp \
+    ../src/core/HitTestIndex.cpp \
+    ../src/core/PolarLayout.cpp \
+    ../src/utils/Geometry.cpp \
+    ../src/core/TreeEdit.cpp \
+    ../src/core/SplitHash.cpp \
+    ../src/core/LabelCache.cpp \
+    ../src/core/MemoryReport.cpp \
+    ../src/core/SubtreeSorter.cpp \
+    ../src/utils/AlphaNumericSorter.cpp \
+    ../src/glUtils/Font.cpp \
+    ../src/core/State.cpp \
+    ../src/core/MetadataInfo.cpp \
+    ../src/core/OptimizeLeafOrder.cpp \
+    ../src/utils/ParsimonyCalculator.cpp
+
+HEADERS += \
+    BenchmarkSuite.hpp \
+    SyntheticTrees.hpp
+
+RESOURCES += ../resources.qrc
@@ -0,0 +1,102 @@
+#include <QCommandLineParser>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QTemporaryDir>
+#include <QtDebug>
+
+#include "BenchmarkSuite.hpp"
+#include "../src/core/State.hpp"
+
+using namespace pygmy;
+
+/**
+ * Benchmark core tree operations on synthetic trees and write the timings to a
+ * JSON file so results can be compared between releases:
+ *
+ *   pygmy-benchmarks --sizes 1000,100000 --shapes yule,balanced --output results.json
+ */
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark core tree operations on synthetic trees.");
+    parser.addHelpOption();
+
+    QCommandLineOption sizesOption("sizes", "Comma separated number of leaves of the generated trees.",
+                                   "sizes", "1000,10000,100000,1000000");
+    QCommandLineOption shapesOption("shapes", "Comma separated tree shapes (" + SyntheticTrees::Shapes().join(", ") + ").",
+                                    "shapes", SyntheticTrees::Shapes().join(","));
+    QCommandLineOption repeatOption("repeat", "Number of timed repetitions of each operation.", "count", "3");
+    QCommandLineOption seedOption("seed", "Seed for the random tree generators.", "seed", "1");
+    QCommandLineOption depthOption("max-depth", "Skip trees deeper than this (e.g., large caterpillar trees).", "depth", "20000");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "JSON file to write results to.", "file", "benchmarks.json");
+    parser.addOption(sizesOption);
+    parser.addOption(shapesOption);
+    parser.addOption(repeatOption);
+    parser.addOption(seedOption);
+    parser.addOption(depthOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    BenchmarkSuite::Options options;
+    options.repeats = parser.value(repeatOption).toUInt();
+    options.seed = parser.value(seedOption).toUInt();
+    options.maxDepth = parser.value(depthOption).toUInt();
+
+    for(const QString& size : parser.value(sizesOption).split(',', QString::SkipEmptyParts))
+    {
+        bool ok;
+        uint leaves = size.toUInt(&ok);
+        if(!ok || leaves < 2)
+        {
+            qCritical().noquote() << "Invalid tree size:" << size;
+            return 1;
+        }
+        options.sizes.push_back(leaves);
+    }
+
+    for(const QString& shape : parser.value(shapesOption).split(',', QString::SkipEmptyParts))
+    {
+        if(!SyntheticTrees::Shapes().contains(shape))
+        {
+            qCritical().noquote() << "Unknown tree shape:" << shape;
+            return 1;
+        }
+        options.shapes.append(shape);
+    }
+
+    // label bounding boxes are calculated with FTGL texture fonts which require a GL context
+    QOffscreenSurface surface;
+    surface.create();
+    QOpenGLContext context;
+    options.labels = context.create() && context.makeCurrent(&surface);
+    if(!options.labels)
+        qWarning() << "Failed to create an OpenGL context. Label bounding boxes will not be benchmarked.";
+
+    State::Inst().Load();
+    State::Inst().SetShowLeafLabels(true);
+    State::Inst().SetShowMetadataLabels(false);
+
+    QTemporaryDir tempDir;
+    if(!tempDir.isValid())
+    {
+        qCritical() << "Failed to create a temporary directory.";
+        return 1;
+    }
+    options.tempDir = tempDir.path();
+
+    BenchmarkSuite suite(options);
+    suite.Run();
+
+    QString output = parser.value(outputOption);
+    if(!suite.WriteJson(output))
+    {
+        qCritical().noquote() << "Failed to write results to" << output;
+        return 1;
+    }
+
+    qDebug().noquote() << "Results written to" << output;
+    return 0;
+}
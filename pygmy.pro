@@ -5,7 +5,7 @@
 #-------------------------------------------------
 QT       += core gui opengl
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 TARGET = pygmy
 TEMPLATE = app
@@ -18,7 +18,7 @@ ICON = resources/images/pygmy.icns
 
 INCLUDEPATH += /usr/local/include /usr/local/include/freetype2
 
-LIBS += -L"/usr/local/lib" -lftgl
+LIBS += -L"/usr/local/lib" -lftgl -lz
 
 SOURCES +=\
     src/gui/GlWidget.cpp \
@@ -26,6 +26,10 @@ SOURCES +=\
     src/gui/MainWindow.cpp \
     src/core/NewickIO.cpp \
     src/utils/Colour.cpp \
+    src/utils/ColourMap.cpp \
+    src/utils/ColourMapContinuous.cpp \
+    src/utils/ColourMapDiscrete.cpp \
+    src/utils/ColourMapManager.cpp \
     src/utils/Node.cpp \
     src/utils/Point.cpp \
     src/core/VisualLine.cpp \
@@ -43,7 +47,35 @@ SOURCES +=\
     src/gui/SimpleSearch.cpp \
     #src/gui/PreferencesDialog.cpp
     src/core/MetadataIO.cpp \
-    src/gui/treeoptions.cpp
+    src/gui/treeoptions.cpp \
+    src/utils/ImageStreamWriter.cpp \
+    src/core/ImageExporter.cpp \
+    src/utils/BufferedWriter.cpp \
+    src/core/VectorExporter.cpp \
+    src/core/SnapshotIO.cpp \
+    src/utils/StreamReader.cpp \
+    src/core/TreeTokenizer.cpp \
+    src/core/NexusIO.cpp \
+    src/core/PhyloXmlIO.cpp \
+    src/core/TreeReader.cpp \
+    src/core/SplitHash.cpp \
+    src/core/TreeCollection.cpp \
+    src/core/CladeFrequencies.cpp \
+    src/core/ConsensusTree.cpp \
+    src/core/TreeComparison.cpp \
+    src/core/OptimizeLeafOrder.cpp \
+    src/gui/TanglegramWidget.cpp \
+    src/core/FoldedClades.cpp \
+    src/core/HitTestIndex.cpp \
+    src/core/OverviewRaster.cpp \
+    src/core/PolarLayout.cpp \
+    src/utils/Geometry.cpp \
+    src/core/TreeEdit.cpp \
+    src/core/LabelCache.cpp \
+    src/core/MemoryReport.cpp \
+    src/core/SubtreeSorter.cpp \
+    src/utils/AlphaNumericSorter.cpp \
+    src/core/CommandLineTool.cpp
 
 HEADERS  += \
     src/gui/MainWindow.hpp \
@@ -53,6 +85,10 @@ HEADERS  += \
     src/utils/TreeTools.hpp \
     src/core/NodePhylo.hpp \
     src/utils/Colour.hpp \
+    src/utils/ColourMap.hpp \
+    src/utils/ColourMapContinuous.hpp \
+    src/utils/ColourMapDiscrete.hpp \
+    src/utils/ColourMapManager.hpp \
     src/utils/Node.hpp \
     src/utils/Point.hpp \
     src/core/DataTypes.hpp \
@@ -76,7 +112,37 @@ HEADERS  += \
     src/core/TextSearch.hpp \
     #src/gui/PreferencesDialog.hpp
     src/core/MetadataIO.hpp \
-    src/gui/treeoptions.hpp
+    src/gui/treeoptions.hpp \
+    src/core/RenderStats.hpp \
+    src/utils/ImageStreamWriter.hpp \
+    src/core/ImageExporter.hpp \
+    src/utils/BufferedWriter.hpp \
+    src/core/VectorExporter.hpp \
+    src/core/SnapshotIO.hpp \
+    src/utils/StreamReader.hpp \
+    src/core/TreeTokenizer.hpp \
+    src/core/NexusIO.hpp \
+    src/core/PhyloXmlIO.hpp \
+    src/core/TreeReader.hpp \
+    src/core/SplitHash.hpp \
+    src/core/TreeCollection.hpp \
+    src/core/CladeFrequencies.hpp \
+    src/core/ConsensusTree.hpp \
+    src/core/TreeComparison.hpp \
+    src/core/OptimizeLeafOrder.hpp \
+    src/gui/TanglegramWidget.hpp \
+    src/core/FoldedClades.hpp \
+    src/core/HitTestIndex.hpp \
+    src/core/OverviewRaster.hpp \
+    src/core/PolarLayout.hpp \
+    src/utils/Geometry.hpp \
+    src/utils/Line.hpp \
+    src/core/TreeEdit.hpp \
+    src/core/LabelCache.hpp \
+    src/core/MemoryReport.hpp \
+    src/core/SubtreeSorter.hpp \
+    src/utils/AlphaNumericSorter.hpp \
+    src/core/CommandLineTool.hpp
 
 RESOURCES += resources.qrc
 
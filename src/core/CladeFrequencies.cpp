@@ -0,0 +1,251 @@
+#include "CladeFrequencies.hpp"
+
+#include "../core/TreeCollection.hpp"
+
+#include <QFuture>
+#include <QMutex>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <functional>
+
+using namespace pygmy;
+using namespace utils;
+
+const char* CladeFrequencies::FIELD = "Clade Frequency";
+
+namespace
+{
+    /** Clades counted by all threads. */
+    struct CladeCounts
+    {
+        CladeCounts(const TreeCollection* _collection, const SplitHash* _splitHash, bool _bRooted, uint _maxClades)
+            : collection(_collection), splitHash(_splitHash), bRooted(_bRooted), maxClades(_maxClades),
+              numTrees(0), numSkipped(0), bExact(true) {}
+
+        const TreeCollection* collection;
+        const SplitHash* splitHash;
+        bool bRooted;
+
+        /** Maximum number of counters kept, or 0 to count all clades. */
+        uint maxClades;
+
+        QMutex mutex;
+        QHash<SplitKey, uint> counts;
+        uint numTrees;
+        uint numSkipped;
+
+        /** Flag indicating if no counter has been reduced. */
+        bool bExact;
+
+        /** Index of each clade counted in a second, exact pass. */
+        QHash<SplitKey, uint> candidates;
+        std::vector<uint> candidateCounts;
+    };
+
+    /**
+     * Reduce the number of counters to at most maxClades by subtracting the count
+     * of the (maxClades + 1)th most frequent clade from every counter. This
+     * underestimates each count by at most the number of clades counted divided
+     * by maxClades + 1 (Misra-Gries). Returns true if any counter was reduced.
+     */
+    bool Reduce(QHash<SplitKey, uint>& counts, uint maxClades)
+    {
+        if(maxClades == 0 || uint(counts.size()) <= maxClades)
+            return false;
+
+        std::vector<uint> values;
+        values.reserve(counts.size());
+        QHash<SplitKey, uint>::const_iterator cit;
+        for(cit = counts.constBegin(); cit != counts.constEnd(); ++cit)
+            values.push_back(cit.value());
+
+        std::nth_element(values.begin(), values.begin() + maxClades, values.end(), std::greater<uint>());
+        uint decrement = values[maxClades];
+
+        QHash<SplitKey, uint>::iterator it = counts.begin();
+        while(it != counts.end())
+        {
+            if(it.value() <= decrement)
+                it = counts.erase(it);
+            else
+            {
+                it.value() -= decrement;
+                ++it;
+            }
+        }
+
+        return true;
+    }
+
+    void CountClades(CladeCounts* shared, uint begin, uint end)
+    {
+        QHash<SplitKey, uint> counts;
+        uint numTrees = 0;
+        uint numSkipped = 0;
+        bool bExact = true;
+        std::vector<NodePhylo*> nodes;
+        std::vector<SplitKey> keys;
+        for(uint i = begin; i < end; ++i)
+        {
+            Tree<NodePhylo>::Ptr tree = shared->collection->LoadTree(i);
+            if(!tree || !shared->splitHash->GetClades(tree->GetRootNode(), shared->bRooted, nodes, keys))
+            {
+                numSkipped++;
+                continue;
+            }
+
+            foreach(const SplitKey& key, keys)
+                counts[key]++;
+
+            numTrees++;
+
+            // counters are reduced in batches, so at most twice the number of counters kept are held
+            if(shared->maxClades && uint(counts.size()) >= 2*shared->maxClades && Reduce(counts, shared->maxClades))
+                bExact = false;
+        }
+
+        QMutexLocker locker(&shared->mutex);
+
+        QHash<SplitKey, uint>::const_iterator it;
+        for(it = counts.constBegin(); it != counts.constEnd(); ++it)
+            shared->counts[it.key()] += it.value();
+
+        if(shared->maxClades && uint(shared->counts.size()) >= 2*shared->maxClades && Reduce(shared->counts, shared->maxClades))
+            bExact = false;
+
+        shared->numTrees += numTrees;
+        shared->numSkipped += numSkipped;
+        shared->bExact = shared->bExact && bExact;
+    }
+
+    void CountCandidates(CladeCounts* shared, uint begin, uint end)
+    {
+        std::vector<uint> counts(shared->candidateCounts.size(), 0);
+        std::vector<NodePhylo*> nodes;
+        std::vector<SplitKey> keys;
+        for(uint i = begin; i < end; ++i)
+        {
+            Tree<NodePhylo>::Ptr tree = shared->collection->LoadTree(i);
+            if(!tree || !shared->splitHash->GetClades(tree->GetRootNode(), shared->bRooted, nodes, keys))
+                continue;
+
+            foreach(const SplitKey& key, keys)
+            {
+                QHash<SplitKey, uint>::const_iterator it = shared->candidates.constFind(key);
+                if(it != shared->candidates.constEnd())
+                    counts[it.value()]++;
+            }
+        }
+
+        QMutexLocker locker(&shared->mutex);
+        for(uint i = 0; i < counts.size(); ++i)
+            shared->candidateCounts[i] += counts[i];
+    }
+
+    /** Run a function over ranges of trees on the global thread pool. */
+    void RunOverTrees(void (*function)(CladeCounts*, uint, uint), CladeCounts* shared)
+    {
+        // several ranges per thread keep threads busy when trees differ in size
+        uint numTrees = shared->collection->GetNumberOfTrees();
+        uint numRanges = qMin(numTrees, uint(qMax(1, QThread::idealThreadCount())) * 4);
+        std::vector< QFuture<void> > futures;
+        for(uint i = 0; i < numRanges; ++i)
+        {
+            uint begin = uint(quint64(numTrees) * i / numRanges);
+            uint end = uint(quint64(numTrees) * (i + 1) / numRanges);
+            futures.push_back(QtConcurrent::run(function, shared, begin, end));
+        }
+
+        for(uint i = 0; i < futures.size(); ++i)
+            futures[i].waitForFinished();
+    }
+}
+
+bool CladeFrequencies::Calculate(const TreeCollection& collection)
+{
+    m_error.clear();
+    m_counts.clear();
+    m_numTrees = 0;
+    m_numSkipped = 0;
+
+    // taxa are defined by the leaves of the first tree
+    Tree<NodePhylo>::Ptr first = collection.LoadTree(0, &m_error);
+    if(!first)
+        return false;
+
+    if(!m_splitHash.SetTaxa(first->GetLeafNames()))
+    {
+        m_error = "Leaf names must be unique to compare clades between trees.";
+        return false;
+    }
+    first.clear();
+
+    // a tree has fewer than n non-trivial clades, so a clade found in a fraction f of
+    // the trees is found more than (number of clades counted) / (n / f + 1) times
+    uint maxClades = 0;
+    if(m_minFrequency > 0.0f)
+        maxClades = uint(qMin(std::ceil(m_splitHash.GetNumberOfTaxa() / double(m_minFrequency)), double(INT_MAX / 2)));
+
+    CladeCounts shared(&collection, &m_splitHash, m_bRooted, maxClades);
+    RunOverTrees(CountClades, &shared);
+
+    m_numTrees = shared.numTrees;
+    m_numSkipped = shared.numSkipped;
+    if(m_numTrees == 0)
+    {
+        m_error = "None of the trees could be read.";
+        return false;
+    }
+
+    if(!shared.bExact)
+    {
+        // counts are underestimates, but every sufficiently frequent clade has a counter
+        shared.candidates.reserve(shared.counts.size());
+        QHash<SplitKey, uint>::const_iterator it;
+        for(it = shared.counts.constBegin(); it != shared.counts.constEnd(); ++it)
+            shared.candidates.insert(it.key(), uint(shared.candidates.size()));
+        shared.counts.clear();
+
+        shared.candidateCounts.resize(shared.candidates.size(), 0);
+        RunOverTrees(CountCandidates, &shared);
+
+        for(it = shared.candidates.constBegin(); it != shared.candidates.constEnd(); ++it)
+            shared.counts.insert(it.key(), shared.candidateCounts[it.value()]);
+    }
+
+    m_counts.swap(shared.counts);
+    if(m_minFrequency > 0.0f)
+    {
+        QHash<SplitKey, uint>::iterator it = m_counts.begin();
+        while(it != m_counts.end())
+        {
+            if(it.value() < m_minFrequency * m_numTrees)
+                it = m_counts.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    return true;
+}
+
+bool CladeFrequencies::Annotate(Tree<NodePhylo>::Ptr tree) const
+{
+    std::vector<NodePhylo*> nodes;
+    std::vector<SplitKey> keys;
+    if(!m_splitHash.GetClades(tree->GetRootNode(), m_bRooted, nodes, keys))
+        return false;
+
+    for(uint i = 0; i < nodes.size(); ++i)
+    {
+        std::map<QString, QString> metadata = nodes[i]->GetMetadata();
+        metadata[FIELD] = QString::number(GetFrequency(keys[i]), 'f', 2);
+        nodes[i]->SetMetadata(metadata);
+    }
+
+    return true;
+}
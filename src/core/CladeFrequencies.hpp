@@ -0,0 +1,117 @@
+#ifndef _CLADE_FREQUENCIES_HPP_
+#define _CLADE_FREQUENCIES_HPP_
+
+#include "../core/NodePhylo.hpp"
+#include "../core/SplitHash.hpp"
+
+#include "../utils/Tree.hpp"
+
+#include <QHash>
+#include <QString>
+
+namespace pygmy
+{
+
+class TreeCollection;
+
+/**
+ * @brief Frequency of clades across a collection of trees (e.g., bootstrap or posterior support).
+ *
+ * Trees are parsed and their clades counted on a pool of worker threads, each
+ * of which reads a range of trees directly from the file of the collection.
+ * Trees whose leaves differ from those of the first tree are skipped.
+ *
+ * The number of distinct clades grows with the number of trees, so when only
+ * frequent clades are of interest a minimum frequency may be given. Clades are
+ * then counted with the Misra-Gries algorithm, which keeps at most n / f
+ * counters for trees with n leaves and a minimum frequency of f while
+ * guaranteeing that every clade at least this frequent is retained. If
+ * counters had to be discarded, the retained clades are counted exactly in a
+ * second pass over the trees.
+ *
+ * Code example:
+ * @code
+ * CladeFrequencies frequencies;
+ * if(frequencies.Calculate(collection))
+ *     frequencies.Annotate(tree);
+ * @endcode
+ */
+class CladeFrequencies
+{
+public:
+    /** Name of metadata field set by Annotate(). */
+    static const char* FIELD;
+
+public:
+    /**
+     * @brief Constructor.
+     * @param bRooted Flag indicating if clades are compared as rooted clades (true) or unrooted splits (false).
+     * @param minFrequency Clades found in a smaller fraction of trees are not reported. Memory is only bounded if this is positive.
+     */
+    CladeFrequencies(bool bRooted = false, float minFrequency = 0.0f)
+        : m_bRooted(bRooted), m_minFrequency(minFrequency), m_numTrees(0), m_numSkipped(0) {}
+
+    /**
+     * @brief Count clades of all trees in a collection.
+     * @param collection Collection of trees.
+     * @return True if at least one tree was counted, else false.
+     */
+    bool Calculate(const TreeCollection& collection);
+
+    /** Number of trees whose clades were counted. */
+    uint GetNumberOfTrees() const { return m_numTrees; }
+
+    /** Number of trees skipped since they could not be read or have different leaves. */
+    uint GetNumberOfSkippedTrees() const { return m_numSkipped; }
+
+    /** Flag indicating if clades are compared as rooted clades. */
+    bool IsRooted() const { return m_bRooted; }
+
+    /** Number of distinct non-trivial clades. */
+    uint GetNumberOfClades() const { return uint(m_counts.size()); }
+
+    /** Get fraction of trees containing a clade. */
+    float GetFrequency(const SplitKey& key) const { return m_numTrees ? float(m_counts.value(key)) / m_numTrees : 0.0f; }
+
+    /** Get object used to identify clades. */
+    const SplitHash& GetSplitHash() const { return m_splitHash; }
+
+    /** Get the number of trees containing each clade. */
+    const QHash<SplitKey, uint>& GetCounts() const { return m_counts; }
+
+    /**
+     * @brief Set the frequency of the clade of each internal node as metadata (see FIELD).
+     * @param tree Tree to annotate.
+     * @return False if the leaves of the tree differ from those of the collection.
+     */
+    bool Annotate(utils::Tree<NodePhylo>::Ptr tree) const;
+
+    /** Get description of the most recent error. */
+    QString GetError() const { return m_error; }
+
+protected:
+    /** Flag indicating if clades are compared as rooted clades. */
+    bool m_bRooted;
+
+    /** Minimum fraction of trees a reported clade is found in. */
+    float m_minFrequency;
+
+    /** Object used to identify clades. */
+    SplitHash m_splitHash;
+
+    /** Number of trees containing each clade. */
+    QHash<SplitKey, uint> m_counts;
+
+    /** Number of trees counted. */
+    uint m_numTrees;
+
+    /** Number of trees skipped. */
+    uint m_numSkipped;
+
+    /** Description of the most recent error. */
+    QString m_error;
+};
+
+}
+
+#endif
@@ -0,0 +1,379 @@
+#include "CommandLineTool.hpp"
+#include "ConsensusTree.hpp"
+#include "ImageExporter.hpp"
+#include "MemoryReport.hpp"
+#include "NodePhylo.hpp"
+#include "SnapshotIO.hpp"
+#include "State.hpp"
+#include "TreeCollection.hpp"
+#include "TreeReader.hpp"
+#include "VectorExporter.hpp"
+#include "VisualTree.hpp"
+
+#include "../utils/Tree.hpp"
+#include "../utils/TreeTools.hpp"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QtDebug>
+
+using namespace pygmy;
+using namespace utils;
+
+QStringList CommandLineTool::Commands()
+{
+    return QStringList() << "export-image" << "save-snapshot" << "memory-report";
+}
+
+bool CommandLineTool::IsRequested(int argc, char *argv[])
+{
+    QStringList commands = Commands();
+    for(int i = 1; i < argc; ++i)
+    {
+        QString arg = QString::fromLocal8Bit(argv[i]);
+        for(const QString& command : commands)
+        {
+            if(arg == "--" + command || arg.startsWith("--" + command + "="))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+void CommandLineTool::PrepareHeadless()
+{
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")
+            && qEnvironmentVariableIsEmpty("DISPLAY")
+            && qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+#endif
+}
+
+int CommandLineTool::Run(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Pygmy phylogenetic tree viewer. The user interface is shown unless a command is given.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("tree", "Tree file in Newick, NEXUS, PhyloXML or pygmy snapshot format (optionally gzip compressed).");
+
+    QCommandLineOption exportImageOption("export-image", "Render the entire tree to a PNG, TIFF, SVG or PDF image.", "file");
+    QCommandLineOption saveSnapshotOption("save-snapshot", "Save tree with its layout as a pygmy snapshot which opens considerably faster than a Newick file.", "file");
+    QCommandLineOption widthOption("width", "Width of image in pixels.", "pixels", "2000");
+    QCommandLineOption zoomOption("zoom", "Vertical zoom of image. At a zoom of 1 leaf labels just touch each other.", "factor", "1");
+    QCommandLineOption tileHeightOption("tile-height", "Height of the tiles the image is rendered in.", "pixels",
+                                        QString::number(ImageExporter::DEFAULT_TILE_HEIGHT));
+    QCommandLineOption cladeOption("clade", "Export only the clade rooted at the named node (SVG and PDF only).", "name");
+    QCommandLineOption branchStyleOption("branch-style", "Branch style of tree (cladogram, phylogram or equal).", "style", "cladogram");
+    QCommandLineOption layoutOption("layout", "Layout of tree (rectangular, circular or radial). Circular and radial trees are exported as PNG or TIFF images only.", "layout", "rectangular");
+    QCommandLineOption consensusOption("consensus", "Use the consensus of all trees in the file (majority or extended majority-rule).", "type");
+    QCommandLineOption projectOption("project", "Project the tree onto the leaves named in a file, one name per line.", "file");
+    QCommandLineOption memoryReportOption("memory-report", "Write the memory used by each part of the loaded tree as JSON ('-' for standard output).", "file");
+    parser.addOption(exportImageOption);
+    parser.addOption(saveSnapshotOption);
+    parser.addOption(widthOption);
+    parser.addOption(zoomOption);
+    parser.addOption(tileHeightOption);
+    parser.addOption(cladeOption);
+    parser.addOption(branchStyleOption);
+    parser.addOption(layoutOption);
+    parser.addOption(consensusOption);
+    parser.addOption(projectOption);
+    parser.addOption(memoryReportOption);
+    parser.process(arguments);
+
+    if(parser.positionalArguments().size() != 1)
+    {
+        qCritical().noquote() << "A single tree file must be specified.";
+        return 1;
+    }
+
+    bool widthOk, zoomOk, tileHeightOk;
+    uint width = parser.value(widthOption).toUInt(&widthOk);
+    float zoom = parser.value(zoomOption).toFloat(&zoomOk);
+    uint tileHeight = parser.value(tileHeightOption).toUInt(&tileHeightOk);
+    if(!widthOk || !zoomOk || !tileHeightOk || width == 0 || zoom <= 0.0f || tileHeight == 0)
+    {
+        qCritical().noquote() << "Width, zoom and tile height must be positive numbers.";
+        return 1;
+    }
+
+    if(!CreateContext())
+        return 1;
+
+    State::Inst().Load();
+
+    if(!LoadTree(parser.positionalArguments().first(), parser.value(branchStyleOption), parser.value(consensusOption)))
+        return 1;
+
+    if(parser.isSet(projectOption) && !ProjectTree(parser.value(projectOption)))
+        return 1;
+
+    if(!SetLayoutStyle(parser.value(layoutOption)))
+        return 1;
+
+    if(parser.isSet(exportImageOption))
+    {
+        if(!ExportImage(parser.value(exportImageOption), width, zoom, tileHeight, parser.value(cladeOption)))
+            return 1;
+    }
+
+    if(parser.isSet(saveSnapshotOption))
+    {
+        SnapshotIO snapshotIO;
+        if(!snapshotIO.Write(m_visualTree, parser.value(saveSnapshotOption)))
+        {
+            qCritical().noquote() << "Failed to save snapshot:" << snapshotIO.GetError();
+            return 1;
+        }
+    }
+
+    // reported last so caches built while exporting are included
+    if(parser.isSet(memoryReportOption) && !WriteMemoryReport(parser.value(memoryReportOption)))
+        return 1;
+
+    return 0;
+}
+
+bool CommandLineTool::CreateContext()
+{
+    m_context.reset(new QOpenGLContext());
+    if(!m_context->create())
+    {
+        qCritical().noquote() << "Failed to create an OpenGL context.";
+        return false;
+    }
+
+    m_surface.reset(new QOffscreenSurface());
+    m_surface->setFormat(m_context->format());
+    m_surface->create();
+    if(!m_surface->isValid() || !m_context->makeCurrent(m_surface.data()))
+    {
+        qCritical().noquote() << "Failed to make the OpenGL context current.";
+        return false;
+    }
+
+    return true;
+}
+
+bool CommandLineTool::LoadTree(const QString& filename, const QString& branchStyle, const QString& consensus)
+{
+    VisualTree::BRANCH_STYLE style;
+    if(branchStyle == "cladogram")
+        style = VisualTree::CLADOGRAM_BRANCHES;
+    else if(branchStyle == "phylogram")
+        style = VisualTree::PHYLOGRAM_BRANCHES;
+    else if(branchStyle == "equal")
+        style = VisualTree::EQUAL_BRANCHES;
+    else
+    {
+        qCritical().noquote() << "Unknown branch style:" << branchStyle;
+        return false;
+    }
+
+    if(!consensus.isEmpty() && consensus != "majority" && consensus != "extended")
+    {
+        qCritical().noquote() << "Unknown consensus type:" << consensus;
+        return false;
+    }
+
+    if(SnapshotIO::IsSnapshot(filename))
+    {
+        // snapshots store the layout they were saved with, so the branch style is ignored
+        SnapshotIO snapshotIO;
+        if(!snapshotIO.Read(filename, m_visualTree))
+        {
+            qCritical().noquote() << "Failed to read snapshot:" << snapshotIO.GetError();
+            return false;
+        }
+
+        return true;
+    }
+
+    Tree<NodePhylo>::Ptr tree(new Tree<NodePhylo>());
+    if(!consensus.isEmpty())
+    {
+        TreeCollection collection;
+        if(!collection.Open(filename))
+        {
+            qCritical().noquote() << "Failed to read trees:" << collection.GetError();
+            return false;
+        }
+
+        ConsensusTree consensusTree;
+        consensusTree.SetExtended(consensus == "extended");
+        if(!consensusTree.Build(collection, tree))
+        {
+            qCritical().noquote() << "Failed to build consensus tree:" << consensusTree.GetError();
+            return false;
+        }
+
+        // the support of each clade is its bootstrap value
+        State::Inst().SetInternalNodeField("Bootstrap");
+        State::Inst().SetShowInternalLabels(true);
+    }
+    else
+    {
+        TreeReader treeReader;
+        if(!treeReader.Read(tree, filename))
+        {
+            qCritical().noquote() << "Failed to read" << TreeReader::FormatName(treeReader.GetFormat()) << "file:" << treeReader.GetError();
+            return false;
+        }
+    }
+
+    m_visualTree.reset(new VisualTree(tree));
+
+    // annotations read with the tree (e.g., NEXUS comments) are available as metadata
+    MetadataInfoPtr metadataInfo = TreeReader::GetMetadataInfo(tree);
+    if(metadataInfo)
+        m_visualTree->SetMetadataInfo(metadataInfo);
+
+    m_visualTree->SetBranchStyle(style);
+    m_visualTree->Layout();
+
+    // requires the OpenGL context as labels are measured with texture fonts
+    m_visualTree->LabelBoundingBoxes();
+
+    return true;
+}
+
+bool CommandLineTool::SetLayoutStyle(const QString& layout)
+{
+    if(layout == "rectangular")
+        m_visualTree->SetLayoutStyle(VisualTree::RECTANGULAR_LAYOUT);
+    else if(layout == "circular")
+        m_visualTree->SetLayoutStyle(VisualTree::CIRCULAR_LAYOUT);
+    else if(layout == "radial")
+        m_visualTree->SetLayoutStyle(VisualTree::RADIAL_LAYOUT);
+    else
+    {
+        qCritical().noquote() << "Unknown layout:" << layout;
+        return false;
+    }
+
+    return true;
+}
+
+bool CommandLineTool::ProjectTree(const QString& filename)
+{
+    TreeReader treeReader;
+    std::vector<QString> names;
+    if(!treeReader.ReadLeafNames(filename, names))
+    {
+        qCritical().noquote() << treeReader.GetError();
+        return false;
+    }
+
+    uint numNames = uint(names.size());
+    m_visualTree->ProjectTree(names);
+    if(names.size() == numNames)
+    {
+        qCritical().noquote() << "None of the names in" << filename << "are leaves of the tree.";
+        return false;
+    }
+
+    if(!names.empty())
+        qWarning().noquote() << names.size() << "names were not found in the tree.";
+
+    qDebug().noquote() << "Projected tree onto" << m_visualTree->GetTree()->GetNumberOfLeaves() << "leaves.";
+
+    m_visualTree->LabelBoundingBoxes();
+
+    return true;
+}
+
+bool CommandLineTool::WriteMemoryReport(const QString& filename)
+{
+    MemoryReport report;
+    m_visualTree->ReportMemory(report);
+
+    QJsonObject json = report.ToJson();
+    json.insert("leaves", double(m_visualTree->GetTree()->GetNumberOfLeaves()));
+    json.insert("nodes", double(m_visualTree->GetTree()->GetNumberOfNodes()));
+
+    QFile file;
+    bool bOpen;
+    if(filename == "-")
+        bOpen = file.open(stdout, QIODevice::WriteOnly);
+    else
+    {
+        file.setFileName(filename);
+        bOpen = file.open(QIODevice::WriteOnly);
+    }
+
+    if(!bOpen || file.write(QJsonDocument(json).toJson()) < 0)
+    {
+        qCritical().noquote() << "Failed to write memory report to" << filename;
+        return false;
+    }
+
+    return true;
+}
+
+bool CommandLineTool::ExportImage(const QString& filename, uint width, float zoom, uint tileHeight, const QString& clade)
+{
+    if(VectorExporter::FormatFromFilename(filename) != VectorExporter::UNKNOWN_FORMAT)
+        return ExportVector(filename, width, zoom, clade);
+
+    if(!clade.isEmpty())
+    {
+        qCritical().noquote() << "Clades can only be exported as SVG or PDF files.";
+        return false;
+    }
+
+    uint height = ImageExporter::ImageHeight(m_visualTree, width, zoom);
+    qDebug().noquote() << QString("Writing %1 x %2 pixel image to %3").arg(width).arg(height).arg(filename);
+
+    // report progress in 10% steps
+    uint reported = 0;
+    ImageExporter exporter(m_visualTree);
+    bool bSuccess = exporter.Export(filename, width, zoom, tileHeight, [&](uint rows, uint imageHeight) {
+        uint percent = uint(100.0 * rows / imageHeight);
+        if(percent >= reported + 10 || rows == imageHeight)
+        {
+            qDebug().noquote() << QString("  %1%").arg(percent);
+            reported = percent;
+        }
+    });
+
+    if(!bSuccess)
+    {
+        qCritical().noquote() << "Failed to export image:" << exporter.GetError();
+        return false;
+    }
+
+    return true;
+}
+
+bool CommandLineTool::ExportVector(const QString& filename, uint width, float zoom, const QString& clade)
+{
+    NodePhylo* root = NULL;
+    if(!clade.isEmpty())
+    {
+        std::vector<NodePhylo*> nodes = TreeTools<NodePhylo>::SearchNodeWithName(m_visualTree->GetTree()->GetRootNode(), clade);
+        if(nodes.empty())
+        {
+            qCritical().noquote() << "No node named" << clade << "in tree.";
+            return false;
+        }
+
+        root = nodes.front();
+    }
+
+    qDebug().noquote() << QString("Writing %1 pixel wide image to %2").arg(width).arg(filename);
+
+    VectorExporter exporter(m_visualTree);
+    if(!exporter.Export(filename, width, zoom, root))
+    {
+        qCritical().noquote() << "Failed to export image:" << exporter.GetError();
+        return false;
+    }
+
+    return true;
+}
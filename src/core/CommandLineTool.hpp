@@ -0,0 +1,92 @@
+#ifndef _COMMAND_LINE_TOOL_HPP_
+#define _COMMAND_LINE_TOOL_HPP_
+
+#include "../core/DataTypes.hpp"
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QScopedPointer>
+#include <QStringList>
+
+namespace pygmy
+{
+
+/**
+ * @brief Perform operations on a tree from the command line without showing the user interface.
+ *
+ * Pygmy runs as a command line tool whenever one of the options listed by
+ * Commands() is given, e.g.:
+ *
+ *   pygmy --export-image tree.png --width 3000 tree.tre
+ *   pygmy --export-image clade.svg --clade Bacteroidetes tree.tre
+ *   pygmy --save-snapshot tree.pygmy tree.tre
+ *   pygmy --export-image consensus.pdf --consensus majority bootstrap.trees
+ *   pygmy --export-image subset.png --project names.txt tree.tre
+ *   pygmy --memory-report memory.json tree.tre
+ *
+ * Rendering is performed in an off-screen OpenGL context. On X11 systems without
+ * a display the 'offscreen' platform plugin is selected so no window system is needed.
+ */
+class CommandLineTool
+{
+public:
+    /** Constructor. */
+    CommandLineTool() {}
+
+    /** Get options which request a command line operation. */
+    static QStringList Commands();
+
+    /**
+     * @brief Check if a command line operation has been requested.
+     * @param argc Number of command line arguments.
+     * @param argv Command line arguments.
+     * @return True if pygmy should run without its user interface.
+     */
+    static bool IsRequested(int argc, char *argv[]);
+
+    /** Select a platform plugin which does not require a display when none is available. Must be called before the application object is created. */
+    static void PrepareHeadless();
+
+    /**
+     * @brief Perform the requested operation.
+     * @param arguments Command line arguments.
+     * @return Exit code of application.
+     */
+    int Run(const QStringList& arguments);
+
+protected:
+    /** Create an off-screen OpenGL context and make it current. */
+    bool CreateContext();
+
+    /** Read tree, or build the consensus of all trees in the file, and prepare it for rendering. */
+    bool LoadTree(const QString& filename, const QString& branchStyle, const QString& consensus);
+
+    /** Draw tree in rows or about a centre. */
+    bool SetLayoutStyle(const QString& layout);
+
+    /** Project tree onto the leaves named in a file. */
+    bool ProjectTree(const QString& filename);
+
+    /** Write the memory used by the tree as JSON to a file, or to standard output if the filename is '-'. */
+    bool WriteMemoryReport(const QString& filename);
+
+    /** Render tree to an image file. A clade may only be given for SVG and PDF files. */
+    bool ExportImage(const QString& filename, uint width, float zoom, uint tileHeight, const QString& clade);
+
+    /** Write tree, or the named clade, to an SVG or PDF file. */
+    bool ExportVector(const QString& filename, uint width, float zoom, const QString& clade);
+
+protected:
+    /** Surface used to make the OpenGL context current. */
+    QScopedPointer<QOffscreenSurface> m_surface;
+
+    /** OpenGL context used for rendering. */
+    QScopedPointer<QOpenGLContext> m_context;
+
+    /** Tree operations are performed on. */
+    VisualTreePtr m_visualTree;
+};
+
+}
+
+#endif
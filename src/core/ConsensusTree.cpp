@@ -0,0 +1,414 @@
+#include "ConsensusTree.hpp"
+
+#include "../core/CladeFrequencies.hpp"
+#include "../core/SplitHash.hpp"
+#include "../core/TreeCollection.hpp"
+
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <climits>
+
+using namespace pygmy;
+using namespace utils;
+
+namespace
+{
+    /**
+     * Information gathered over all trees for each item of the consensus tree. Items
+     * are the taxa, followed by the clades above the threshold, followed by the
+     * clades which may be added to an extended consensus.
+     */
+    struct ConsensusItems
+    {
+        ConsensusItems(const TreeCollection* _collection, const SplitHash* _splitHash, bool _bRooted)
+            : collection(_collection), splitHash(_splitHash), bRooted(_bRooted), numAccepted(0) {}
+
+        const TreeCollection* collection;
+        const SplitHash* splitHash;
+        bool bRooted;
+
+        /** Index of the item of each clade. */
+        QHash<SplitKey, uint> clades;
+
+        /** Number of taxa and clades above the threshold. */
+        uint numAccepted;
+
+        QMutex mutex;
+
+        /** Smallest clade above the threshold found above an item, or -1 if there is none. */
+        std::vector<int> parents;
+        std::vector<uint> parentSizes;
+
+        /** Number of leaves of each item. */
+        std::vector<uint> sizes;
+
+        /** Sum and number of branch lengths of each item. */
+        std::vector<double> lengths;
+        std::vector<uint> numLengths;
+
+        /** First tree containing each item. */
+        std::vector<uint> firstTrees;
+    };
+
+    void GatherItems(ConsensusItems* shared, uint begin, uint end)
+    {
+        uint numItems = uint(shared->sizes.size());
+        std::vector<int> parents(numItems, -1);
+        std::vector<uint> parentSizes(numItems, UINT_MAX);
+        std::vector<uint> sizes(numItems, 0);
+        std::vector<double> lengths(numItems, 0.0);
+        std::vector<uint> numLengths(numItems, 0);
+        std::vector<uint> firstTrees(numItems, UINT_MAX);
+
+        std::vector<SplitHash::Clade> clades;
+        std::vector<int> items;
+        std::vector<int> nearest;
+        for(uint t = begin; t < end; ++t)
+        {
+            Tree<NodePhylo>::Ptr tree = shared->collection->LoadTree(t);
+            if(!tree || !shared->splitHash->GetCladeTree(tree->GetRootNode(), shared->bRooted, clades))
+                continue;
+
+            // the largest clade of an unrooted tree is defined by the branch to the first taxon
+            items.resize(clades.size());
+            for(uint i = 0; i < clades.size(); ++i)
+            {
+                const SplitHash::Clade& clade = clades[i];
+                if(clade.taxon >= 0)
+                    items[i] = clade.taxon;
+                else if(clade.parent == -1)
+                    items[i] = shared->bRooted ? -1 : 0;
+                else
+                    items[i] = int(shared->clades.value(clade.key, UINT_MAX));
+            }
+
+            // clades containing a clade are found in reverse post-order
+            nearest.resize(clades.size());
+            for(int i = int(clades.size()) - 1; i >= 0; --i)
+            {
+                const SplitHash::Clade& clade = clades[i];
+                int parent = clade.parent;
+                if(parent == -1 || clades[parent].parent == -1)
+                    nearest[i] = -1;
+                else if(items[parent] >= 0 && uint(items[parent]) < shared->numAccepted)
+                    nearest[i] = parent;
+                else
+                    nearest[i] = nearest[parent];
+
+                int item = items[i];
+                if(item < 0)
+                    continue;
+
+                sizes[item] = clade.numLeaves;
+
+                if(clade.length != NodePhylo::NO_DISTANCE)
+                {
+                    lengths[item] += clade.length;
+                    numLengths[item]++;
+                }
+
+                firstTrees[item] = qMin(firstTrees[item], t);
+
+                if(clade.parent == -1 || uint(item) >= shared->numAccepted)
+                    continue;
+
+                // the parent of an item is the smallest clade containing it, which is
+                // found directly above it in any tree containing both
+                uint parentSize = (nearest[i] == -1) ? UINT_MAX - 1 : clades[nearest[i]].numLeaves;
+                if(parentSize < parentSizes[item])
+                {
+                    parents[item] = (nearest[i] == -1) ? -1 : items[nearest[i]];
+                    parentSizes[item] = parentSize;
+                }
+            }
+        }
+
+        QMutexLocker locker(&shared->mutex);
+        for(uint i = 0; i < numItems; ++i)
+        {
+            if(parentSizes[i] < shared->parentSizes[i])
+            {
+                shared->parents[i] = parents[i];
+                shared->parentSizes[i] = parentSizes[i];
+            }
+
+            shared->sizes[i] = qMax(shared->sizes[i], sizes[i]);
+            shared->lengths[i] += lengths[i];
+            shared->numLengths[i] += numLengths[i];
+            shared->firstTrees[i] = qMin(shared->firstTrees[i], firstTrees[i]);
+        }
+    }
+
+    /** Percentage of trees containing a clade, to one decimal place. */
+    float Support(uint count, uint numTrees)
+    {
+        return qRound(1000.0 * count / numTrees) / 10.0f;
+    }
+
+    /** Count leaves below each node and order children by the first taxon below them, so the consensus follows the order of the first tree. */
+    void CountLeaves(NodePhylo* root, const std::vector<int>& taxa, std::vector<uint>& numLeaves)
+    {
+        std::vector<int> firstTaxa(numLeaves.size(), INT_MAX);
+        std::vector< std::pair<NodePhylo*, uint> > stack;
+        stack.push_back(std::make_pair(root, 0u));
+        while(!stack.empty())
+        {
+            NodePhylo* node = stack.back().first;
+            uint childIndex = stack.back().second;
+            if(childIndex < node->GetNumberOfChildren())
+            {
+                stack.back().second++;
+                stack.push_back(std::make_pair(node->GetChild(childIndex), 0u));
+                continue;
+            }
+            stack.pop_back();
+
+            uint id = node->GetId();
+            if(node->GetNumberOfChildren() == 0)
+            {
+                numLeaves[id] = 1;
+                firstTaxa[id] = taxa[id];
+                continue;
+            }
+
+            std::vector<NodePhylo*> children = node->GetChildren();
+            std::stable_sort(children.begin(), children.end(), [&firstTaxa](NodePhylo* a, NodePhylo* b) {
+                return firstTaxa[a->GetId()] < firstTaxa[b->GetId()];
+            });
+
+            node->RemoveChildren();
+            numLeaves[id] = 0;
+            foreach(NodePhylo* child, children)
+            {
+                node->AddChild(child);
+                numLeaves[id] += numLeaves[child->GetId()];
+            }
+            firstTaxa[id] = firstTaxa[children.front()->GetId()];
+        }
+    }
+}
+
+bool ConsensusTree::Build(const TreeCollection& collection, Tree<NodePhylo>::Ptr tree)
+{
+    m_error.clear();
+    m_numTrees = 0;
+    m_numSkipped = 0;
+
+    // only clades which may be part of the consensus are counted
+    CladeFrequencies frequencies(m_bRooted, m_bExtended ? qMin(m_minFrequency, m_threshold) : m_threshold);
+    if(!frequencies.Calculate(collection))
+    {
+        m_error = frequencies.GetError();
+        return false;
+    }
+    m_numTrees = frequencies.GetNumberOfTrees();
+    m_numSkipped = frequencies.GetNumberOfSkippedTrees();
+
+    const SplitHash& splitHash = frequencies.GetSplitHash();
+    uint numTaxa = splitHash.GetNumberOfTaxa();
+
+    // clades above the threshold form the majority-rule consensus; the remaining
+    // clades are only considered for the extended consensus
+    std::vector< std::pair<uint, SplitKey> > accepted;
+    std::vector< std::pair<uint, SplitKey> > candidates;
+    const QHash<SplitKey, uint>& counts = frequencies.GetCounts();
+    QHash<SplitKey, uint>::const_iterator it;
+    for(it = counts.constBegin(); it != counts.constEnd(); ++it)
+    {
+        if(it.value() == m_numTrees || it.value() > m_threshold * m_numTrees)
+            accepted.push_back(std::make_pair(it.value(), it.key()));
+        else if(m_bExtended)
+            candidates.push_back(std::make_pair(it.value(), it.key()));
+    }
+
+    ConsensusItems shared(&collection, &splitHash, m_bRooted);
+    shared.numAccepted = numTaxa + uint(accepted.size());
+    uint numItems = shared.numAccepted + uint(candidates.size());
+    for(uint i = 0; i < accepted.size(); ++i)
+        shared.clades.insert(accepted[i].second, numTaxa + i);
+    for(uint i = 0; i < candidates.size(); ++i)
+        shared.clades.insert(candidates[i].second, shared.numAccepted + i);
+
+    shared.parents.resize(numItems, -1);
+    shared.parentSizes.resize(numItems, UINT_MAX);
+    shared.sizes.resize(numItems, 0);
+    shared.lengths.resize(numItems, 0.0);
+    shared.numLengths.resize(numItems, 0);
+    shared.firstTrees.resize(numItems, UINT_MAX);
+
+    uint numTrees = collection.GetNumberOfTrees();
+    uint numRanges = qMin(numTrees, uint(qMax(1, QThread::idealThreadCount())) * 4);
+    std::vector< QFuture<void> > futures;
+    for(uint i = 0; i < numRanges; ++i)
+    {
+        uint begin = uint(quint64(numTrees) * i / numRanges);
+        uint end = uint(quint64(numTrees) * (i + 1) / numRanges);
+        futures.push_back(QtConcurrent::run(GatherItems, &shared, begin, end));
+    }
+
+    for(uint i = 0; i < futures.size(); ++i)
+        futures[i].waitForFinished();
+
+    // create a node for each taxon and clade above the threshold
+    NodePhylo::NodeId id = 0;
+    NodePhylo* root = new NodePhylo(id++);
+    std::vector<NodePhylo*> nodes(shared.numAccepted, NULL);
+    std::vector<int> taxa(1, -1);
+    for(uint i = 0; i < shared.numAccepted; ++i)
+    {
+        nodes[i] = (i < numTaxa) ? new NodePhylo(id++, splitHash.GetTaxon(i)) : new NodePhylo(id++);
+        taxa.push_back((i < numTaxa) ? int(i) : -1);
+
+        if(i >= numTaxa)
+            nodes[i]->SetBootstrapToParent(Support(accepted[i - numTaxa].first, m_numTrees));
+
+        if(shared.numLengths[i] > 0)
+            nodes[i]->SetDistanceToParent(float(shared.lengths[i] / shared.numLengths[i]));
+    }
+
+    for(uint i = 0; i < shared.numAccepted; ++i)
+    {
+        NodePhylo* parent = (shared.parents[i] == -1) ? root : nodes[shared.parents[i]];
+        parent->AddChild(nodes[i]);
+    }
+
+    tree->SetRootNode(root);
+    QString type = m_bExtended ? "Extended majority-rule" : (m_threshold >= 1.0f ? "Strict" : "Majority-rule");
+    tree->SetName(QString("%1 consensus of %2 trees").arg(type).arg(m_numTrees));
+
+    // every clade must contain the number of leaves it was found with
+    std::vector<uint> numLeaves(id, 0);
+    CountLeaves(root, taxa, numLeaves);
+    for(uint i = numTaxa; i < shared.numAccepted; ++i)
+    {
+        if(numLeaves[nodes[i]->GetId()] != shared.sizes[i])
+        {
+            m_error = "Clades of the consensus tree are not compatible.";
+            return false;
+        }
+    }
+
+    if(m_bExtended)
+    {
+        // greedily add clades while they are compatible with those already added
+        uint maxClades = uint(qMax(0, int(numTaxa) - (m_bRooted ? 2 : 3)));
+        uint numClades = uint(accepted.size());
+
+        std::vector<uint> order(candidates.size());
+        for(uint i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&candidates, &shared](uint a, uint b) {
+            if(candidates[a].first != candidates[b].first)
+                return candidates[a].first > candidates[b].first;
+            return shared.firstTrees[shared.numAccepted + a] < shared.firstTrees[shared.numAccepted + b];
+        });
+
+        uint loadedTree = UINT_MAX;
+        std::vector<SplitHash::Clade> clades;
+        std::vector<uint> firstDescendants;
+        QHash<SplitKey, uint> cladeIndices;
+        QHash<NodePhylo*, uint> marked;
+        std::vector<uint> cladeTaxa;
+        foreach(uint candidate, order)
+        {
+            if(numClades >= maxClades)
+                break;
+
+            // leaves of the clade are those of a tree containing it
+            uint treeIndex = shared.firstTrees[shared.numAccepted + candidate];
+            if(treeIndex != loadedTree)
+            {
+                loadedTree = treeIndex;
+                cladeIndices.clear();
+                Tree<NodePhylo>::Ptr source = collection.LoadTree(treeIndex);
+                if(!source || !splitHash.GetCladeTree(source->GetRootNode(), m_bRooted, clades))
+                    clades.clear();
+
+                // clades are in post-order, so the clades below a clade precede it contiguously
+                firstDescendants.resize(clades.size());
+                for(uint i = 0; i < clades.size(); ++i)
+                    firstDescendants[i] = i;
+
+                for(uint i = 0; i < clades.size(); ++i)
+                {
+                    int parent = clades[i].parent;
+                    if(parent != -1)
+                        firstDescendants[parent] = qMin(firstDescendants[parent], firstDescendants[i]);
+
+                    if(clades[i].numLeaves > 1)
+                        cladeIndices.insert(clades[i].key, i);
+                }
+            }
+
+            QHash<SplitKey, uint>::const_iterator index = cladeIndices.constFind(candidates[candidate].second);
+            if(index == cladeIndices.constEnd())
+                continue;
+
+            cladeTaxa.clear();
+            for(uint i = firstDescendants[index.value()]; i <= index.value(); ++i)
+            {
+                if(clades[i].taxon >= 0)
+                    cladeTaxa.push_back(uint(clades[i].taxon));
+            }
+
+            // count leaves of the clade below each node of the consensus tree
+            marked.clear();
+            foreach(uint taxon, cladeTaxa)
+            {
+                for(NodePhylo* node = nodes[taxon]; node; node = node->GetParent())
+                    marked[node]++;
+            }
+
+            // the clade is compatible if it is the union of several, but not all, children of the smallest node containing it
+            NodePhylo* lca = nodes[cladeTaxa.front()];
+            while(marked.value(lca) < cladeTaxa.size())
+                lca = lca->GetParent();
+
+            std::vector<NodePhylo*> inside;
+            std::vector<NodePhylo*> outside;
+            bool bCompatible = true;
+            for(uint i = 0; i < lca->GetNumberOfChildren() && bCompatible; ++i)
+            {
+                NodePhylo* child = lca->GetChild(i);
+                uint count = marked.value(child);
+                if(count == 0)
+                    outside.push_back(child);
+                else if(count == numLeaves[child->GetId()])
+                    inside.push_back(child);
+                else
+                    bCompatible = false;
+            }
+
+            if(!bCompatible || inside.size() < 2 || outside.empty())
+                continue;
+
+            NodePhylo* node = new NodePhylo(id++);
+            node->SetBootstrapToParent(Support(candidates[candidate].first, m_numTrees));
+            uint item = shared.numAccepted + candidate;
+            if(shared.numLengths[item] > 0)
+                node->SetDistanceToParent(float(shared.lengths[item] / shared.numLengths[item]));
+
+            lca->RemoveChildren();
+            foreach(NodePhylo* child, outside)
+                lca->AddChild(child);
+            lca->AddChild(node);
+            foreach(NodePhylo* child, inside)
+                node->AddChild(child);
+
+            numLeaves.push_back(uint(cladeTaxa.size()));
+            taxa.push_back(-1);
+            numClades++;
+        }
+
+        CountLeaves(root, taxa, numLeaves);
+    }
+
+    tree->CalculateStatistics();
+
+    return true;
+}
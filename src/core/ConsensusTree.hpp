@@ -0,0 +1,112 @@
+#ifndef _CONSENSUS_TREE_HPP_
+#define _CONSENSUS_TREE_HPP_
+
+#include "../core/NodePhylo.hpp"
+
+#include "../utils/Tree.hpp"
+
+#include <QString>
+
+namespace pygmy
+{
+
+class TreeCollection;
+
+/**
+ * @brief Summarise a collection of trees by a majority-rule or extended majority-rule consensus tree.
+ *
+ * Clades are identified by hashing (see SplitHash) and counted in parallel
+ * (see CladeFrequencies), keeping only counters for clades which may be
+ * frequent enough to be of interest. The consensus tree is then assembled in
+ * a second pass over the trees: clades found in more than the threshold
+ * fraction of trees are always compatible, and the parent of each clade in the
+ * consensus tree is the smallest such clade found above it in any tree. No set
+ * of leaves is stored for any clade, so memory is proportional to the number
+ * of leaves rather than to the number of trees times the number of leaves.
+ *
+ * The extended (greedy) consensus additionally adds less frequent clades, most
+ * frequent first, while they are compatible with the clades already added. The
+ * leaves of these clades are taken from a tree containing them.
+ *
+ * The support of each clade (the percentage of trees containing it) is set as
+ * the bootstrap value of its branch, and branch lengths are the mean length of
+ * the branch over the trees containing the clade.
+ *
+ * Code example:
+ * @code
+ * ConsensusTree consensus;
+ * consensus.SetExtended(true);
+ * Tree<NodePhylo>::Ptr tree(new Tree<NodePhylo>());
+ * if(!consensus.Build(collection, tree))
+ *     qCritical() << consensus.GetError();
+ * @endcode
+ */
+class ConsensusTree
+{
+public:
+    /**
+     * @brief Constructor.
+     * @param bRooted Flag indicating if clades are compared as rooted clades (true) or unrooted splits (false).
+     */
+    ConsensusTree(bool bRooted = false)
+        : m_bRooted(bRooted), m_threshold(0.5f), m_bExtended(false), m_minFrequency(0.05f), m_numTrees(0), m_numSkipped(0) {}
+
+    /** Set fraction of trees a clade must be found in (more than 0.5 of trees, or all trees for a strict consensus when set to 1). */
+    void SetThreshold(float threshold) { m_threshold = qBound(0.5f, threshold, 1.0f); }
+
+    /** Get fraction of trees a clade must be found in. */
+    float GetThreshold() const { return m_threshold; }
+
+    /**
+     * @brief Set if compatible clades below the threshold are added (extended majority-rule consensus).
+     * @param bExtended Flag indicating if clades below the threshold are added.
+     * @param minFrequency Clades found in a smaller fraction of trees are never added. Memory grows in inverse proportion to this value.
+     */
+    void SetExtended(bool bExtended, float minFrequency = 0.05f) { m_bExtended = bExtended; m_minFrequency = minFrequency; }
+
+    /** Check if compatible clades below the threshold are added. */
+    bool IsExtended() const { return m_bExtended; }
+
+    /**
+     * @brief Build the consensus of all trees in a collection.
+     * @param collection Collection of trees.
+     * @param tree Set to the consensus tree.
+     * @return True if successful, else false.
+     */
+    bool Build(const TreeCollection& collection, utils::Tree<NodePhylo>::Ptr tree);
+
+    /** Number of trees summarised by the consensus. */
+    uint GetNumberOfTrees() const { return m_numTrees; }
+
+    /** Number of trees skipped since they could not be read or have different leaves. */
+    uint GetNumberOfSkippedTrees() const { return m_numSkipped; }
+
+    /** Get description of the most recent error. */
+    QString GetError() const { return m_error; }
+
+protected:
+    /** Flag indicating if clades are compared as rooted clades. */
+    bool m_bRooted;
+
+    /** Fraction of trees a clade must be found in. */
+    float m_threshold;
+
+    /** Flag indicating if compatible clades below the threshold are added. */
+    bool m_bExtended;
+
+    /** Minimum fraction of trees a clade added by the extended consensus is found in. */
+    float m_minFrequency;
+
+    /** Number of trees summarised. */
+    uint m_numTrees;
+
+    /** Number of trees skipped. */
+    uint m_numSkipped;
+
+    /** Description of the most recent error. */
+    QString m_error;
+};
+
+}
+
+#endif
@@ -45,6 +45,24 @@ namespace pygmy
 
 	class VisualTree;
     typedef QSharedPointer<VisualTree> VisualTreePtr;
+
+    class TreeCollection;
+    typedef QSharedPointer<TreeCollection> TreeCollectionPtr;
+
+    class CladeFrequencies;
+    typedef QSharedPointer<CladeFrequencies> CladeFrequenciesPtr;
+
+    class ConsensusTree;
+    typedef QSharedPointer<ConsensusTree> ConsensusTreePtr;
+
+    class OverviewRaster;
+    typedef QSharedPointer<OverviewRaster> OverviewRasterPtr;
+
+    class PolarLayout;
+    typedef QSharedPointer<PolarLayout> PolarLayoutPtr;
+
+    class TreeEdit;
+    typedef QSharedPointer<TreeEdit> TreeEditPtr;
 }
 
 namespace glUtils
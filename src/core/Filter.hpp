@@ -11,6 +11,7 @@
 #define _FILTER_H_
 
 
+#include "../core/MemoryReport.hpp"
 #include "../core/NodePhylo.hpp"
 
 #include "../utils/Colour.hpp"
@@ -47,6 +48,9 @@ public:
 	/** Get the filitered list. */
 	std::set<uint> FilteredList() { return m_ids; }
 
+	/** Add the memory used by the filter list to a report. */
+	void ReportMemory(MemoryReport& report) const { report.Add(MemoryReport::SEARCH_INDEX, MemoryReport::SetBytes(m_ids)); }
+
 private:
 	/** Vector of filtered nodes. */
 	std::set<uint> m_ids;
@@ -0,0 +1,389 @@
+#include "FoldedClades.hpp"
+
+#include "MemoryReport.hpp"
+#include "MetadataInfo.hpp"
+
+#include <QSet>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace pygmy;
+using namespace utils;
+
+namespace
+{
+    bool DeeperNode(const NodePhylo* a, const NodePhylo* b)
+    {
+        return a->GetDepth() > b->GetDepth();
+    }
+}
+
+void FoldedClades::SetLayout(Tree<NodePhylo>::Ptr tree)
+{
+    QHash<const NodePhylo*, FoldedClade> folds;
+    if(tree == m_tree)
+        folds.swap(m_folds);
+
+    m_tree = tree;
+    m_numLeaves = tree ? tree->GetNumberOfLeaves() : 0;
+    Clear();
+
+    // refold clades as the order of leaves or position of nodes may have changed
+    for(QHash<const NodePhylo*, FoldedClade>::const_iterator it = folds.constBegin(); it != folds.constEnd(); ++it)
+        AddFold(it.key(), it.value().label);
+
+    UpdateAllOffsets();
+}
+
+void FoldedClades::Clear()
+{
+    m_folds.clear();
+    m_foldsByLeaf.clear();
+    m_offsets.clear();
+
+    // each leaf takes a single row, so every entry of the Fenwick tree is the size of the range it covers
+    m_rows.assign(m_numLeaves + 1, 0);
+    for(uint i = 1; i <= m_numLeaves; ++i)
+        m_rows[i] = int(i & (0u - i));
+
+    m_numRows = m_numLeaves;
+}
+
+const NodePhylo* FoldedClades::GetShownNode(const NodePhylo* node) const
+{
+    const NodePhylo* shown = node;
+    for(const NodePhylo* ancestor = GetFoldedAncestor(node); ancestor; ancestor = GetFoldedAncestor(ancestor))
+        shown = ancestor;
+
+    return shown;
+}
+
+bool FoldedClades::Fold(NodePhylo* node, const QString& label)
+{
+    if(!AddFold(node, label))
+        return false;
+
+    std::vector<const NodePhylo*> ancestors;
+    for(const NodePhylo* ancestor = node->GetParent(); ancestor; ancestor = ancestor->GetParent())
+        ancestors.push_back(ancestor);
+
+    UpdateOffsets(ancestors);
+
+    return true;
+}
+
+bool FoldedClades::Unfold(NodePhylo* node)
+{
+    QHash<const NodePhylo*, FoldedClade>::iterator it = m_folds.find(node);
+    if(it == m_folds.end())
+        return false;
+
+    uint first = FirstLeaf(node);
+    uint last = LastLeaf(node);
+
+    int delta = it.value().delta;
+    m_folds.erase(it);
+    AddRows(first, -delta);
+
+    std::multimap<uint, const NodePhylo*>::iterator entry = m_foldsByLeaf.lower_bound(first);
+    while(entry->second != node)
+        ++entry;
+    m_foldsByLeaf.erase(entry);
+
+    // the nearest folded clade containing this one must still take the same number of rows
+    const NodePhylo* folded = GetFoldedAncestor(node);
+    if(folded)
+    {
+        m_folds[folded].delta += delta;
+        AddRows(FirstLeaf(folded), delta);
+    }
+
+    m_numRows = uint(Rows(m_numLeaves));
+
+    if(m_folds.isEmpty())
+    {
+        m_offsets.clear();
+        return true;
+    }
+
+    // clades without folds are laid out as in the unfolded tree
+    const NodePhylo* ancestor = node;
+    while(ancestor && !HasNestedFolds(ancestor))
+    {
+        m_offsets.remove(ancestor);
+        ancestor = ancestor->GetParent();
+    }
+
+    // offsets between the clade and the clades folded within it were set while it was folded,
+    // so are recalculated before those of its ancestors
+    std::vector<const NodePhylo*> nodes;
+    QSet<const NodePhylo*> visited;
+    std::multimap<uint, const NodePhylo*>::const_iterator nested = m_foldsByLeaf.lower_bound(first);
+    for(; nested != m_foldsByLeaf.end() && nested->first <= last; ++nested)
+    {
+        // folded ancestors may share the first leaf of the clade
+        if(nested->second->GetDepth() <= node->GetDepth())
+            continue;
+
+        for(const NodePhylo* parent = nested->second->GetParent(); parent != node && !visited.contains(parent); parent = parent->GetParent())
+        {
+            visited.insert(parent);
+            nodes.push_back(parent);
+        }
+    }
+
+    std::sort(nodes.begin(), nodes.end(), DeeperNode);
+    for(; ancestor; ancestor = ancestor->GetParent())
+        nodes.push_back(ancestor);
+
+    UpdateOffsets(nodes);
+
+    return true;
+}
+
+uint FoldedClades::FoldByField(const QString& field)
+{
+    if(!m_tree || field.isEmpty())
+        return 0;
+
+    // flatten tree into pre-order so the value shared by the leaves of each clade is found in a single pass
+    std::vector<NodePhylo*> nodes;
+    std::vector<int> parents;
+    nodes.reserve(m_tree->GetNumberOfNodes());
+    parents.reserve(m_tree->GetNumberOfNodes());
+    std::vector< std::pair<NodePhylo*, int> > stack(1, std::make_pair(m_tree->GetRootNode(), -1));
+    while(!stack.empty())
+    {
+        NodePhylo* node = stack.back().first;
+        parents.push_back(stack.back().second);
+        stack.pop_back();
+
+        int index = int(nodes.size());
+        nodes.push_back(node);
+        for(uint i = node->GetNumberOfChildren(); i > 0; --i)
+            stack.push_back(std::make_pair(node->GetChild(i-1), index));
+    }
+
+    enum { NO_LEAVES, SHARED, MIXED };
+
+    uint numNodes = uint(nodes.size());
+    std::vector<QString> values(numNodes);
+    std::vector<char> state(numNodes, NO_LEAVES);
+    for(uint i = numNodes; i > 0; --i)
+    {
+        uint index = i-1;
+        if(nodes[index]->IsLeaf())
+        {
+            values[index] = nodes[index]->GetData(field);
+            state[index] = MetadataInfo::IsMissingData(values[index]) ? MIXED : SHARED;
+        }
+
+        int parent = parents[index];
+        if(parent < 0)
+            continue;
+
+        if(state[index] == MIXED)
+        {
+            state[parent] = MIXED;
+        }
+        else if(state[parent] == NO_LEAVES)
+        {
+            state[parent] = SHARED;
+            values[parent] = values[index];
+        }
+        else if(state[parent] == SHARED && values[parent] != values[index])
+        {
+            state[parent] = MIXED;
+        }
+    }
+
+    // fold the largest clades with a shared value
+    uint numFolded = 0;
+    for(uint i = 0; i < numNodes; ++i)
+    {
+        int parent = parents[i];
+        if(state[i] == SHARED && (parent < 0 || state[parent] != SHARED) && AddFold(nodes[i], values[i]))
+            numFolded++;
+    }
+
+    UpdateAllOffsets();
+
+    return numFolded;
+}
+
+float FoldedClades::GetYPos(const NodePhylo* node) const
+{
+    if(!HasFolds())
+        return node->GetYPos();
+
+    return Row(node) / m_numRows;
+}
+
+Interval FoldedClades::GetInterval(const NodePhylo* node) const
+{
+    if(!HasFolds())
+        return node->GetInterval();
+
+    int start = Rows(FirstLeaf(node));
+    int end = Rows(LastLeaf(node) + 1) - 1;
+
+    QHash<const NodePhylo*, FoldedClade>::const_iterator fold = m_folds.constFind(node);
+    if(fold != m_folds.constEnd())
+        end = start + int(fold.value().rows) - 1;
+
+    return Interval(float(start) / m_numRows, float(end) / m_numRows);
+}
+
+QString FoldedClades::GetFoldedLabel(const NodePhylo* node) const
+{
+    FoldedClade fold = m_folds.value(node);
+    QString label = fold.label.isEmpty() ? node->GetName() : fold.label;
+    if(label.isEmpty())
+        return QString::number(fold.leaves) + " leaves";
+
+    return label + " (" + QString::number(fold.leaves) + ")";
+}
+
+int FoldedClades::Rows(uint leaves) const
+{
+    int rows = 0;
+    for(uint i = leaves; i > 0; i &= i - 1)
+        rows += m_rows[i];
+
+    return rows;
+}
+
+void FoldedClades::AddRows(uint leaf, int rows)
+{
+    for(uint i = leaf + 1; i <= m_numLeaves; i += i & (0u - i))
+        m_rows[i] += rows;
+}
+
+float FoldedClades::Offset(const NodePhylo* node) const
+{
+    // folded clades are centred on their triangle
+    QHash<const NodePhylo*, FoldedClade>::const_iterator fold = m_folds.constFind(node);
+    if(fold != m_folds.constEnd())
+        return 0.5f * (fold.value().rows - 1);
+
+    QHash<const NodePhylo*, float>::const_iterator offset = m_offsets.constFind(node);
+    if(offset != m_offsets.constEnd())
+        return offset.value();
+
+    // clades without folds are laid out as in the unfolded tree
+    return node->GetYPos() * m_numLeaves - FirstLeaf(node);
+}
+
+const NodePhylo* FoldedClades::GetFoldedAncestor(const NodePhylo* node) const
+{
+    for(const NodePhylo* ancestor = node->GetParent(); ancestor; ancestor = ancestor->GetParent())
+    {
+        if(m_folds.contains(ancestor))
+            return ancestor;
+    }
+
+    return NULL;
+}
+
+bool FoldedClades::HasNestedFolds(const NodePhylo* node) const
+{
+    uint last = LastLeaf(node);
+    std::multimap<uint, const NodePhylo*>::const_iterator it = m_foldsByLeaf.lower_bound(FirstLeaf(node));
+    for(; it != m_foldsByLeaf.end() && it->first <= last; ++it)
+    {
+        // the node and its folded ancestors may share its first leaf
+        if(it->second->GetDepth() > node->GetDepth())
+            return true;
+    }
+
+    return false;
+}
+
+bool FoldedClades::AddFold(const NodePhylo* node, const QString& label)
+{
+    if(node->IsLeaf() || m_folds.contains(node))
+        return false;
+
+    uint first = FirstLeaf(node);
+
+    FoldedClade fold;
+    fold.leaves = LastLeaf(node) - first + 1;
+    fold.rows = uint(std::ceil(std::sqrt(double(fold.leaves))));
+    fold.label = label;
+
+    // rows taken by the unfolded clade, excluding those added by folded clades sharing its first leaf
+    int rows = Rows(LastLeaf(node) + 1) - Rows(first);
+    const NodePhylo* ancestor = GetFoldedAncestor(node);
+    for(const NodePhylo* folded = ancestor; folded && FirstLeaf(folded) == first; folded = GetFoldedAncestor(folded))
+        rows -= m_folds.value(folded).delta;
+
+    fold.delta = int(fold.rows) - rows;
+    AddRows(first, fold.delta);
+
+    // the nearest folded clade containing this one must still take the same number of rows
+    if(ancestor)
+    {
+        m_folds[ancestor].delta -= fold.delta;
+        AddRows(FirstLeaf(ancestor), -fold.delta);
+    }
+
+    // the triangle extends to the furthest leaf of the clade
+    fold.extent = node->GetPosition().x;
+    std::vector<const NodePhylo*> stack(1, node);
+    while(!stack.empty())
+    {
+        const NodePhylo* descendant = stack.back();
+        stack.pop_back();
+
+        fold.extent = std::max(fold.extent, descendant->GetPosition().x);
+        for(uint i = 0; i < descendant->GetNumberOfChildren(); ++i)
+            stack.push_back(descendant->GetChild(i));
+    }
+
+    m_folds.insert(node, fold);
+    m_foldsByLeaf.insert(std::make_pair(first, node));
+    m_numRows = uint(Rows(m_numLeaves));
+
+    return true;
+}
+
+void FoldedClades::UpdateOffsets(const std::vector<const NodePhylo*>& nodes)
+{
+    foreach(const NodePhylo* node, nodes)
+    {
+        if(node->IsLeaf() || m_folds.contains(node))
+            continue;
+
+        // internal nodes are centred on the span of their children
+        const NodePhylo* firstChild = node->GetChild(0);
+        const NodePhylo* lastChild = node->GetChild(node->GetNumberOfChildren() - 1);
+        m_offsets[node] = 0.5f * (Row(firstChild) + Row(lastChild)) - Rows(FirstLeaf(node));
+    }
+}
+
+void FoldedClades::UpdateAllOffsets()
+{
+    m_offsets.clear();
+
+    QSet<const NodePhylo*> ancestors;
+    for(QHash<const NodePhylo*, FoldedClade>::const_iterator it = m_folds.constBegin(); it != m_folds.constEnd(); ++it)
+    {
+        for(const NodePhylo* ancestor = it.key()->GetParent(); ancestor && !ancestors.contains(ancestor); ancestor = ancestor->GetParent())
+            ancestors.insert(ancestor);
+    }
+
+    std::vector<const NodePhylo*> nodes(ancestors.begin(), ancestors.end());
+    std::sort(nodes.begin(), nodes.end(), DeeperNode);
+    UpdateOffsets(nodes);
+}
+
+void FoldedClades::ReportMemory(MemoryReport& report) const
+{
+    report.Add(MemoryReport::LAYOUT, MemoryReport::VectorBytes(m_rows)
+               + MemoryReport::HashBytes(m_folds) + MemoryReport::MapBytes(m_foldsByLeaf)
+               + MemoryReport::HashBytes(m_offsets));
+
+    for(QHash<const NodePhylo*, FoldedClade>::const_iterator it = m_folds.constBegin(); it != m_folds.constEnd(); ++it)
+        report.AddString(MemoryReport::LAYOUT, it.value().label);
+}
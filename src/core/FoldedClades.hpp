@@ -0,0 +1,185 @@
+#ifndef _FOLDED_CLADES_HPP_
+#define _FOLDED_CLADES_HPP_
+
+#include "../core/NodePhylo.hpp"
+
+#include "../utils/Tree.hpp"
+
+#include <QHash>
+#include <QString>
+
+#include <map>
+#include <vector>
+
+namespace pygmy
+{
+
+class MemoryReport;
+
+/**
+ * @brief Clades folded into a triangle without modifying the tree.
+ *
+ * The positions set by VisualTree::LayoutY() are kept as the layout of the
+ * unfolded tree. A folded clade takes fewer rows than it has leaves, so every
+ * node below it moves up. Rather than updating the position of each of these
+ * nodes, the number of rows taken by each leaf is kept in a Fenwick tree and
+ * the first row of a node is found as a prefix sum in O(log n) time. Folding
+ * or unfolding a clade changes a single entry of the Fenwick tree and the
+ * offset of each of its ancestors from their first row, so takes O(depth log n)
+ * time regardless of the size of the tree. Unfolding a clade also updates the
+ * nodes between it and the clades folded within it, which are found by their
+ * first leaf without visiting the rest of the clade.
+ *
+ * Nodes within a folded clade are hidden and have no meaningful position.
+ */
+class FoldedClades
+{
+public:
+    /** Constructor. */
+    FoldedClades() : m_numLeaves(0), m_numRows(0) {}
+
+    /**
+     * @brief Index the leaves of a tree after the y-position of its nodes has been laid out.
+     * @param tree Tree that has been laid out. Clades of the same tree stay folded.
+     */
+    void SetLayout(utils::Tree<NodePhylo>::Ptr tree);
+
+    /** Get tree whose layout is indexed. */
+    utils::Tree<NodePhylo>::Ptr GetTree() const { return m_tree; }
+
+    /** Unfold all clades. Must be called before nodes are removed from the tree. */
+    void Clear();
+
+    /** Flag indicating if any clade is folded. */
+    bool HasFolds() const { return !m_folds.isEmpty(); }
+
+    /** Flag indicating if a node is the root of a folded clade. */
+    bool IsFolded(const NodePhylo* node) const { return m_folds.contains(node); }
+
+    /** Flag indicating if a node is within a folded clade. */
+    bool IsHidden(const NodePhylo* node) const { return GetFoldedAncestor(node) != NULL; }
+
+    /** Get the node drawn in place of a node: the outermost folded clade containing it, or the node itself. */
+    const NodePhylo* GetShownNode(const NodePhylo* node) const;
+
+    /**
+     * @brief Fold a clade so it is drawn as a triangle.
+     * @param node Root of clade. Leaves can not be folded.
+     * @param label Label drawn beside the triangle. If empty, the name of the node is used.
+     * @return True if the clade was folded.
+     */
+    bool Fold(NodePhylo* node, const QString& label = QString());
+
+    /**
+     * @brief Unfold a clade.
+     * @return True if the clade was folded.
+     */
+    bool Unfold(NodePhylo* node);
+
+    /**
+     * @brief Fold every largest clade whose leaves all have the same value for a metadata
+     *        field, e.g. every clade at a given taxonomic rank.
+     * @param field Metadata field. Leaves with missing data are not part of any such clade.
+     * @return Number of clades folded.
+     */
+    uint FoldByField(const QString& field);
+
+    /** Get number of rows taken by the leaves and folded clades of the tree. */
+    uint GetNumberOfRows() const { return m_numRows; }
+
+    /** Get y-position of a node between 0 and 1. */
+    float GetYPos(const NodePhylo* node) const;
+
+    /** Get interval spanned by the leaves and folded clades below a node. */
+    utils::Interval GetInterval(const NodePhylo* node) const;
+
+    /** Get number of leaves within a folded clade. */
+    uint GetFoldedLeaves(const NodePhylo* node) const { return m_folds.value(node).leaves; }
+
+    /** Get x-position of the furthest leaf of a folded clade, where its triangle ends. */
+    float GetFoldedExtent(const NodePhylo* node) const { return m_folds.value(node).extent; }
+
+    /** Get label drawn beside a folded clade. */
+    QString GetFoldedLabel(const NodePhylo* node) const;
+
+    /** Add the memory used by the folded clades to a report. */
+    void ReportMemory(MemoryReport& report) const;
+
+protected:
+    /** Folded clade. */
+    struct FoldedClade
+    {
+        FoldedClade() : delta(0), rows(0), leaves(0), extent(0) {}
+
+        /** Rows added at the first leaf of the clade (negative, unless offsetting nested folds). */
+        int delta;
+
+        /** Rows taken by the triangle. */
+        uint rows;
+
+        /** Number of leaves within the clade. */
+        uint leaves;
+
+        /** X-position of the furthest leaf. */
+        float extent;
+
+        /** Label drawn beside the triangle. */
+        QString label;
+    };
+
+    /** Index of the first and last leaf below a node in the unfolded layout. */
+    uint FirstLeaf(const NodePhylo* node) const { return uint(node->GetInterval().start * m_numLeaves + 0.5f); }
+    uint LastLeaf(const NodePhylo* node) const { return uint(node->GetInterval().end * m_numLeaves + 0.5f); }
+
+    /** Number of rows taken by the first leaves of the tree. */
+    int Rows(uint leaves) const;
+
+    /** Add rows taken by a leaf. */
+    void AddRows(uint leaf, int rows);
+
+    /** Position of a node relative to its first row. */
+    float Offset(const NodePhylo* node) const;
+
+    /** Position of a node in rows. */
+    float Row(const NodePhylo* node) const { return Rows(FirstLeaf(node)) + Offset(node); }
+
+    /** Nearest folded clade containing a node. */
+    const NodePhylo* GetFoldedAncestor(const NodePhylo* node) const;
+
+    /** Flag indicating if a folded clade is within the clade below a node. */
+    bool HasNestedFolds(const NodePhylo* node) const;
+
+    /** Fold a clade without updating the offset of its ancestors. */
+    bool AddFold(const NodePhylo* node, const QString& label);
+
+    /** Set the offset of internal nodes ordered from the deepest to the root. */
+    void UpdateOffsets(const std::vector<const NodePhylo*>& nodes);
+
+    /** Set the offset of all folded clades and their ancestors. */
+    void UpdateAllOffsets();
+
+    /** Tree being laid out. */
+    utils::Tree<NodePhylo>::Ptr m_tree;
+
+    /** Number of leaves in the tree. */
+    uint m_numLeaves;
+
+    /** Number of rows taken by the leaves and folded clades of the tree. */
+    uint m_numRows;
+
+    /** Fenwick tree of the number of rows taken by each leaf. */
+    std::vector<int> m_rows;
+
+    /** Folded clades. */
+    QHash<const NodePhylo*, FoldedClade> m_folds;
+
+    /** Roots of folded clades indexed by their first leaf, so the folds within a clade can be found. */
+    std::multimap<uint, const NodePhylo*> m_foldsByLeaf;
+
+    /** Offset from their first row of nodes whose position differs from the unfolded layout. */
+    QHash<const NodePhylo*, float> m_offsets;
+};
+
+}
+
+#endif
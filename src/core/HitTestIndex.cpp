@@ -0,0 +1,128 @@
+#include "HitTestIndex.hpp"
+#include "MemoryReport.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace pygmy;
+using namespace utils;
+
+const float HitTestIndex::BAND_HEIGHT = 16.0f;
+const float HitTestIndex::TOLERANCE = 3.0f;
+
+void HitTestIndex::Clear(float viewportHeight)
+{
+    m_viewportHeight = viewportHeight;
+    m_elements.clear();
+    m_bandStart.clear();
+    m_bandElements.clear();
+    m_bBuilt = false;
+}
+
+void HitTestIndex::Add(const BBox& box, NodePhylo* node, ELEMENT element)
+{
+    // corners of branches are not necessarily given in order
+    Element e;
+    e.box = BBox(std::min(box.x, box.dx) - TOLERANCE, std::min(box.y, box.dy) - TOLERANCE,
+                 std::max(box.x, box.dx) + TOLERANCE, std::max(box.y, box.dy) + TOLERANCE);
+
+    // branches to nodes outside the viewport may extend far beyond it
+    if(e.box.dy < 0.0f || e.box.y > m_viewportHeight)
+        return;
+
+    e.box.y = std::max(e.box.y, 0.0f);
+    e.box.dy = std::min(e.box.dy, m_viewportHeight);
+    e.node = node;
+    e.element = element;
+
+    m_elements.push_back(e);
+    m_bBuilt = false;
+}
+
+void HitTestIndex::Bands(const BBox& box, uint& first, uint& last) const
+{
+    first = uint((box.y - m_minY) / BAND_HEIGHT);
+    last = uint((box.dy - m_minY) / BAND_HEIGHT);
+}
+
+void HitTestIndex::Build()
+{
+    m_bandStart.clear();
+    m_bandElements.clear();
+    m_bBuilt = true;
+
+    if(m_elements.empty())
+        return;
+
+    m_minY = m_elements[0].box.y;
+    float maxY = m_elements[0].box.dy;
+    for(const Element& e : m_elements)
+    {
+        m_minY = std::min(m_minY, e.box.y);
+        maxY = std::max(maxY, e.box.dy);
+    }
+
+    // count the elements in each band, then place them with a second pass
+    uint numBands = uint((maxY - m_minY) / BAND_HEIGHT) + 1;
+    m_bandStart.assign(numBands + 1, 0);
+    for(const Element& e : m_elements)
+    {
+        uint first, last;
+        Bands(e.box, first, last);
+        for(uint band = first; band <= last; ++band)
+            m_bandStart[band + 1]++;
+    }
+
+    for(uint band = 0; band < numBands; ++band)
+        m_bandStart[band + 1] += m_bandStart[band];
+
+    std::vector<uint> next(m_bandStart.begin(), m_bandStart.end() - 1);
+    m_bandElements.resize(m_bandStart.back());
+    for(uint i = 0; i < m_elements.size(); ++i)
+    {
+        uint first, last;
+        Bands(m_elements[i].box, first, last);
+        for(uint band = first; band <= last; ++band)
+            m_bandElements[next[band]++] = i;
+    }
+}
+
+HitTestIndex::Hit HitTestIndex::Find(const Point& pt) const
+{
+    if(!m_bBuilt || m_bandStart.empty() || pt.y < m_minY)
+        return Hit();
+
+    uint band = uint((pt.y - m_minY) / BAND_HEIGHT);
+    if(band + 1 >= m_bandStart.size())
+        return Hit();
+
+    const Element* best = NULL;
+    float bestDistance = 0.0f;
+    for(uint i = m_bandStart[band]; i < m_bandStart[band + 1]; ++i)
+    {
+        const Element& e = m_elements[m_bandElements[i]];
+        if(pt.x < e.box.x || pt.x > e.box.dx || pt.y < e.box.y || pt.y > e.box.dy)
+            continue;
+
+        // distance to the nearest centre line of the element, so the closest of overlapping branches is found
+        float dx = pt.x - 0.5f*(e.box.x + e.box.dx);
+        float dy = pt.y - 0.5f*(e.box.y + e.box.dy);
+        float distance = std::min(dx*dx, dy*dy);
+        if(!best || e.element < best->element || (e.element == best->element && distance < bestDistance))
+        {
+            best = &e;
+            bestDistance = distance;
+        }
+    }
+
+    if(!best)
+        return Hit();
+
+    return Hit(best->node, best->element);
+}
+
+void HitTestIndex::ReportMemory(MemoryReport& report) const
+{
+    report.Add(MemoryReport::LAYOUT, MemoryReport::VectorBytes(m_elements)
+               + MemoryReport::VectorBytes(m_bandStart) + MemoryReport::VectorBytes(m_bandElements));
+}
@@ -0,0 +1,119 @@
+#ifndef _HIT_TEST_INDEX_HPP_
+#define _HIT_TEST_INDEX_HPP_
+
+#include "../core/NodePhylo.hpp"
+
+#include "../utils/Common.hpp"
+
+#include <vector>
+
+namespace pygmy
+{
+
+class MemoryReport;
+
+/**
+ * @brief Spatial index of the elements drawn in a frame, used to find the element under the mouse.
+ *
+ * Elements are added as boxes in viewport coordinates after a frame has been
+ * rendered. Build() sorts them into horizontal bands of equal height in time
+ * linear in the number of elements, so finding the element under a point only
+ * tests the few elements within a single band. Elements spanning several bands
+ * (e.g., the vertical branches of a node) are added to each of them.
+ */
+class HitTestIndex
+{
+public:
+    /** Type of element, in the order they take precedence when they overlap. */
+    enum ELEMENT { NODE, LABEL, CLADE, BRANCH, NO_ELEMENT };
+
+    /** Element found under a point. */
+    struct Hit
+    {
+        /** Constructor. */
+        Hit(NodePhylo* _node = NULL, ELEMENT _element = NO_ELEMENT): node(_node), element(_element) {}
+
+        /** Node the element belongs to, or NULL if there is no element under the point. */
+        NodePhylo* node;
+
+        /** Type of element. */
+        ELEMENT element;
+    };
+
+    /** Height of bands (in pixels). */
+    static const float BAND_HEIGHT;
+
+    /** Distance from an element a point may be and still hit it (in pixels), so thin branches can be picked. */
+    static const float TOLERANCE;
+
+public:
+    /** Constructor. */
+    HitTestIndex(): m_viewportHeight(0), m_minY(0), m_bBuilt(true) {}
+
+    /**
+     * @brief Remove all elements.
+     * @param viewportHeight Height of viewport. Elements are clipped to the viewport.
+     */
+    void Clear(float viewportHeight);
+
+    /**
+     * @brief Add an element. Build() must be called before elements can be found.
+     * @param box Bounds of element in viewport coordinates.
+     * @param node Node the element belongs to.
+     * @param element Type of element.
+     */
+    void Add(const utils::BBox& box, NodePhylo* node, ELEMENT element);
+
+    /** Sort elements into bands. */
+    void Build();
+
+    /** Flag indicating if elements have been sorted into bands since the index was cleared. */
+    bool IsBuilt() const { return m_bBuilt; }
+
+    /** Get number of elements in index. */
+    uint GetNumberOfElements() const { return uint(m_elements.size()); }
+
+    /**
+     * @brief Find the element under a point. Nodes take precedence over labels, labels over folded
+     *        clades and folded clades over branches. Among elements of the same type the closest is found.
+     * @param pt Point in viewport coordinates.
+     */
+    Hit Find(const utils::Point& pt) const;
+
+    /** Add the memory used by the index to a report. */
+    void ReportMemory(MemoryReport& report) const;
+
+protected:
+    /** Element of index. */
+    struct Element
+    {
+        utils::BBox box;
+        NodePhylo* node;
+        ELEMENT element;
+    };
+
+    /** Get range of bands overlapped by a box. */
+    void Bands(const utils::BBox& box, uint& first, uint& last) const;
+
+    /** Elements of index. */
+    std::vector<Element> m_elements;
+
+    /** Index into m_bandElements of the first element of each band, with the total number of entries last. */
+    std::vector<uint> m_bandStart;
+
+    /** Index of the elements in each band. */
+    std::vector<uint> m_bandElements;
+
+    /** Height of viewport. */
+    float m_viewportHeight;
+
+    /** Bottom of the first band. */
+    float m_minY;
+
+    /** Flag indicating if elements have been sorted into bands. */
+    bool m_bBuilt;
+};
+
+}
+
+#endif
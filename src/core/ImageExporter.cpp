@@ -0,0 +1,169 @@
+#include "ImageExporter.hpp"
+#include "State.hpp"
+#include "VisualTree.hpp"
+
+#include "../glUtils/ErrorGL.hpp"
+#include "../utils/ImageStreamWriter.hpp"
+#include "../utils/Point.hpp"
+
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace pygmy;
+using namespace utils;
+
+uint ImageExporter::ImageHeight(VisualTreePtr visualTree, uint width, float zoom)
+{
+    Point border = State::Inst().GetBorderSize();
+
+    // the viewport height does not affect the height of the tree
+    visualTree->CalculateTreeDimensions(width, 1, zoom);
+    return uint(ceil(visualTree->GetTreeHeight() * zoom + 2*border.y));
+}
+
+bool ImageExporter::Export(const QString& filename, uint width, float zoom, uint tileHeight, ProgressFunc progress)
+{
+    m_error.clear();
+
+    if(!QOpenGLContext::currentContext())
+    {
+        m_error = "No current OpenGL context.";
+        return false;
+    }
+
+    ImageStreamWriter::FORMAT format = ImageStreamWriter::FormatFromFilename(filename);
+    if(format == ImageStreamWriter::UNKNOWN_FORMAT)
+    {
+        m_error = "Unknown image format. Images must be saved as PNG (.png) or TIFF (.tif, .tiff).";
+        return false;
+    }
+
+    if(width == 0 || zoom <= 0.0f || tileHeight == 0)
+    {
+        m_error = "Image width, zoom and tile height must be greater than zero.";
+        return false;
+    }
+
+    glUtils::ErrorGL::Check();
+
+    uint height = ImageHeight(m_visualTree, width, zoom);
+
+    // Labels and node markers are only drawn for nodes within the viewport, so each tile is
+    // rendered with a margin above and below it to ensure labels of nodes just outside the
+    // tile which overlap it are drawn. Only the rows of the tile itself are written.
+    uint margin = uint(2*(m_visualTree->GetHighestLabel() + State::Inst().GetLineWidth()) + 16);
+
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if(width > uint(maxSize))
+    {
+        m_error = QString("Image width can not exceed %1 pixels.").arg(maxSize);
+        return false;
+    }
+
+    tileHeight = std::min(tileHeight, height);
+    if(tileHeight + 2*margin > uint(maxSize))
+        tileHeight = uint(maxSize) > 2*margin ? uint(maxSize) - 2*margin : 1;
+    uint bufferHeight = tileHeight + 2*margin;
+
+    QOpenGLFramebufferObject fbo(width, bufferHeight);
+    if(!fbo.isValid() || !fbo.bind())
+    {
+        m_error = "Failed to create off-screen framebuffer.";
+        return false;
+    }
+
+    ImageStreamWriter writer;
+    if(!writer.Open(filename, width, height, format))
+    {
+        fbo.release();
+        m_error = writer.GetError();
+        return false;
+    }
+
+    // render with the same state as the tree viewport, restoring the caller's state afterwards
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluOrtho2D(0, (GLint) width, 0, (GLint) bufferHeight);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glViewport(0, 0, (GLint) width, (GLint) bufferHeight);
+
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glShadeModel(GL_SMOOTH);
+    glEnable(GL_POINT_SMOOTH);
+    glEnable(GL_LINE_SMOOTH);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_SCISSOR_TEST);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    uint rowBytes = width*3;
+    std::vector<uchar> pixels(size_t(rowBytes) * tileHeight);
+    std::vector<uchar> swap(rowBytes);
+
+    // circular and radial trees are exported centred, however they are placed in the viewport
+    float horizontalOffset = m_visualTree->GetHorizontalOffset();
+    m_visualTree->SetHorizontalOffset(0);
+
+    // tiles are rendered from the top of the image down since image rows are written in this order
+    bool bSuccess = true;
+    for(uint top = 0; top < height && bSuccess; top += tileHeight)
+    {
+        uint rows = std::min(tileHeight, height - top);
+
+        // translation places the bottom of the buffer 'margin' pixels below the bottom of the tile
+        float translation = float(height) - float(top) - float(tileHeight) - float(margin);
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        m_visualTree->Render(width, bufferHeight, translation, zoom);
+
+        glReadPixels(0, margin + tileHeight - rows, width, rows, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+        // OpenGL rows are ordered from bottom to top
+        for(uint r = 0; r < rows/2; ++r)
+        {
+            uchar* upper = &pixels[size_t(r)*rowBytes];
+            uchar* lower = &pixels[size_t(rows-1-r)*rowBytes];
+            memcpy(&swap[0], upper, rowBytes);
+            memcpy(upper, lower, rowBytes);
+            memcpy(lower, &swap[0], rowBytes);
+        }
+
+        bSuccess = writer.WriteRows(&pixels[0], rows);
+
+        if(progress)
+            progress(top + rows, height);
+    }
+
+    m_visualTree->SetHorizontalOffset(horizontalOffset);
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopClientAttrib();
+    glPopAttrib();
+
+    fbo.release();
+
+    glUtils::ErrorGL::Check();
+
+    if(!bSuccess || !writer.Close())
+    {
+        m_error = writer.GetError();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef _IMAGE_EXPORTER_HPP_
+#define _IMAGE_EXPORTER_HPP_
+
+#include "../core/DataTypes.hpp"
+
+#include <QString>
+#include <functional>
+
+namespace pygmy
+{
+
+/**
+ * @brief Render an entire tree to a raster image without a visible window.
+ *
+ * The tree is rendered into an off-screen framebuffer object one horizontal
+ * tile at a time and each tile is streamed to the image file as soon as it has
+ * been read back. Memory use therefore depends only on the image width and
+ * tile height, so images far taller than the screen or the maximum texture
+ * size (e.g., a poster of a 50,000 leaf tree) can be produced.
+ *
+ * An OpenGL context must be current when Export() is called.
+ *
+ * Code example:
+ * @code
+ * ImageExporter exporter(visualTree);
+ * if(!exporter.Export("tree.png", 2000, 1.0f))
+ *     qCritical() << exporter.GetError();
+ * @endcode
+ */
+class ImageExporter
+{
+public:
+    /** Default height of tiles rendered to the framebuffer object. */
+    static const uint DEFAULT_TILE_HEIGHT = 2048;
+
+    /** Function called after each tile is written with the number of rows written and the image height. */
+    typedef std::function<void(uint rows, uint height)> ProgressFunc;
+
+public:
+    /**
+     * @brief Constructor.
+     * @param visualTree Tree to render. Layout() must have been called.
+     */
+    ImageExporter(VisualTreePtr visualTree): m_visualTree(visualTree) {}
+
+    /**
+     * @brief Get height of image needed to show entire tree.
+     * @param visualTree Tree to render.
+     * @param width Width of image in pixels.
+     * @param zoom Zoom level of tree (1 = leaf labels just touch each other).
+     */
+    static uint ImageHeight(VisualTreePtr visualTree, uint width, float zoom);
+
+    /**
+     * @brief Render tree to an image file.
+     * @param filename Image file. Format is determined by the extension (.png, .tif, .tiff).
+     * @param width Width of image in pixels.
+     * @param zoom Zoom level of tree (1 = leaf labels just touch each other).
+     * @param tileHeight Height of tiles tree is rendered in.
+     * @param progress Optional function reporting progress.
+     * @return True if image was written successfully, else false.
+     */
+    bool Export(const QString& filename, uint width, float zoom,
+                uint tileHeight = DEFAULT_TILE_HEIGHT, ProgressFunc progress = ProgressFunc());
+
+    /** Get description of the most recent error. */
+    QString GetError() const { return m_error; }
+
+protected:
+    /** Tree to render. */
+    VisualTreePtr m_visualTree;
+
+    /** Description of the most recent error. */
+    QString m_error;
+};
+
+}
+
+#endif
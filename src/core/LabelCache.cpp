@@ -0,0 +1,92 @@
+#include "LabelCache.hpp"
+
+#include "MemoryReport.hpp"
+#include "State.hpp"
+
+#include <algorithm>
+
+using namespace pygmy;
+
+const uint LabelCache::EMPTY_LABEL = 0;
+
+void LabelCache::Clear()
+{
+    m_labels.clear();
+    m_text.clear();
+    m_ids.clear();
+    m_leafLabels.clear();
+
+    Intern(QString());
+}
+
+uint LabelCache::Intern(const QString& label)
+{
+    QHash<QString, uint>::const_iterator it = m_ids.constFind(label);
+    if(it != m_ids.constEnd())
+        return it.value();
+
+    uint id = uint(m_labels.size());
+    m_ids.insert(label, id);
+    m_labels.push_back(label);
+    m_text.push_back(label.toLatin1());
+
+    return id;
+}
+
+bool LabelCache::Update(utils::Tree<NodePhylo>::Ptr tree)
+{
+    bool bShowLeafLabels = State::Inst().GetShowLeafLabels();
+    bool bShowMetadataLabels = State::Inst().GetShowMetadataLabels();
+    const QString& field = State::Inst().GetMetadataField();
+
+    // the field only matters if metadata is part of the label
+    if(m_bValid && bShowLeafLabels == m_bShowLeafLabels && bShowMetadataLabels == m_bShowMetadataLabels
+            && (!bShowMetadataLabels || field == m_field))
+        return false;
+
+    Clear();
+    m_bValid = true;
+    m_bShowLeafLabels = bShowLeafLabels;
+    m_bShowMetadataLabels = bShowMetadataLabels;
+    m_field = field;
+
+    if(!bShowLeafLabels && !bShowMetadataLabels)
+        return true;
+
+    std::vector<NodePhylo*> leaves = tree->GetLeaves();
+    utils::Node::NodeId maxId = 0;
+    for(NodePhylo* leaf : leaves)
+        maxId = std::max(maxId, leaf->GetId());
+
+    m_leafLabels.resize(leaves.empty() ? 0 : maxId + 1, EMPTY_LABEL);
+    m_ids.reserve(int(leaves.size()));
+    for(NodePhylo* leaf : leaves)
+    {
+        QString label;
+        if(bShowLeafLabels && bShowMetadataLabels)
+            label = leaf->GetName() + " (" + leaf->GetData(field) + ")";
+        else if(bShowLeafLabels)
+            label = leaf->GetName();
+        else
+            label = leaf->GetData(field);
+
+        m_leafLabels[leaf->GetId()] = Intern(label);
+    }
+
+    m_ids.squeeze();
+
+    return true;
+}
+
+void LabelCache::ReportMemory(MemoryReport& report) const
+{
+    // labels built from a name alone share the name of their leaf
+    report.Add(MemoryReport::STRINGS, MemoryReport::VectorBytes(m_labels) + MemoryReport::VectorBytes(m_text)
+               + MemoryReport::HashBytes(m_ids) + MemoryReport::VectorBytes(m_leafLabels));
+
+    for(uint i = 0; i < m_labels.size(); ++i)
+    {
+        report.AddString(MemoryReport::STRINGS, m_labels[i]);
+        report.AddByteArray(MemoryReport::STRINGS, m_text[i]);
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef _LABEL_CACHE_HPP_
+#define _LABEL_CACHE_HPP_
+
+#include "../core/NodePhylo.hpp"
+
+#include "../utils/Tree.hpp"
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+
+#include <vector>
+
+namespace pygmy
+{
+
+class MemoryReport;
+
+/**
+ * @brief Display label of each leaf, built in bulk for the current label mode and metadata field.
+ *
+ * Labels are interned: each distinct label is stored once, together with the
+ * Latin-1 text passed to the font, and leaves refer to it by id. Drawing a
+ * leaf label is then a lookup rather than a concatenation of strings and a
+ * search of the metadata of the leaf, and the size of each distinct label only
+ * needs to be measured once (e.g., when leaves are labelled by genus). Labels
+ * are rebuilt only when the label mode or metadata field changes, or the cache
+ * is invalidated because the leaves or their metadata changed.
+ *
+ * Leaves are indexed by id, which readers assign sequentially.
+ */
+class LabelCache
+{
+public:
+    /** Id of the empty label, given to nodes which are not labelled. */
+    static const uint EMPTY_LABEL;
+
+public:
+    /** Constructor. */
+    LabelCache(): m_bValid(false), m_bShowLeafLabels(false), m_bShowMetadataLabels(false) { Clear(); }
+
+    /**
+     * @brief Build the label of every leaf if the label mode or metadata field has changed since they were built.
+     * @param tree Tree whose leaves are labelled.
+     * @return True if labels were rebuilt.
+     */
+    bool Update(utils::Tree<NodePhylo>::Ptr tree);
+
+    /** Rebuild labels on the next update (e.g., after the leaves of the tree or their metadata change). */
+    void Invalidate() { m_bValid = false; }
+
+    /** Get id of the label of a leaf. */
+    uint GetLabelId(const NodePhylo* leaf) const
+    {
+        return (leaf->GetId() < m_leafLabels.size()) ? m_leafLabels[leaf->GetId()] : EMPTY_LABEL;
+    }
+
+    /** Get label of a leaf. */
+    const QString& GetLabel(const NodePhylo* leaf) const { return m_labels[GetLabelId(leaf)]; }
+
+    /** Get label with a given id. */
+    const QString& GetLabel(uint id) const { return m_labels[id]; }
+
+    /** Get Latin-1 text of label with a given id, as rendered by the font. */
+    const char* GetText(uint id) const { return m_text[id].constData(); }
+
+    /** Get number of distinct labels, including the empty label. */
+    uint GetNumberOfLabels() const { return uint(m_labels.size()); }
+
+    /** Add the memory used by the labels to a report. */
+    void ReportMemory(MemoryReport& report) const;
+
+protected:
+    /** Remove all labels other than the empty label. */
+    void Clear();
+
+    /** Get id of a label, adding it if it has not been seen. */
+    uint Intern(const QString& label);
+
+protected:
+    /** Flag indicating if labels were built for the current leaves and their metadata. */
+    bool m_bValid;
+
+    /** Label mode and metadata field labels were built for. */
+    bool m_bShowLeafLabels, m_bShowMetadataLabels;
+    QString m_field;
+
+    /** Distinct labels and their Latin-1 text. */
+    std::vector<QString> m_labels;
+    std::vector<QByteArray> m_text;
+
+    /** Id of each distinct label. */
+    QHash<QString, uint> m_ids;
+
+    /** Id of the label of each leaf, indexed by node id. */
+    std::vector<uint> m_leafLabels;
+};
+
+}
+
+#endif
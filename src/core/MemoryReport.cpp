@@ -0,0 +1,145 @@
+#include "MemoryReport.hpp"
+
+using namespace pygmy;
+
+const quint64 MemoryReport::ALLOCATION_OVERHEAD = 16;
+
+MemoryReport::MemoryReport()
+{
+    for(uint i = 0; i < NUM_SUBSYSTEMS; ++i)
+        m_bytes[i] = 0;
+}
+
+quint64 MemoryReport::GetTotalBytes() const
+{
+    quint64 total = 0;
+    for(uint i = 0; i < NUM_SUBSYSTEMS; ++i)
+        total += m_bytes[i];
+
+    return total;
+}
+
+bool MemoryReport::MarkCounted(const void* object)
+{
+    if(m_counted.contains(object))
+        return false;
+
+    m_counted.insert(object);
+    return true;
+}
+
+void MemoryReport::AddTree(utils::Tree<NodePhylo>::Ptr tree, SUBSYSTEM subsystem)
+{
+    if(!tree || !MarkCounted(tree.data()))
+        return;
+
+    Add(subsystem, Allocation(sizeof(utils::Tree<NodePhylo>)));
+
+    // iterative traversal, as trees may be too deep to recurse
+    std::vector<NodePhylo*> stack(1, tree->GetRootNode());
+    while(!stack.empty())
+    {
+        NodePhylo* node = stack.back();
+        stack.pop_back();
+
+        AddNode(node, subsystem);
+        for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
+            stack.push_back(node->GetChild(i));
+    }
+}
+
+void MemoryReport::AddNode(const NodePhylo* node, SUBSYSTEM subsystem)
+{
+    // the capacity of the list of children is not exposed, so it is taken to be the number of children
+    Add(subsystem, Allocation(sizeof(NodePhylo)) + Allocation(node->GetNumberOfChildren()*sizeof(NodePhylo*)));
+
+    AddString(STRINGS, node->GetName());
+
+    const std::map<QString, QString>& metadata = node->GetMetadata();
+    Add(METADATA, MapBytes(metadata));
+    for(std::map<QString, QString>::const_iterator it = metadata.begin(); it != metadata.end(); ++it)
+    {
+        AddString(METADATA, it->first);
+        AddString(METADATA, it->second);
+    }
+}
+
+void MemoryReport::AddString(SUBSYSTEM subsystem, const QString& str)
+{
+    // empty strings share static data
+    if(str.capacity() == 0)
+        return;
+
+    // only strings with several owners need to be remembered
+    if(!str.isDetached() && !MarkCounted(str.constData()))
+        return;
+
+    Add(subsystem, Allocation(sizeof(QArrayData) + (quint64(str.capacity()) + 1)*sizeof(QChar)));
+}
+
+void MemoryReport::AddByteArray(SUBSYSTEM subsystem, const QByteArray& bytes)
+{
+    if(bytes.capacity() == 0)
+        return;
+
+    if(!bytes.isDetached() && !MarkCounted(bytes.constData()))
+        return;
+
+    Add(subsystem, Allocation(sizeof(QArrayData) + quint64(bytes.capacity()) + 1));
+}
+
+QString MemoryReport::GetName(SUBSYSTEM subsystem)
+{
+    switch(subsystem)
+    {
+    case TREE_NODES: return "Tree nodes";
+    case STRINGS: return "Names and labels";
+    case METADATA: return "Metadata";
+    case LAYOUT: return "Layout";
+    case SEARCH_INDEX: return "Search index";
+    case GPU_BUFFERS: return "GPU buffers";
+    case EDIT_HISTORY: return "Undo history";
+    default: return QString();
+    }
+}
+
+QString MemoryReport::GetKey(SUBSYSTEM subsystem)
+{
+    switch(subsystem)
+    {
+    case TREE_NODES: return "tree_nodes";
+    case STRINGS: return "strings";
+    case METADATA: return "metadata";
+    case LAYOUT: return "layout";
+    case SEARCH_INDEX: return "search_index";
+    case GPU_BUFFERS: return "gpu_buffers";
+    case EDIT_HISTORY: return "edit_history";
+    default: return QString();
+    }
+}
+
+QString MemoryReport::FormatBytes(quint64 bytes)
+{
+    if(bytes < 1024)
+        return QString::number(bytes) + " B";
+    else if(bytes < 1024*1024)
+        return QString::number(bytes / 1024.0, 'f', 1) + " KB";
+    else if(bytes < Q_UINT64_C(1024)*1024*1024)
+        return QString::number(bytes / (1024.0*1024.0), 'f', 1) + " MB";
+
+    return QString::number(bytes / (1024.0*1024.0*1024.0), 'f', 2) + " GB";
+}
+
+QJsonObject MemoryReport::ToJson() const
+{
+    // JSON numbers are doubles, which represent byte counts exactly up to 2^53
+    QJsonObject subsystems;
+    for(uint i = 0; i < NUM_SUBSYSTEMS; ++i)
+        subsystems.insert(GetKey(SUBSYSTEM(i)), double(m_bytes[i]));
+
+    QJsonObject report;
+    report.insert("bytes", subsystems);
+    report.insert("total_bytes", double(GetTotalBytes()));
+
+    return report;
+}
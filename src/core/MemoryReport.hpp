@@ -0,0 +1,122 @@
+#ifndef _MEMORY_REPORT_HPP_
+#define _MEMORY_REPORT_HPP_
+
+#include "../core/NodePhylo.hpp"
+
+#include "../utils/Tree.hpp"
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QSet>
+#include <QString>
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace pygmy
+{
+
+/**
+ * @brief Bytes of memory used by each subsystem holding a tree.
+ *
+ * Classes holding a large part of a tree's state report the heap memory they
+ * use through a ReportMemory() method. Each allocation is accounted for by the
+ * size of what is stored (the capacity of vectors, strings and hash tables and
+ * the nodes of maps and sets) plus ALLOCATION_OVERHEAD bytes of bookkeeping.
+ * This mirrors what a counting allocator would see without changing the types
+ * of the containers involved. Objects that may be reachable from several owners
+ * (e.g., implicitly shared strings or trees kept by the edit history) are only
+ * counted once.
+ *
+ * Code example:
+ * @code
+ * MemoryReport report;
+ * visualTree->ReportMemory(report);
+ * qDebug() << MemoryReport::FormatBytes(report.GetBytes(MemoryReport::METADATA));
+ * @endcode
+ */
+class MemoryReport
+{
+public:
+    enum SUBSYSTEM { TREE_NODES, STRINGS, METADATA, LAYOUT, SEARCH_INDEX, GPU_BUFFERS, EDIT_HISTORY, NUM_SUBSYSTEMS };
+
+    /** Bytes of bookkeeping assumed for each heap allocation. */
+    static const quint64 ALLOCATION_OVERHEAD;
+
+public:
+    /** Constructor. */
+    MemoryReport();
+
+    /** Add bytes used by a subsystem. */
+    void Add(SUBSYSTEM subsystem, quint64 bytes) { m_bytes[subsystem] += bytes; }
+
+    /** Get bytes used by a subsystem. */
+    quint64 GetBytes(SUBSYSTEM subsystem) const { return m_bytes[subsystem]; }
+
+    /** Get bytes used by all subsystems. */
+    quint64 GetTotalBytes() const;
+
+    /**
+     * @brief Add the nodes of a tree, along with their names and metadata.
+     * @param tree Tree to add. Nothing is added if the tree has already been counted.
+     * @param subsystem Subsystem the nodes belong to (e.g., EDIT_HISTORY for trees only kept so a change can be undone).
+     */
+    void AddTree(utils::Tree<NodePhylo>::Ptr tree, SUBSYSTEM subsystem = TREE_NODES);
+
+    /** Add a node, its name and metadata. Nodes kept outside of a tree (e.g., by the edit history) are added this way. */
+    void AddNode(const NodePhylo* node, SUBSYSTEM subsystem);
+
+    /** Add a string unless its data has already been counted. */
+    void AddString(SUBSYSTEM subsystem, const QString& str);
+
+    /** Add a byte array unless its data has already been counted. */
+    void AddByteArray(SUBSYSTEM subsystem, const QByteArray& bytes);
+
+    /**
+     * @brief Mark an object as counted.
+     * @return False if the object had already been counted.
+     */
+    bool MarkCounted(const void* object);
+
+    /** Get name of a subsystem for display (e.g., "Tree nodes"). */
+    static QString GetName(SUBSYSTEM subsystem);
+
+    /** Get key of a subsystem in JSON reports (e.g., "tree_nodes"). */
+    static QString GetKey(SUBSYSTEM subsystem);
+
+    /** Format bytes for display (e.g., "12.3 MB"). */
+    static QString FormatBytes(quint64 bytes);
+
+    /** Get report as a JSON object with the bytes used by each subsystem and in total. */
+    QJsonObject ToJson() const;
+
+    /** Get bytes used by an allocation of a given size. */
+    static quint64 Allocation(quint64 bytes) { return bytes ? bytes + ALLOCATION_OVERHEAD : 0; }
+
+    /** Get bytes allocated by a vector, not including the heap memory of its elements. */
+    template <class T> static quint64 VectorBytes(const std::vector<T>& v) { return Allocation(v.capacity()*sizeof(T)); }
+
+    /** Get bytes allocated by a map or multimap, not including the heap memory of its elements. Each node holds a colour and three links. */
+    template <class M> static quint64 MapBytes(const M& m)
+        { return m.size() * Allocation(4*sizeof(void*) + sizeof(typename M::value_type)); }
+
+    /** Get bytes allocated by a set, not including the heap memory of its elements. */
+    template <class T> static quint64 SetBytes(const std::set<T>& s) { return s.size() * Allocation(4*sizeof(void*) + sizeof(T)); }
+
+    /** Get bytes allocated by a hash table, not including the heap memory of its elements. Each node holds a link and the hash of its key. */
+    template <class K, class V> static quint64 HashBytes(const QHash<K, V>& h)
+        { return Allocation(quint64(h.capacity())*sizeof(void*)) + quint64(h.size()) * Allocation(sizeof(void*) + sizeof(uint) + sizeof(K) + sizeof(V)); }
+
+protected:
+    /** Bytes used by each subsystem. */
+    quint64 m_bytes[NUM_SUBSYSTEMS];
+
+    /** Objects and shared string data already counted. */
+    QSet<const void*> m_counted;
+};
+
+}
+
+#endif
@@ -8,6 +8,7 @@
 //=======================================================================
 
 
+#include "../core/MemoryReport.hpp"
 #include "../core/MetadataInfo.hpp"
 #include "../core/NodePhylo.hpp"
 #include "../utils/Tree.hpp"
@@ -101,3 +102,17 @@ bool MetadataInfo::IsMissingData(const QString& value)
 {
     return value.isEmpty() || value == "N/A" || value == "-" || value == "NULL";
 }
+
+void MetadataInfo::ReportMemory(MemoryReport& report) const
+{
+	report.Add(MemoryReport::METADATA, MemoryReport::MapBytes(m_metadataInfo));
+
+	std::map<QString, FieldInfo>::const_iterator it;
+	for(it = m_metadataInfo.begin(); it != m_metadataInfo.end(); ++it)
+	{
+		report.AddString(MemoryReport::METADATA, it->first);
+		report.Add(MemoryReport::METADATA, MemoryReport::SetBytes(it->second.values));
+		for(const QString& value : it->second.values)
+			report.AddString(MemoryReport::METADATA, value);
+	}
+}
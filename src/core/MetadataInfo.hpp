@@ -21,6 +21,8 @@
 namespace pygmy
 {
 
+class MemoryReport;
+
 /**
  * @class FieldInfo
  * @brief Information calculated for each metadata field.
@@ -99,6 +101,9 @@ public:
 	/** Check if data is missing. */
     static bool IsMissingData(const QString& value);
 
+	/** Add the memory used by the summary of each field to a report. */
+	void ReportMemory(MemoryReport& report) const;
+
 private:
     std::map<QString, FieldInfo> m_metadataInfo;
 };
@@ -8,12 +8,15 @@
 //=======================================================================
 
 #include "NewickIO.hpp"
+#include <QBuffer>
 #include <QFileInfo>
 #include <QFile>
 #include <QTextStream>
-#include <QRegularExpression>
+#include <QStringList>
 #include <QtDebug>
 
+#include "../utils/StreamReader.hpp"
+
 using namespace pygmy;
 using namespace utils;
 using namespace std;
@@ -24,17 +27,15 @@ bool NewickIO::Read(Tree<NodePhylo>::Ptr tree, const QString& filename)
     QFileInfo file(filename);
     tree->SetName(file.baseName());
 
-
 	// Parse Newick file
     QFile input(filename);
-    if (!input.open(QIODevice::ReadOnly | QIODevice::Text))
+    if (!input.open(QIODevice::ReadOnly))
     {
-        //TODO: Put in error dialog
+        m_error = "Failed to open " + filename + ": " + input.errorString();
         return false;
     }
 
-    QTextStream instream(&input);
-    bool bLoaded = Read(tree, instream);
+    bool bLoaded = Read(tree, &input);
 	input.close();
 
 	if(bLoaded)
@@ -43,245 +44,384 @@ bool NewickIO::Read(Tree<NodePhylo>::Ptr tree, const QString& filename)
 	return bLoaded;
 }
 
+bool NewickIO::Read(Tree<NodePhylo>::Ptr tree, QIODevice* device)
+{
+	StreamReader reader(device);
+	TreeTokenizer tokenizer(reader);
+
+	return ParseTree(tokenizer, tree);
+}
+
 bool NewickIO::Read(Tree<NodePhylo>::Ptr tree, QTextStream & in)
 {	
-	
-	// We concatenate all line in file till we reach the ending semi colon:
-    QString temp, newickStr;
-
-	// Read entire input stream
-    do {
-        temp = in.readLine();
-        QString::size_type index = temp.indexOf(";");
-        if(index != -1)
-        {
-            newickStr += temp.mid(0, index + 1);
-            break;
-        }
-        else
-        {
-            newickStr += temp;
-        }
-    }
-    while (!temp.isNull());
+	return ParseNewickString(tree, in.readAll());
+}
 
-    QString newickStr2 = newickStr.remove(QRegularExpression("\\[.*\\]"));
+bool NewickIO::ParseNewickString(Tree<NodePhylo>::Ptr tree, const QString& newickStr)
+{
+	QByteArray data = newickStr.toUtf8();
+	QBuffer buffer(&data);
+	buffer.open(QIODevice::ReadOnly);
 
-    return ParseNewickString(tree, newickStr2);
+	return Read(tree, &buffer);
 }
 
-void NewickIO::ParseNodeInfo(NodePhylo* node, QString& nodeInfo, bool bLeafNode)
+bool NewickIO::ParseTree(TreeTokenizer& tokenizer, Tree<NodePhylo>::Ptr tree, const std::map<QString, QString>* translate)
 {
-    QString length;
-    QString name;
-    QString supportValue;
-
-	// check if this element has length
-    int colon = nodeInfo.lastIndexOf(':');
-  if(colon != -1)
-  {
-        length = nodeInfo.mid(colon + 1).simplified();
-        nodeInfo = nodeInfo.mid(0, colon).simplified();
-  }
-
-	// check for name and/or support value
-    int lastP = nodeInfo.lastIndexOf('\'');
-    int firstP = nodeInfo.indexOf('\'');
-	if(firstP != -1)
-	{
-        name = nodeInfo.mid(firstP+1, lastP-firstP-1);
-        //name = name.replace( '_', ' ');
-        supportValue = nodeInfo.mid(lastP+1).simplified();
-	}
-	else
+	m_error.clear();
+
+	uint processedElement = 0;
+	NodePhylo* root = NULL;
+
+	// internal nodes whose children are being read
+	std::vector<NodePhylo*> nodeStack;
+
+	// node whose labels, branch length and comments are being read
+	NodePhylo* activeNode = NULL;
+	bool bActiveLeaf = false;
+	bool bFirstLabel = true;
+
+	TreeTokenizer::Token token;
+	while(m_error.isEmpty() && tokenizer.Next(token))
 	{
-        int spacePos = nodeInfo.indexOf(' ');
-		if(spacePos != -1)
+		if(token.Is(';'))
+			break;
+
+		if(token.Is('('))
 		{
-			// parse the name and support value
-            name = nodeInfo.mid(0, spacePos-1);
-            //name = name.replace('_', ' ');
-            supportValue = nodeInfo.mid(spacePos+1).simplified();
+			if(activeNode || (root && nodeStack.empty()))
+			{
+				m_error = QString("Unexpected '(' on line %1.").arg(tokenizer.GetLineNumber());
+				break;
+			}
+
+			// create a new internal node which will be the child
+			// of the node on the top of the stack
+			NodePhylo* node(new NodePhylo(processedElement++));
+			if(nodeStack.empty())
+				root = node;
+			else
+				nodeStack.back()->AddChild(node);
+
+			nodeStack.push_back(node);
 		}
-		else
+		else if(token.Is(',') || token.Is(')'))
 		{
-			// The remaining description is either a name of support value depending 
-			// on whether this is a leaf or internal node.
-			if(bLeafNode)
+			if(nodeStack.empty())
 			{
-                name = nodeInfo.simplified();
-                //name = name.replace( '_', ' ');
+				m_error = QString("Unexpected '%1' on line %2.").arg(token.ToString()).arg(tokenizer.GetLineNumber());
+				break;
+			}
+
+			// if there is no active node, this is an unlabelled leaf node
+			if(!activeNode)
+			{
+				NodePhylo* node(new NodePhylo(processedElement++));
+				nodeStack.back()->AddChild(node);
+			}
+
+			activeNode = NULL;
+			if(token.Is(')'))
+			{
+				// we are finished processing all children of the node
+				// on the top of the stack, so its labels follow
+				activeNode = nodeStack.back();
+				nodeStack.pop_back();
+				bActiveLeaf = false;
+				bFirstLabel = true;
 			}
-			else
-                supportValue = nodeInfo.simplified();
 		}
-	}	
+		else if(token.Is(':') || token.IsWord())
+		{
+			if(!activeNode)
+			{
+				// start of a new leaf node
+				if(root && nodeStack.empty())
+				{
+					m_error = QString("Unexpected '%1' on line %2.").arg(token.ToString()).arg(tokenizer.GetLineNumber());
+					break;
+				}
+
+				activeNode = new NodePhylo(processedElement++);
+				if(nodeStack.empty())
+					root = activeNode;
+				else
+					nodeStack.back()->AddChild(activeNode);
+
+				bActiveLeaf = true;
+				bFirstLabel = true;
+			}
 
-    if(!name.isEmpty())
-		node->SetName(name);
+			if(token.IsWord())
+			{
+				ParseLabel(activeNode, token, bActiveLeaf, bFirstLabel, translate);
+				bFirstLabel = false;
+				continue;
+			}
 
-    if(!length.isEmpty())
-        node->SetDistanceToParent(length.toDouble());
+			// branch length
+			bool bOk = tokenizer.Next(token) && token.type == TreeTokenizer::WORD;
+			double length = bOk ? token.text.toDouble(&bOk) : 0;
+			if(!bOk)
+			{
+				m_error = QString("Invalid branch length on line %1.").arg(tokenizer.GetLineNumber());
+				break;
+			}
+
+			activeNode->SetDistanceToParent(length);
+		}
+		else if(token.type == TreeTokenizer::COMMENT)
+		{
+			// comments not following a node (e.g., [&R] before the tree) are ignored
+			if(activeNode && token.text.startsWith('&'))
+				ParseAnnotation(activeNode, token.text);
+		}
+		else
+		{
+			m_error = QString("Unexpected '%1' on line %2.").arg(token.ToString()).arg(tokenizer.GetLineNumber());
+		}
+	}
 
-    if(!supportValue.isEmpty())
-        node->SetBootstrapToParent(supportValue.toInt());
+	// the tree takes ownership of any nodes created, even if parsing failed
+	if(root)
+	{
+		if(root->GetDistanceToParent() == NodePhylo::NO_DISTANCE)
+			root->SetDistanceToParent(0.0f);
+
+		tree->SetRootNode(root);
+	}
+
+	if(m_error.isEmpty() && tokenizer.HasError())
+		m_error = tokenizer.GetError();
+
+	if(m_error.isEmpty() && !root)
+		m_error = "No tree found in input.";
+
+	if(m_error.isEmpty() && !nodeStack.empty())
+		m_error = "Failed to parse Newick string. There does not appear to be an even number of opening and closing parentheses.";
+
+	return m_error.isEmpty();
 }
 
-bool NewickIO::ParseNewickString(Tree<NodePhylo>::Ptr tree, const QString& newickStr)
+void NewickIO::ParseLabel(NodePhylo* node, const TreeTokenizer::Token& token, bool bLeafNode, bool bFirstLabel,
+                          const std::map<QString, QString>* translate)
 {
-	// create root node
-	uint processedElement = 0;
-	NodePhylo* root(new NodePhylo(processedElement++));
-	tree->SetRootNode(root);
-	root->SetDistanceToParent(0.0f);
-
-    int lastP  = newickStr.lastIndexOf(')');
-    int firstP = newickStr.indexOf('(');
-    int semi = newickStr.lastIndexOf(';');
-
-    QString content = newickStr.mid(firstP + 1, lastP - firstP);
-    QString rootElements = newickStr.mid(lastP + 1, semi - lastP - 1);
-  
-	ParseNodeInfo(root, rootElements, false);
-
-	// parse newick string
-	std::stack<NodePhylo*> nodeStack;
-	nodeStack.push(root);
-    QString nodeInfo;
-	NodePhylo* activeNode = NULL;
-	for(uint i = 0; i < content.size(); ++i)
+	QString label = token.ToString();
+
+	bool bSupport = !bFirstLabel;
+	float support = 0;
+	if(!bLeafNode && bFirstLabel && token.type == TreeTokenizer::WORD)
+		support = label.toFloat(&bSupport);
+	else if(bSupport)
+		support = label.toFloat(&bSupport);
+
+	if(bSupport)
 	{
-        QChar ch = content.at(i);
+		node->SetBootstrapToParent(support);
+	}
+	else if(bFirstLabel)
+	{
+		if(translate)
+		{
+			std::map<QString, QString>::const_iterator it = translate->find(label);
+			if(it != translate->end())
+				label = it->second;
+		}
 
-		if(ch == '(')
+		node->SetName(label);
+	}
+}
+
+void NewickIO::ParseAnnotation(NodePhylo* node, const QByteArray& comment)
+{
+	QString text = QString::fromUtf8(comment);
+
+	std::map<QString, QString> metadata = node->GetMetadata();
+
+	if(text.startsWith("&&NHX"))
+	{
+		// NHX: [&&NHX:key=value:key=value]
+		QStringList fields = text.mid(5).split(':', QString::SkipEmptyParts);
+		foreach(const QString& field, fields)
 		{
-			// create a new internal node which will be the child 
-			// of the node on the top of the stack
-			NodePhylo* node(new NodePhylo(processedElement++));
-			nodeStack.top()->AddChild(node);
-			nodeStack.push(node);
+			int equals = field.indexOf('=');
+			if(equals > 0)
+				metadata[field.left(equals).trimmed()] = field.mid(equals + 1).trimmed();
 		}
-		else if(ch == ')')
+	}
+	else
+	{
+		// BEAST/FigTree style: [&key=value,key="quoted, value",key={a,b}]
+		QString key, value;
+		bool bValue = false;
+		int depth = 0;
+		QChar quote;
+		for(int i = 1; i <= text.size(); ++i)
 		{
-			if(activeNode)
+			QChar ch = i < text.size() ? text.at(i) : QChar(',');
+
+			if(!quote.isNull())
 			{
-				// if there is a currently active node, then we are
-				// processing an internal node
-				ParseNodeInfo(activeNode, nodeInfo, false);
+				if(ch == quote)
+					quote = QChar();
+				else
+					value += ch;
+				continue;
 			}
-			else
+
+			if(ch == ',' && depth == 0)
 			{
-				// if there is no currently active node, then we
-				// must create a new leaf node
-				NodePhylo* node(new NodePhylo(processedElement++));
-				nodeStack.top()->AddChild(node);
+				key = key.trimmed();
+				if(!key.isEmpty())
+					metadata[key] = value.trimmed();
 
-				ParseNodeInfo(node, nodeInfo, true);				
+				key.clear();
+				value.clear();
+				bValue = false;
 			}
-
-			// we are finished processing all children of the node
-			// on the top of the stack
-			activeNode = nodeStack.top();
-			nodeStack.pop();
-
-            nodeInfo = "";
-		}
-		else if(ch == ',')
-		{
-			if(activeNode)
+			else if(!bValue)
+			{
+				if(ch == '=')
+					bValue = true;
+				else
+					key += ch;
+			}
+			else if(ch == '"' || ch == '\'')
 			{
-				// if there is a currently active node, then we are
-				// processing an internal node
-				ParseNodeInfo(activeNode, nodeInfo, false);
-				activeNode = NULL;
-                nodeInfo = "";
+				quote = ch;
 			}
 			else
 			{
-				// if there is no currently active node, then we
-				// must create a new leaf node
-				NodePhylo* node(new NodePhylo(processedElement++));
-				nodeStack.top()->AddChild(node);
+				if(ch == '{')
+					depth++;
+				else if(ch == '}' && depth > 0)
+					depth--;
 
-				ParseNodeInfo(node, nodeInfo, true);
-                nodeInfo = "";
+				value += ch;
 			}
 		}
-		else
-		{
-			// character is indicate the properties of a node
-			nodeInfo += ch;
-		}
 	}
 
-	if(!nodeStack.empty())
+	node->SetMetadata(metadata);
+}
+
+void NewickIO::Write(Tree<NodePhylo>::Ptr tree, QTextStream &out) const
+{
+	// write directly to the device underlying the stream when there is one
+	if(out.device())
 	{
-		//Log::Inst().Error("Failed to parse Newick string. There does not appear to be an even number of opening and closing parentheses.");
-		return false;
+		out.flush();
+		Write(tree, out.device());
+		return;
 	}
-	
-	return true; 
+
+	QBuffer buffer;
+	buffer.open(QIODevice::WriteOnly);
+	Write(tree, &buffer);
+	out << QString::fromUtf8(buffer.data());
 }
 
-void NewickIO::Write(Tree<NodePhylo>::Ptr tree, QTextStream &out) const
+bool NewickIO::Write(Tree<NodePhylo>::Ptr tree, const QString& filename, bool overwrite) const
 {
+	QFile output(filename);
+	if(!output.open(QIODevice::WriteOnly | (overwrite ? QIODevice::Truncate : QIODevice::Append)))
+		return false;
 
-	out << "(";
+	BufferedWriter::COMPRESSION compression = BufferedWriter::NO_COMPRESSION;
+	if(filename.endsWith(".gz", Qt::CaseInsensitive))
+		compression = BufferedWriter::GZIP_COMPRESSION;
+
+	bool bWritten = Write(tree, &output, compression);
+	output.close();
+
+	return bWritten;
+}
+
+bool NewickIO::Write(Tree<NodePhylo>::Ptr tree, QIODevice* device, BufferedWriter::COMPRESSION compression) const
+{
+	BufferedWriter out(device, compression);
+
+	out << '(';
 
 	NodePhylo* root = tree->GetRootNode();
-	
-  if(tree->GetNumberOfLeaves() == 0)
-  {
-    out << "'" << root->GetName() << "'";
+
+	if(tree->GetNumberOfLeaves() == 0)
+	{
+		out << '\'' << QString(root->GetName()).replace("'", "''") << '\'';
 
 		float dist = root->GetDistanceToParent();
 		if(dist != NodePhylo::NO_DISTANCE)
-			out << " " << dist;
-  }
-  else
-  {
-		WriteNodes(tree, out, root);
-  }
-	out << ")";
-	
+		{
+			out << ' ';
+			out.Significant(dist);
+		}
+	}
+	else
+	{
+		// Iterative depth-first traversal. Each stack entry holds a node and the index
+		// of its next child to write, so no per-node allocations are required.
+		std::vector< std::pair<NodePhylo*, uint> > stack;
+		stack.reserve(64);
+		stack.push_back(std::make_pair(root, 0u));
+		while(!stack.empty())
+		{
+			NodePhylo* node = stack.back().first;
+			uint childIndex = stack.back().second;
+
+			if(childIndex < node->GetNumberOfChildren())
+			{
+				if(childIndex > 0)
+					out << ',';
+
+				stack.back().second++;
+
+				NodePhylo* child = node->GetChild(childIndex);
+				if(child->GetNumberOfChildren() != 0)
+				{
+					out << '(';
+					stack.push_back(std::make_pair(child, 0u));
+				}
+				else
+					WriteNodeInfo(out, child);
+			}
+			else
+			{
+				stack.pop_back();
+
+				if(node != root)
+				{
+					out << ')';
+					WriteNodeInfo(out, node);
+				}
+			}
+		}
+	}
+	out << ')';
+
 	// Output the name of the root if it has one
-    if(!(root->GetName().isEmpty()))
-        out << "'" << root->GetName() << "'";
-	
-	out << ";" << endl;
+	if(!(root->GetName().isEmpty()))
+		out << '\'' << QString(root->GetName()).replace("'", "''") << '\'';
+
+	out << ";\n";
+
+	return out.Finish();
 }
 
-void NewickIO::WriteNodes(Tree<NodePhylo>::Ptr tree, QTextStream& out, NodePhylo* parent) const
+void NewickIO::WriteNodeInfo(BufferedWriter& out, NodePhylo* node) const
 {
-	vector<unsigned int> childrenId = parent->GetChildrenIds();
-	assert(childrenId.size() > 0);
+	// quotes within a name are doubled, as the tokenizer reads a doubled quote as a literal quote
+	if(!node->GetName().isEmpty())
+		out << '\'' << QString(node->GetName()).replace("'", "''") << '\'';
 
-	WriteElements(tree, out, parent, parent->GetChild(0));
-	for(uint i = 1; i < childrenId.size(); i++)
+	if(node->GetBootstrapToParent() != NodePhylo::NO_DISTANCE)
 	{
-		out << ",";
-		WriteElements(tree, out, parent, parent->GetChild(i));
+		out << ' ';
+		out.Significant(node->GetBootstrapToParent());
 	}
-}
 
-void NewickIO::WriteElements(Tree<NodePhylo>::Ptr tree, QTextStream& out, NodePhylo* parent, NodePhylo* child) const
-{	
-  if(child->GetNumberOfChildren() != 0)
-  {
-    out << "(";
-		WriteNodes(tree, out, child); 
-    out << ")";
-  }
-
-    if(!child->GetName().isEmpty())
-        out << "'" << child->GetName() << "'";
-	
-	if(child->GetBootstrapToParent() != NodePhylo::NO_DISTANCE)
-		out << " " << ((NodePhylo*)child)->GetBootstrapToParent();
-
-	if(child->GetDistanceToParent() != NodePhylo::NO_DISTANCE)
-		out << ":" << child->GetDistanceToParent();
+	if(node->GetDistanceToParent() != NodePhylo::NO_DISTANCE)
+	{
+		out << ':';
+		out.Significant(node->GetDistanceToParent());
+	}
 }
-
-
-
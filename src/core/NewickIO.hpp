@@ -11,7 +11,9 @@
 #define _NEWICK_IO_
 
 #include "../core/NodePhylo.hpp"
+#include "../core/TreeTokenizer.hpp"
 
+#include "../utils/BufferedWriter.hpp"
 #include "../utils/Tree.hpp"
 #include <QFile>
 #include <QTextStream>
@@ -29,6 +31,12 @@ namespace pygmy
  * ((Human:0.1,Gorilla:0.1):0.4,(Mouse:0.2,Rat:0.2):0.3);
  * </code>
  *
+ * Input is tokenized as it is read, so trees are parsed in a single pass
+ * without the file being held in memory, and gzip compressed files are read
+ * directly. Annotations within comments (e.g., [&rate=0.5,host="cow"] or
+ * [&&NHX:S=human:E=1.1.1]) are kept as metadata of the node they follow.
+ * Other comments are ignored.
+ *
  * Code example:
  * @code
  * #include <NewickIO.hpp>
@@ -65,6 +73,32 @@ public:
     bool Read(utils::Tree<NodePhylo>::Ptr tree, QTextStream &in);
 
 
+	/**
+	 * @brief Read a phylogenetic tree from a device.
+	 *
+	 * @param tree Tree to populate from device.
+	 * @param device Open device to read from. Gzip compressed input is decompressed.
+	 * @return True if tree loaded successfully, else false.
+	 */
+    bool Read(utils::Tree<NodePhylo>::Ptr tree, QIODevice* device);
+
+	/**
+	 * @brief Parse a tree from a stream of tokens.
+	 *
+	 * Tokens are consumed up to and including the semicolon ending the tree. This
+	 * allows trees embedded in other formats (e.g., NEXUS) to be parsed.
+	 *
+	 * @param tokenizer Source of tokens.
+	 * @param tree Tree to populate.
+	 * @param translate Optional table mapping labels in the tree to taxon names.
+	 * @return True if tree parsed successfully, else false.
+	 */
+    bool ParseTree(TreeTokenizer& tokenizer, utils::Tree<NodePhylo>::Ptr tree,
+                   const std::map<QString, QString>* translate = NULL);
+
+	/** Get description of the most recent error. */
+	QString GetError() const { return m_error; }
+
 	/**
 	 * @brief Parse a string in Newick format and convert it to a tree.
 	 *
@@ -79,57 +113,71 @@ public:
 	 *
 	 * @param tree Tree to write out to file.
 	 * @param out The output stream.
-	 * @throw IOException If output stream is invalid
 	 */
     void Write(utils::Tree<NodePhylo>::Ptr tree, QTextStream & out) const;
 
+	/**
+	 * @brief Write a phylogenetic tree to a device.
+	 *
+	 * The tree is traversed iteratively and written through a large output buffer,
+	 * so trees with millions of nodes can be written quickly with bounded memory.
+	 *
+	 * @param tree Tree to write out to file.
+	 * @param device Open device to write to.
+	 * @param compression Compression applied to the output.
+	 * @return True if tree was written successfully, else false.
+	 */
+    bool Write(utils::Tree<NodePhylo>::Ptr tree, QIODevice* device,
+               utils::BufferedWriter::COMPRESSION compression = utils::BufferedWriter::NO_COMPRESSION) const;
+
   /**
    * @brief Write a phylogenetic tree to a file.
+   *
+   * Files with a .gz extension are gzip compressed.
    *
 	 * @param tree Tree to write out to file.
    * @param filename The file path.
    * @param overwrite Tell if existing file should be overwritten or appended to.
-	 * @throw IOException If file can not be opened.
+   * @return True if tree was written successfully, else false.
    */
-    void Write(utils::Tree<NodePhylo>::Ptr tree, const QString & filename, bool overwrite = true) const
-	{
-        QFile output(filename);
-        if (!output.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
-            //TODO: make error msg
-            return;
-        QTextStream out(&output);
-        Write(tree, out);
-		output.close();
-	}
+    bool Write(utils::Tree<NodePhylo>::Ptr tree, const QString & filename, bool overwrite = true) const;
 
 protected:
-	 /**
-		* @brief Parse Newick string information about a node.
-		*
-		* @param node Node to associate information with.
-		* @param nodeInfo Node data obtained from Newick string.
-		* @return bLeafNode Flag indicating if node represents a leaf node (true) or internal node (false).
-		*/
-    void ParseNodeInfo(NodePhylo* node, QString& nodeInfo, bool bLeafNode);
-  
-		/**
-     * @brief Write elements of a node to file in Newick format.
-     *
-		 * @param tree Tree to write out to file.
-     * @param out The output stream.
-		 * @param parentID Index of parent node.
-		 * @param childID Node structure of the child node.
-     */
-        void WriteElements(utils::Tree<NodePhylo>::Ptr tree, QTextStream& out, NodePhylo* parent, NodePhylo* child) const;
+	/**
+	 * @brief Assign a name or support value to a node.
+	 *
+	 * The first label of a leaf node is its name. The first label of an internal node is its
+	 * name if it is quoted or not a number, and otherwise its support value. Any later label
+	 * is a support value.
+	 *
+	 * @param node Node to associate label with.
+	 * @param token Label read from the Newick string.
+	 * @param bLeafNode Flag indicating if node is a leaf node.
+	 * @param bFirstLabel Flag indicating if this is the first label of the node.
+	 * @param translate Optional table mapping labels to taxon names.
+	 */
+    void ParseLabel(NodePhylo* node, const TreeTokenizer::Token& token, bool bLeafNode, bool bFirstLabel,
+                    const std::map<QString, QString>* translate);
+
+	/**
+	 * @brief Parse annotations within a comment and add them to the metadata of a node.
+	 *
+	 * @param node Node to associate annotations with.
+	 * @param comment Text of comment, without the enclosing brackets.
+	 */
+    static void ParseAnnotation(NodePhylo* node, const QByteArray& comment);
 
 		/**
-     * @brief Write each node to file in Newick format.
+     * @brief Write name, support value and branch length of a node in Newick format.
      *
-		 * @param tree Tree to write out to file.
-     * @param out The output stream.
-		 * @param parentID Index of parent node.
+     * @param out The output buffer.
+		 * @param node Node to write.
      */
-        void WriteNodes(utils::Tree<NodePhylo>::Ptr tree, QTextStream &out, NodePhylo* parent) const;
+        void WriteNodeInfo(utils::BufferedWriter& out, NodePhylo* node) const;
+
+protected:
+	/** Description of the most recent error. */
+	QString m_error;
 };
 
 } 
@@ -0,0 +1,194 @@
+#include "NexusIO.hpp"
+
+#include "../core/NewickIO.hpp"
+#include "../core/TreeTokenizer.hpp"
+
+#include "../utils/StreamReader.hpp"
+
+#include <QFile>
+
+using namespace pygmy;
+using namespace utils;
+
+namespace
+{
+    /** Consume tokens up to and including the semicolon ending the current command. */
+    void SkipCommand(TreeTokenizer& tokenizer, TreeTokenizer::Token& token)
+    {
+        while(!token.Is(';') && tokenizer.Next(token))
+            ;
+    }
+
+    /** Read the label/taxon pairs of a TRANSLATE command. */
+    bool ReadTranslate(TreeTokenizer& tokenizer, std::map<QString, QString>& translate, QString& error)
+    {
+        TreeTokenizer::Token label, name;
+        for(;;)
+        {
+            if(!tokenizer.Next(label))
+                break;
+
+            if(label.Is(';'))
+                return true;
+
+            if(!label.IsWord() || !tokenizer.Next(name) || !name.IsWord())
+                break;
+
+            translate[label.ToString()] = name.ToString();
+
+            if(!tokenizer.Next(label))
+                break;
+
+            if(label.Is(';'))
+                return true;
+
+            if(!label.Is(','))
+                break;
+        }
+
+        if(!tokenizer.HasError())
+            error = QString("Invalid TRANSLATE command on line %1.").arg(tokenizer.GetLineNumber());
+
+        return false;
+    }
+}
+
+bool NexusIO::Read(Tree<NodePhylo>::Ptr tree, const QString& filename)
+{
+    std::vector<Tree<NodePhylo>::Ptr> trees;
+    if(!Read(trees, filename, 1))
+        return false;
+
+    // move nodes into the tree provided by the caller
+    tree->SetRootNode(trees.front()->GetRootNode());
+    tree->SetName(trees.front()->GetName());
+    trees.front()->SetRootNode(NULL);
+    tree->CalculateStatistics();
+
+    return true;
+}
+
+bool NexusIO::Read(std::vector<Tree<NodePhylo>::Ptr>& trees, const QString& filename, uint maxTrees)
+{
+    QFile input(filename);
+    if(!input.open(QIODevice::ReadOnly))
+    {
+        m_error = "Failed to open " + filename + ": " + input.errorString();
+        return false;
+    }
+
+    return Read(trees, &input, maxTrees);
+}
+
+bool NexusIO::Read(std::vector<Tree<NodePhylo>::Ptr>& trees, QIODevice* device, uint maxTrees)
+{
+    return ReadTrees(device, maxTrees, &trees, NULL, NULL);
+}
+
+bool NexusIO::Index(QIODevice* device, std::vector<TreeOffset>& offsets, std::vector< std::map<QString, QString> >& translateTables)
+{
+    return ReadTrees(device, UINT_MAX, NULL, &offsets, &translateTables);
+}
+
+bool NexusIO::ReadTrees(QIODevice* device, uint maxTrees, std::vector<Tree<NodePhylo>::Ptr>* trees,
+                        std::vector<TreeOffset>* offsets, std::vector< std::map<QString, QString> >* translateTables)
+{
+    m_error.clear();
+
+    StreamReader reader(device);
+    TreeTokenizer tokenizer(reader);
+    TreeTokenizer::Token token;
+
+    if(!tokenizer.Next(token) || !token.IsKeyword("#NEXUS"))
+    {
+        m_error = tokenizer.HasError() ? tokenizer.GetError() : "Input is not in NEXUS format (missing #NEXUS header).";
+        return false;
+    }
+
+    NewickIO newickIO;
+    std::map<QString, QString> translate;
+    bool bTreesBlock = false;
+    uint numTrees = 0;
+    while(numTrees < maxTrees && m_error.isEmpty() && tokenizer.Next(token))
+    {
+        if(token.type == TreeTokenizer::COMMENT)
+            continue;
+
+        if(token.IsKeyword("begin"))
+        {
+            if(tokenizer.Next(token))
+                bTreesBlock = token.IsKeyword("trees");
+
+            translate.clear();
+        }
+        else if(token.IsKeyword("end") || token.IsKeyword("endblock"))
+        {
+            bTreesBlock = false;
+        }
+        else if(bTreesBlock && token.IsKeyword("translate"))
+        {
+            translate.clear();
+            if(ReadTranslate(tokenizer, translate, m_error) && translateTables)
+                translateTables->push_back(translate);
+
+            continue;
+        }
+        else if(bTreesBlock && (token.IsKeyword("tree") || token.IsKeyword("utree")))
+        {
+            // TREE [*] name = [&R] newick;
+            QString name;
+            while(tokenizer.Next(token) && !token.Is('=') && !token.Is(';'))
+            {
+                if(token.IsWord() && token.text != "*")
+                    name = token.ToString();
+            }
+
+            if(!token.Is('='))
+            {
+                if(!tokenizer.HasError())
+                    m_error = QString("Invalid TREE command on line %1.").arg(tokenizer.GetLineNumber());
+                break;
+            }
+
+            if(offsets)
+            {
+                // only record where the tree starts
+                TreeOffset treeOffset;
+                treeOffset.offset = reader.GetPosition();
+                treeOffset.name = name;
+                treeOffset.translateTable = translate.empty() ? -1 : int(translateTables->size()) - 1;
+                offsets->push_back(treeOffset);
+                numTrees++;
+
+                if(!tokenizer.SkipTo(';') && tokenizer.HasError())
+                    break;
+
+                continue;
+            }
+
+            Tree<NodePhylo>::Ptr tree(new Tree<NodePhylo>());
+            if(!newickIO.ParseTree(tokenizer, tree, translate.empty() ? NULL : &translate))
+            {
+                m_error = newickIO.GetError();
+                break;
+            }
+
+            tree->SetName(name);
+            tree->CalculateStatistics();
+            trees->push_back(tree);
+            numTrees++;
+
+            continue;
+        }
+
+        SkipCommand(tokenizer, token);
+    }
+
+    if(m_error.isEmpty() && tokenizer.HasError())
+        m_error = tokenizer.GetError();
+
+    if(m_error.isEmpty() && numTrees == 0)
+        m_error = "No trees found in NEXUS file.";
+
+    return m_error.isEmpty();
+}
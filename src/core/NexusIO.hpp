@@ -0,0 +1,118 @@
+#ifndef _NEXUS_IO_HPP_
+#define _NEXUS_IO_HPP_
+
+#include "../core/NodePhylo.hpp"
+
+#include "../utils/Tree.hpp"
+
+#include <QIODevice>
+#include <QString>
+
+#include <climits>
+#include <vector>
+
+namespace pygmy
+{
+
+/**
+ * @brief Read trees in NEXUS format.
+ *
+ * Trees are read from the TREES block. Labels in a TRANSLATE command are
+ * replaced by the taxon names they map to, and annotations within comments
+ * following a node (e.g., [&posterior=0.95]) are kept as metadata of the
+ * node. All other blocks and commands are skipped.
+ *
+ * The file is tokenized as it is read, so files containing many trees are
+ * read in a single pass with only the requested trees held in memory.
+ *
+ * ex:
+ * <code>
+ * #NEXUS
+ * begin trees;
+ *     translate 1 Human, 2 Gorilla, 3 Mouse;
+ *     tree one = [&R] ((1:0.1,2:0.1)[&posterior=0.9]:0.4,3:0.5);
+ * end;
+ * </code>
+ *
+ * Code example:
+ * @code
+ * NexusIO nexusIO;
+ * std::vector<Tree<NodePhylo>::Ptr> trees;
+ * if(!nexusIO.Read(trees, "posterior.trees"))
+ *     qCritical() << nexusIO.GetError();
+ * @endcode
+ */
+class NexusIO
+{
+public:
+    /** Location of a tree within a NEXUS file. */
+    struct TreeOffset
+    {
+        /** Position of the Newick string of the tree within the file. */
+        qint64 offset;
+
+        /** Name given to the tree by its TREE command. */
+        QString name;
+
+        /** Index of the TRANSLATE table applying to the tree, or -1 if there is none. */
+        int translateTable;
+    };
+
+public:
+    /** Constructor. */
+    NexusIO() {}
+
+    /**
+     * @brief Read first tree in a file.
+     * @param tree Tree to populate from file.
+     * @param filename The file path.
+     * @return True if tree loaded successfully, else false.
+     */
+    bool Read(utils::Tree<NodePhylo>::Ptr tree, const QString& filename);
+
+    /**
+     * @brief Read trees in a file.
+     * @param trees Trees read from the file are appended to this list.
+     * @param filename The file path.
+     * @param maxTrees Maximum number of trees to read. Reading stops once this many trees have been read.
+     * @return True if at least one tree was read and no errors occurred, else false.
+     */
+    bool Read(std::vector<utils::Tree<NodePhylo>::Ptr>& trees, const QString& filename, uint maxTrees = UINT_MAX);
+
+    /**
+     * @brief Read trees from a device.
+     * @param trees Trees read from the device are appended to this list.
+     * @param device Open device to read from. Gzip compressed input is decompressed.
+     * @param maxTrees Maximum number of trees to read.
+     * @return True if at least one tree was read and no errors occurred, else false.
+     */
+    bool Read(std::vector<utils::Tree<NodePhylo>::Ptr>& trees, QIODevice* device, uint maxTrees = UINT_MAX);
+
+    /**
+     * @brief Find the location of all trees in a file without parsing them.
+     *
+     * Used to browse large tree sets, where each tree is parsed only when needed.
+     *
+     * @param device Open device to read from. Must not be compressed, since offsets refer to the device.
+     * @param offsets Set to the location of each tree.
+     * @param translateTables Set to the TRANSLATE tables referred to by the trees.
+     * @return True if at least one tree was found and no errors occurred, else false.
+     */
+    bool Index(QIODevice* device, std::vector<TreeOffset>& offsets, std::vector< std::map<QString, QString> >& translateTables);
+
+    /** Get description of the most recent error. */
+    QString GetError() const { return m_error; }
+
+protected:
+    /** Read (or only find the location of) trees in a device. */
+    bool ReadTrees(QIODevice* device, uint maxTrees, std::vector<utils::Tree<NodePhylo>::Ptr>* trees,
+                   std::vector<TreeOffset>* offsets, std::vector< std::map<QString, QString> >* translateTables);
+
+protected:
+    /** Description of the most recent error. */
+    QString m_error;
+};
+
+}
+
+#endif
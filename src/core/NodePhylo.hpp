@@ -28,7 +28,7 @@ public:
 	 * @brief Constructor.
 	 * @param id Unique id identifying node.
 	 */
-	NodePhylo(NodeId id): utils::Node(id), m_bootstrap(NO_DISTANCE), m_pos(utils::Point()), 
+	NodePhylo(NodeId id): utils::Node(id), m_bootstrap(NO_DISTANCE), m_pos(utils::Point()), m_extent(0),
 												m_colour(utils::Colour(0,0,0)), m_bProcessed(false), m_bMissingData(false),
                                                 m_baryCenter(0), m_layoutPos(0), m_crossings(0), m_bSelected(false) {}
 
@@ -37,7 +37,7 @@ public:
 	 * @param id Unique id identifying node.
 	 * @param name Name of node.
 	 */
-    NodePhylo(NodeId id,  const QString & name): Node(id, name), m_bootstrap(NO_DISTANCE), m_pos(utils::Point()),
+    NodePhylo(NodeId id,  const QString & name): Node(id, name), m_bootstrap(NO_DISTANCE), m_pos(utils::Point()), m_extent(0),
 												m_colour(utils::Colour(0,0,0)), m_bProcessed(false), m_bMissingData(false),
                                                 m_baryCenter(0), m_layoutPos(0), m_crossings(0), m_bSelected(false) {}
 
@@ -50,7 +50,7 @@ public:
    * @param node The node to copy.
    */
   NodePhylo(const NodePhylo& node): Node(node), m_bootstrap(node.GetBootstrapToParent()),
-		m_pos(node.GetPosition()), m_interval(node.GetInterval()), m_colour(node.GetColour()),
+		m_pos(node.GetPosition()), m_extent(node.GetExtent()), m_interval(node.GetInterval()), m_colour(node.GetColour()),
 		m_bProcessed(node.IsProcessed()), m_bMissingData(node.IsMissingData()),
 		m_baryCenter(node.GetBaryCenter()), m_layoutPos(node.GetLayoutPos()), m_crossings(node.GetNumCrossings()),
 		m_bSelected(node.IsSelected())
@@ -119,21 +119,22 @@ public:
 	}
 
     /**
-     * @brief Sort the child array based on the m_height parameter
+     * @brief Sort the child array by a key of each child, keeping children with equal keys in order
+     * @param keys Key of each node, indexed by node id
      * @param Sort based on ascending or descending (default)
      */
-    void sortChildren(bool ascending = false)
+    void sortChildren(const std::vector<double>& keys, bool ascending = false)
     {
         if(ascending)
         {
-            std::sort(m_children.begin(), m_children.end(), [](Node * a, Node * b){
-                return a->GetHeight() < b->GetHeight();
+            std::stable_sort(m_children.begin(), m_children.end(), [&keys](Node * a, Node * b){
+                return keys[a->GetId()] < keys[b->GetId()];
             });
         }
         else
         {
-            std::sort(m_children.begin(), m_children.end(), [](Node * a, Node * b){
-                return a->GetHeight() > b->GetHeight();
+            std::stable_sort(m_children.begin(), m_children.end(), [&keys](Node * a, Node * b){
+                return keys[a->GetId()] > keys[b->GetId()];
             });
         }
     }
@@ -173,6 +174,12 @@ public:
 	/** Get position of node. */
 	const utils::Point& GetPosition() const { return m_pos; }
 
+	/** Set x-position of the furthest leaf below node. */
+	void SetExtent(float extent) { m_extent = extent; }
+
+	/** Get x-position of the furthest leaf below node. */
+	float GetExtent() const { return m_extent; }
+
 	/** Set interval of node. */
 	void SetInterval(const utils::Interval& interval) { m_interval = interval; }
 
@@ -189,14 +196,19 @@ public:
     void SetMetadata(const std::map<QString, QString>& metadata) { m_metadata = metadata; }
 
 	/** Get metadata for node. */
-    std::map<QString, QString> GetMetadata() const { return m_metadata; }
+    const std::map<QString, QString>& GetMetadata() const { return m_metadata; }
 
 	/** 
 	 * @brief Get data for specified field. 
 	 * @param field Field to get data for. 
-	 * @return Data associated with the provided field.
+	 * @return Data associated with the provided field, or an empty string if the node has no such data.
 	 */
-    const QString& GetData(const QString& field) { return m_metadata[field]; }
+    const QString& GetData(const QString& field) const
+    {
+        static const QString noData;
+        std::map<QString, QString>::const_iterator it = m_metadata.find(field);
+        return (it != m_metadata.end()) ? it->second : noData;
+    }
 
 	/** Set processed flag. */
 	void SetProcessed(bool state) { m_bProcessed = state; }
@@ -234,7 +246,12 @@ public:
 	/** Determine if node is currently selected. */
 	virtual bool IsSelected() const { return m_bSelected; }
 
-    QString GetLabel() {
+    /**
+     * @brief Get label of node for the current label mode and metadata field.
+     *
+     * Leaf labels drawn by VisualTree are built in bulk by LabelCache instead.
+     */
+    QString GetLabel() const {
         if(State::Inst().GetShowLeafLabels() && State::Inst().GetShowMetadataLabels())
         {
             QString label = GetName() + " (" + GetData(State::Inst().GetMetadataField()) + ")";
@@ -248,6 +265,8 @@ public:
         {
             return GetData(State::Inst().GetMetadataField());
         }
+
+        return QString();
     }
 
 protected:
@@ -257,6 +276,9 @@ protected:
 	/** Position of node. */
 	utils::Point m_pos;
 
+	/** X-position of the furthest leaf below node. */
+	float m_extent;
+
 	/** Vertical region spanned by the leaves of this node. */
 	utils::Interval m_interval;
 
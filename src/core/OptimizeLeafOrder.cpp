@@ -7,15 +7,22 @@
 // http://creativecommons.org/licenses/by-sa/3.0/
 //=======================================================================
 
-#include "../core/Precompiled.hpp"
-
-#include "../core/App.hpp"
 #include "../core/OptimizeLeafOrder.hpp"
 #include "../core/NodePhylo.hpp"
 #include "../core/MetadataInfo.hpp"
 
 #include "../utils/TreeTools.hpp"
-#include "../utils/StringTools.hpp"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <functional>
 
 using namespace pygmy;
 using namespace utils;
@@ -38,552 +45,757 @@ bool IdenticalSetVectorPredicate(std::vector<IdenticalValueSet> elem1, std::vect
 	 return elem1.at(0).layoutPos < elem2.at(0).layoutPos;
 }
 
-void OptimizeLeafOrder::OptimizeLeafNodeOrdering(Tree<NodePhylo>::Ptr tree, MetadataInfoPtr metadataInfo, const std::wstring& field, 
-																											uint& numCrossings, bool bOptimize)
+namespace
 {
-	numCrossings = 0;
+	/** Nodes with more children than this are ordered by the barycenter heuristic, since the count matrix grows with the square of the number of children. */
+	const uint MAX_SEARCH_CHILDREN = 128;
 
-	FieldInfo fieldInfo = metadataInfo->GetInfo(field);
+	/** Subtrees with fewer leaves than this are never divided between threads. */
+	const uint MIN_TASK_LEAVES = 1024;
 
-	// assign layout position of each leaf node along colour map
-	std::vector<NodePhylo*> leafNodes = tree->GetLeaves();
-	foreach(NodePhylo* leafNode, leafNodes)
+	/** Limits on the search for the best order of the children of a single node. */
+	struct SearchLimit
 	{
-		leafNode->SetNumCrossings(0);
+		SearchLimit(uint _maxTime, quint64 _maxPermutations): maxTime(_maxTime), maxPermutations(_maxPermutations) {}
 
-		std::wstring value = leafNode->GetData(field);
-		if(!metadataInfo->IsMissingData(value))
-		{
-			// find position in unique values
-			uint pos = 0;
-			foreach(const std::wstring& v, fieldInfo.values)
-			{
-				if(value == v)
-					leafNode->SetLayoutPos(pos);
-				pos++;
-			}
-		}
-		else
-		{
-			// ignore leaf nodes with missing data
-			leafNode->SetLayoutPos(NOT_SET);
-		}
-	}
+		/** Maximum time (in ms) spent searching, or 0 for no limit on time. */
+		uint maxTime;
 
-	// find optimal ordering of leaf nodes in tree
-	BranchAndBoundTreeOpt(tree->GetRootNode(), numCrossings, bOptimize);
-}
+		/** Maximum number of permutations evaluated, or 0 for no limit on permutations. */
+		quint64 maxPermutations;
+	};
 
-void OptimizeLeafOrder::BranchAndBoundTreeOpt(NodePhylo* node, uint& numCrossings, bool bOptimize)
-{
-	if(!node->IsLeaf())
+	typedef struct sHEURISTIC_SORTER
 	{
-		uint numChildren = node->GetNumberOfChildren();
+		sHEURISTIC_SORTER(double _heuristicValue, uint _index, uint _degree): heuristicValue(_heuristicValue), index(_index), degree(_degree) {}
 
-		// optimize ordering of subtrees first
-		std::vector<uint> permutationVec;
-		for(uint i = 0; i < numChildren; ++i)
-		{
-			BranchAndBoundTreeOpt(node->GetChild(i), numCrossings, bOptimize);
-			permutationVec.push_back(i);
-		}
+		double heuristicValue;
+		uint index;
+		uint degree;
+	} HeuristicSorter;
 
-		// Get number of crossings in subtrees below this node
-		std::vector<NodePhylo*> childNode = node->GetChildren();
-		uint childrenCrossings = 0;
-		foreach(NodePhylo* child, childNode)
-		{
-			childrenCrossings += child->GetNumCrossings();
-		}
+	// Predicate used to sort items in HeuristicSorter.
+	bool HeuristicSorterPredicate(const HeuristicSorter& elem1, const HeuristicSorter& elem2)
+	{
+		if(elem1.heuristicValue != elem2.heuristicValue)
+			return elem1.heuristicValue < elem2.heuristicValue;
 
+		// if one of the elements has odd degree and the other even, than the
+		// odd degree vertex should be placed on the left. If both have the
+		// same degree than the order is arbitrary.
+		// see: Graph Drawing: Algorithms for the Visualization of Graphs
+		//				by Battista, Eades, Tamassia, Tollis
+		return (elem1.degree % 2 == 1) && (elem2.degree % 2 == 0);
+	}
 
-		// Get ordering of leaf nodes determine by barycenter heuristic
-		// Complexity barycenter heuristic: O(|E|)
-		std::vector<uint> baryCenterOrdering;
-		BaryCenterOrdering(node, baryCenterOrdering);				
+	/** Tree flattened into arrays, so leaf orders can be evaluated without modifying nodes. */
+	struct FlatTree
+	{
+		/** Nodes in pre-order, so the subtree of node i is nodes i to i + subtreeSize[i] - 1. */
+		std::vector<NodePhylo*> nodes;
+		std::vector<uint> subtreeSize;
 
-		// Get crossing count for the barycenter heuristic		
-		// Complexity: O(|E|log(|Vsmall|))
-		for(uint i = 0; i < numChildren; ++i)
-		{
-			node->SetChild(i, childNode.at(baryCenterOrdering.at(i)));
-		}
-		uint baryCenterBound = CountCrossingsByInversionNumber(node);
+		/** Children of node i are children[firstChild[i]] to children[firstChild[i+1] - 1]. */
+		std::vector<uint> firstChild;
+		std::vector<uint> children;
 
-		if(!bOptimize)
-		{
-			node->SetNumCrossings(childrenCrossings+baryCenterBound);
-			return;
-		}
+		/** Leaves below node i are the numLeaves[i] leaves starting at firstLeaf[i] in the original leaf order. */
+		std::vector<uint> firstLeaf;
+		std::vector<uint> numLeaves;
 
-		// It has been shown that if there is an ordering of points that results in zero crossings,
-		// that both the median and barycenter heuristics will find this ordering.
-		// see: Graph Drawing: Algorithms for the Visualization of Graphs
-		//				by Battista, Eades, Tamassia, Tollis
-		uint bound = baryCenterBound;
-		if(baryCenterBound == 0)
+		/** Layout position of each leaf in the original leaf order. */
+		std::vector<uint> leafPositions;
+	};
+
+	void Flatten(NodePhylo* root, FlatTree& tree)
+	{
+		std::vector<uint> parents;
+		std::vector< std::pair<NodePhylo*, uint> > stack(1, std::make_pair(root, uint(UINT_MAX)));
+		while(!stack.empty())
 		{
-			node->SetNumCrossings(childrenCrossings);
-			return;
+			NodePhylo* node = stack.back().first;
+			parents.push_back(stack.back().second);
+			stack.pop_back();
+
+			uint index = uint(tree.nodes.size());
+			tree.nodes.push_back(node);
+			if(node->IsLeaf())
+				tree.leafPositions.push_back(node->GetLayoutPos());
+
+			for(uint i = node->GetNumberOfChildren(); i > 0; --i)
+				stack.push_back(std::make_pair(node->GetChild(i-1), index));
 		}
-		else
+
+		uint numNodes = uint(tree.nodes.size());
+		tree.subtreeSize.assign(numNodes, 1);
+		tree.numLeaves.assign(numNodes, 0);
+		tree.firstLeaf.assign(numNodes, 0);
+		tree.firstChild.assign(numNodes+1, 0);
+		for(uint i = numNodes; i > 0; --i)
 		{
-			// Create count matrix
-			// Complexity: O(|Vsmall|^2) 
-			std::vector< std::vector<uint> > countMatrix;
-			CreateCountMatrix(node, countMatrix);
-
-			// Get order of children now that they are in the order specified by the barycenter heuristic.
-			// It is likely that lower bound will be found more quickly starting from this ordering than
-			// the default one.
-			childNode = node->GetChildren();	
-
-			// Determine best order of leaf nodes by performing a branch and bound search
-			// over the entire permutation tree as represented by a permutation vector.
-			std::vector<uint> optOrder = permutationVec;
-
-			// perform branch and bound on the permutation tree in a depth first search manner
-			// Complexity: O(?)
-			do
-			{		
-				uint crossingsForPermutation = 0;
-
-				// evaluate current permutation
-				// Complexity (worst case): O(|Vsmall|^2)
-				for(uint i = 1; i < numChildren; ++i)
-				{
-					// determine number of crossings for the potentially partial permutation						
-					for(uint j = 0; j < i; ++j)
-					{
-						crossingsForPermutation += countMatrix[permutationVec.at(j)][permutationVec.at(i)];
-						if(crossingsForPermutation >= bound)
-							break;
-					}
-			
-					if(i < numChildren-1 && crossingsForPermutation >= bound)
-					{
-						// No need to explore the rest of the permutation below the current node
-						// in the permutation tree. This portion of the tree can be skipped by
-						// setting the elements in the permutation vector beyond this node in
-						// descending order. This works because std::next_permutation() goes through
-						// permutations in a specific order. Namely, it always generates the
-						// "lexicographically next greater permutation of the elements".
-						//
-						// Note: this could be done in O(|Vsmall|) time using a radix sort,
-						// however in practice for the size of problem considered here
-						// the std::sort will be faster. Notice, that this step only every
-						// occurs once per permutation.
-						std::sort(permutationVec.begin()+i+1, permutationVec.end(), std::greater<int>());
-						break;
-					}
-				}
-				
-				if(crossingsForPermutation < bound)
-				{
-					bound = crossingsForPermutation;
-					optOrder = permutationVec;
-				}
-			} while(next_permutation(permutationVec.begin(), permutationVec.end()));
+			uint index = i-1;
+			if(tree.nodes[index]->IsLeaf())
+				tree.numLeaves[index] = 1;
 
-			// Set node to the optimal order
-			if(bound < baryCenterBound)
+			uint parent = parents[index];
+			if(parent != UINT_MAX)
 			{
-				// if the bary center bound is optimal than the children 
-				// have already been put in the correct order
-				node->RemoveChildren();
-				for(uint i = 0; i < numChildren; ++i)
-				{
-					node->AddChild(childNode.at(optOrder.at(i)));
-				}
+				tree.subtreeSize[parent] += tree.subtreeSize[index];
+				tree.numLeaves[parent] += tree.numLeaves[index];
+				tree.firstChild[parent+1]++;
 			}
 		}
 
-		// tabulate total number of crossings for tree
-		numCrossings += bound;
+		for(uint i = 0; i < numNodes; ++i)
+			tree.firstChild[i+1] += tree.firstChild[i];
 
-		node->SetNumCrossings(childrenCrossings + bound);
+		// a pre-order traversal visits the children of a node in order
+		tree.children.resize(numNodes-1);
+		std::vector<uint> nextChild(tree.firstChild.begin(), tree.firstChild.end()-1);
+		uint leaf = 0;
+		for(uint i = 0; i < numNodes; ++i)
+		{
+			tree.firstLeaf[i] = leaf;
+			if(tree.nodes[i]->IsLeaf())
+				leaf++;
+
+			if(parents[i] != UINT_MAX)
+				tree.children[nextChild[parents[i]]++] = i;
+		}
 	}
-}
 
-typedef struct sCROSS_SORTER
-{
-	sCROSS_SORTER(uint _southIndex, uint _northIndex): southIndex(_southIndex), northIndex(_northIndex) {}
+	/** Order of children and leaves found so far. Threads only modify the entries of the subtrees they are ordering. */
+	struct Ordering
+	{
+		/** Children of each node (see FlatTree::children), in their current order. */
+		std::vector<uint> children;
 
-	uint southIndex;
-	uint northIndex;
-} CrossSorter;
+		/** Layout position of each leaf, in the current leaf order. */
+		std::vector<uint> positions;
 
-// Predicate used to sort items in NodeSorter.
-bool CrossSorterPredicate(CrossSorter elem1, CrossSorter elem2)
-{
-	 return elem1.southIndex < elem2.southIndex;
-}
+		/** Number of crossings between the subtrees of each node. */
+		std::vector<uint> crossings;
+	};
 
-uint OptimizeLeafOrder::CountCrossingsByInversionNumber(NodePhylo* node, uint maxCrossings)
-{
-	// Determine lexicographical order of nodes on the north line as read from left to right
-	// across the south line. The implementation here takes O(|E|log(|E|)) where E is the 
-	// number of edges. It can be done in O(|E|) time by using radix sort. Although radix
-	// sort is better theoretically (and in practice for large |E|) I have decided to use
-	// std::sort for simplicity and since |E| is fairly small for the cases we are interested in.
-	std::vector<NodePhylo*> children = node->GetChildren();
-	std::vector<CrossSorter> crossSeq;
-	for(uint i = 0; i < children.size(); ++i)
+	/** Buffers used to order the children of a node, reused between nodes by a single thread. */
+	struct Scratch
+	{
+		std::vector< std::pair<uint, uint> > crossSeq;
+		std::vector<HeuristicSorter> baryCenters;
+		std::vector<uint> order;
+		std::vector<uint> rank;
+		std::vector<uint> accumulator;
+		std::vector<uint> countMatrix;
+		std::vector<uint> seen;
+		std::vector<uint> permutation;
+		std::vector<uint> bestPermutation;
+		std::vector<uint> offsets;
+		std::vector<uint> buffer;
+		QElapsedTimer timer;
+	};
+
+	/**
+	 * Count crossings between subtrees placed in the given order, with crossSeq holding the layout position
+	 * of each leaf and the subtree it is in sorted by position. Leaves with the same position do not cross.
+	 * See: "Simple and efficient bilayer cross counting" by Barth, W., Junger, M., and Mutzel, P. The
+	 * accumulator tree is stored as a Fenwick tree, so this takes O(|E|log(|V_small|)) time.
+	 */
+	uint CountCrossings(const std::vector< std::pair<uint, uint> >& crossSeq, const std::vector<uint>& rank,
+												uint numChildren, std::vector<uint>& accumulator)
 	{
-		if(children.at(i)->IsLeaf())
+		accumulator.assign(numChildren+1, 0);
+
+		uint crossCount = 0;
+		uint inserted = 0;
+		uint groupStart = 0;
+		for(uint k = 0; k < crossSeq.size(); ++k)
 		{
-			uint pos = children.at(i)->GetLayoutPos();
-			if(pos != NOT_SET)
+			if(crossSeq[k].first != crossSeq[groupStart].first)
 			{
-				CrossSorter crossSorter(pos, i);
-				crossSeq.push_back(crossSorter);
-			}
-		}
-		else
-		{
-			std::vector<NodePhylo*> grandChildren = TreeTools<NodePhylo>::GetLeaves(children.at(i));
-
-			foreach(NodePhylo* node, grandChildren)
-			{			
-				uint pos = node->GetLayoutPos();
-				if(pos != NOT_SET)
+				for(; groupStart < k; ++groupStart)
 				{
-					CrossSorter crossSorter(pos, i);
-					crossSeq.push_back(crossSorter);
+					for(uint index = rank[crossSeq[groupStart].second]+1; index <= numChildren; index += index & (~index+1))
+						accumulator[index]++;
+					inserted++;
 				}
 			}
+
+			// leaves already seen cross this one if their subtree is placed to the right of its subtree
+			uint notRight = 0;
+			for(uint index = rank[crossSeq[k].second]+1; index > 0; index -= index & (~index+1))
+				notRight += accumulator[index];
+			crossCount += inserted - notRight;
 		}
+
+		return crossCount;
 	}
 
-	std::sort(crossSeq.begin(), crossSeq.end(), CrossSorterPredicate);
-
-	// Count crossings using accumulator tree
-	// See: "Simple and efficient bilayer cross counting" by Barth, W., Junger, M., and Mutzel, P.
-	// This takes O(|E|log(|V_small|), where E is the number of edges and V_small is the smaller
-	// cardinality node set. In our case, E is the number of leaf nodes in the subtree rooted at 
-	// the specified node and V_small is the number of children of this node. Intuitively, the 
-	// runtime is O(|E|log(|V_small|)) since for each edge all positions in a balance search tree
-	// from the leaf node of this edge to the root must be updated. The height of the balanced
-	// search tree is log(|V_small|) so there is log(|V_small|) work for each edge.
-	uint firstIndex = 1;
-	while(firstIndex < children.size())
-		firstIndex *= 2;
-
-	uint treeSize = 2*firstIndex - 1;		// number of nodes in tree	
-	firstIndex -= 1;										// index of leftmost leaf
-	uint* tree = new uint[treeSize];
-	for(uint t = 0; t < treeSize; ++t)
-		tree[t] = 0;
-
-	uint crossCount = 0;
-	for(uint k = 0; k < crossSeq.size(); ++k)
+	/**
+	 * Create a count matrix indicating the number of crossings between any two subtrees, with
+	 * countMatrix[i*numChildren + j] the number of crossings when the subtree of rank i is placed
+	 * left of the subtree of rank j. Complexity: O(|E||V_small|).
+	 */
+	void CreateCountMatrix(const std::vector< std::pair<uint, uint> >& crossSeq, const std::vector<uint>& rank,
+												uint numChildren, std::vector<uint>& seen, std::vector<uint>& countMatrix)
 	{
-		uint index = crossSeq.at(k).northIndex + firstIndex;
-		tree[index]++;
-		while(index > 0)
+		countMatrix.assign(numChildren*numChildren, 0);
+		seen.assign(numChildren, 0);
+
+		uint groupStart = 0;
+		for(uint k = 0; k < crossSeq.size(); ++k)
 		{
-			if(index%2)
+			if(crossSeq[k].first != crossSeq[groupStart].first)
 			{
-				crossCount += tree[index+1];
-				if(crossCount > maxCrossings)
-					return crossCount;
+				for(; groupStart < k; ++groupStart)
+					seen[rank[crossSeq[groupStart].second]]++;
 			}
 
-			index = (index-1) / 2;
-			tree[index]++;
+			uint* row = &countMatrix[rank[crossSeq[k].second]*numChildren];
+			for(uint j = 0; j < numChildren; ++j)
+				row[j] += seen[j];
 		}
+
+		for(uint i = 0; i < numChildren; ++i)
+			countMatrix[i*numChildren + i] = 0;
 	}
 
-	delete[] tree;
+	/**
+	 * Find the order of subtrees with the fewest crossings by a branch and bound search over all
+	 * permutations, starting from the identity permutation. The search stops early if it exceeds
+	 * either limit, in which case the best order found so far is used.
+	 * @return Number of crossings of the best order, which is left in scratch.bestPermutation.
+	 */
+	uint BranchAndBound(Scratch& scratch, uint numChildren, uint bound, const SearchLimit& limit)
+	{
+		const std::vector<uint>& countMatrix = scratch.countMatrix;
+		std::vector<uint>& permutationVec = scratch.permutation;
 
-	return crossCount;
-}
+		permutationVec.resize(numChildren);
+		for(uint i = 0; i < numChildren; ++i)
+			permutationVec[i] = i;
+		scratch.bestPermutation = permutationVec;
 
-void OptimizeLeafOrder::CreateCountMatrix(NodePhylo* node, std::vector< std::vector<uint> >& countMatrix)
-{
-	std::vector<NodePhylo*> childNodes = node->GetChildren();
-	countMatrix.resize(childNodes.size());
-	for(uint i = 0; i < childNodes.size(); ++i)
-	{
-		countMatrix.at(i).resize(childNodes.size());
-	}
+		// the canonical lower bound: any two subtrees cross at least as often as in their best relative order
+		uint lowerBound = 0;
+		for(uint i = 0; i < numChildren; ++i)
+		{
+			for(uint j = i+1; j < numChildren; ++j)
+				lowerBound += std::min(countMatrix[i*numChildren + j], countMatrix[j*numChildren + i]);
+		}
 
-	// count crossings between all pairs of children 
-	for(uint i = 0; i < childNodes.size(); ++i)
-	{
-		for(uint j = 0; j < childNodes.size(); ++j)
+		if(bound <= lowerBound)
+			return bound;
+
+		scratch.timer.start();
+		quint64 iterations = 0;
+		do
 		{
-			if(i != j)
+			uint crossingsForPermutation = 0;
+
+			// evaluate current permutation
+			// Complexity (worst case): O(|Vsmall|^2)
+			for(uint i = 1; i < numChildren; ++i)
 			{
-				NodePhylo tempNode(0);
-				tempNode.AddChild(childNodes[i]);
-				tempNode.AddChild(childNodes[j]);
-				countMatrix[i][j] = CountCrossingsByInversionNumber(&tempNode);
+				// determine number of crossings for the potentially partial permutation
+				const uint* column = &countMatrix[permutationVec[i]];
+				for(uint j = 0; j < i; ++j)
+					crossingsForPermutation += column[permutationVec[j]*numChildren];
+
+				if(crossingsForPermutation >= bound)
+				{
+					// No need to explore the rest of the permutation below the current node
+					// in the permutation tree. This portion of the tree can be skipped by
+					// setting the elements in the permutation vector beyond this node in
+					// descending order. This works because std::next_permutation() goes through
+					// permutations in a specific order. Namely, it always generates the
+					// "lexicographically next greater permutation of the elements".
+					if(i < numChildren-1)
+						std::sort(permutationVec.begin()+i+1, permutationVec.end(), std::greater<uint>());
+					break;
+				}
 			}
-			else 
+
+			if(crossingsForPermutation < bound)
 			{
-				countMatrix[i][j] = 0;
+				bound = crossingsForPermutation;
+				scratch.bestPermutation = permutationVec;
+				if(bound == lowerBound)
+					break;
 			}
-		}
-	}
 
-	// reset all children to point to the parent node since they will be modified above
-	for(uint i = 0; i < childNodes.size(); ++i)
-	{
-		childNodes.at(i)->SetParent(node);
+			// fall back to the best order found so far if the search is taking too long
+			++iterations;
+			if(iterations == limit.maxPermutations)
+				break;
+
+			if(limit.maxTime != 0 && (iterations & 0xfff) == 0 && scratch.timer.elapsed() > qint64(limit.maxTime))
+				break;
+		} while(std::next_permutation(permutationVec.begin(), permutationVec.end()));
+
+		return bound;
 	}
-}
 
-uint OptimizeLeafOrder::CanonicalLowerBound(const std::vector< std::vector<uint> >& countMatrix)
-{
-	uint lowerBound = 0;
-	for(uint i = 0; i < countMatrix.size()-1; ++i)
+	/** Order the children of a node, whose subtrees must already be ordered. */
+	void OrderChildren(const FlatTree& tree, uint node, Ordering& ordering, Scratch& scratch, bool bOptimize, const SearchLimit& limit)
 	{
-		for(uint j = i+1; j < countMatrix.size(); ++j)
+		uint firstChild = tree.firstChild[node];
+		uint numChildren = tree.firstChild[node+1] - firstChild;
+		if(numChildren < 2)
+			return;
+
+		uint* children = &ordering.children[firstChild];
+		uint firstLeaf = tree.firstLeaf[node];
+
+		// gather the layout position of each leaf along with the subtree it is in, and
+		// the barycenter (average) of each subtree. This heuristic finds an O(sqrt(n))
+		// -approximation solution or a (d-1)-approximation solution, where d is the maximum degree of
+		// nodes in the free side.
+		scratch.crossSeq.clear();
+		scratch.baryCenters.clear();
+		scratch.offsets.resize(numChildren+1);
+		uint leaf = firstLeaf;
+		for(uint i = 0; i < numChildren; ++i)
 		{
-			uint c_ij = countMatrix[i][j];
-			uint c_ji = countMatrix[j][i];
+			uint child = children[i];
+			scratch.offsets[i] = leaf;
 
-			if(c_ij <= c_ji)
+			double sum = 0;
+			uint count = 0;
+			for(uint end = leaf + tree.numLeaves[child]; leaf < end; ++leaf)
 			{
-				lowerBound += c_ij;
-			}
-			else
-			{
-				lowerBound += c_ji;
+				uint pos = ordering.positions[leaf];
+				if(pos != NOT_SET)
+				{
+					scratch.crossSeq.push_back(std::make_pair(pos, i));
+					sum += pos;
+					count++;
+				}
 			}
+
+			// the placement of subtrees where none of the leaves have a position does not matter
+			// so just place them at the end
+			double baryCenter = (count != 0) ? sum / count : double(NOT_SET);
+			scratch.baryCenters.push_back(HeuristicSorter(baryCenter, i, tree.firstChild[child+1] - tree.firstChild[child]));
 		}
-	}
+		scratch.offsets[numChildren] = leaf;
 
-	return lowerBound;
-}
+		std::sort(scratch.crossSeq.begin(), scratch.crossSeq.end());
+		std::sort(scratch.baryCenters.begin(), scratch.baryCenters.end(), HeuristicSorterPredicate);
 
-typedef struct sHEURISTIC_SORTER
-{
-	sHEURISTIC_SORTER(double _heuristicValue, uint _index, uint _degree): heuristicValue(_heuristicValue), index(_index), degree(_degree) {}
+		scratch.order.resize(numChildren);
+		scratch.rank.resize(numChildren);
+		for(uint i = 0; i < numChildren; ++i)
+		{
+			scratch.order[i] = scratch.baryCenters[i].index;
+			scratch.rank[scratch.order[i]] = i;
+		}
 
-	double heuristicValue;
-	uint index;
-	uint degree;
-} HeuristicSorter;
+		// Get crossing count for the barycenter heuristic
+		// Complexity: O(|E|log(|Vsmall|))
+		uint bound = CountCrossings(scratch.crossSeq, scratch.rank, numChildren, scratch.accumulator);
 
-// Predicate used to sort items in NodeSorter.
-bool HeuristicSorterPredicate(HeuristicSorter elem1, HeuristicSorter elem2)
-{
-	if(elem1.heuristicValue < elem2.heuristicValue)
-	 return true;
-	else if(elem1.heuristicValue > elem2.heuristicValue)
-	 return false;
-	else
-	{
-		// if one of the elements has odd degree and the other even, than the
-		// odd degree vertex should be placed on the left. If both have the
-		// same degree than the order is arbitrary.
+		// It has been shown that if there is an ordering of points that results in zero crossings,
+		// that both the median and barycenter heuristics will find this ordering.
 		// see: Graph Drawing: Algorithms for the Visualization of Graphs
 		//				by Battista, Eades, Tamassia, Tollis
-		if(elem1.degree % 2 == 1)
-			return true;
+		if(bOptimize && bound > 0 && numChildren <= MAX_SEARCH_CHILDREN)
+		{
+			// the search starts from the barycenter order, since a good bound is then found quickly
+			CreateCountMatrix(scratch.crossSeq, scratch.rank, numChildren, scratch.seen, scratch.countMatrix);
+			bound = BranchAndBound(scratch, numChildren, bound, limit);
+
+			for(uint i = 0; i < numChildren; ++i)
+				scratch.rank[i] = scratch.order[scratch.bestPermutation[i]];
+			scratch.order.swap(scratch.rank);
+		}
+
+		ordering.crossings[node] = bound;
+
+		bool bIdentity = true;
+		for(uint i = 0; i < numChildren && bIdentity; ++i)
+			bIdentity = (scratch.order[i] == i);
+
+		if(bIdentity)
+			return;
+
+		// move the leaves of each subtree along with it
+		scratch.buffer.assign(ordering.positions.begin() + firstLeaf, ordering.positions.begin() + scratch.offsets[numChildren]);
+		std::vector<uint>::iterator dest = ordering.positions.begin() + firstLeaf;
+		for(uint i = 0; i < numChildren; ++i)
+		{
+			uint child = scratch.order[i];
+			dest = std::copy(scratch.buffer.begin() + (scratch.offsets[child] - firstLeaf),
+												scratch.buffer.begin() + (scratch.offsets[child+1] - firstLeaf), dest);
+		}
 
-		// Note: Weird way to write the above relationship so the it is a strictly weak ordering
-		// as required by STL
-		//if( ( elem1.degree % 2 ) >= ( elem2.degree % 2 ) ) 
-    //    return true; 
+		scratch.buffer.assign(children, children + numChildren);
+		for(uint i = 0; i < numChildren; ++i)
+			children[i] = scratch.buffer[scratch.order[i]];
 	}
-		
-		return false;
-}
 
-void OptimizeLeafOrder::BaryCenterOrdering(NodePhylo* node, std::vector<uint>& baryCenterOrdering)
-{
-	// Calculate the barycenter (average) for each subtree. This heuristic finds an O(sqrt(n))
-	// -approximation solution or a (d−1)-approximation solution, where d is the maximum degree of 
-	// nodes in the free side.
-
-	// This algorithm assumes the barycenter of all children node (except leaf nodes) has already been
-	// calculated. In this way, the barycenter can more efficently be calculated.
-	std::vector<NodePhylo*> childNodes = node->GetChildren();
-	std::vector<HeuristicSorter> baryCenters;
-	for(uint i = 0; i < childNodes.size(); ++i)
+	/** Order the children of every node in a subtree, with subtrees ordered before their parent. */
+	void OrderSubtree(const FlatTree& tree, uint root, Ordering& ordering, Scratch& scratch, bool bOptimize, const SearchLimit& limit)
+	{
+		for(uint i = root + tree.subtreeSize[root]; i > root; --i)
+			OrderChildren(tree, i-1, ordering, scratch, bOptimize, limit);
+	}
+
+	/** Subtrees ordered by a pool of threads. */
+	struct SubtreeTasks
+	{
+		SubtreeTasks(const SearchLimit& _limit): limit(_limit) {}
+
+		const FlatTree* tree;
+		Ordering* ordering;
+		bool bOptimize;
+		SearchLimit limit;
+
+		/** Root of each subtree, largest first. */
+		std::vector<uint> roots;
+
+		/** Index of the next subtree to be ordered. */
+		QAtomicInt next;
+	};
+
+	void OrderSubtrees(SubtreeTasks* tasks)
 	{
-		NodePhylo* curNode = childNodes.at(i);
+		// threads take the next subtree as soon as they are idle, so a thread given a
+		// subtree which is quick to order does not wait on the others
+		Scratch scratch;
+		int task;
+		while((task = tasks->next.fetchAndAddRelaxed(1)) < int(tasks->roots.size()))
+			OrderSubtree(*tasks->tree, tasks->roots[task], *tasks->ordering, scratch, tasks->bOptimize, tasks->limit);
+	}
+
+	/**
+	 * Find the order of children of every node, starting from the original order of the tree with the
+	 * given layout position of each leaf. The scratch buffers are used by the calling thread.
+	 */
+	void Optimize(const FlatTree& tree, const std::vector<uint>& leafPositions, Ordering& ordering, Scratch& scratch,
+								bool bOptimize, const SearchLimit& limit, bool bParallel)
+	{
+		uint numNodes = uint(tree.nodes.size());
+		ordering.children = tree.children;
+		ordering.positions = leafPositions;
+		ordering.crossings.assign(numNodes, 0);
 
-		if(curNode->IsLeaf())
+		uint numThreads = bParallel ? uint(qMax(1, QThread::idealThreadCount())) : 1;
+		if(numThreads == 1 || tree.numLeaves[0] <= MIN_TASK_LEAVES)
 		{
-			baryCenters.push_back(HeuristicSorter(curNode->GetLayoutPos(), i, 0));
+			OrderSubtree(tree, 0, ordering, scratch, bOptimize, limit);
+			return;
 		}
-		else
-		{
-			std::vector<NodePhylo*> childChildNodes = curNode->GetChildren();
 
-			uint baryCenter = 0;
-			uint divisor = 0;
-			foreach(NodePhylo* node, childChildNodes)
-			{
-				if(node->IsLeaf())
-				{
-					uint pos = node->GetLayoutPos();
-					if(pos != NOT_SET)
-					{
-						baryCenter += pos;
-						divisor++;
-					}
-				}
-				else
-				{
-					uint pos = node->GetBaryCenter();
-					if(pos != NOT_SET)
-					{
-						baryCenter += node->GetBaryCenter()*node->GetNumberOfChildren();
-						divisor += node->GetNumberOfChildren();
-					}
-				}
-			}
+		// the tree is divided into many more subtrees than threads, so threads remain busy when
+		// subtrees differ in how long they take to order; the nodes above these subtrees are
+		// ordered once all subtrees are done
+		uint grainSize = qMax(MIN_TASK_LEAVES, tree.numLeaves[0] / (numThreads * 16));
 
-			if(divisor != 0)
+		SubtreeTasks tasks(limit);
+		tasks.tree = &tree;
+		tasks.ordering = &ordering;
+		tasks.bOptimize = bOptimize;
+
+		std::vector<uint> upperNodes;
+		for(uint i = 0; i < numNodes; )
+		{
+			if(tree.numLeaves[i] <= grainSize)
 			{
-				baryCenter /= divisor;
+				tasks.roots.push_back(i);
+				i += tree.subtreeSize[i];
 			}
 			else
 			{
-				// the placement of nodes where none of the leaves are attached to geographic locations does not matter
-				// so just place it at the end and mark the internal node as being unset
-				baryCenter = NOT_SET;
+				upperNodes.push_back(i);
+				i++;
 			}
+		}
 
-			baryCenters.push_back(HeuristicSorter(baryCenter, i, childNodes.at(i)->GetNumberOfChildren()));
-			curNode->SetBaryCenter(baryCenter);
-		}		
-	}
-	std::sort(baryCenters.begin(), baryCenters.end(), HeuristicSorterPredicate);
+		std::vector< std::pair<uint, uint> > sizes;
+		foreach(uint root, tasks.roots)
+			sizes.push_back(std::make_pair(tree.numLeaves[root], root));
+		std::sort(sizes.begin(), sizes.end(), std::greater< std::pair<uint, uint> >());
+		for(uint i = 0; i < sizes.size(); ++i)
+			tasks.roots[i] = sizes[i].second;
 
-	for(uint i = 0; i < baryCenters.size(); ++i)
-	{
-		baryCenterOrdering.push_back(baryCenters.at(i).index);
+		std::vector< QFuture<void> > futures;
+		for(uint i = 1; i < numThreads; ++i)
+			futures.push_back(QtConcurrent::run(OrderSubtrees, &tasks));
+		OrderSubtrees(&tasks);
+
+		for(uint i = 0; i < futures.size(); ++i)
+			futures[i].waitForFinished();
+
+		// upper nodes are in pre-order, so children are ordered before their parents
+		for(uint i = uint(upperNodes.size()); i > 0; --i)
+			OrderChildren(tree, upperNodes[i-1], ordering, scratch, bOptimize, limit);
 	}
-}
 
-void OptimizeLeafOrder::MedianOrdering(NodePhylo* node, std::vector<uint>& medianOrdering)
-{
-	// Calculate the median for each subtree. This heuristic finds an 3-approximation solution,
-	// but in NodePhylo is often worse than the bartcenter heuristic.
-	std::vector<NodePhylo*> childNodes = node->GetChildren();
-	std::vector<HeuristicSorter> medians;
-	for(uint i = 0; i < childNodes.size(); ++i)
+	/** Reorder the children of each node and set the number of crossings within each subtree. */
+	uint Apply(const FlatTree& tree, const Ordering& ordering)
 	{
-		std::vector<NodePhylo*> leafNodes = TreeTools<NodePhylo>::GetLeaves(node->GetChild(i));
-		std::vector<uint> leafPos;
-		for(uint j = 0; j < leafNodes.size(); ++j)
+		uint numNodes = uint(tree.nodes.size());
+		std::vector<uint> crossings(ordering.crossings);
+		for(uint i = numNodes; i > 0; --i)
 		{
-			uint pos = leafNodes.at(j)->GetLayoutPos();
-			if(pos != NOT_SET)
+			uint node = i-1;
+			NodePhylo* nodePhylo = tree.nodes[node];
+			for(uint j = tree.firstChild[node]; j < tree.firstChild[node+1]; ++j)
 			{
-				leafPos.push_back(pos);
+				uint child = ordering.children[j];
+				crossings[node] += crossings[child];
+				nodePhylo->SetChild(j - tree.firstChild[node], tree.nodes[child]);
 			}
+
+			nodePhylo->SetNumCrossings(crossings[node]);
 		}
 
-		std::sort(leafPos.begin(), leafPos.end());
-		uint median = leafPos.at(leafPos.size()/2);
-		medians.push_back(HeuristicSorter(median, i, childNodes.at(i)->GetNumberOfChildren()));
+		return crossings[0];
 	}
-	std::sort(medians.begin(), medians.end(), HeuristicSorterPredicate);
 
-	for(uint i = 0; i < medians.size(); ++i)
+	/** Total number of crossings of an ordering. */
+	uint TotalCrossings(const Ordering& ordering)
 	{
-		medianOrdering.push_back(medians.at(i).index);
+		uint numCrossings = 0;
+		foreach(uint crossings, ordering.crossings)
+			numCrossings += crossings;
+
+		return numCrossings;
 	}
-}
 
-double OptimizeLeafOrder::SignificanceTest(Tree<NodePhylo>::Ptr tree, NodePhylo* node, uint iterations, std::map<uint, uint>& pdf)
-{
-	/*
-	wxProgressDialog* progressDlg = new wxProgressDialog("Performing Significance Test", "Iteration: 0", iterations, App::Inst().GetMainFrame());
-
-	// get order of leaf nodes
-	std::vector<uint> leafOrder;
-	std::vector<NodePhylo*> leafNodes = TreeTools<NodePhylo>::GetLeaves(node);
-	std::vector<NodePhylo*> activeLeafNodes;
-	foreach(NodePhylo* leaf, leafNodes)
+	/**
+	 * Counter-based random number generator: the SplitMix64 output function applied to a key and counter.
+	 * Any number in any stream can be generated directly, so permutations do not depend on which thread
+	 * performs them or in what order.
+	 */
+	quint64 RandomNumber(quint64 key, quint64 counter)
 	{
-		//if(leaf->GetActive())
-		{
-			leafOrder.push_back(leaf->GetLayoutPos());
-			activeLeafNodes.push_back(leaf);
-		}
+		quint64 z = key + (counter+1) * Q_UINT64_C(0x9e3779b97f4a7c15);
+		z = (z ^ (z >> 30)) * Q_UINT64_C(0xbf58476d1ce4e5b9);
+		z = (z ^ (z >> 27)) * Q_UINT64_C(0x94d049bb133111eb);
+		return z ^ (z >> 31);
 	}
 
-	// get number of crossings for original association of leaf nodes to geographical locations
-	uint origNumCrossings = 0;
-	OptimizeLeafNodeOrdering(tree, node, origNumCrossings, true);
+	/** Number of permutations performed before the p-value is first checked. */
+	const uint MIN_ROUND_ITERATIONS = 100;
 
-	// Create probability density function by holding the tree topology and order 
-	// of geographical locations along the layout line constant. Only the association 
-	// of leaf nodes to geographical location is randomized.
-	std::vector<uint> rndPermutation = leafOrder;
-	for(uint i = 0; i < iterations; ++i)
+	/** Buffers used by a single thread to evaluate permutations. */
+	struct PermutationWorker
+	{
+		std::vector<uint> positions;
+		std::vector<uint> values;
+		Ordering ordering;
+		Scratch scratch;
+	};
+
+	/** Permutations evaluated by a pool of threads. */
+	struct PermutationRound
+	{
+		PermutationRound(uint first, uint _end): end(_end), next(int(first)) {}
+
+		const FlatTree* tree;
+		quint64 seed;
+
+		/** Limits on the search for the order of children, which must not depend on timing. */
+		const SearchLimit* limit;
+
+		/** Index of leaves with a layout position, and their positions. */
+		const std::vector<uint>* located;
+		const std::vector<uint>* values;
+
+		/** Number of crossings resulting from each permutation. */
+		std::vector<uint>* crossings;
+
+		/** Index of the last permutation of this round, plus one. */
+		uint end;
+
+		/** Index of the next permutation to be evaluated. */
+		QAtomicInt next;
+	};
+
+	void EvaluatePermutations(PermutationRound* round, PermutationWorker* worker)
 	{
-		// randomly permute association between leaf node and geographical location
-		RandomPermutation(rndPermutation);
-		for(uint j = 0; j < activeLeafNodes.size(); ++j)
+		const std::vector<uint>& located = *round->located;
+		int iteration;
+		while((iteration = round->next.fetchAndAddRelaxed(1)) < int(round->end))
 		{
-			activeLeafNodes.at(j)->SetLayoutPos(rndPermutation.at(j));
+			// randomly permute association between leaf nodes and layout positions
+			// see: http://www.algoblog.com/2007/06/04/permutation/
+			quint64 key = RandomNumber(round->seed, uint(iteration));
+			std::vector<uint>& values = worker->values;
+			values = *round->values;
+			for(uint i = uint(values.size()); i > 1; --i)
+			{
+				uint j = uint(((RandomNumber(key, i) >> 32) * i) >> 32);
+				std::swap(values[i-1], values[j]);
+			}
+
+			worker->positions = round->tree->leafPositions;
+			for(uint i = 0; i < located.size(); ++i)
+				worker->positions[located[i]] = values[i];
+
+			Optimize(*round->tree, worker->positions, worker->ordering, worker->scratch, true, *round->limit, false);
+			(*round->crossings)[iteration] = TotalCrossings(worker->ordering);
 		}
+	}
+}
 
-		uint numCrossings = 0;
-		OptimizeLeafNodeOrdering(tree, node, numCrossings, true);
 
-		std::map<uint, uint>::iterator iter;
-		iter = pdf.find(numCrossings);
-		if(iter == pdf.end())
+void OptimizeLeafOrder::OptimizeLeafNodeOrdering(Tree<NodePhylo>::Ptr tree, MetadataInfoPtr metadataInfo, const QString& field, 
+																											uint& numCrossings, bool bOptimize, uint maxNodeTime)
+{
+	numCrossings = 0;
+
+	FieldInfo fieldInfo = metadataInfo->GetInfo(field);
+
+	// assign layout position of each leaf node along colour map
+	std::vector<NodePhylo*> leafNodes = tree->GetLeaves();
+	foreach(NodePhylo* leafNode, leafNodes)
+	{
+		leafNode->SetNumCrossings(0);
+
+		QString value = leafNode->GetData(field);
+		if(!metadataInfo->IsMissingData(value))
 		{
-			pdf[numCrossings] = 1;
+			// find position in unique values
+			uint pos = 0;
+			foreach(const QString& v, fieldInfo.values)
+			{
+				if(value == v)
+					leafNode->SetLayoutPos(pos);
+				pos++;
+			}
 		}
 		else
 		{
-			iter->second++;
-		}
-
-		if(!progressDlg->Update(i, "Iteration: " + utils::StringTools::ToString(i)))
-		{
-			progressDlg->Destroy();
-			return 1.0f;
+			// ignore leaf nodes with missing data
+			leafNode->SetLayoutPos(NOT_SET);
 		}
 	}
 
-	// determine p-value for original association of leaf nodes to geographical locations
-	std::map<uint, uint>::iterator iter;
-	uint pValueCount = 0;
-	for(iter = pdf.begin(); iter != pdf.end(); ++iter)
-	{
-		if(iter->first <= origNumCrossings)
-			pValueCount += iter->second;
-	}
-	double pValue = (pValueCount + 1.0) / (iterations + 1.0);		// the +1 is to account for the original model (permutation)
-	
-	// restore original order and statistics for tree
-	for(uint i = 0; i < activeLeafNodes.size(); ++i)
+	// find optimal ordering of leaf nodes in tree
+	BranchAndBoundTreeOpt(tree->GetRootNode(), numCrossings, bOptimize, maxNodeTime);
+}
+
+void OptimizeLeafOrder::OptimizeLeafNodeOrdering(Tree<NodePhylo>::Ptr tree, const QHash<QString, uint>& leafPositions,
+																											uint& numCrossings, bool bOptimize, uint maxNodeTime)
+{
+	numCrossings = 0;
+
+	// leaf nodes without a position do not contribute any crossings
+	std::vector<NodePhylo*> leafNodes = tree->GetLeaves();
+	foreach(NodePhylo* leafNode, leafNodes)
 	{
-		activeLeafNodes.at(i)->SetLayoutPos(leafOrder.at(i));
+		leafNode->SetNumCrossings(0);
+		leafNode->SetLayoutPos(leafPositions.value(leafNode->GetName(), NOT_SET));
 	}
 
-	uint numCrossings = 0;
-	OptimizeLeafNodeOrdering(tree, node, numCrossings, true);
-
-	progressDlg->Destroy();
+	// find optimal ordering of leaf nodes in tree
+	BranchAndBoundTreeOpt(tree->GetRootNode(), numCrossings, bOptimize, maxNodeTime);
+}
 
-	return pValue;
-	*/
-	return 0;
+void OptimizeLeafOrder::BranchAndBoundTreeOpt(NodePhylo* node, uint& numCrossings, bool bOptimize, uint maxNodeTime)
+{
+	// Independent subtrees are ordered in parallel. The order of the children of each node is found
+	// by first ordering them by the barycenter heuristic and then performing a branch and bound search
+	// over the entire permutation tree as represented by a permutation vector.
+	FlatTree tree;
+	Flatten(node, tree);
+
+	Ordering ordering;
+	Scratch scratch;
+	Optimize(tree, tree.leafPositions, ordering, scratch, bOptimize, SearchLimit(maxNodeTime, 0), true);
+
+	// tabulate total number of crossings for tree
+	numCrossings += Apply(tree, ordering);
 }
 
-void OptimizeLeafOrder::RandomPermutation(std::vector<uint>& leafOrder)
+OptimizeLeafOrder::SignificanceTestResults OptimizeLeafOrder::SignificanceTest(NodePhylo* node, uint iterations, double precision, quint64 seed)
 {
-	// randomly permute order of leaf nodes
-	// see: http://www.algoblog.com/2007/06/04/permutation/
-	for(uint i = 1; i < leafOrder.size(); ++i)
+	SignificanceTestResults results;
+	results.numCrossings = 0;
+	results.pValue = 1.0;
+	results.confidenceInterval = 0.0;
+	results.iterations = 0;
+	results.iterationsPerSecond = 0.0;
+
+	FlatTree tree;
+	Flatten(node, tree);
+
+	// leaf nodes with missing data are ignored, so only the association of other
+	// leaf nodes to layout positions is randomized
+	std::vector<uint> located;
+	std::vector<uint> values;
+	for(uint i = 0; i < tree.leafPositions.size(); ++i)
+	{
+		if(tree.leafPositions[i] != NOT_SET)
+		{
+			located.push_back(i);
+			values.push_back(tree.leafPositions[i]);
+		}
+	}
+
+	// the search for the order of children is bounded by a number of permutations rather than
+	// by time, so the number of crossings of each permutation does not depend on the load or
+	// number of threads
+	SearchLimit limit(0, SIGNIFICANCE_NODE_PERMUTATIONS);
+
+	// get number of crossings for original association of leaf nodes to layout positions
+	uint numThreads = uint(qMax(1, QThread::idealThreadCount()));
+	std::vector<PermutationWorker> workers(numThreads);
+	Optimize(tree, tree.leafPositions, workers[0].ordering, workers[0].scratch, true, limit, true);
+	results.numCrossings = TotalCrossings(workers[0].ordering);
+
+	// Create probability density function by holding the tree topology and order 
+	// of layout positions constant. Only the association of leaf nodes to layout
+	// positions is randomized. Each permutation is ordered serially by a single
+	// thread, with different permutations ordered concurrently.
+	std::vector<uint> crossings(iterations);
+	uint pValueCount = 0;
+	QElapsedTimer timer;
+	timer.start();
+	while(results.iterations < iterations)
 	{
-		uint j = rand() % (i+1);
-		uint temp = leafOrder.at(i);
-		leafOrder.at(i) = leafOrder.at(j);
-		leafOrder.at(j) = temp;
+		// rounds double in size, so the p-value is checked often at first without
+		// threads frequently waiting on each other later
+		uint first = results.iterations;
+		PermutationRound round(first, first + qMin(iterations - first, qMax(MIN_ROUND_ITERATIONS, first)));
+		round.tree = &tree;
+		round.seed = seed;
+		round.limit = &limit;
+		round.located = &located;
+		round.values = &values;
+		round.crossings = &crossings;
+
+		std::vector< QFuture<void> > futures;
+		for(uint i = 1; i < numThreads; ++i)
+			futures.push_back(QtConcurrent::run(EvaluatePermutations, &round, &workers[i]));
+		EvaluatePermutations(&round, &workers[0]);
+
+		for(uint i = 0; i < futures.size(); ++i)
+			futures[i].waitForFinished();
+
+		for(uint i = first; i < round.end; ++i)
+		{
+			results.pdf[crossings[i]]++;
+			if(crossings[i] <= results.numCrossings)
+				pValueCount++;
+		}
+		results.iterations = round.end;
+
+		// determine p-value for original association of leaf nodes to layout positions
+		double n = results.iterations + 1.0;	// the +1 is to account for the original model (permutation)
+		results.pValue = (pValueCount + 1.0) / n;
+
+		// Wilson score interval, which remains sensible for p-values near 0
+		const double z = 1.96;
+		results.confidenceInterval = z * sqrt(results.pValue*(1.0 - results.pValue)/n + z*z/(4*n*n)) / (1.0 + z*z/n);
+		if(precision > 0 && results.confidenceInterval <= precision)
+			break;
 	}
+
+	qint64 elapsed = timer.elapsed();
+	results.iterationsPerSecond = (elapsed > 0) ? 1000.0 * results.iterations / elapsed : 0.0;
+
+	return results;
 }
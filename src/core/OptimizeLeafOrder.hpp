@@ -10,17 +10,33 @@
 #ifndef _OPT_LEAF_ORDER_
 #define _OPT_LEAF_ORDER_
 
-#include "../core/Precompiled.hpp"
-
+#include "../core/DataTypes.hpp"
 #include "../core/NodePhylo.hpp"
 
 #include "../utils/Tree.hpp"
 
+#include <QHash>
+#include <QString>
+
+#include <climits>
+#include <map>
+#include <vector>
+
 namespace pygmy 
 {
 
 class OptimizeLeafOrder
 {
+public:
+	/** Default time (in ms) spent searching for the best order of the children of a single node before the best order found so far is used. */
+	static const uint DEFAULT_MAX_NODE_TIME = 100;
+
+	/**
+	 * Number of permutations searched for the best order of the children of a single node during a significance test.
+	 * A fixed number of permutations is used rather than a time limit so results do not depend on timing.
+	 */
+	static const uint SIGNIFICANCE_NODE_PERMUTATIONS = 1 << 20;
+
 public:
 	/**
 	 * @brief Find optimal leaf ordering of a tree using branch and bound in order to reduce required computation.
@@ -30,67 +46,70 @@ public:
 	 * @param field Metadata field to perform optimization on.
 	 * @param numCrossings Number of crossings that occurs after optimizing leaf node order.
 	 * @param bOptimize Flag indicating if optimal ordering should be found (true) or if a heuristic ordering should be used (false).
+	 * @param maxNodeTime Maximum time (in ms) spent searching for the best order of the children of a single node, or 0 for no limit.
 	 */
-	static void OptimizeLeafNodeOrdering(utils::Tree<NodePhylo>::Ptr tree, MetadataInfoPtr metadataInfo, const std::wstring& field,
-																					uint& numCrossings, bool bOptimize);
-
-	/**
-	 * @brief Perform Monte Carlo significance test between tree topology and position of points on layout primative.
-	 * @param tree Tree significance test will be performed on.
-	 * @param node Subtree to perform significance test on.
-	 * @param iterations Number of iterations to perform when creating probability density function.
-	 * @param pdf Probability density function generated by significance test.
-	 * @return P-value from significance test.
-	 */
-	static double SignificanceTest(utils::Tree<NodePhylo>::Ptr tree, NodePhylo* node, uint iterations, std::map<uint, uint>& pdf);
+	static void OptimizeLeafNodeOrdering(utils::Tree<NodePhylo>::Ptr tree, MetadataInfoPtr metadataInfo, const QString& field,
+																					uint& numCrossings, bool bOptimize, uint maxNodeTime = DEFAULT_MAX_NODE_TIME);
 
-protected:
 	/**
-	 * @brief Find optimal leaf ordering of a tree using branch and bound in order to reduce required computation.
-	 *				Note: This algorithm is designed to work with multifurcating trees.
-	 * @param node Tree (subtree) to find optimal leaf ordering for.
+	 * @brief Find leaf ordering of a tree which best matches a given order of leaves (e.g., the leaf order of another tree).
+	 * @param tree Tree to optimize leaf node ordering of.
+	 * @param leafPositions Desired position of leaves, indexed by name. Leaves without a position are ignored.
 	 * @param numCrossings Number of crossings that occurs after optimizing leaf node order.
 	 * @param bOptimize Flag indicating if optimal ordering should be found (true) or if a heuristic ordering should be used (false).
+	 * @param maxNodeTime Maximum time (in ms) spent searching for the best order of the children of a single node, or 0 for no limit.
 	 */
-	static void BranchAndBoundTreeOpt(NodePhylo* node, uint& numCrossings, bool bOptimize);
+	static void OptimizeLeafNodeOrdering(utils::Tree<NodePhylo>::Ptr tree, const QHash<QString, uint>& leafPositions,
+																					uint& numCrossings, bool bOptimize, uint maxNodeTime = DEFAULT_MAX_NODE_TIME);
 
-	/**
-	 * @brief Count number of crossings between the subtrees below a given node (crossings within a subtree are not counted).
-	 * @param node Crossings between subtrees below this node will be counted.
-	 * @param leafOrder Desired order of leaf nodes (from left to right).
-	 * @param maxCrossings Function will return immediately after counting more than this many crossings.
-	 * @return Number of crossings.
-	 */
-	static uint CountCrossingsByInversionNumber(NodePhylo* node, uint maxCrossings = INT_MAX);
+	/** Results of a permutation significance test. */
+	typedef struct sSIGNIFICANCE_TEST_RESULTS
+	{
+		/** Number of crossings for the original association of leaf nodes to layout positions. */
+		uint numCrossings;
 
-	/**
-	 * @brief Create a count matrix which indicates the number of crossings between any two subtrees below the given node.
-	 *				Note: crossings within a subtree are not counted.
-	 * @param node Crossings between subtrees below this node will be tabulated into a counting matrix.
-	 * @param countMatrix Count matrix to be populated.
-	 */
-	static void CreateCountMatrix(NodePhylo* node, std::vector< std::vector<uint> >& countMatrix);
+		/** Proportion of permutations, counting the original association, with at most as many crossings. */
+		double pValue;
 
-	/**
-	 * @brief Calculate the canonical lower bound on the number of crossings.
-	 * @param countMatrix Count matrix indicating number of crossings between any pair of subtrees (see CreateCountMatrix).
-	 */
-	static uint CanonicalLowerBound(const std::vector< std::vector<uint> >& countMatrix);
+		/** Half width of the 95% confidence interval of the p-value. */
+		double confidenceInterval;
+
+		/** Number of permutations performed. */
+		uint iterations;
+
+		/** Number of permutations performed per second. */
+		double iterationsPerSecond;
+
+		/** Number of permutations resulting in each number of crossings. */
+		std::map<uint, uint> pdf;
+	} SignificanceTestResults;
 
 	/**
-	 * @brief Calculate the ordering of subtrees below the given nodes as determined by the barycenter heuristic.
-	 * @param baryCenterOrdering The barycenter ordering.
+	 * @brief Perform Monte Carlo significance test between tree topology and position of points on layout primative.
+	 *				The layout position of leaf nodes must already be set (see OptimizeLeafNodeOrdering()). Leaf nodes
+	 *				are not modified: the association of leaf nodes to layout positions is randomized in arrays private
+	 *				to each thread, with permutations performed concurrently.
+	 * @param node Subtree to perform significance test on.
+	 * @param iterations Maximum number of iterations to perform when creating probability density function.
+	 * @param precision Stop once the half width of the 95% confidence interval of the p-value is at most this value (0 to perform all iterations).
+	 * @param seed Seed of random permutations. The search for the order of the children of each node is limited to
+	 *				SIGNIFICANCE_NODE_PERMUTATIONS permutations rather than a time, so results for a given seed do not depend
+	 *				on timing or the number of threads.
+	 * @return Results of significance test.
 	 */
-	static void BaryCenterOrdering(NodePhylo* node, std::vector<uint>& baryCenterOrdering);
+	static SignificanceTestResults SignificanceTest(NodePhylo* node, uint iterations, double precision = 0, quint64 seed = 0);
 
+protected:
 	/**
-	 * @brief Calculate the ordering of subtrees below the given nodes as determined by the median heuristic.
-	 * @param medianOrdering The median ordering.
+	 * @brief Find optimal leaf ordering of a tree using branch and bound in order to reduce required computation.
+	 *				Note: This algorithm is designed to work with multifurcating trees.
+	 *				Independent subtrees are ordered in parallel on the global thread pool.
+	 * @param node Tree (subtree) to find optimal leaf ordering for.
+	 * @param numCrossings Number of crossings that occurs after optimizing leaf node order.
+	 * @param bOptimize Flag indicating if optimal ordering should be found (true) or if a heuristic ordering should be used (false).
+	 * @param maxNodeTime Maximum time (in ms) spent searching for the best order of the children of a single node, or 0 for no limit.
 	 */
-	static void MedianOrdering(NodePhylo* node, std::vector<uint>& medianOrdering);
-
-	/** Randomly permute a vector. */
-	static void RandomPermutation(std::vector<uint>& leafOrder);
+	static void BranchAndBoundTreeOpt(NodePhylo* node, uint& numCrossings, bool bOptimize, uint maxNodeTime);
 
 protected:
 
@@ -0,0 +1,250 @@
+#include "OverviewRaster.hpp"
+
+#include "FoldedClades.hpp"
+#include "MemoryReport.hpp"
+#include "VisualTree.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+using namespace pygmy;
+using namespace utils;
+
+namespace
+{
+    /** Number of branches covering a pixel and the sum of their colours. */
+    struct Coverage
+    {
+        Coverage(): count(0), red(0), green(0), blue(0) {}
+
+        void Add(const Coverage& c, int sign)
+        {
+            count += sign*c.count;
+            red += sign*c.red;
+            green += sign*c.green;
+            blue += sign*c.blue;
+        }
+
+        int count, red, green, blue;
+    };
+
+    /** Spans of pixels covered by branches, aggregated as differences along each row and column. */
+    class SpanBuffer
+    {
+    public:
+        SpanBuffer(int width, int height)
+            : m_width(width), m_height(height), m_rows((width + 1) * height), m_columns(width * (height + 1)) {}
+
+        /** Cover pixels of a row between two columns. */
+        void AddRowSpan(int row, int col0, int col1, const Coverage& c)
+        {
+            if(col0 > col1)
+                std::swap(col0, col1);
+
+            if(row < 0 || row >= m_height || col1 < 0 || col0 >= m_width)
+                return;
+
+            col0 = std::max(col0, 0);
+            col1 = std::min(col1, m_width - 1);
+            m_rows[row*(m_width + 1) + col0].Add(c, 1);
+            m_rows[row*(m_width + 1) + col1 + 1].Add(c, -1);
+        }
+
+        /** Cover pixels of a column between two rows. */
+        void AddColumnSpan(int col, int row0, int row1, const Coverage& c)
+        {
+            if(row0 > row1)
+                std::swap(row0, row1);
+
+            if(col < 0 || col >= m_width || row1 < 0 || row0 >= m_height)
+                return;
+
+            row0 = std::max(row0, 0);
+            row1 = std::min(row1, m_height - 1);
+            m_columns[row0*m_width + col].Add(c, 1);
+            m_columns[(row1 + 1)*m_width + col].Add(c, -1);
+        }
+
+        /** Sum differences into an image coloured by the average colour of the branches covering each pixel. */
+        QImage Resolve() const
+        {
+            QImage image(m_width, m_height, QImage::Format_ARGB32);
+            image.fill(0);
+
+            std::vector<Coverage> columns(m_width);
+            for(int row = 0; row < m_height; ++row)
+            {
+                // rows are counted from the bottom of the viewport, scan lines from the top of the image
+                QRgb* scanLine = reinterpret_cast<QRgb*>(image.scanLine(m_height - 1 - row));
+
+                Coverage span;
+                for(int col = 0; col < m_width; ++col)
+                {
+                    span.Add(m_rows[row*(m_width + 1) + col], 1);
+                    columns[col].Add(m_columns[row*m_width + col], 1);
+
+                    Coverage total = span;
+                    total.Add(columns[col], 1);
+                    if(total.count > 0)
+                        scanLine[col] = qRgb(total.red / total.count, total.green / total.count, total.blue / total.count);
+                }
+            }
+
+            return image;
+        }
+
+    private:
+        int m_width, m_height;
+
+        /** Differences along each row, with an extra column so spans may end at the last pixel. */
+        std::vector<Coverage> m_rows;
+
+        /** Differences along each column, with an extra row so spans may end at the last pixel. */
+        std::vector<Coverage> m_columns;
+    };
+}
+
+void OverviewRaster::Capture(VisualTreePtr visualTree)
+{
+    m_nodes.clear();
+    m_folds.clear();
+
+    utils::Tree<NodePhylo>::Ptr tree = visualTree->GetTree();
+    if(!tree || !tree->GetRootNode())
+        return;
+
+    m_nodes.reserve(tree->GetNumberOfNodes());
+
+    const FoldedClades& foldedClades = visualTree->GetFoldedClades();
+    std::vector< std::pair<NodePhylo*, int> > stack(1, std::make_pair(tree->GetRootNode(), -1));
+    while(!stack.empty())
+    {
+        NodePhylo* node = stack.back().first;
+        int parent = stack.back().second;
+        stack.pop_back();
+
+        Point pos = visualTree->GetNodePosition(node);
+        const Colour& colour = node->GetColour();
+
+        Node n;
+        n.x = pos.x;
+        n.y = pos.y;
+        n.parent = parent;
+        n.colour = qRgb(colour.GetRedInt(), colour.GetGreenInt(), colour.GetBlueInt());
+
+        int index = int(m_nodes.size());
+        m_nodes.push_back(n);
+
+        // nodes within folded clades are not drawn
+        if(foldedClades.IsFolded(node))
+        {
+            Interval interval = visualTree->GetNodeInterval(node);
+
+            Fold fold;
+            fold.node = uint(index);
+            fold.extent = foldedClades.GetFoldedExtent(node);
+            fold.start = interval.start;
+            fold.end = interval.end;
+            m_folds.push_back(fold);
+            continue;
+        }
+
+        for(uint i = node->GetNumberOfChildren(); i > 0; --i)
+            stack.push_back(std::make_pair(node->GetChild(i-1), index));
+    }
+}
+
+QImage OverviewRaster::Rasterize(const Settings& settings) const
+{
+    if(settings.width <= 0 || settings.height <= 0)
+        return QImage();
+
+    // branches are offset to either side of their position as in the main viewport
+    int thicknessMajor = static_cast<int>(1 + settings.lineWidth*0.5);
+    int thicknessMinor = static_cast<int>((settings.lineWidth - 0.5)*0.5);
+
+    // scale and translation of tree, with lines aligned to pixels
+    float sx = settings.width - 2*settings.borderX;
+    float sy = settings.height - 2*settings.borderY;
+    float dx = settings.borderX + 0.5f;
+    float dy = settings.borderY + 0.5f;
+
+    std::vector<int> cols(m_nodes.size());
+    std::vector<int> rows(m_nodes.size());
+    for(uint i = 0; i < m_nodes.size(); ++i)
+    {
+        cols[i] = int(m_nodes[i].x*sx + dx);
+        rows[i] = int(m_nodes[i].y*sy + dy);
+    }
+
+    // each branch adds its colour to the pixels it covers
+    auto colour = [this, &settings](uint i) {
+        QRgb rgb = settings.bColour ? m_nodes[i].colour : qRgb(128, 128, 128);
+        Coverage c;
+        c.count = 1;
+        c.red = qRed(rgb);
+        c.green = qGreen(rgb);
+        c.blue = qBlue(rgb);
+        return c;
+    };
+
+    SpanBuffer buffer(settings.width, settings.height);
+
+    // horizontal branches, while finding the rows spanned by the children of each node
+    std::vector<int> minRows(m_nodes.size(), INT_MAX);
+    std::vector<int> maxRows(m_nodes.size(), INT_MIN);
+    for(uint i = 0; i < m_nodes.size(); ++i)
+    {
+        int parent = m_nodes[i].parent;
+        if(parent < 0)
+            continue;
+
+        for(int row = rows[i] - thicknessMinor; row < rows[i] + thicknessMajor; ++row)
+            buffer.AddRowSpan(row, cols[parent], cols[i], colour(i));
+
+        minRows[parent] = std::min(minRows[parent], rows[i]);
+        maxRows[parent] = std::max(maxRows[parent], rows[i]);
+    }
+
+    // a single vertical branch for each internal node
+    for(uint i = 0; i < m_nodes.size(); ++i)
+    {
+        if(minRows[i] > maxRows[i])
+            continue;
+
+        int row0 = std::min(minRows[i], rows[i]) - thicknessMinor;
+        int row1 = std::max(maxRows[i], rows[i]) + thicknessMajor - 1;
+        for(int col = cols[i] - thicknessMinor; col < cols[i] + thicknessMajor; ++col)
+            buffer.AddColumnSpan(col, row0, row1, colour(i));
+    }
+
+    // folded clades are filled one row at a time from the apex of the triangle to its base
+    for(const Fold& fold : m_folds)
+    {
+        int apexCol = cols[fold.node];
+        int apexRow = rows[fold.node];
+        int baseCol = int(fold.extent*sx + dx);
+        int baseStart = std::min(int(fold.start*sy + dy) - thicknessMinor, apexRow);
+        int baseEnd = std::max(int(fold.end*sy + dy) + thicknessMajor, apexRow);
+
+        for(int row = baseStart; row <= baseEnd; ++row)
+        {
+            float t = 0.0f;
+            if(row < apexRow)
+                t = float(apexRow - row) / (apexRow - baseStart);
+            else if(row > apexRow)
+                t = float(row - apexRow) / (baseEnd - apexRow);
+
+            int col = int(std::floor(apexCol + t*(baseCol - apexCol) + 0.5f));
+            buffer.AddRowSpan(row, col, baseCol, colour(fold.node));
+        }
+    }
+
+    return buffer.Resolve();
+}
+
+void OverviewRaster::ReportMemory(MemoryReport& report) const
+{
+    report.Add(MemoryReport::LAYOUT, MemoryReport::VectorBytes(m_nodes) + MemoryReport::VectorBytes(m_folds));
+}
@@ -0,0 +1,110 @@
+#ifndef _OVERVIEW_RASTER_HPP_
+#define _OVERVIEW_RASTER_HPP_
+
+#include "../core/DataTypes.hpp"
+
+#include <QImage>
+
+#include <vector>
+
+namespace pygmy
+{
+
+class MemoryReport;
+
+/**
+ * @brief Tree drawn in the overview, rasterized into an image at the resolution of the panel.
+ *
+ * The position and colour of the nodes drawn in the overview are captured from
+ * the visual tree so the image can be rasterized on a worker thread while the
+ * tree itself is modified. Thousands of nodes fall within each row of pixels of
+ * a large tree, so rather than drawing each branch the spans covered by branches
+ * are aggregated per row (and the vertical branches per column) as differences
+ * which are summed once all nodes have been visited. Rasterizing therefore takes
+ * time linear in the number of nodes plus the number of pixels, regardless of
+ * the length of the branches.
+ */
+class OverviewRaster
+{
+public:
+    /** Settings used to rasterize the tree. */
+    struct Settings
+    {
+        /** Constructor. */
+        Settings(): width(0), height(0), borderX(0), borderY(0), lineWidth(1.0f), bColour(true) {}
+
+        /** Size of image (in pixels). */
+        int width, height;
+
+        /** Border around tree (in pixels). */
+        int borderX, borderY;
+
+        /** Width of branches (in pixels). */
+        float lineWidth;
+
+        /** Flag indicating if branches are drawn in the colour of their node, or in grey. */
+        bool bColour;
+    };
+
+public:
+    /** Constructor. */
+    OverviewRaster() {}
+
+    /**
+     * @brief Capture the position and colour of the nodes drawn in the overview.
+     *        Nodes within folded clades are not captured. Must be called from the GUI thread.
+     * @param visualTree Tree to capture.
+     */
+    void Capture(VisualTreePtr visualTree);
+
+    /** Get number of nodes captured. */
+    uint GetNumberOfNodes() const { return uint(m_nodes.size()); }
+
+    /** Add the memory used by the captured tree to a report. */
+    void ReportMemory(MemoryReport& report) const;
+
+    /**
+     * @brief Rasterize the captured tree. Safe to call from any thread.
+     * @param settings Size of image and style of branches.
+     * @return Image with the origin of the tree at the bottom, left. Pixels not covered
+     *         by the tree are transparent.
+     */
+    QImage Rasterize(const Settings& settings) const;
+
+protected:
+    /** Node drawn in the overview. */
+    struct Node
+    {
+        /** Position of node (between 0 and 1). */
+        float x, y;
+
+        /** Index of parent, or -1 for the root. Parents are captured before their children. */
+        int parent;
+
+        /** Colour of node. */
+        QRgb colour;
+    };
+
+    /** Folded clade drawn as a triangle. */
+    struct Fold
+    {
+        /** Index of root of clade. */
+        uint node;
+
+        /** X-position where the triangle ends. */
+        float extent;
+
+        /** Interval spanned by the base of the triangle. */
+        float start, end;
+    };
+
+    /** Nodes in pre-order. */
+    std::vector<Node> m_nodes;
+
+    /** Folded clades. */
+    std::vector<Fold> m_folds;
+};
+
+}
+
+#endif
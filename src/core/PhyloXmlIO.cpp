@@ -0,0 +1,183 @@
+#include "PhyloXmlIO.hpp"
+
+#include "../utils/StreamReader.hpp"
+
+#include <QFile>
+#include <QXmlStreamReader>
+
+using namespace pygmy;
+using namespace utils;
+
+bool PhyloXmlIO::Read(Tree<NodePhylo>::Ptr tree, const QString& filename)
+{
+    std::vector<Tree<NodePhylo>::Ptr> trees;
+    if(!Read(trees, filename, 1))
+        return false;
+
+    // move nodes into the tree provided by the caller
+    tree->SetRootNode(trees.front()->GetRootNode());
+    tree->SetName(trees.front()->GetName());
+    trees.front()->SetRootNode(NULL);
+    tree->CalculateStatistics();
+
+    return true;
+}
+
+bool PhyloXmlIO::Read(std::vector<Tree<NodePhylo>::Ptr>& trees, const QString& filename, uint maxTrees)
+{
+    QFile input(filename);
+    if(!input.open(QIODevice::ReadOnly))
+    {
+        m_error = "Failed to open " + filename + ": " + input.errorString();
+        return false;
+    }
+
+    return Read(trees, &input, maxTrees);
+}
+
+bool PhyloXmlIO::Read(std::vector<Tree<NodePhylo>::Ptr>& trees, QIODevice* device, uint maxTrees)
+{
+    m_error.clear();
+
+    StreamReader reader(device);
+    QXmlStreamReader xml;
+    QByteArray chunk;
+
+    // names of all open elements
+    std::vector<QString> elements;
+
+    // clades being read, from the root of the current tree
+    std::vector<NodePhylo*> clades;
+
+    Tree<NodePhylo>::Ptr tree;
+    uint processedElement = 0;
+    uint numTrees = 0;
+    QString text;
+    QString propertyRef;
+    while(numTrees < maxTrees)
+    {
+        QXmlStreamReader::TokenType type = xml.readNext();
+
+        if(type == QXmlStreamReader::Invalid)
+        {
+            // data is passed to the parser a block at a time
+            if(xml.error() == QXmlStreamReader::PrematureEndOfDocumentError && reader.ReadChunk(chunk))
+            {
+                xml.addData(chunk);
+                continue;
+            }
+
+            if(reader.HasError())
+                m_error = reader.GetError();
+            else
+                m_error = QString("Invalid PhyloXML on line %1: %2").arg(xml.lineNumber()).arg(xml.errorString());
+            break;
+        }
+
+        if(type == QXmlStreamReader::EndDocument)
+            break;
+
+        if(type == QXmlStreamReader::StartElement)
+        {
+            QString name = xml.name().toString();
+            if(elements.empty() && name != "phyloxml")
+            {
+                m_error = "Input is not in PhyloXML format (missing phyloxml element).";
+                break;
+            }
+
+            elements.push_back(name);
+            text.clear();
+
+            if(name == "phylogeny")
+            {
+                tree = Tree<NodePhylo>::Ptr(new Tree<NodePhylo>());
+                processedElement = 0;
+                clades.clear();
+            }
+            else if(name == "clade" && tree)
+            {
+                NodePhylo* node(new NodePhylo(processedElement++));
+
+                QStringRef length = xml.attributes().value("branch_length");
+                if(!length.isEmpty())
+                    node->SetDistanceToParent(length.toString().toDouble());
+
+                if(clades.empty())
+                    tree->SetRootNode(node);
+                else
+                    clades.back()->AddChild(node);
+
+                clades.push_back(node);
+            }
+            else if(name == "property")
+            {
+                propertyRef = xml.attributes().value("ref").toString();
+            }
+        }
+        else if(type == QXmlStreamReader::Characters)
+        {
+            text += xml.text();
+        }
+        else if(type == QXmlStreamReader::EndElement)
+        {
+            QString name = elements.back();
+            elements.pop_back();
+
+            QString parent = elements.empty() ? QString() : elements.back();
+            NodePhylo* node = clades.empty() ? NULL : clades.back();
+
+            if(name == "clade" && node)
+            {
+                clades.pop_back();
+            }
+            else if(name == "phylogeny" && tree)
+            {
+                NodePhylo* root = tree->GetRootNode();
+                if(root)
+                {
+                    if(root->GetDistanceToParent() == NodePhylo::NO_DISTANCE)
+                        root->SetDistanceToParent(0.0f);
+
+                    tree->CalculateStatistics();
+                    trees.push_back(tree);
+                    numTrees++;
+                }
+
+                tree.clear();
+            }
+            else if(name == "name" && parent == "phylogeny" && tree)
+            {
+                tree->SetName(text.trimmed());
+            }
+            else if(parent == "clade" && node)
+            {
+                if(name == "name")
+                    node->SetName(text.trimmed());
+                else if(name == "branch_length")
+                    node->SetDistanceToParent(text.trimmed().toDouble());
+                else if(name == "confidence" && node->GetBootstrapToParent() == NodePhylo::NO_DISTANCE)
+                    node->SetBootstrapToParent(text.trimmed().toFloat());
+                else if(name == "property" && !propertyRef.isEmpty())
+                {
+                    std::map<QString, QString> metadata = node->GetMetadata();
+                    metadata[propertyRef] = text.trimmed();
+                    node->SetMetadata(metadata);
+                }
+            }
+            else if(parent == "taxonomy" && node && (name == "scientific_name" || name == "code"))
+            {
+                // taxonomy only names a node which has not been given a name
+                if(node->GetName().isEmpty())
+                    node->SetName(text.trimmed());
+            }
+
+            text.clear();
+        }
+    }
+
+    if(m_error.isEmpty() && numTrees == 0)
+        m_error = "No trees found in PhyloXML file.";
+
+    return m_error.isEmpty();
+}
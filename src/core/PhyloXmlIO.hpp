@@ -0,0 +1,82 @@
+#ifndef _PHYLO_XML_IO_HPP_
+#define _PHYLO_XML_IO_HPP_
+
+#include "../core/NodePhylo.hpp"
+
+#include "../utils/Tree.hpp"
+
+#include <QIODevice>
+#include <QString>
+
+#include <climits>
+#include <vector>
+
+namespace pygmy
+{
+
+/**
+ * @brief Read trees in PhyloXML format.
+ *
+ * Each phylogeny element is read as a tree. The following elements of a clade
+ * are used:
+ *
+ * - name: name of node (the scientific name or code of its taxonomy is used if absent)
+ * - branch_length (element or attribute): distance to parent
+ * - confidence: support value
+ * - property: metadata of node, keyed by its ref attribute
+ *
+ * All other elements are ignored. The file is passed to the XML parser in
+ * blocks as it is read, so it is parsed in a single pass with only the
+ * requested trees held in memory.
+ *
+ * Code example:
+ * @code
+ * PhyloXmlIO phyloXmlIO;
+ * Tree<NodePhylo>::Ptr tree(new Tree<NodePhylo>());
+ * if(!phyloXmlIO.Read(tree, "tree.xml"))
+ *     qCritical() << phyloXmlIO.GetError();
+ * @endcode
+ */
+class PhyloXmlIO
+{
+public:
+    /** Constructor. */
+    PhyloXmlIO() {}
+
+    /**
+     * @brief Read first tree in a file.
+     * @param tree Tree to populate from file.
+     * @param filename The file path.
+     * @return True if tree loaded successfully, else false.
+     */
+    bool Read(utils::Tree<NodePhylo>::Ptr tree, const QString& filename);
+
+    /**
+     * @brief Read trees in a file.
+     * @param trees Trees read from the file are appended to this list.
+     * @param filename The file path.
+     * @param maxTrees Maximum number of trees to read. Reading stops once this many trees have been read.
+     * @return True if at least one tree was read and no errors occurred, else false.
+     */
+    bool Read(std::vector<utils::Tree<NodePhylo>::Ptr>& trees, const QString& filename, uint maxTrees = UINT_MAX);
+
+    /**
+     * @brief Read trees from a device.
+     * @param trees Trees read from the device are appended to this list.
+     * @param device Open device to read from. Gzip compressed input is decompressed.
+     * @param maxTrees Maximum number of trees to read.
+     * @return True if at least one tree was read and no errors occurred, else false.
+     */
+    bool Read(std::vector<utils::Tree<NodePhylo>::Ptr>& trees, QIODevice* device, uint maxTrees = UINT_MAX);
+
+    /** Get description of the most recent error. */
+    QString GetError() const { return m_error; }
+
+protected:
+    /** Description of the most recent error. */
+    QString m_error;
+};
+
+}
+
+#endif
@@ -0,0 +1,749 @@
+#include "PolarLayout.hpp"
+
+#include "MemoryReport.hpp"
+#include "State.hpp"
+
+#include "../glUtils/ErrorGL.hpp"
+#include "../glUtils/Font.hpp"
+
+#include "../utils/Geometry.hpp"
+#include "../utils/Line.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace pygmy;
+using namespace utils;
+
+const float PolarLayout::LOD_PIXELS = 1.0f;
+const float PolarLayout::ARC_SEGMENT_PIXELS = 4.0f;
+
+namespace
+{
+    /** Fraction of a row folded clades are padded by on either side, as in the rectangular layout. */
+    const float FOLD_PADDING = 0.4f;
+
+    /** Angle in [0, 2*PI). */
+    float WrapAngle(float angle)
+    {
+        angle = fmod(angle, PI2);
+        if(angle < 0)
+            angle += PI2;
+
+        return angle;
+    }
+
+    /** Point within the unit disc at a given distance from the centre and angle. */
+    Point PolarPoint(float radius, float angle)
+    {
+        if(radius <= 0)
+            return Point(0, 0);
+
+        return Geometry::GetEllipsePointAtAngle(radius, radius, angle);
+    }
+}
+
+void PolarLayout::Layout(utils::Tree<NodePhylo>::Ptr tree, const FoldedClades& foldedClades)
+{
+    m_nodes.clear();
+    m_indices.clear();
+    ClearVisibleElements();
+    m_foldedClades = &foldedClades;
+
+    if(!tree || !tree->GetRootNode())
+        return;
+
+    uint rows = foldedClades.HasFolds() ? foldedClades.GetNumberOfRows() : tree->GetNumberOfLeaves();
+    m_rowAngle = PI2 / std::max(rows, 1u);
+
+    m_nodes.reserve(tree->GetNumberOfNodes());
+    m_indices.reserve(int(tree->GetNumberOfNodes()));
+
+    // nodes are captured in pre-order so each subtree is a contiguous range
+    std::vector< std::pair<NodePhylo*, int> > stack(1, std::make_pair(tree->GetRootNode(), -1));
+    while(!stack.empty())
+    {
+        NodePhylo* node = stack.back().first;
+        int parent = stack.back().second;
+        stack.pop_back();
+
+        Interval interval = foldedClades.GetInterval(node);
+
+        Node n;
+        n.node = node;
+        n.parent = parent;
+        n.end = uint(m_nodes.size()) + 1;
+        n.depth = node->GetPosition().x;
+        n.angle = foldedClades.GetYPos(node) * PI2;
+        n.angleStart = interval.start * PI2;
+        n.angleEnd = interval.end * PI2;
+        n.labelAngle = n.angle;
+        n.bFolded = foldedClades.IsFolded(node);
+
+        m_indices.insert(node, uint(m_nodes.size()));
+        int index = int(m_nodes.size());
+        m_nodes.push_back(n);
+
+        // nodes within folded clades are not drawn
+        if(n.bFolded)
+            continue;
+
+        for(uint i = node->GetNumberOfChildren(); i > 0; --i)
+            stack.push_back(std::make_pair(node->GetChild(i-1), index));
+    }
+
+    for(uint i = uint(m_nodes.size()); i > 1; --i)
+    {
+        Node& parent = m_nodes[m_nodes[i-1].parent];
+        parent.end = std::max(parent.end, m_nodes[i-1].end);
+    }
+
+    LayoutNodes();
+    LayoutSectors();
+}
+
+void PolarLayout::LayoutSectors()
+{
+    // each node covers itself and what is drawn from it, then sectors are merged from the leaves
+    for(uint i = 0; i < m_nodes.size(); ++i)
+    {
+        Node& node = m_nodes[i];
+        node.bounds = LineSector(node.pos, node.pos);
+
+        if(node.bFolded)
+        {
+            Point start, end;
+            FoldedWedge(i, start, end);
+
+            Sector wedge = LineSector(node.pos, start);
+            Include(wedge, LineSector(start, end));
+            Include(wedge, LineSector(end, node.pos));
+
+            // a wedge surrounding the centre covers all angles down to the centre
+            if(wedge.span >= PI2)
+                wedge.radiusMin = 0;
+
+            Include(node.bounds, wedge);
+        }
+        else
+        {
+            Include(node.bounds, ChildBranchesSector(i));
+        }
+    }
+
+    for(uint i = uint(m_nodes.size()); i > 1; --i)
+        Include(m_nodes[m_nodes[i-1].parent].bounds, m_nodes[i-1].bounds);
+}
+
+void PolarLayout::Render(const View& view, const std::map<utils::Node::NodeId, utils::BBox>& bboxMap,
+                         const LabelCache& leafLabels, RenderStats& stats)
+{
+    ClearVisibleElements();
+    m_lineVertices.clear();
+    m_lineColours.clear();
+
+    if(m_nodes.empty() || view.radius <= 0)
+        return;
+
+    glUtils::ErrorGL::Check();
+
+    m_viewSector = ViewportSector(view);
+    float lodSpan = LOD_PIXELS / view.radius;
+
+    std::vector<uint> markers;
+    std::vector<uint> labels;
+    std::vector<Point> triangles;
+    std::vector<NodePhylo*> triangleNodes;
+
+    // Subtrees are visited in pre-order, skipping any whose sector is outside the viewport
+    // and drawing any narrower than a pixel as a single line without visiting their nodes.
+    uint i = 0;
+    while(i < m_nodes.size())
+    {
+        const Node& node = m_nodes[i];
+        if(!Overlaps(node.bounds, m_viewSector))
+        {
+            i = node.end;
+            continue;
+        }
+
+        stats.traversedNodes++;
+        Point pos = ToViewport(node.pos, view);
+
+        bool bLeaf = node.end == i + 1 && !node.bFolded;
+        if(node.bFolded)
+        {
+            Point start, end;
+            FoldedWedge(i, start, end);
+
+            triangles.push_back(pos);
+            triangles.push_back(ToViewport(start, view));
+            triangles.push_back(ToViewport(end, view));
+            triangleNodes.push_back(node.node);
+        }
+        else if(!bLeaf && node.bounds.span >= 0 && node.bounds.span*node.bounds.radiusMax < lodSpan)
+        {
+            float angle = node.bounds.angle + 0.5f*node.bounds.span;
+            AddLine(pos, ToViewport(PolarPoint(node.bounds.radiusMax, angle), view), node.node->GetColour());
+
+            i = node.end;
+            continue;
+        }
+        else
+        {
+            AddChildBranches(i, view);
+        }
+
+        // nodes are only drawn and picked within the viewport, but labels may reach into it
+        if(pos.x >= view.viewport.x && pos.x <= view.viewport.dx && pos.y >= view.viewport.y && pos.y <= view.viewport.dy)
+            markers.push_back(i);
+
+        if(view.bLabels && (bLeaf || node.bFolded))
+            labels.push_back(i);
+
+        ++i;
+    }
+
+    // branches and folded clades are each drawn as a single batch
+    glDisable(GL_LINE_SMOOTH);
+
+    glBegin(GL_TRIANGLES);
+    for(uint t = 0; t < triangleNodes.size(); ++t)
+    {
+        triangleNodes[t]->GetColour().SetColourGL();
+        for(uint v = 0; v < 3; ++v)
+            glVertex2f(triangles[3*t + v].x, triangles[3*t + v].y);
+
+        BBox box(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for(uint v = 0; v < 3; ++v)
+        {
+            box.x = std::min(box.x, triangles[3*t + v].x);
+            box.y = std::min(box.y, triangles[3*t + v].y);
+            box.dx = std::max(box.dx, triangles[3*t + v].x);
+            box.dy = std::max(box.dy, triangles[3*t + v].y);
+        }
+
+        Element element = { box, triangleNodes[t], HitTestIndex::CLADE };
+        m_visibleElements.push_back(element);
+    }
+    glEnd();
+
+    glEnable(GL_LINE_SMOOTH);
+
+    if(!m_lineVertices.empty())
+    {
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glVertexPointer(2, GL_FLOAT, 0, &m_lineVertices[0]);
+        glColorPointer(3, GL_FLOAT, 0, &m_lineColours[0]);
+        glDrawArrays(GL_LINES, 0, GLsizei(m_lineVertices.size() / 2));
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+
+    stats.visibleBranches += uint(m_lineVertices.size() / 4);
+
+    for(uint index : markers)
+    {
+        NodePhylo* node = m_nodes[index].node;
+        Point pos = ToViewport(m_nodes[index].pos, view);
+
+        VisualMarker marker(node->GetColour(), view.markerSize, VisualMarker::CIRCLE, VisualMarker::FILL, pos);
+        marker.SetVisibility(node->IsSelected());
+        marker.SetSelected(node->IsSelected());
+        marker.Render();
+
+        float size = 0.5f * view.markerSize;
+        Element element = { BBox(pos.x - size, pos.y - size, pos.x + size, pos.y + size), node, HitTestIndex::NODE };
+        m_visibleElements.push_back(element);
+    }
+
+    stats.visibleNodes += uint(markers.size());
+
+    if(labels.empty())
+    {
+        glUtils::ErrorGL::Check();
+        return;
+    }
+
+    // labels are drawn outwards from their node once adjacent rows are far enough apart not to overlap
+    Colour colour = State::Inst().GetTreeFontColour();
+    glColor3f(colour.GetRed(), colour.GetGreen(), colour.GetBlue());
+
+    for(uint index : labels)
+    {
+        const Node& node = m_nodes[index];
+        if(node.bFolded)
+        {
+            Point start, end;
+            FoldedWedge(index, start, end);
+            if(Geometry::Distance(start, end)*view.radius < view.labelHeight)
+                continue;
+
+            QString label = m_foldedClades->GetFoldedLabel(node.node);
+            BBox bbox = State::Inst().GetFont()->GetBoundingBox(label);
+            Point base = ToViewport(Geometry::MidPoint(Line(start, end)), view);
+            RenderLabel(label.toLatin1().constData(), bbox, base, node.labelAngle, view, node.node);
+        }
+        else
+        {
+            if(m_rowAngle*node.pos.Length()*view.radius < view.labelHeight)
+                continue;
+
+            std::map<utils::Node::NodeId, utils::BBox>::const_iterator it = bboxMap.find(node.node->GetId());
+            if(it == bboxMap.end())
+                continue;
+
+            RenderLabel(leafLabels.GetText(leafLabels.GetLabelId(node.node)), it->second, ToViewport(node.pos, view), node.labelAngle, view, node.node);
+        }
+
+        stats.leafLabels++;
+    }
+
+    glUtils::ErrorGL::Check();
+}
+
+void PolarLayout::RenderLabel(const char* text, const utils::BBox& bbox, const utils::Point& pos, float angle,
+                              const View& view, NodePhylo* node)
+{
+    // labels on the left of the centre are turned around so they are not upside down
+    bool bFlip = cos(angle) < 0;
+    float rotation = bFlip ? angle + PI : angle;
+    float textX = bFlip ? -(view.labelOffset + bbox.dx) : view.labelOffset;
+    float textY = -view.labelBaseline;
+
+    glPushMatrix();
+    {
+        glTranslatef(pos.x, pos.y, 0.0f);
+        glRotatef(rotation*RAD_TO_DEG, 0.0f, 0.0f, 1.0f);
+        glTranslatef(textX, textY, 0.0f);
+        State::Inst().GetFont()->Render(text, 0, 0);
+    }
+    glPopMatrix();
+
+    // labels are picked by the axis-aligned box around their rotated bounds
+    float c = cos(rotation);
+    float s = sin(rotation);
+    float xs[2] = { textX + bbox.x, textX + bbox.dx };
+    float ys[2] = { textY + bbox.y, textY + bbox.dy };
+
+    BBox box(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for(float x : xs)
+    {
+        for(float y : ys)
+        {
+            Point corner(pos.x + x*c - y*s, pos.y + x*s + y*c);
+            box.x = std::min(box.x, corner.x);
+            box.y = std::min(box.y, corner.y);
+            box.dx = std::max(box.dx, corner.x);
+            box.dy = std::max(box.dy, corner.y);
+        }
+    }
+
+    Element element = { box, node, HitTestIndex::LABEL };
+    m_visibleElements.push_back(element);
+}
+
+void PolarLayout::RenderHover(NodePhylo* node, const View& view) const
+{
+    QHash<const NodePhylo*, uint>::const_iterator it = m_indices.constFind(node);
+    if(it == m_indices.constEnd())
+        return;
+
+    glUtils::ErrorGL::Check();
+
+    uint index = it.value();
+    Point pos = ToViewport(m_nodes[index].pos, view);
+    Colour colour(1.0f, 0.48f, 0.14f);
+
+    if(m_nodes[index].parent >= 0)
+    {
+        Point start = ToViewport(BranchStart(index), view);
+
+        glLineWidth(State::Inst().GetLineWidth()+2);
+        colour.SetColourGL();
+        glBegin(GL_LINES);
+            glVertex2f(start.x, start.y);
+            glVertex2f(pos.x, pos.y);
+        glEnd();
+        glLineWidth(State::Inst().GetLineWidth());
+    }
+
+    VisualMarker marker(colour, view.markerSize, VisualMarker::CIRCLE, VisualMarker::FILL, pos);
+    marker.Render();
+
+    glUtils::ErrorGL::Check();
+}
+
+void PolarLayout::AddToHitTestIndex(HitTestIndex& index) const
+{
+    for(const Element& element : m_visibleElements)
+        index.Add(element.box, element.node, element.element);
+}
+
+void PolarLayout::ClearVisibleElements()
+{
+    m_visibleElements.clear();
+}
+
+bool PolarLayout::GetPosition(const NodePhylo* node, utils::Point& pos) const
+{
+    QHash<const NodePhylo*, uint>::const_iterator it = m_indices.constFind(node);
+    if(it == m_indices.constEnd())
+        return false;
+
+    pos = m_nodes[it.value()].pos;
+    return true;
+}
+
+void PolarLayout::AddLine(const utils::Point& start, const utils::Point& end, const utils::Colour& colour)
+{
+    m_lineVertices.push_back(start.x);
+    m_lineVertices.push_back(start.y);
+    m_lineVertices.push_back(end.x);
+    m_lineVertices.push_back(end.y);
+
+    for(uint i = 0; i < 2; ++i)
+    {
+        m_lineColours.push_back(colour.GetRed());
+        m_lineColours.push_back(colour.GetGreen());
+        m_lineColours.push_back(colour.GetBlue());
+    }
+}
+
+void PolarLayout::AddArc(float radius, float startAngle, float endAngle, const View& view, const utils::Colour& colour)
+{
+    // arcs of a zoomed in tree may go far beyond the viewport, so are clipped to the angles it covers
+    if(m_viewSector.span < PI2)
+    {
+        float clippedStart = FLT_MAX, clippedEnd = -FLT_MAX;
+        for(int turn = -1; turn <= 1; ++turn)
+        {
+            float viewStart = m_viewSector.angle + turn*PI2;
+            float start = std::max(startAngle, viewStart);
+            float end = std::min(endAngle, viewStart + m_viewSector.span);
+            if(start <= end)
+            {
+                clippedStart = std::min(clippedStart, start);
+                clippedEnd = std::max(clippedEnd, end);
+            }
+        }
+
+        if(clippedStart > clippedEnd)
+            return;
+
+        startAngle = clippedStart;
+        endAngle = clippedEnd;
+    }
+
+    // arcs are divided into segments of a few pixels
+    uint segments = uint(std::min(radius*view.radius*(endAngle - startAngle) / ARC_SEGMENT_PIXELS, 4096.0f)) + 1;
+
+    Point previous = ToViewport(PolarPoint(radius, startAngle), view);
+    for(uint i = 1; i <= segments; ++i)
+    {
+        Point next = ToViewport(PolarPoint(radius, startAngle + (endAngle - startAngle)*i/segments), view);
+        AddLine(previous, next, colour);
+        previous = next;
+    }
+}
+
+PolarLayout::Sector PolarLayout::LineSector(const utils::Point& start, const utils::Point& end)
+{
+    Sector sector;
+    sector.radiusMax = std::max(start.Length(), end.Length());
+
+    // closest point of the line to the centre
+    Point closest;
+    if(start == end || !Geometry::ClosestPointToLine(Line(start, end), Point(0, 0), closest))
+        sector.radiusMin = std::min(start.Length(), end.Length());
+    else
+        sector.radiusMin = closest.Length();
+
+    // the line sweeps the smaller angle between its ends, and points at the centre have no angle
+    const float eps = 1e-6f;
+    if(start.Length() < eps && end.Length() < eps)
+        return sector;
+
+    if(start.Length() < eps || end.Length() < eps)
+    {
+        const Point& pt = start.Length() < eps ? end : start;
+        sector.angle = WrapAngle(atan2(pt.y, pt.x));
+        sector.span = 0;
+        return sector;
+    }
+
+    float startAngle = WrapAngle(atan2(start.y, start.x));
+    float endAngle = WrapAngle(atan2(end.y, end.x));
+    float delta = WrapAngle(endAngle - startAngle);
+    if(delta <= PI)
+    {
+        sector.angle = startAngle;
+        sector.span = delta;
+    }
+    else
+    {
+        sector.angle = endAngle;
+        sector.span = PI2 - delta;
+    }
+
+    return sector;
+}
+
+PolarLayout::Sector PolarLayout::ArcSector(float radius, float startAngle, float endAngle)
+{
+    Sector sector;
+    sector.radiusMin = radius;
+    sector.radiusMax = radius;
+
+    if(radius > 0)
+    {
+        sector.angle = WrapAngle(startAngle);
+        sector.span = std::min(endAngle - startAngle, PI2);
+    }
+
+    return sector;
+}
+
+void PolarLayout::Include(Sector& sector, const Sector& other)
+{
+    if(other.radiusMin > other.radiusMax)
+        return;
+
+    if(sector.radiusMin > sector.radiusMax)
+    {
+        sector = other;
+        return;
+    }
+
+    sector.radiusMin = std::min(sector.radiusMin, other.radiusMin);
+    sector.radiusMax = std::max(sector.radiusMax, other.radiusMax);
+
+    if(other.span < 0 || sector.span >= PI2)
+        return;
+
+    if(sector.span < 0 || other.span >= PI2)
+    {
+        sector.angle = other.angle;
+        sector.span = other.span;
+        return;
+    }
+
+    // the narrowest sector covering both starts at the start of one of them
+    float spanFromSector = std::max(sector.span, WrapAngle(other.angle - sector.angle) + other.span);
+    float spanFromOther = std::max(other.span, WrapAngle(sector.angle - other.angle) + sector.span);
+    if(spanFromOther < spanFromSector)
+    {
+        sector.angle = other.angle;
+        sector.span = spanFromOther;
+    }
+    else
+    {
+        sector.span = spanFromSector;
+    }
+
+    if(sector.span >= PI2)
+        sector.span = PI2;
+}
+
+bool PolarLayout::Overlaps(const Sector& sector1, const Sector& sector2)
+{
+    if(sector1.radiusMin > sector1.radiusMax || sector2.radiusMin > sector2.radiusMax)
+        return false;
+
+    if(sector1.radiusMax < sector2.radiusMin || sector1.radiusMin > sector2.radiusMax)
+        return false;
+
+    // sectors at the centre only cover all angles
+    if(sector1.span < 0 || sector2.span < 0 || sector1.span >= PI2 || sector2.span >= PI2)
+        return true;
+
+    return WrapAngle(sector2.angle - sector1.angle) <= sector1.span
+        || WrapAngle(sector1.angle - sector2.angle) <= sector2.span;
+}
+
+PolarLayout::Sector PolarLayout::ViewportSector(const View& view)
+{
+    // the viewport is extended so labels of nodes just outside of it are still drawn
+    float x0 = (view.viewport.x - view.margin - view.centre.x) / view.radius;
+    float x1 = (view.viewport.dx + view.margin - view.centre.x) / view.radius;
+    float y0 = (view.viewport.y - view.margin - view.centre.y) / view.radius;
+    float y1 = (view.viewport.dy + view.margin - view.centre.y) / view.radius;
+
+    Sector sector;
+    Point closest(std::min(std::max(0.0f, x0), x1), std::min(std::max(0.0f, y0), y1));
+    sector.radiusMin = closest.Length();
+
+    Point corners[4] = { Point(x0, y0), Point(x1, y0), Point(x1, y1), Point(x0, y1) };
+    for(const Point& corner : corners)
+        sector.radiusMax = std::max(sector.radiusMax, corner.Length());
+
+    if(sector.radiusMin == 0)
+    {
+        sector.angle = 0;
+        sector.span = PI2;
+        return sector;
+    }
+
+    // seen from outside the viewport, its corners lie within half a turn of its middle
+    float middle = atan2(0.5f*(y0 + y1), 0.5f*(x0 + x1));
+    float minOffset = 0, maxOffset = 0;
+    for(const Point& corner : corners)
+    {
+        float offset = WrapAngle(atan2(corner.y, corner.x) - middle + PI) - PI;
+        minOffset = std::min(minOffset, offset);
+        maxOffset = std::max(maxOffset, offset);
+    }
+
+    sector.angle = WrapAngle(middle + minOffset);
+    sector.span = maxOffset - minOffset;
+
+    return sector;
+}
+
+void CircularLayout::LayoutNodes()
+{
+    // rows are spread over the full circle and nodes are at their depth from the centre
+    for(Node& node : m_nodes)
+        node.pos = PolarPoint(node.depth, node.angle);
+}
+
+PolarLayout::Sector CircularLayout::ChildBranchesSector(uint index) const
+{
+    Sector sector;
+    const Node& node = m_nodes[index];
+    if(node.end == index + 1)
+        return sector;
+
+    float firstAngle = FLT_MAX, lastAngle = -FLT_MAX;
+    for(uint child = index + 1; child < node.end; child = m_nodes[child].end)
+    {
+        Include(sector, LineSector(BranchStart(child), m_nodes[child].pos));
+        firstAngle = std::min(firstAngle, m_nodes[child].angle);
+        lastAngle = std::max(lastAngle, m_nodes[child].angle);
+    }
+
+    Include(sector, ArcSector(node.depth, firstAngle, lastAngle));
+
+    return sector;
+}
+
+utils::Point CircularLayout::BranchStart(uint index) const
+{
+    const Node& node = m_nodes[index];
+    if(node.parent < 0)
+        return node.pos;
+
+    return PolarPoint(m_nodes[node.parent].depth, node.angle);
+}
+
+void CircularLayout::AddChildBranches(uint index, const View& view)
+{
+    const Node& node = m_nodes[index];
+    if(node.end == index + 1)
+        return;
+
+    // branches run outwards from an arc joining the children of a node
+    float firstAngle = FLT_MAX, lastAngle = -FLT_MAX;
+    for(uint child = index + 1; child < node.end; child = m_nodes[child].end)
+    {
+        const Node& childNode = m_nodes[child];
+        AddLine(ToViewport(BranchStart(child), view), ToViewport(childNode.pos, view), childNode.node->GetColour());
+        firstAngle = std::min(firstAngle, childNode.angle);
+        lastAngle = std::max(lastAngle, childNode.angle);
+    }
+
+    if(node.depth > 0 && lastAngle > firstAngle)
+        AddArc(node.depth, firstAngle, lastAngle, view, node.node->GetColour());
+}
+
+void CircularLayout::FoldedWedge(uint index, utils::Point& start, utils::Point& end) const
+{
+    const Node& node = m_nodes[index];
+    float extent = m_foldedClades->GetFoldedExtent(node.node);
+    start = PolarPoint(extent, node.angleStart - FOLD_PADDING*m_rowAngle);
+    end = PolarPoint(extent, node.angleEnd + FOLD_PADDING*m_rowAngle);
+}
+
+void RadialLayout::LayoutNodes()
+{
+    // each node points to the middle of a wedge proportional to its number of rows,
+    // with parents placed before their children
+    float maxRadius = 0;
+    for(Node& node : m_nodes)
+    {
+        node.labelAngle = 0.5f*(node.angleStart + node.angleEnd);
+        if(node.parent < 0)
+        {
+            node.pos = Point(0, 0);
+            continue;
+        }
+
+        const Node& parent = m_nodes[node.parent];
+        float length = node.depth - parent.depth;
+        node.pos = parent.pos + Point(length*cos(node.labelAngle), length*sin(node.labelAngle));
+        maxRadius = std::max(maxRadius, node.pos.Length());
+    }
+
+    // folded clades reach beyond their node
+    m_scale = 1;
+    for(uint i = 0; i < m_nodes.size(); ++i)
+    {
+        if(!m_nodes[i].bFolded)
+            continue;
+
+        Point start, end;
+        FoldedWedge(i, start, end);
+        maxRadius = std::max(maxRadius, std::max(start.Length(), end.Length()));
+    }
+
+    m_scale = maxRadius > 0 ? 1.0f / maxRadius : 1.0f;
+    for(Node& node : m_nodes)
+        node.pos = Point(node.pos.x*m_scale, node.pos.y*m_scale);
+}
+
+PolarLayout::Sector RadialLayout::ChildBranchesSector(uint index) const
+{
+    Sector sector;
+    const Node& node = m_nodes[index];
+    for(uint child = index + 1; child < node.end; child = m_nodes[child].end)
+        Include(sector, LineSector(node.pos, m_nodes[child].pos));
+
+    return sector;
+}
+
+utils::Point RadialLayout::BranchStart(uint index) const
+{
+    const Node& node = m_nodes[index];
+    if(node.parent < 0)
+        return node.pos;
+
+    return m_nodes[node.parent].pos;
+}
+
+void RadialLayout::AddChildBranches(uint index, const View& view)
+{
+    const Node& node = m_nodes[index];
+    Point pos = ToViewport(node.pos, view);
+    for(uint child = index + 1; child < node.end; child = m_nodes[child].end)
+        AddLine(pos, ToViewport(m_nodes[child].pos, view), m_nodes[child].node->GetColour());
+}
+
+void RadialLayout::FoldedWedge(uint index, utils::Point& start, utils::Point& end) const
+{
+    const Node& node = m_nodes[index];
+    float length = (m_foldedClades->GetFoldedExtent(node.node) - node.depth) * m_scale;
+    float startAngle = node.angleStart - FOLD_PADDING*m_rowAngle;
+    float endAngle = node.angleEnd + FOLD_PADDING*m_rowAngle;
+
+    start = node.pos + Point(length*cos(startAngle), length*sin(startAngle));
+    end = node.pos + Point(length*cos(endAngle), length*sin(endAngle));
+}
+
+void PolarLayout::ReportMemory(MemoryReport& report) const
+{
+    report.Add(MemoryReport::LAYOUT, MemoryReport::VectorBytes(m_nodes) + MemoryReport::HashBytes(m_indices)
+               + MemoryReport::VectorBytes(m_lineVertices) + MemoryReport::VectorBytes(m_lineColours)
+               + MemoryReport::VectorBytes(m_visibleElements));
+}
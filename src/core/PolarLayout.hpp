@@ -0,0 +1,302 @@
+#ifndef _POLAR_LAYOUT_HPP_
+#define _POLAR_LAYOUT_HPP_
+
+#include "../core/DataTypes.hpp"
+#include "../core/FoldedClades.hpp"
+#include "../core/HitTestIndex.hpp"
+#include "../core/LabelCache.hpp"
+#include "../core/NodePhylo.hpp"
+#include "../core/RenderStats.hpp"
+#include "../core/VisualMarker.hpp"
+
+#include "../utils/Colour.hpp"
+#include "../utils/Common.hpp"
+#include "../utils/Point.hpp"
+#include "../utils/Tree.hpp"
+
+#include <QHash>
+
+#include <cfloat>
+#include <map>
+#include <vector>
+
+namespace pygmy
+{
+
+class MemoryReport;
+
+/**
+ * @brief Layout of a tree about a centre, with leaves spread over the full circle.
+ *
+ * Nodes are captured in pre-order together with the sector (an interval of
+ * angles and of radii about the centre) covering everything drawn for their
+ * subtree. Sectors are merged from the leaves in a single reverse pass, so a
+ * frame can skip any subtree whose sector misses the viewport and draw any
+ * subtree narrower than a pixel as a single line, which keeps the number of
+ * nodes traversed in proportion to what is visible rather than to the size of
+ * the tree. Positions are within the unit disc; subclasses decide where each
+ * node is placed and how the branches to its children are drawn.
+ */
+class PolarLayout
+{
+public:
+    /** Arc length (in pixels) below which a subtree is drawn as a single line. */
+    static const float LOD_PIXELS;
+
+    /** Length of the segments arcs are drawn with (in pixels). */
+    static const float ARC_SEGMENT_PIXELS;
+
+    /** Transformation of the unit disc to the viewport and the region of it to draw. */
+    struct View
+    {
+        /** Constructor. */
+        View(): radius(1), margin(0), labelOffset(0), labelBaseline(0), labelHeight(0), markerSize(0), bLabels(false) {}
+
+        /** Centre of disc (in pixels). */
+        utils::Point centre;
+
+        /** Radius of disc (in pixels). */
+        float radius;
+
+        /** Region of the viewport to draw (in pixels). */
+        utils::BBox viewport;
+
+        /** Distance beyond the viewport nodes are still visited, so their labels can reach into it (in pixels). */
+        float margin;
+
+        /** Distance of labels from their node, offset of their baseline and height of the highest label (in pixels). */
+        float labelOffset, labelBaseline, labelHeight;
+
+        /** Size of node markers (in pixels). */
+        float markerSize;
+
+        /** Flag indicating if leaf and folded clade labels are drawn. */
+        bool bLabels;
+    };
+
+public:
+    /** Constructor. */
+    PolarLayout(): m_foldedClades(NULL), m_rowAngle(0) {}
+
+    /** Destructor. */
+    virtual ~PolarLayout() {}
+
+    /**
+     * @brief Capture the layout of a tree. Must be repeated whenever the tree is laid out or clades are folded.
+     * @param tree Tree which has been laid out in rows.
+     * @param foldedClades Clades drawn as wedges. Nodes within them are not captured.
+     */
+    void Layout(utils::Tree<NodePhylo>::Ptr tree, const FoldedClades& foldedClades);
+
+    /** Flag indicating if a tree has been captured. */
+    bool IsEmpty() const { return m_nodes.empty(); }
+
+    /**
+     * @brief Render the portion of the tree within the viewport.
+     * @param view Transformation and region to draw.
+     * @param bboxMap Bounding boxes of leaf labels.
+     * @param leafLabels Labels of leaves.
+     * @param stats Counts of nodes traversed and drawn are added to these statistics.
+     */
+    void Render(const View& view, const std::map<utils::Node::NodeId, utils::BBox>& bboxMap,
+                const LabelCache& leafLabels, RenderStats& stats);
+
+    /**
+     * @brief Highlight a node and the branch leading to it.
+     * @param node Node to highlight. Nothing is drawn if it was not captured.
+     * @param view Transformation used by the most recent call to Render().
+     */
+    void RenderHover(NodePhylo* node, const View& view) const;
+
+    /**
+     * @brief Add the nodes, labels and folded clades drawn by the most recent call to Render().
+     * @param index Index to add elements to.
+     */
+    void AddToHitTestIndex(HitTestIndex& index) const;
+
+    /** Clear the elements drawn by the most recent call to Render(). */
+    void ClearVisibleElements();
+
+    /**
+     * @brief Get position of a node within the unit disc.
+     * @param node Node of interest.
+     * @param pos Set to position of node.
+     * @return False if the node was not captured (e.g., it is within a folded clade).
+     */
+    bool GetPosition(const NodePhylo* node, utils::Point& pos) const;
+
+    /** Add the memory used by the layout to a report. */
+    void ReportMemory(MemoryReport& report) const;
+
+protected:
+    /** Interval of angles and radii about the centre. */
+    struct Sector
+    {
+        /** Constructor of an empty sector. */
+        Sector(): angle(0), span(-1), radiusMin(FLT_MAX), radiusMax(0) {}
+
+        /** First angle (in radians) and angular extent counter-clockwise from it. Negative if no angle is covered. */
+        float angle, span;
+
+        /** Closest and furthest distance from the centre. The sector is empty if the closest exceeds the furthest. */
+        float radiusMin, radiusMax;
+    };
+
+    /** Node captured in pre-order. */
+    struct Node
+    {
+        /** Node of tree. */
+        NodePhylo* node;
+
+        /** Index of parent, or -1 for the root. */
+        int parent;
+
+        /** Index following the last node of the subtree. */
+        uint end;
+
+        /** Distance from the root given by the branch style, between 0 and 1. */
+        float depth;
+
+        /** Angle of node and first and last angle of the rows below it (in radians). */
+        float angle, angleStart, angleEnd;
+
+        /** Position of node within the unit disc. */
+        utils::Point pos;
+
+        /** Direction labels of the node are drawn in (in radians). */
+        float labelAngle;
+
+        /** Flag indicating if the node is a folded clade. */
+        bool bFolded;
+
+        /** Sector covering the node and everything drawn for it and its descendants. */
+        Sector bounds;
+    };
+
+    /** Element drawn in the viewport, recorded for hit testing. */
+    struct Element
+    {
+        utils::BBox box;
+        NodePhylo* node;
+        HitTestIndex::ELEMENT element;
+    };
+
+protected:
+    /** Place nodes within the unit disc, setting their position and label angle. */
+    virtual void LayoutNodes() = 0;
+
+    /** Set the sector covering each subtree once nodes have been placed. */
+    void LayoutSectors();
+
+    /** Get sector covering the branches drawn from a node to its children. */
+    virtual Sector ChildBranchesSector(uint index) const = 0;
+
+    /** Get point within the unit disc where the branch leading to a node starts. */
+    virtual utils::Point BranchStart(uint index) const = 0;
+
+    /** Add the lines of the branches from a node to its children, in viewport coordinates. */
+    virtual void AddChildBranches(uint index, const View& view) = 0;
+
+    /** Get the corners of the wedge drawn for a folded clade, within the unit disc. */
+    virtual void FoldedWedge(uint index, utils::Point& start, utils::Point& end) const = 0;
+
+    /** Get viewport position of a point within the unit disc. */
+    utils::Point ToViewport(const utils::Point& pt, const View& view) const
+        { return utils::Point(view.centre.x + pt.x*view.radius, view.centre.y + pt.y*view.radius); }
+
+    /** Add a line in viewport coordinates drawn with the colour of a node. */
+    void AddLine(const utils::Point& start, const utils::Point& end, const utils::Colour& colour);
+
+    /** Add the portion of an arc about the centre within the viewport, drawn with the colour of a node. */
+    void AddArc(float radius, float startAngle, float endAngle, const View& view, const utils::Colour& colour);
+
+    /** Sector covering a line within the unit disc. */
+    static Sector LineSector(const utils::Point& start, const utils::Point& end);
+
+    /** Sector covering an arc about the centre. */
+    static Sector ArcSector(float radius, float startAngle, float endAngle);
+
+    /** Extend a sector to also cover another, giving the narrowest sector covering both. */
+    static void Include(Sector& sector, const Sector& other);
+
+    /** Determine if two sectors overlap. */
+    static bool Overlaps(const Sector& sector1, const Sector& sector2);
+
+    /** Sector of the unit disc covered by a box in viewport coordinates. */
+    static Sector ViewportSector(const View& view);
+
+    /** Render the Latin-1 encoded label of a node outwards from a point in viewport coordinates. */
+    void RenderLabel(const char* text, const utils::BBox& bbox, const utils::Point& pos, float angle,
+                     const View& view, NodePhylo* node);
+
+protected:
+    /** Nodes in pre-order. */
+    std::vector<Node> m_nodes;
+
+    /** Index of each captured node. */
+    QHash<const NodePhylo*, uint> m_indices;
+
+    /** Folded clades of the captured tree. */
+    const FoldedClades* m_foldedClades;
+
+    /** Angle between adjacent rows (in radians). */
+    float m_rowAngle;
+
+    /** Sector covered by the viewport in the most recent call to Render(). */
+    Sector m_viewSector;
+
+    /** Vertices and colours of the lines of the most recent frame, drawn as a single batch. */
+    std::vector<float> m_lineVertices;
+    std::vector<float> m_lineColours;
+
+    /** Nodes, labels and folded clades drawn by the most recent call to Render(). */
+    std::vector<Element> m_visibleElements;
+};
+
+/**
+ * @brief Rows placed at equal angles on concentric circles, with the distance from the centre given by the branch style.
+ *
+ * The branch leading to a node runs outwards along the angle of the node and
+ * the branches to the children of a node are joined by an arc.
+ */
+class CircularLayout: public PolarLayout
+{
+public:
+    /** Constructor. */
+    CircularLayout() {}
+
+protected:
+    virtual void LayoutNodes();
+    virtual Sector ChildBranchesSector(uint index) const;
+    virtual utils::Point BranchStart(uint index) const;
+    virtual void AddChildBranches(uint index, const View& view);
+    virtual void FoldedWedge(uint index, utils::Point& start, utils::Point& end) const;
+};
+
+/**
+ * @brief Unrooted (equal-angle) layout, with each subtree given a wedge in proportion to its number of rows.
+ *
+ * Branches are straight lines whose length is given by the branch style, pointing
+ * to the middle of the wedge of the node they lead to.
+ */
+class RadialLayout: public PolarLayout
+{
+public:
+    /** Constructor. */
+    RadialLayout(): m_scale(1) {}
+
+protected:
+    virtual void LayoutNodes();
+    virtual Sector ChildBranchesSector(uint index) const;
+    virtual utils::Point BranchStart(uint index) const;
+    virtual void AddChildBranches(uint index, const View& view);
+    virtual void FoldedWedge(uint index, utils::Point& start, utils::Point& end) const;
+
+protected:
+    /** Scale of branch lengths such that the layout fits within the unit disc. */
+    float m_scale;
+};
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef _RENDER_STATS_HPP_
+#define _RENDER_STATS_HPP_
+
+#include <QString>
+#include <QtGlobal>
+
+namespace pygmy
+{
+
+/**
+ * @brief Timing and element counts for a single rendered frame.
+ *
+ * CPU times are wall-clock times measured around each stage of VisualTree::Render().
+ * Frame level values (paint time, frame interval and GPU time) are filled in by the
+ * widget performing the rendering.
+ */
+typedef struct sRENDER_STATS
+{
+    /** Constructor. */
+    sRENDER_STATS(): frame(0), treeNs(0), textSearchNs(0), leafLabelsNs(0), internalLabelsNs(0),
+        renderNs(0), paintNs(0), frameIntervalNs(0), gpuNs(-1),
+        visibleBranches(0), visibleNodes(0), leafLabels(0), internalLabels(0), traversedNodes(0), deferredNodes(0) {}
+
+    /** Header line for a CSV trace of render statistics. */
+    static QString CsvHeader()
+    {
+        return "frame,tree_ms,text_search_ms,leaf_labels_ms,internal_labels_ms,render_ms,paint_ms,"
+               "frame_interval_ms,gpu_ms,visible_branches,visible_nodes,leaf_labels,internal_labels,"
+               "traversed_nodes,deferred_nodes";
+    }
+
+    /** Render statistics as a line of a CSV trace. A GPU time of -1 indicates it is unavailable. */
+    QString ToCsv() const
+    {
+        return QString::number(frame) + ","
+            + QString::number(treeNs * 1e-6, 'f', 3) + ","
+            + QString::number(textSearchNs * 1e-6, 'f', 3) + ","
+            + QString::number(leafLabelsNs * 1e-6, 'f', 3) + ","
+            + QString::number(internalLabelsNs * 1e-6, 'f', 3) + ","
+            + QString::number(renderNs * 1e-6, 'f', 3) + ","
+            + QString::number(paintNs * 1e-6, 'f', 3) + ","
+            + QString::number(frameIntervalNs * 1e-6, 'f', 3) + ","
+            + (gpuNs < 0 ? QString("-1") : QString::number(gpuNs * 1e-6, 'f', 3)) + ","
+            + QString::number(visibleBranches) + ","
+            + QString::number(visibleNodes) + ","
+            + QString::number(leafLabels) + ","
+            + QString::number(internalLabels) + ","
+            + QString::number(traversedNodes) + ","
+            + QString::number(deferredNodes);
+    }
+
+    /** Number of frame since rendering statistics were first collected. */
+    quint64 frame;
+
+    /** CPU time spent rendering branches and nodes (ns). */
+    qint64 treeNs;
+
+    /** CPU time spent rendering text search highlights (ns). */
+    qint64 textSearchNs;
+
+    /** CPU time spent rendering leaf node labels (ns). */
+    qint64 leafLabelsNs;
+
+    /** CPU time spent rendering internal node labels (ns). */
+    qint64 internalLabelsNs;
+
+    /** CPU time spent in VisualTree::Render() (ns). */
+    qint64 renderNs;
+
+    /** CPU time spent painting the entire frame (ns). */
+    qint64 paintNs;
+
+    /** Time since the previous frame was painted (ns). */
+    qint64 frameIntervalNs;
+
+    /** GPU time of the most recent frame with a completed timer query (ns), or -1 if unavailable. */
+    qint64 gpuNs;
+
+    /** Number of branch segments drawn. */
+    uint visibleBranches;
+
+    /** Number of nodes within the viewport. */
+    uint visibleNodes;
+
+    /** Number of leaf node labels drawn. */
+    uint leafLabels;
+
+    /** Number of internal node labels drawn. */
+    uint internalLabels;
+
+    /** Number of nodes traversed while rendering the tree. */
+    uint traversedNodes;
+
+    /** Number of nodes not traversed as the node budget of a progressive frame was reached. Clades among them are drawn in outline. */
+    uint deferredNodes;
+} RenderStats;
+
+}
+
+#endif
@@ -0,0 +1,608 @@
+#include "SnapshotIO.hpp"
+#include "MetadataInfo.hpp"
+#include "NodePhylo.hpp"
+#include "State.hpp"
+#include "VisualTree.hpp"
+
+#include "../utils/BufferedWriter.hpp"
+#include "../utils/Tree.hpp"
+
+#include <QFile>
+#include <QHash>
+
+#include <cstring>
+#include <functional>
+#include <map>
+#include <set>
+#include <stack>
+#include <vector>
+
+using namespace pygmy;
+using namespace utils;
+
+namespace
+{
+
+/** Identifies a file as a snapshot. */
+const char MAGIC[8] = { 'P', 'Y', 'G', 'M', 'Y', 'S', 'N', 'P' };
+
+/** Written in native byte order to detect files written on machines with a different byte order. */
+const quint32 BYTE_ORDER_MARK = 0x01020304;
+
+/** Index used for missing strings (e.g., a node without a value for a metadata field). */
+const quint32 NO_STRING = 0xFFFFFFFF;
+
+/** Maximum number of sections in a snapshot. */
+const quint32 MAX_SECTIONS = 64;
+
+/** Flags indicating which labels the label bounding boxes were calculated for. */
+enum LABEL_FLAGS { LEAF_LABELS = 1, METADATA_LABELS = 2 };
+
+/** Sections of a snapshot. All arrays are indexed by the pre-order position of a node. */
+enum SECTION_ID
+{
+    TOPOLOGY = 1,       // qint32 index of parent node (-1 for the root)
+    NODE_IDS = 2,       // quint32 id of node
+    BRANCH_LENGTHS = 3, // float distance to parent
+    BOOTSTRAPS = 4,     // float bootstrap value to parent
+    NAMES = 5,          // quint32 string index of node name
+    STRINGS = 6,        // quint32 count, quint32 offsets[count+1], UTF-8 data
+    STATISTICS = 7,     // float distance to root[n], qint32 depth[n], qint32 height[n]
+    LAYOUT = 8,         // float x[n], float y[n], float interval start[n], float interval end[n]
+    LABEL_BOXES = 9,    // float x, y, dx, dy of each label (zero for internal nodes)
+    METADATA = 10       // quint32 number of fields, quint32 field names[fields], quint32 values[fields][n]
+};
+
+/** Fixed size header at the start of a snapshot. */
+struct SnapshotHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    quint32 numNodes;
+    quint32 numLeaves;
+    float lengthOfTree;
+    quint32 branchStyle;
+    quint32 sortStyle;
+    quint32 labelFlags;
+    quint32 fontFile;
+    quint32 fontSize;
+    quint32 metadataField;
+    float widestLabel;
+    float highestLabel;
+    quint32 treeName;
+    quint32 numSections;
+    quint32 reserved;
+};
+
+/** Entry in the section directory following the header. */
+struct SnapshotSection
+{
+    quint32 id;
+    quint32 reserved;
+    quint64 offset;
+    quint64 size;
+};
+
+/** Round offset up to a multiple of 8 bytes so arrays in the mapped file are aligned. */
+quint64 Align(quint64 offset)
+{
+    return (offset + 7) & ~quint64(7);
+}
+
+template<class T>
+void WriteValue(BufferedWriter& out, T value)
+{
+    out.Write(reinterpret_cast<const char*>(&value), int(sizeof(T)));
+}
+
+/** Strings stored once regardless of how many nodes refer to them. */
+class StringTable
+{
+public:
+    StringTable() { Intern(QString()); }
+
+    quint32 Intern(const QString& str)
+    {
+        QHash<QString, quint32>::const_iterator it = m_indices.constFind(str);
+        if(it != m_indices.constEnd())
+            return it.value();
+
+        quint32 index = quint32(m_strings.size());
+        m_indices.insert(str, index);
+        m_strings.push_back(str.toUtf8());
+        m_bytes += m_strings.back().size();
+
+        return index;
+    }
+
+    quint64 Size() const { return 4 + 4*(quint64(m_strings.size()) + 1) + m_bytes; }
+
+    void Write(BufferedWriter& out) const
+    {
+        WriteValue(out, quint32(m_strings.size()));
+
+        quint32 offset = 0;
+        WriteValue(out, offset);
+        for(const QByteArray& str : m_strings)
+        {
+            offset += str.size();
+            WriteValue(out, offset);
+        }
+
+        for(const QByteArray& str : m_strings)
+            out << str;
+    }
+
+protected:
+    QHash<QString, quint32> m_indices;
+    std::vector<QByteArray> m_strings;
+    quint64 m_bytes = 0;
+};
+
+/** Section written by a function producing exactly 'size' bytes. */
+struct PendingSection
+{
+    SECTION_ID id;
+    quint64 size;
+    std::function<void(BufferedWriter&)> write;
+};
+
+}
+
+bool SnapshotIO::IsSnapshot(const QString& filename)
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    char magic[sizeof(MAGIC)];
+    return file.read(magic, sizeof(magic)) == qint64(sizeof(magic)) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool SnapshotIO::Write(VisualTreePtr visualTree, const QString& filename, bool bMetadata)
+{
+    m_error.clear();
+
+    Tree<NodePhylo>::Ptr tree = visualTree->GetTree();
+    State& state = State::Inst();
+
+    // order nodes by a pre-order traversal so each parent precedes its children
+    std::vector<NodePhylo*> nodes;
+    std::vector<qint32> parents;
+    nodes.reserve(tree->GetNumberOfNodes());
+    parents.reserve(tree->GetNumberOfNodes());
+
+    std::stack< std::pair<NodePhylo*, qint32> > stack;
+    stack.push(std::make_pair(tree->GetRootNode(), -1));
+    while(!stack.empty())
+    {
+        NodePhylo* node = stack.top().first;
+        qint32 parent = stack.top().second;
+        stack.pop();
+
+        qint32 index = qint32(nodes.size());
+        nodes.push_back(node);
+        parents.push_back(parent);
+
+        // push in reverse so children are visited in their original order
+        for(uint i = node->GetNumberOfChildren(); i > 0; --i)
+            stack.push(std::make_pair(node->GetChild(i-1), index));
+    }
+    quint32 numNodes = quint32(nodes.size());
+
+    StringTable strings;
+    std::vector<quint32> names(numNodes);
+    uint numLeaves = 0;
+    for(quint32 i = 0; i < numNodes; ++i)
+    {
+        names[i] = strings.Intern(nodes[i]->GetName());
+        if(nodes[i]->IsLeaf())
+            numLeaves++;
+    }
+
+    // metadata is stored as one column of string indices per field
+    std::vector<QString> fields;
+    std::vector<quint32> metadataValues;
+    if(bMetadata)
+    {
+        std::set<QString> fieldSet;
+        for(NodePhylo* node : nodes)
+        {
+            std::map<QString, QString> metadata = node->GetMetadata();
+            for(const auto& item : metadata)
+                fieldSet.insert(item.first);
+        }
+        fields.assign(fieldSet.begin(), fieldSet.end());
+
+        metadataValues.assign(fields.size() * numNodes, NO_STRING);
+        for(quint32 i = 0; i < numNodes; ++i)
+        {
+            std::map<QString, QString> metadata = nodes[i]->GetMetadata();
+            for(size_t f = 0; f < fields.size() && !metadata.empty(); ++f)
+            {
+                std::map<QString, QString>::const_iterator it = metadata.find(fields[f]);
+                if(it != metadata.end())
+                    metadataValues[f*numNodes + i] = strings.Intern(it->second);
+            }
+        }
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.numNodes = numNodes;
+    header.numLeaves = numLeaves;
+    header.lengthOfTree = tree->GetLengthOfTree();
+    header.branchStyle = quint32(visualTree->GetBranchStyle());
+    header.sortStyle = quint32(visualTree->GetSubtreeSortStyle());
+    header.labelFlags = (state.GetShowLeafLabels() ? LEAF_LABELS : 0) | (state.GetShowMetadataLabels() ? METADATA_LABELS : 0);
+    header.fontFile = strings.Intern(state.GetFontFile());
+    header.fontSize = state.GetTreeFontSize();
+    header.metadataField = strings.Intern(state.GetMetadataField());
+    header.widestLabel = visualTree->GetWidestLabel();
+    header.highestLabel = visualTree->GetHighestLabel();
+    header.treeName = strings.Intern(tree->GetName());
+
+    std::vector<quint32> fieldNames;
+    for(const QString& field : fields)
+        fieldNames.push_back(strings.Intern(field));
+
+    // sections are written directly from the tree, so their sizes must be known in advance
+    quint64 n = numNodes;
+    std::vector<PendingSection> sections;
+    sections.push_back({ TOPOLOGY, 4*n, [&](BufferedWriter& out) {
+        for(qint32 parent : parents)
+            WriteValue(out, parent);
+    }});
+    sections.push_back({ NODE_IDS, 4*n, [&](BufferedWriter& out) {
+        for(NodePhylo* node : nodes)
+            WriteValue(out, quint32(node->GetId()));
+    }});
+    sections.push_back({ BRANCH_LENGTHS, 4*n, [&](BufferedWriter& out) {
+        for(NodePhylo* node : nodes)
+            WriteValue(out, node->GetDistanceToParent());
+    }});
+    sections.push_back({ BOOTSTRAPS, 4*n, [&](BufferedWriter& out) {
+        for(NodePhylo* node : nodes)
+            WriteValue(out, node->GetBootstrapToParent());
+    }});
+    sections.push_back({ NAMES, 4*n, [&](BufferedWriter& out) {
+        for(quint32 name : names)
+            WriteValue(out, name);
+    }});
+    sections.push_back({ STATISTICS, 12*n, [&](BufferedWriter& out) {
+        for(NodePhylo* node : nodes)
+            WriteValue(out, node->GetDistanceToRoot());
+        for(NodePhylo* node : nodes)
+            WriteValue(out, qint32(node->GetDepth()));
+        for(NodePhylo* node : nodes)
+            WriteValue(out, qint32(node->GetHeight()));
+    }});
+    sections.push_back({ LAYOUT, 16*n, [&](BufferedWriter& out) {
+        for(NodePhylo* node : nodes)
+            WriteValue(out, node->GetPosition().x);
+        for(NodePhylo* node : nodes)
+            WriteValue(out, node->GetPosition().y);
+        for(NodePhylo* node : nodes)
+            WriteValue(out, node->GetInterval().start);
+        for(NodePhylo* node : nodes)
+            WriteValue(out, node->GetInterval().end);
+    }});
+    if(!visualTree->GetLabelBoundingBoxes().empty())
+    {
+        sections.push_back({ LABEL_BOXES, 16*n, [&](BufferedWriter& out) {
+            const std::map<Node::NodeId, BBox>& bboxMap = visualTree->GetLabelBoundingBoxes();
+            for(NodePhylo* node : nodes)
+            {
+                BBox bbox;
+                std::map<Node::NodeId, BBox>::const_iterator it = bboxMap.find(node->GetId());
+                if(node->IsLeaf() && it != bboxMap.end())
+                    bbox = it->second;
+
+                WriteValue(out, bbox.x);
+                WriteValue(out, bbox.y);
+                WriteValue(out, bbox.dx);
+                WriteValue(out, bbox.dy);
+            }
+        }});
+    }
+    if(!fields.empty())
+    {
+        sections.push_back({ METADATA, 4 + 4*fieldNames.size() + 4*metadataValues.size(), [&](BufferedWriter& out) {
+            WriteValue(out, quint32(fieldNames.size()));
+            for(quint32 field : fieldNames)
+                WriteValue(out, field);
+            for(quint32 value : metadataValues)
+                WriteValue(out, value);
+        }});
+    }
+
+    // the string table is written last as all strings must be interned first
+    sections.push_back({ STRINGS, strings.Size(), [&](BufferedWriter& out) { strings.Write(out); } });
+
+    header.numSections = quint32(sections.size());
+
+    std::vector<SnapshotSection> directory;
+    quint64 offset = Align(sizeof(SnapshotHeader) + sections.size()*sizeof(SnapshotSection));
+    for(const PendingSection& section : sections)
+    {
+        SnapshotSection entry = { quint32(section.id), 0, offset, section.size };
+        directory.push_back(entry);
+        offset = Align(offset + section.size);
+    }
+
+    QFile file(filename);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        m_error = "Failed to open file: " + file.errorString();
+        return false;
+    }
+
+    BufferedWriter out(&file);
+    out.Write(reinterpret_cast<const char*>(&header), int(sizeof(header)));
+    out.Write(reinterpret_cast<const char*>(&directory[0]), int(directory.size()*sizeof(SnapshotSection)));
+
+    const char padding[8] = { 0 };
+    quint64 written = sizeof(SnapshotHeader) + directory.size()*sizeof(SnapshotSection);
+    for(size_t i = 0; i < sections.size(); ++i)
+    {
+        out.Write(padding, int(directory[i].offset - written));
+        sections[i].write(out);
+        written = directory[i].offset + directory[i].size;
+    }
+
+    if(!out.Finish())
+    {
+        m_error = "Failed to write file: " + file.errorString();
+        file.remove();
+        return false;
+    }
+
+    return true;
+}
+
+bool SnapshotIO::Read(const QString& filename, VisualTreePtr& visualTree, bool bMetadata)
+{
+    m_error.clear();
+
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        m_error = "Failed to open file: " + file.errorString();
+        return false;
+    }
+
+    quint64 fileSize = quint64(file.size());
+    if(fileSize < sizeof(SnapshotHeader))
+    {
+        m_error = "File is not a pygmy snapshot.";
+        return false;
+    }
+
+    const uchar* data = file.map(0, file.size());
+    if(!data)
+    {
+        m_error = "Failed to memory map file: " + file.errorString();
+        return false;
+    }
+
+    SnapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    if(memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        m_error = "File is not a pygmy snapshot.";
+        return false;
+    }
+
+    if(header.byteOrder != BYTE_ORDER_MARK)
+    {
+        m_error = "Snapshot was written on a machine with a different byte order.";
+        return false;
+    }
+
+    if(header.version != VERSION)
+    {
+        m_error = QString("Snapshot format version %1 is not supported.").arg(header.version);
+        return false;
+    }
+
+    if(header.numNodes == 0 || header.numSections > MAX_SECTIONS
+        || sizeof(SnapshotHeader) + header.numSections*sizeof(SnapshotSection) > fileSize
+        || header.branchStyle > VisualTree::SLANTED_CLADOGRAM || header.sortStyle > VisualTree::DESCENDING)
+    {
+        m_error = "Snapshot is corrupt.";
+        return false;
+    }
+
+    // find a section, checking it lies within the file and has the expected size
+    const SnapshotSection* directory = reinterpret_cast<const SnapshotSection*>(data + sizeof(SnapshotHeader));
+    auto findSection = [&](SECTION_ID id, quint64 minSize, quint64* size) -> const uchar* {
+        for(quint32 i = 0; i < header.numSections; ++i)
+        {
+            const SnapshotSection& section = directory[i];
+            if(section.id != quint32(id))
+                continue;
+
+            if(section.offset % 8 != 0 || section.offset > fileSize || section.size > fileSize - section.offset || section.size < minSize)
+                return NULL;
+
+            if(size)
+                *size = section.size;
+
+            return data + section.offset;
+        }
+
+        return NULL;
+    };
+
+    quint64 n = header.numNodes;
+    const qint32* parents = reinterpret_cast<const qint32*>(findSection(TOPOLOGY, 4*n, NULL));
+    const quint32* ids = reinterpret_cast<const quint32*>(findSection(NODE_IDS, 4*n, NULL));
+    const float* branchLengths = reinterpret_cast<const float*>(findSection(BRANCH_LENGTHS, 4*n, NULL));
+    const float* bootstraps = reinterpret_cast<const float*>(findSection(BOOTSTRAPS, 4*n, NULL));
+    const quint32* names = reinterpret_cast<const quint32*>(findSection(NAMES, 4*n, NULL));
+    const float* statistics = reinterpret_cast<const float*>(findSection(STATISTICS, 12*n, NULL));
+    const float* layout = reinterpret_cast<const float*>(findSection(LAYOUT, 16*n, NULL));
+
+    quint64 stringsSize = 0;
+    const uchar* stringsSection = findSection(STRINGS, 8, &stringsSize);
+
+    if(!parents || !ids || !branchLengths || !bootstraps || !names || !statistics || !stringsSection)
+    {
+        m_error = "Snapshot is corrupt.";
+        return false;
+    }
+
+    // strings are only converted when first used
+    const quint32* stringOffsets = reinterpret_cast<const quint32*>(stringsSection + 4);
+    quint32 numStrings = *reinterpret_cast<const quint32*>(stringsSection);
+    if(4 + 4*(quint64(numStrings) + 1) > stringsSize
+        || 4 + 4*(quint64(numStrings) + 1) + stringOffsets[numStrings] > stringsSize)
+    {
+        m_error = "Snapshot is corrupt.";
+        return false;
+    }
+
+    const char* stringData = reinterpret_cast<const char*>(stringOffsets + numStrings + 1);
+    std::vector<QString> stringCache(numStrings);
+    std::vector<bool> bConverted(numStrings, false);
+    bool bCorrupt = false;
+    auto getString = [&](quint32 index) -> const QString& {
+        static const QString empty;
+        if(index >= numStrings || stringOffsets[index] > stringOffsets[index+1] || stringOffsets[index+1] > stringOffsets[numStrings])
+        {
+            bCorrupt = bCorrupt || index != NO_STRING;
+            return empty;
+        }
+
+        if(!bConverted[index])
+        {
+            stringCache[index] = QString::fromUtf8(stringData + stringOffsets[index], int(stringOffsets[index+1] - stringOffsets[index]));
+            bConverted[index] = true;
+        }
+
+        return stringCache[index];
+    };
+
+    // create nodes; each parent precedes its children so the tree can be built in a single pass
+    const qint32* depths = reinterpret_cast<const qint32*>(statistics + n);
+    const qint32* heights = reinterpret_cast<const qint32*>(statistics + 2*n);
+
+    Tree<NodePhylo>::Ptr tree(new Tree<NodePhylo>());
+    std::vector<NodePhylo*> nodes(n);
+    uint numLeaves = 0;
+    for(quint64 i = 0; i < n; ++i)
+    {
+        if((i == 0) != (parents[i] < 0) || parents[i] >= qint64(i))
+        {
+            m_error = "Snapshot is corrupt.";
+            return false;
+        }
+
+        NodePhylo* node = new NodePhylo(ids[i], getString(names[i]));
+        node->SetDistanceToParent(branchLengths[i]);
+        node->SetBootstrapToParent(bootstraps[i]);
+        node->SetDistanceToRoot(statistics[i]);
+        node->SetDepth(depths[i]);
+        node->SetHeight(heights[i]);
+
+        if(layout)
+        {
+            node->SetPosition(Point(layout[i], layout[n + i]));
+            node->SetInterval(Interval(layout[2*n + i], layout[3*n + i]));
+        }
+
+        if(i == 0)
+            tree->SetRootNode(node);
+        else
+            nodes[parents[i]]->AddChild(node);
+
+        nodes[i] = node;
+    }
+
+    for(NodePhylo* node : nodes)
+    {
+        if(node->IsLeaf())
+            numLeaves++;
+    }
+
+    // metadata must be set before the visual tree clones the tree
+    quint64 metadataSize = 0;
+    const quint32* metadata = bMetadata ? reinterpret_cast<const quint32*>(findSection(METADATA, 4, &metadataSize)) : NULL;
+    quint32 numFields = metadata ? metadata[0] : 0;
+    if(metadata && 4 + 4*(quint64(numFields) + numFields*n) <= metadataSize)
+    {
+        const quint32* fieldNames = metadata + 1;
+        const quint32* values = fieldNames + numFields;
+        for(quint64 i = 0; i < n; ++i)
+        {
+            std::map<QString, QString> nodeMetadata;
+            for(quint32 f = 0; f < numFields; ++f)
+            {
+                quint32 value = values[f*n + i];
+                if(value != NO_STRING)
+                    nodeMetadata[getString(fieldNames[f])] = getString(value);
+            }
+
+            if(!nodeMetadata.empty())
+                nodes[i]->SetMetadata(nodeMetadata);
+        }
+    }
+    else
+        numFields = 0;
+
+    if(bCorrupt)
+    {
+        m_error = "Snapshot is corrupt.";
+        return false;
+    }
+
+    tree->SetName(getString(header.treeName));
+    tree->SetStatistics(numLeaves, header.numNodes, header.lengthOfTree);
+
+    visualTree.reset(new VisualTree(tree));
+    visualTree->SetBranchStyle(VisualTree::BRANCH_STYLE(header.branchStyle));
+    visualTree->SetSubtreeSortStyle(VisualTree::SUBTREE_SORT(header.sortStyle));
+    if(!layout)
+        visualTree->Layout();
+
+    if(numFields > 0)
+    {
+        MetadataInfoPtr metadataInfo(new MetadataInfo());
+        metadataInfo->SetMetadata(tree);
+        visualTree->SetMetadataInfo(metadataInfo);
+    }
+
+    // label bounding boxes are only valid for the font and labels they were calculated with
+    State& state = State::Inst();
+    quint32 labelFlags = (state.GetShowLeafLabels() ? LEAF_LABELS : 0) | (state.GetShowMetadataLabels() ? METADATA_LABELS : 0);
+    const float* labelBoxes = NULL;
+    if(labelFlags == header.labelFlags && labelFlags != 0
+        && header.fontSize == state.GetTreeFontSize() && getString(header.fontFile) == state.GetFontFile()
+        && (!(labelFlags & METADATA_LABELS) || (numFields > 0 && getString(header.metadataField) == state.GetMetadataField())))
+    {
+        labelBoxes = reinterpret_cast<const float*>(findSection(LABEL_BOXES, 16*n, NULL));
+    }
+
+    if(labelBoxes)
+    {
+        std::map<Node::NodeId, BBox> bboxMap;
+        for(quint64 i = 0; i < n; ++i)
+        {
+            if(nodes[i]->IsLeaf())
+                bboxMap.insert(std::make_pair(ids[i], BBox(labelBoxes[4*i], labelBoxes[4*i+1], labelBoxes[4*i+2], labelBoxes[4*i+3])));
+        }
+
+        visualTree->SetLabelBoundingBoxes(std::move(bboxMap), header.widestLabel, header.highestLabel);
+    }
+    else
+        visualTree->LabelBoundingBoxes();
+
+    file.unmap(const_cast<uchar*>(data));
+    file.close();
+
+    return true;
+}
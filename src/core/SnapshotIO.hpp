@@ -0,0 +1,84 @@
+#ifndef _SNAPSHOT_IO_HPP_
+#define _SNAPSHOT_IO_HPP_
+
+#include "../core/DataTypes.hpp"
+
+#include <QString>
+
+namespace pygmy
+{
+
+/**
+ * @brief Read/write trees in pygmy's binary snapshot format (.pygmy).
+ *
+ * A snapshot stores a tree together with everything computed when a Newick file
+ * is opened: node statistics (depth, height, distance to root), the layout of all
+ * nodes for the current branch style and the bounding boxes of leaf labels. The
+ * leaf metadata may optionally be included. Opening a snapshot therefore only
+ * requires the nodes to be created, rather than parsing the Newick string and
+ * recalculating statistics, layout and label sizes.
+ *
+ * The file consists of a fixed size header, a directory of sections and the
+ * sections themselves. Each section is a flat array indexed by the position of
+ * a node in a pre-order traversal of the tree, with all strings (names, metadata
+ * values) interned in a single string table. The file is memory mapped when read,
+ * so sections which are not needed (e.g., label bounding boxes calculated for a
+ * different font, or metadata when it is not requested) are never paged in.
+ *
+ * Snapshots are written in the byte order of the machine writing them and are
+ * rejected on machines with a different byte order.
+ *
+ * Code example:
+ * @code
+ * SnapshotIO snapshotIO;
+ * VisualTreePtr visualTree;
+ * if(!snapshotIO.Read("reference.pygmy", visualTree))
+ *     qCritical() << snapshotIO.GetError();
+ * @endcode
+ */
+class SnapshotIO
+{
+public:
+    /** Version of the snapshot format written by this class. */
+    static const uint VERSION = 1;
+
+public:
+    /** Constructor. */
+    SnapshotIO() {}
+
+    /** Check if a file is a snapshot (regardless of its extension). */
+    static bool IsSnapshot(const QString& filename);
+
+    /**
+     * @brief Write current tree of a visual tree to a snapshot.
+     * @param visualTree Tree to write. Layout() must have been called.
+     * @param filename The file path.
+     * @param bMetadata Flag indicating if the metadata of nodes should be written.
+     * @return True if snapshot was written successfully, else false.
+     */
+    bool Write(VisualTreePtr visualTree, const QString& filename, bool bMetadata = true);
+
+    /**
+     * @brief Read a snapshot.
+     *
+     * Label bounding boxes are recalculated if the snapshot was written with a
+     * different font or label settings than those currently in use.
+     *
+     * @param filename The file path.
+     * @param visualTree Set to the tree read from the snapshot, ready to be rendered.
+     * @param bMetadata Flag indicating if metadata should be read if present.
+     * @return True if snapshot was read successfully, else false.
+     */
+    bool Read(const QString& filename, VisualTreePtr& visualTree, bool bMetadata = true);
+
+    /** Get description of the most recent error. */
+    QString GetError() const { return m_error; }
+
+protected:
+    /** Description of the most recent error. */
+    QString m_error;
+};
+
+}
+
+#endif
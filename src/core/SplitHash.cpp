@@ -0,0 +1,262 @@
+#include "SplitHash.hpp"
+
+#include <algorithm>
+
+using namespace pygmy;
+
+namespace
+{
+    /** SplitMix64 generator, used to derive well mixed codes from a counter. */
+    quint64 SplitMix64(quint64 x)
+    {
+        x += Q_UINT64_C(0x9e3779b97f4a7c15);
+        x = (x ^ (x >> 30)) * Q_UINT64_C(0xbf58476d1ce4e5b9);
+        x = (x ^ (x >> 27)) * Q_UINT64_C(0x94d049bb133111eb);
+        return x ^ (x >> 31);
+    }
+}
+
+bool SplitHash::SetTaxa(const std::vector<QString>& taxa)
+{
+    m_taxa.clear();
+    m_taxa.reserve(int(taxa.size()));
+    m_names.clear();
+    m_codes.clear();
+    m_all = SplitKey();
+    m_numTaxa = 0;
+
+    for(uint i = 0; i < taxa.size(); ++i)
+    {
+        if(m_taxa.contains(taxa[i]))
+        {
+            m_taxa.clear();
+            m_codes.clear();
+            return false;
+        }
+
+        SplitKey code(SplitMix64(2*quint64(i)), SplitMix64(2*quint64(i) + 1));
+        m_taxa.insert(taxa[i], i);
+        m_codes.push_back(code);
+        m_all ^= code;
+    }
+
+    m_names = taxa;
+    m_numTaxa = uint(taxa.size());
+
+    return true;
+}
+
+bool SplitHash::GetCladeTree(NodePhylo* root, bool bRooted, std::vector<Clade>& clades) const
+{
+    clades.clear();
+    if(m_numTaxa == 0)
+        return false;
+
+    // unrooted trees are traversed as if rooted on the leaf of the first taxon,
+    // which has the root of the tree as its only neighbour if the tree is a single leaf
+    NodePhylo* start = root;
+    NodePhylo* reference = NULL;
+    if(!bRooted)
+    {
+        std::vector<NodePhylo*> stack(1, root);
+        while(!stack.empty() && !reference)
+        {
+            NodePhylo* node = stack.back();
+            stack.pop_back();
+            if(node->GetNumberOfChildren() == 0 && node->GetName() == m_names[0])
+                reference = node;
+
+            for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
+                stack.push_back(node->GetChild(i));
+        }
+
+        if(!reference || !reference->GetParent())
+            return false;
+
+        start = reference->GetParent();
+    }
+
+    // iterative post-order traversal in which the neighbours of a node are its
+    // children and its parent, excluding the node it was reached from
+    struct Frame
+    {
+        NodePhylo* node;
+        NodePhylo* from;
+        uint neighbour;
+        uint firstChild;
+    };
+
+    std::vector<Frame> stack;
+    std::vector<int> children;
+    Frame frame = { start, reference, 0, 0 };
+    stack.push_back(frame);
+    while(!stack.empty())
+    {
+        Frame& top = stack.back();
+        NodePhylo* node = top.node;
+
+        NodePhylo* next = NULL;
+        while(!next && top.neighbour <= node->GetNumberOfChildren())
+        {
+            NodePhylo* neighbour = (top.neighbour < node->GetNumberOfChildren()) ? node->GetChild(top.neighbour) : node->GetParent();
+            top.neighbour++;
+            if(neighbour && neighbour != top.from)
+                next = neighbour;
+        }
+
+        if(next)
+        {
+            Frame child = { next, node, 0, uint(children.size()) };
+            stack.push_back(child);
+            continue;
+        }
+
+        // the branch defining the clade joins the node to the node it was reached from
+        NodePhylo* lower = (top.from && top.from->GetParent() == node) ? top.from : node;
+        float length = lower->GetDistanceToParent();
+        uint firstChild = top.firstChild;
+        stack.pop_back();
+
+        uint numChildren = uint(children.size()) - firstChild;
+        if(numChildren == 1)
+        {
+            // a node with a single child does not define a new clade
+            Clade& clade = clades[children.back()];
+            if(length != NodePhylo::NO_DISTANCE)
+                clade.length = (clade.length != NodePhylo::NO_DISTANCE) ? clade.length + length : length;
+
+            continue;
+        }
+
+        Clade clade;
+        clade.node = lower;
+        clade.parent = -1;
+        clade.length = length;
+        if(numChildren == 0)
+        {
+            QHash<QString, uint>::const_iterator it = m_taxa.constFind(node->GetName());
+            if(it == m_taxa.constEnd())
+                return false;
+
+            clade.key = m_codes[it.value()];
+            clade.numLeaves = 1;
+            clade.taxon = int(it.value());
+        }
+        else
+        {
+            clade.numLeaves = 0;
+            clade.taxon = -1;
+            for(uint i = firstChild; i < children.size(); ++i)
+            {
+                clades[children[i]].parent = int(clades.size());
+                clade.key ^= clades[children[i]].key;
+                clade.numLeaves += clades[children[i]].numLeaves;
+            }
+            children.resize(firstChild);
+        }
+
+        children.push_back(int(clades.size()));
+        clades.push_back(clade);
+    }
+
+    // every taxon must occur exactly once
+    const Clade& all = clades.back();
+    if(bRooted)
+        return all.numLeaves == m_numTaxa && all.key == m_all;
+
+    return all.numLeaves == m_numTaxa - 1 && all.key == (m_all ^ m_codes[0]);
+}
+
+bool SplitHash::GetClades(NodePhylo* root, bool bRooted, std::vector<NodePhylo*>& nodes, std::vector<SplitKey>& keys) const
+{
+    nodes.clear();
+    keys.clear();
+
+    std::vector<Clade> clades;
+    if(!GetCladeTree(root, bRooted, clades))
+        return false;
+
+    // leaves and the clade containing all taxa considered are trivial
+    foreach(const Clade& clade, clades)
+    {
+        if(clade.numLeaves > 1 && clade.parent != -1)
+        {
+            nodes.push_back(clade.node);
+            keys.push_back(clade.key);
+        }
+    }
+
+    return true;
+}
+
+bool SplitHash::GetNodeClades(NodePhylo* root, bool bRooted, std::vector<NodePhylo*>& nodes,
+                              std::vector<SplitKey>& keys, std::vector<uint>& numLeaves) const
+{
+    nodes.clear();
+    keys.clear();
+    numLeaves.clear();
+    if(m_numTaxa == 0)
+        return false;
+
+    // a pre-order traversal, which visited in reverse is a post-order traversal
+    std::vector<int> parents;
+    std::vector< std::pair<NodePhylo*, int> > stack(1, std::make_pair(root, -1));
+    while(!stack.empty())
+    {
+        NodePhylo* node = stack.back().first;
+        parents.push_back(stack.back().second);
+        stack.pop_back();
+
+        int index = int(nodes.size());
+        nodes.push_back(node);
+        for(uint i = node->GetNumberOfChildren(); i > 0; --i)
+            stack.push_back(std::make_pair(node->GetChild(i - 1), index));
+    }
+
+    uint numNodes = uint(nodes.size());
+    keys.resize(numNodes);
+    numLeaves.resize(numNodes, 0);
+    std::vector<bool> hasReference(numNodes, false);
+    for(uint i = numNodes; i > 0; --i)
+    {
+        uint index = i - 1;
+        NodePhylo* node = nodes[index];
+        if(node->GetNumberOfChildren() == 0)
+        {
+            QHash<QString, uint>::const_iterator it = m_taxa.constFind(node->GetName());
+            if(it != m_taxa.constEnd())
+            {
+                keys[index] = m_codes[it.value()];
+                numLeaves[index] = 1;
+                hasReference[index] = (it.value() == 0);
+            }
+        }
+
+        int parent = parents[index];
+        if(parent >= 0)
+        {
+            keys[parent] ^= keys[index];
+            numLeaves[parent] += numLeaves[index];
+            hasReference[parent] = hasReference[parent] || hasReference[index];
+        }
+    }
+
+    // every taxon must occur exactly once
+    if(numLeaves[0] != m_numTaxa || keys[0] != m_all)
+        return false;
+
+    if(!bRooted)
+    {
+        for(uint i = 0; i < numNodes; ++i)
+        {
+            if(hasReference[i])
+                keys[i] ^= m_all;
+        }
+    }
+
+    std::reverse(nodes.begin(), nodes.end());
+    std::reverse(keys.begin(), keys.end());
+    std::reverse(numLeaves.begin(), numLeaves.end());
+
+    return true;
+}
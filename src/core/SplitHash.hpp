@@ -0,0 +1,177 @@
+#ifndef _SPLIT_HASH_HPP_
+#define _SPLIT_HASH_HPP_
+
+#include "../core/NodePhylo.hpp"
+
+#include <QHash>
+#include <QString>
+
+#include <vector>
+
+namespace pygmy
+{
+
+/** 128-bit key identifying a set of taxa. */
+struct SplitKey
+{
+    SplitKey(): lo(0), hi(0) {}
+    SplitKey(quint64 _lo, quint64 _hi): lo(_lo), hi(_hi) {}
+
+    SplitKey operator^(const SplitKey& key) const { return SplitKey(lo ^ key.lo, hi ^ key.hi); }
+    SplitKey& operator^=(const SplitKey& key) { lo ^= key.lo; hi ^= key.hi; return *this; }
+
+    bool operator==(const SplitKey& key) const { return lo == key.lo && hi == key.hi; }
+    bool operator!=(const SplitKey& key) const { return !(*this == key); }
+    bool operator<(const SplitKey& key) const { return hi < key.hi || (hi == key.hi && lo < key.lo); }
+
+    quint64 lo;
+    quint64 hi;
+};
+
+inline uint qHash(const SplitKey& key, uint seed = 0)
+{
+    return uint(key.lo ^ (key.lo >> 32)) ^ seed;
+}
+
+/**
+ * @brief Identify clades (or splits) of trees over a common set of taxa.
+ *
+ * Each taxon is assigned a random 128-bit code and a clade is identified by the
+ * exclusive-or of the codes of its leaves. This allows the clades of a tree to
+ * be found in a single traversal with memory proportional to the depth of the
+ * tree, rather than storing a bit set of leaves for each node. The probability
+ * of two different clades sharing a key is negligible (about 2^-128 per pair).
+ *
+ * Clades of rooted trees are compared directly. For unrooted trees, a split is
+ * identified by the side which does not contain the first taxon. This is
+ * equivalent to rooting every tree on the first taxon, so the splits of
+ * different trees nest in the same way as rooted clades.
+ *
+ * Code example:
+ * @code
+ * SplitHash splitHash;
+ * splitHash.SetTaxa(tree->GetLeafNames());
+ * std::vector<NodePhylo*> nodes;
+ * std::vector<SplitKey> keys;
+ * splitHash.GetClades(tree->GetRootNode(), false, nodes, keys);
+ * @endcode
+ */
+class SplitHash
+{
+public:
+    /** Clade of a tree, together with the smallest clade of the tree containing it. */
+    struct Clade
+    {
+        /** Node below the branch defining the clade. */
+        NodePhylo* node;
+
+        /** Key of clade. */
+        SplitKey key;
+
+        /** Number of leaves in clade. */
+        uint numLeaves;
+
+        /** Index of taxon if the clade is a single leaf, else -1. */
+        int taxon;
+
+        /** Index of the smallest clade containing this one, or -1 for the clade containing all taxa considered. */
+        int parent;
+
+        /** Length of the branch defining the clade, or NO_DISTANCE if the tree has no branch lengths. */
+        float length;
+    };
+
+public:
+    /** Constructor. */
+    SplitHash(): m_numTaxa(0) {}
+
+    /**
+     * @brief Set the taxa clades are formed from.
+     * @param taxa Names of taxa (i.e., leaves).
+     * @return False if names are not unique.
+     */
+    bool SetTaxa(const std::vector<QString>& taxa);
+
+    /** Get number of taxa. */
+    uint GetNumberOfTaxa() const { return m_numTaxa; }
+
+    /** Check if a taxon is known. */
+    bool HasTaxon(const QString& name) const { return m_taxa.contains(name); }
+
+    /** Get name of a taxon. */
+    QString GetTaxon(uint index) const { return m_names.at(index); }
+
+    /**
+     * @brief Get every clade of a tree, including leaves, along with how clades nest.
+     *
+     * For rooted trees the largest clade contains all taxa and is defined by the root.
+     * For unrooted trees the tree is viewed as rooted on the first taxon, so the
+     * largest clade contains all but the first taxon and is defined by its leaf.
+     * Nodes with a single child (including the root of an unrooted tree with two
+     * children) do not define a new clade; their branch is merged with that of
+     * their child.
+     *
+     * Clades are reported in post-order, so a clade always follows the clades it contains.
+     *
+     * @param root Root of tree.
+     * @param bRooted Flag indicating if clades are compared as rooted clades (true) or unrooted splits (false).
+     * @param clades Set to the clades of the tree.
+     * @return False if the leaves of the tree are not exactly the taxa of this object.
+     */
+    bool GetCladeTree(NodePhylo* root, bool bRooted, std::vector<Clade>& clades) const;
+
+    /**
+     * @brief Get the key of every non-trivial clade in a tree.
+     *
+     * Clades containing a single leaf, all leaves, and (for unrooted trees) all but
+     * one leaf are trivial and not reported. Keys are reported in post-order.
+     *
+     * @param root Root of tree.
+     * @param bRooted Flag indicating if clades are compared as rooted clades (true) or unrooted splits (false).
+     * @param nodes Set to the internal node defining each clade.
+     * @param keys Set to the key of each clade.
+     * @return False if the leaves of the tree are not exactly the taxa of this object.
+     */
+    bool GetClades(NodePhylo* root, bool bRooted, std::vector<NodePhylo*>& nodes, std::vector<SplitKey>& keys) const;
+
+    /**
+     * @brief Get the clade below every node of a tree, restricted to the taxa of this object.
+     *
+     * Leaves whose taxa are unknown are ignored, so trees with different leaves can
+     * be compared over the taxa they share. Unlike GetCladeTree(), every node is
+     * reported, including nodes whose clade is the same as that of their only child
+     * (after ignoring leaves) or which contain no known taxa. For unrooted trees the
+     * key is that of the side of the split without the first taxon.
+     *
+     * Nodes are reported in post-order.
+     *
+     * @param root Root of tree.
+     * @param bRooted Flag indicating if clades are compared as rooted clades (true) or unrooted splits (false).
+     * @param nodes Set to every node of the tree.
+     * @param keys Set to the key of the clade of each node.
+     * @param numLeaves Set to the number of known taxa below each node.
+     * @return False if the tree does not contain every taxon of this object exactly once.
+     */
+    bool GetNodeClades(NodePhylo* root, bool bRooted, std::vector<NodePhylo*>& nodes,
+                        std::vector<SplitKey>& keys, std::vector<uint>& numLeaves) const;
+
+protected:
+    /** Index of each taxon. */
+    QHash<QString, uint> m_taxa;
+
+    /** Name of each taxon. */
+    std::vector<QString> m_names;
+
+    /** Code assigned to each taxon. */
+    std::vector<SplitKey> m_codes;
+
+    /** Number of taxa. */
+    uint m_numTaxa;
+
+    /** Key of the clade containing all taxa. */
+    SplitKey m_all;
+};
+
+}
+
+#endif
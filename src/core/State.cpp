@@ -93,6 +93,8 @@ void State::Load()
     m_translationSensitivity = settings.value("Mouse/translationSensitivity", 15.8f).toFloat();
     m_zoomSensitivity = settings.value("Mouse/zoomSensitivity", 0.015f).toFloat();
 
+    m_bShowRenderStats = settings.value("Debug/showRenderStats", false).toBool();
+
         /*elem = pRoot->FirstChildElement("ColourMapVis");
 		elem->GetAttribute("width", &m_colourMapWidth);
 		elem->GetAttribute("show", &m_bShowColourMapVis);
@@ -155,5 +157,6 @@ void State::Save()
     settings.setValue("Mouse/scrollSensitivity", m_scrollSensitivity);
     settings.setValue("Mouse/translationSensitivity", m_translationSensitivity);
     settings.setValue("Mouse/zoomSensitivity", m_zoomSensitivity);
+    settings.setValue("Debug/showRenderStats", m_bShowRenderStats);
     settings.setValue("MainWindow/PreviousDir", m_prevOpenedDir);
 }
@@ -262,6 +262,12 @@ public:
 	/** Get flag indicating if ordering of leaf nodes should be optimized. */
 	bool GetOptimizeLeafNodeOrdering() { return m_bOptimizeLeafNodes; }
 
+	/** Set flag indicating if render statistics should be overlaid on the tree viewport. */
+	void SetShowRenderStats(bool state) { m_bShowRenderStats = state; }
+
+	/** Get flag indicating if render statistics should be overlaid on the tree viewport. */
+	bool GetShowRenderStats() { return m_bShowRenderStats; }
+
     void SetPreviousDirectory(QString dir) { m_prevOpenedDir = dir; }
 
     QString GetPreviousDirectory() {return m_prevOpenedDir; }
@@ -404,6 +410,9 @@ private:
 	/** Flag indicating if ordering of leaf nodes should be optimized. */
 	bool m_bOptimizeLeafNodes;
 
+	/** Flag indicating if render statistics should be overlaid on the tree viewport. */
+	bool m_bShowRenderStats;
+
     /** The directory of the previously opened file.
      *  This directory will be opened again for the next file open*/
     QString m_prevOpenedDir;
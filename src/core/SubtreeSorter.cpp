@@ -0,0 +1,158 @@
+#include "SubtreeSorter.hpp"
+
+#include "MemoryReport.hpp"
+
+#include "../utils/AlphaNumericSorter.hpp"
+
+#include <QHash>
+#include <QSet>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <limits>
+
+using namespace pygmy;
+using namespace utils;
+
+const uint SubtreeSorter::MIN_PARALLEL_NODES = 16384;
+
+bool SubtreeSorter::Sort(Tree<NodePhylo>::Ptr tree, SORT_KEY key, const QString& field, bool bAscending)
+{
+    // the field only matters when sorting by metadata
+    bool bSameKey = (key == m_key && (key != SORT_BY_FIELD || field == m_field));
+    if(m_bSorted && bSameKey && bAscending == m_bAscending)
+        return false;
+
+    // pre-order traversal; iterative as trees may be too deep to recurse
+    std::vector<NodePhylo*> nodes;
+    nodes.reserve(tree->GetNumberOfNodes());
+    std::vector<NodePhylo*> stack(1, tree->GetRootNode());
+    while(!stack.empty())
+    {
+        NodePhylo* node = stack.back();
+        stack.pop_back();
+
+        nodes.push_back(node);
+        for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
+            stack.push_back(node->GetChild(i));
+    }
+
+    // heights and numbers of leaves do not depend on the direction of sorting
+    bool bKeysReusable = m_bKeysValid && bSameKey
+            && (bAscending == m_bAscending || key == SORT_BY_HEIGHT || key == SORT_BY_LEAVES);
+    if(!bKeysReusable)
+        CalculateKeys(nodes, key, field, bAscending);
+
+    m_bSorted = true;
+    m_bKeysValid = true;
+    m_key = key;
+    m_field = field;
+    m_bAscending = bAscending;
+
+    std::vector<NodePhylo*> parents;
+    for(NodePhylo* node : nodes)
+    {
+        if(node->GetNumberOfChildren() > 1)
+            parents.push_back(node);
+    }
+
+    uint numParents = uint(parents.size());
+    if(numParents < MIN_PARALLEL_NODES)
+    {
+        SortChildren(&parents, 0, numParents, &m_keys, bAscending);
+        return true;
+    }
+
+    // each node's children are sorted independently, so ranges of nodes can be sorted concurrently
+    uint numRanges = uint(qMax(1, QThread::idealThreadCount())) * 4;
+    std::vector< QFuture<void> > futures;
+    for(uint i = 0; i < numRanges; ++i)
+    {
+        uint begin = uint(quint64(numParents) * i / numRanges);
+        uint end = uint(quint64(numParents) * (i + 1) / numRanges);
+        futures.push_back(QtConcurrent::run(SortChildren, &parents, begin, end, &m_keys, bAscending));
+    }
+
+    for(uint i = 0; i < futures.size(); ++i)
+        futures[i].waitForFinished();
+
+    return true;
+}
+
+void SubtreeSorter::CalculateKeys(const std::vector<NodePhylo*>& nodes, SORT_KEY key, const QString& field, bool bAscending)
+{
+    Node::NodeId maxId = 0;
+    for(NodePhylo* node : nodes)
+        maxId = std::max(maxId, node->GetId());
+
+    m_keys.assign(nodes.empty() ? 0 : maxId + 1, 0.0);
+
+    // names and metadata values are ranked in alphanumeric order, so subtrees are compared by number
+    QHash<QString, double> ranks;
+    if(key == SORT_BY_NAME || key == SORT_BY_FIELD)
+    {
+        QSet<QString> values;
+        for(NodePhylo* node : nodes)
+        {
+            if(node->IsLeaf())
+                values.insert((key == SORT_BY_NAME) ? node->GetName() : node->GetData(field));
+        }
+        values.remove(QString());
+
+        std::vector<QString> sortedValues(values.begin(), values.end());
+
+        AlphaNumericSorter::Sort(sortedValues);
+
+        ranks.reserve(int(sortedValues.size()));
+        for(uint i = 0; i < sortedValues.size(); ++i)
+            ranks.insert(sortedValues[i], double(i));
+    }
+
+    // leaves without a value are placed last in either direction
+    double missing = bAscending ? std::numeric_limits<double>::infinity() : -std::numeric_limits<double>::infinity();
+
+    // children follow their parent in pre-order, so visiting nodes in reverse calculates keys bottom-up
+    for(std::vector<NodePhylo*>::const_reverse_iterator it = nodes.rbegin(); it != nodes.rend(); ++it)
+    {
+        NodePhylo* node = *it;
+        double& nodeKey = m_keys[node->GetId()];
+
+        if(node->IsLeaf())
+        {
+            if(key == SORT_BY_HEIGHT)
+                nodeKey = 0.0;
+            else if(key == SORT_BY_LEAVES)
+                nodeKey = 1.0;
+            else
+                nodeKey = ranks.value((key == SORT_BY_NAME) ? node->GetName() : node->GetData(field), missing);
+
+            continue;
+        }
+
+        nodeKey = (key == SORT_BY_NAME || key == SORT_BY_FIELD) ? missing : 0.0;
+        for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
+        {
+            double childKey = m_keys[node->GetChild(i)->GetId()];
+            if(key == SORT_BY_HEIGHT)
+                nodeKey = std::max(nodeKey, childKey + 1.0);
+            else if(key == SORT_BY_LEAVES)
+                nodeKey += childKey;
+            else if(bAscending)
+                nodeKey = std::min(nodeKey, childKey);
+            else
+                nodeKey = std::max(nodeKey, childKey);
+        }
+    }
+}
+
+void SubtreeSorter::SortChildren(const std::vector<NodePhylo*>* nodes, uint begin, uint end, const std::vector<double>* keys, bool bAscending)
+{
+    for(uint i = begin; i < end; ++i)
+        (*nodes)[i]->sortChildren(*keys, bAscending);
+}
+
+void SubtreeSorter::ReportMemory(MemoryReport& report) const
+{
+    report.Add(MemoryReport::LAYOUT, MemoryReport::VectorBytes(m_keys));
+}
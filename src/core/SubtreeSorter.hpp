@@ -0,0 +1,83 @@
+#ifndef _SUBTREE_SORTER_HPP_
+#define _SUBTREE_SORTER_HPP_
+
+#include "../core/NodePhylo.hpp"
+
+#include "../utils/Tree.hpp"
+
+#include <QString>
+
+#include <vector>
+
+namespace pygmy
+{
+
+class MemoryReport;
+
+/**
+ * @brief Order the children of each node by a key of their subtree.
+ *
+ * The key of every subtree is calculated in a single bottom-up pass and kept
+ * until the tree changes: the height of a subtree, its number of leaves, or the
+ * first (or last, when sorting in descending order) name or metadata value of its
+ * leaves in alphanumeric order. Leaves without a value for the field are placed
+ * last. Children are reordered with a stable sort, so subtrees with equal keys
+ * keep their order, and nodes are sorted on several threads for large trees.
+ * Sorting a tree which is already in the requested order does nothing.
+ *
+ * Keys are indexed by node id, which readers assign sequentially.
+ */
+class SubtreeSorter
+{
+public:
+    enum SORT_KEY { SORT_BY_HEIGHT, SORT_BY_LEAVES, SORT_BY_NAME, SORT_BY_FIELD };
+
+    /** Minimum number of nodes with several children before they are sorted on several threads. */
+    static const uint MIN_PARALLEL_NODES;
+
+public:
+    /** Constructor. */
+    SubtreeSorter(): m_bSorted(false), m_bKeysValid(false), m_key(SORT_BY_HEIGHT), m_bAscending(false) {}
+
+    /**
+     * @brief Order the children of every node by the key of their subtree, unless the tree is already in this order.
+     * @param tree Tree to sort.
+     * @param key Key subtrees are ordered by.
+     * @param field Metadata field subtrees are ordered by when sorting by SORT_BY_FIELD.
+     * @param bAscending Flag indicating if subtrees are placed in ascending or descending order of their key.
+     * @return True if children were reordered.
+     */
+    bool Sort(utils::Tree<NodePhylo>::Ptr tree, SORT_KEY key, const QString& field, bool bAscending);
+
+    /** Calculate keys and sort again on the next call to Sort() (e.g., after the tree or its metadata changes). */
+    void Invalidate() { m_bSorted = false; m_bKeysValid = false; }
+
+    /** Add the memory used by the keys to a report. */
+    void ReportMemory(MemoryReport& report) const;
+
+protected:
+    /** Calculate the key of every subtree of a tree given in pre-order. */
+    void CalculateKeys(const std::vector<NodePhylo*>& nodes, SORT_KEY key, const QString& field, bool bAscending);
+
+    /** Sort the children of each node in a range. */
+    static void SortChildren(const std::vector<NodePhylo*>* nodes, uint begin, uint end, const std::vector<double>* keys, bool bAscending);
+
+protected:
+    /** Flag indicating if the tree is in the order given by the key, field and direction below. */
+    bool m_bSorted;
+
+    /** Flag indicating if keys were calculated for the current tree and the key, field and direction below. */
+    bool m_bKeysValid;
+
+    /** Key, field and direction subtrees were last ordered by. */
+    SORT_KEY m_key;
+    QString m_field;
+    bool m_bAscending;
+
+    /** Key of each subtree, indexed by the id of its root. */
+    std::vector<double> m_keys;
+};
+
+}
+
+#endif
@@ -109,6 +109,19 @@ public:
 	 */
 	FilterPtr DataFilter() { return m_dataFilter; }
 
+	/** Add the memory used by the list of words and filtered items to a report. */
+	void ReportMemory(MemoryReport& report) const
+	{
+		report.Add(MemoryReport::SEARCH_INDEX, MemoryReport::MapBytes(m_words) + MemoryReport::VectorBytes(m_wordFilter));
+
+		// words are usually the labels of leaves, whose data is shared
+        std::map<QString, uint>::const_iterator it;
+		for(it = m_words.begin(); it != m_words.end(); ++it)
+			report.AddString(MemoryReport::SEARCH_INDEX, it->first);
+
+		m_dataFilter->ReportMemory(report);
+	}
+
 private:
 	/** Map words to associated data. */
     std::map<QString, uint> m_words;
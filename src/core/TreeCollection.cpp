@@ -0,0 +1,168 @@
+#include "TreeCollection.hpp"
+
+#include "../core/NewickIO.hpp"
+#include "../core/NexusIO.hpp"
+#include "../core/TreeReader.hpp"
+#include "../core/TreeTokenizer.hpp"
+
+#include "../utils/StreamReader.hpp"
+
+#include <QFile>
+
+using namespace pygmy;
+using namespace utils;
+
+TreeCollection::TreeCollection(uint maxCachedNodes)
+    : m_cache(int(maxCachedNodes))
+{
+}
+
+bool TreeCollection::Open(const QString& filename)
+{
+    m_error.clear();
+    m_filename = filename;
+    m_trees.clear();
+    m_translateTables.clear();
+    m_cache.clear();
+
+    TreeReader::FORMAT format = TreeReader::DetectFormat(filename);
+    if(format != TreeReader::NEWICK && format != TreeReader::NEXUS)
+    {
+        m_error = "Only Newick and NEXUS files can be opened as a collection of trees.";
+        return false;
+    }
+
+    QFile input(filename);
+    if(!input.open(QIODevice::ReadOnly))
+    {
+        m_error = "Failed to open " + filename + ": " + input.errorString();
+        return false;
+    }
+
+    StreamReader reader(&input);
+    if(reader.IsCompressed())
+    {
+        m_error = "Compressed files can not be opened as a collection of trees.";
+        return false;
+    }
+
+    if(format == TreeReader::NEXUS)
+    {
+        // the NEXUS reader reads the device from its start
+        input.seek(0);
+
+        NexusIO nexusIO;
+        std::vector<NexusIO::TreeOffset> offsets;
+        if(!nexusIO.Index(&input, offsets, m_translateTables))
+        {
+            m_error = nexusIO.GetError();
+            return false;
+        }
+
+        m_trees.reserve(offsets.size());
+        foreach(const NexusIO::TreeOffset& offset, offsets)
+        {
+            TreeEntry entry;
+            entry.offset = offset.offset;
+            entry.name = offset.name;
+            entry.translateTable = offset.translateTable;
+            m_trees.push_back(entry);
+        }
+
+        return true;
+    }
+
+    // each tree of a Newick file starts at the first token following the end of the previous tree
+    TreeTokenizer tokenizer(reader);
+    TreeTokenizer::Token token;
+    while(tokenizer.Next(token))
+    {
+        if(token.type == TreeTokenizer::COMMENT || token.Is(';'))
+            continue;
+
+        TreeEntry entry;
+        entry.offset = tokenizer.GetTokenPosition();
+        entry.translateTable = -1;
+        m_trees.push_back(entry);
+
+        if(!tokenizer.SkipTo(';'))
+            break;
+    }
+
+    if(tokenizer.HasError())
+        m_error = tokenizer.GetError();
+    else if(m_trees.empty())
+        m_error = "No trees found in " + filename + ".";
+
+    if(!m_error.isEmpty())
+        m_trees.clear();
+
+    return m_error.isEmpty();
+}
+
+QString TreeCollection::GetTreeName(uint index) const
+{
+    if(index < m_trees.size() && !m_trees[index].name.isEmpty())
+        return m_trees[index].name;
+
+    return QString("Tree %1").arg(index + 1);
+}
+
+Tree<NodePhylo>::Ptr TreeCollection::GetTree(uint index)
+{
+    Tree<NodePhylo>::Ptr* cached = m_cache.object(index);
+    if(cached)
+        return *cached;
+
+    Tree<NodePhylo>::Ptr tree = LoadTree(index, &m_error);
+    if(!tree)
+        return tree;
+
+    // trees larger than the entire cache are not cached
+    int cost = int(tree->GetNumberOfNodes());
+    if(cost <= m_cache.maxCost())
+        m_cache.insert(index, new Tree<NodePhylo>::Ptr(tree), cost);
+
+    return tree;
+}
+
+Tree<NodePhylo>::Ptr TreeCollection::LoadTree(uint index, QString* error) const
+{
+    if(index >= m_trees.size())
+    {
+        if(error)
+            *error = QString("There is no tree %1 in the collection.").arg(index + 1);
+
+        return Tree<NodePhylo>::Ptr();
+    }
+
+    const TreeEntry& entry = m_trees[index];
+
+    QFile input(m_filename);
+    if(!input.open(QIODevice::ReadOnly) || !input.seek(entry.offset))
+    {
+        if(error)
+            *error = "Failed to read " + m_filename + ": " + input.errorString();
+
+        return Tree<NodePhylo>::Ptr();
+    }
+
+    // reading stops at the semicolon ending the tree, so only a single block past it is read
+    StreamReader reader(&input, 1 << 16);
+    TreeTokenizer tokenizer(reader);
+    NewickIO newickIO;
+    Tree<NodePhylo>::Ptr tree(new Tree<NodePhylo>());
+    const std::map<QString, QString>* translate = (entry.translateTable >= 0) ? &m_translateTables[entry.translateTable] : NULL;
+    if(!newickIO.ParseTree(tokenizer, tree, translate))
+    {
+        if(error)
+            *error = QString("Failed to parse %1: %2").arg(GetTreeName(index)).arg(newickIO.GetError());
+
+        return Tree<NodePhylo>::Ptr();
+    }
+
+    tree->SetName(GetTreeName(index));
+    tree->CalculateStatistics();
+
+    return tree;
+}
@@ -0,0 +1,116 @@
+#ifndef _TREE_COLLECTION_HPP_
+#define _TREE_COLLECTION_HPP_
+
+#include "../core/NodePhylo.hpp"
+
+#include "../utils/Tree.hpp"
+
+#include <QCache>
+#include <QString>
+
+#include <map>
+#include <vector>
+
+namespace pygmy
+{
+
+/**
+ * @brief Set of trees stored in a single Newick or NEXUS file (e.g., bootstrap or posterior trees).
+ *
+ * Opening a collection makes a single pass over the file which records where
+ * each tree starts without parsing it. Trees are parsed when requested and
+ * the most recently used trees are kept in a cache, so moving between trees
+ * does not require the file to be read again and files containing thousands
+ * of trees can be browsed with bounded memory.
+ *
+ * Compressed files can not be opened as a collection, since trees can only
+ * be located by their position within the file.
+ *
+ * Code example:
+ * @code
+ * TreeCollection collection;
+ * if(!collection.Open("posterior.trees"))
+ *     qCritical() << collection.GetError();
+ * Tree<NodePhylo>::Ptr tree = collection.GetTree(collection.GetNumberOfTrees() - 1);
+ * @endcode
+ */
+class TreeCollection
+{
+public:
+    /**
+     * @brief Constructor.
+     * @param maxCachedNodes Maximum total number of nodes in cached trees.
+     */
+    TreeCollection(uint maxCachedNodes = 1000000);
+
+    /**
+     * @brief Find all trees in a file.
+     * @param filename The file path.
+     * @return True if at least one tree was found, else false.
+     */
+    bool Open(const QString& filename);
+
+    /** Get name of file. */
+    QString GetFilename() const { return m_filename; }
+
+    /** Get number of trees in collection. */
+    uint GetNumberOfTrees() const { return uint(m_trees.size()); }
+
+    /** Get name of a tree (the name given in a NEXUS file or its position in the collection). */
+    QString GetTreeName(uint index) const;
+
+    /**
+     * @brief Get a tree, parsing it if it is not cached.
+     * @param index Index of tree.
+     * @return Tree, or a null pointer if the tree could not be read.
+     */
+    utils::Tree<NodePhylo>::Ptr GetTree(uint index);
+
+    /**
+     * @brief Parse a tree without using or updating the cache.
+     *
+     * Unlike GetTree(), this may be called from several threads at once.
+     *
+     * @param index Index of tree.
+     * @param error Set to a description of any error.
+     * @return Tree, or a null pointer if the tree could not be read.
+     */
+    utils::Tree<NodePhylo>::Ptr LoadTree(uint index, QString* error = NULL) const;
+
+    /** Get description of the most recent error. */
+    QString GetError() const { return m_error; }
+
+protected:
+    /** Location of a tree within the file. */
+    struct TreeEntry
+    {
+        /** Position of the Newick string of the tree. */
+        qint64 offset;
+
+        /** Name of tree. Empty if the tree is unnamed. */
+        QString name;
+
+        /** Index of TRANSLATE table applying to tree, or -1 if there is none. */
+        int translateTable;
+    };
+
+protected:
+    /** Name of file. */
+    QString m_filename;
+
+    /** Location of each tree. */
+    std::vector<TreeEntry> m_trees;
+
+    /** TRANSLATE tables of a NEXUS file. */
+    std::vector< std::map<QString, QString> > m_translateTables;
+
+    /** Most recently used trees. The cost of a tree is its number of nodes. */
+    QCache<uint, utils::Tree<NodePhylo>::Ptr> m_cache;
+
+    /** Description of the most recent error. */
+    QString m_error;
+};
+
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include "TreeComparison.hpp"
+
+#include "../core/SplitHash.hpp"
+
+#include <QSet>
+
+using namespace pygmy;
+using namespace utils;
+
+const char* TreeComparison::FIELD = "In Other Tree";
+const char* TreeComparison::PRESENT = "Yes";
+const char* TreeComparison::ABSENT = "No";
+
+namespace
+{
+    /** Clades below every node of a tree, restricted to the shared taxa. */
+    struct TreeClades
+    {
+        std::vector<NodePhylo*> nodes;
+        std::vector<SplitKey> keys;
+        std::vector<uint> numLeaves;
+
+        /** Distinct non-trivial clades. */
+        QSet<SplitKey> clades;
+    };
+
+    /** Leaves, clades containing every shared taxon, and (for unrooted trees) clades with all but one are trivial. */
+    bool IsTrivial(uint numLeaves, uint numTaxa, bool bRooted)
+    {
+        return numLeaves <= 1 || numLeaves >= (bRooted ? numTaxa : numTaxa - 1);
+    }
+
+    void Annotate(const TreeClades& tree, const TreeClades& other, uint numTaxa, bool bRooted)
+    {
+        for(uint i = 0; i < tree.nodes.size(); ++i)
+        {
+            // nodes without shared taxa (e.g., leaves missing from the other tree) are absent
+            bool bPresent = tree.numLeaves[i] > 0
+                    && (IsTrivial(tree.numLeaves[i], numTaxa, bRooted) || other.clades.contains(tree.keys[i]));
+
+            std::map<QString, QString> metadata = tree.nodes[i]->GetMetadata();
+            metadata[TreeComparison::FIELD] = bPresent ? TreeComparison::PRESENT : TreeComparison::ABSENT;
+            tree.nodes[i]->SetMetadata(metadata);
+        }
+    }
+}
+
+bool TreeComparison::Compare(Tree<NodePhylo>::Ptr first, Tree<NodePhylo>::Ptr second)
+{
+    m_error.clear();
+    m_numSharedTaxa = 0;
+    m_numClades[0] = m_numClades[1] = 0;
+    m_numSharedClades = 0;
+
+    // clades are compared over the leaves found in both trees
+    std::vector<QString> names = first->GetLeafNames();
+    SplitHash secondNames;
+    if(!secondNames.SetTaxa(second->GetLeafNames()))
+    {
+        m_error = "Leaf names must be unique to compare clades between trees.";
+        return false;
+    }
+
+    std::vector<QString> taxa;
+    foreach(const QString& name, names)
+    {
+        if(secondNames.HasTaxon(name))
+            taxa.push_back(name);
+    }
+
+    SplitHash splitHash;
+    if(!splitHash.SetTaxa(taxa))
+    {
+        m_error = "Leaf names must be unique to compare clades between trees.";
+        return false;
+    }
+
+    if(taxa.size() < 2)
+    {
+        m_error = "The trees must share at least two leaves to be compared.";
+        return false;
+    }
+
+    TreeClades clades[2];
+    Tree<NodePhylo>::Ptr trees[2] = { first, second };
+    for(uint t = 0; t < 2; ++t)
+    {
+        TreeClades& tree = clades[t];
+        if(!splitHash.GetNodeClades(trees[t]->GetRootNode(), m_bRooted, tree.nodes, tree.keys, tree.numLeaves))
+        {
+            m_error = "Leaf names must be unique to compare clades between trees.";
+            return false;
+        }
+
+        tree.clades.reserve(int(tree.nodes.size()));
+        for(uint i = 0; i < tree.nodes.size(); ++i)
+        {
+            if(!IsTrivial(tree.numLeaves[i], uint(taxa.size()), m_bRooted))
+                tree.clades.insert(tree.keys[i]);
+        }
+
+        m_numClades[t] = uint(tree.clades.size());
+    }
+
+    foreach(const SplitKey& key, clades[0].clades)
+    {
+        if(clades[1].clades.contains(key))
+            m_numSharedClades++;
+    }
+
+    m_numSharedTaxa = uint(taxa.size());
+    Annotate(clades[0], clades[1], m_numSharedTaxa, m_bRooted);
+    Annotate(clades[1], clades[0], m_numSharedTaxa, m_bRooted);
+
+    return true;
+}
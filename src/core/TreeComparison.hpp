@@ -0,0 +1,104 @@
+#ifndef _TREE_COMPARISON_HPP_
+#define _TREE_COMPARISON_HPP_
+
+#include "../core/NodePhylo.hpp"
+
+#include "../utils/Tree.hpp"
+
+#include <QString>
+
+namespace pygmy
+{
+
+/**
+ * @brief Compare the clades of two trees.
+ *
+ * Clades are identified by hashing (see SplitHash), so the Robinson-Foulds
+ * distance between two trees is found in time linear in the number of leaves.
+ * Trees need not have the same leaves: clades are compared over the leaves the
+ * trees share, with all other leaves ignored.
+ *
+ * Each node of both trees is annotated with a metadata field (see FIELD)
+ * indicating if its clade is also found in the other tree. Leaves are marked
+ * as present if the other tree has a leaf with the same name.
+ *
+ * Code example:
+ * @code
+ * TreeComparison comparison;
+ * if(comparison.Compare(first, second))
+ *     qDebug() << comparison.GetDistance();
+ * @endcode
+ */
+class TreeComparison
+{
+public:
+    /** Name of metadata field set by Compare(). */
+    static const char* FIELD;
+
+    /** Value of FIELD for nodes whose clade is found in the other tree. */
+    static const char* PRESENT;
+
+    /** Value of FIELD for nodes whose clade is not found in the other tree. */
+    static const char* ABSENT;
+
+public:
+    /**
+     * @brief Constructor.
+     * @param bRooted Flag indicating if clades are compared as rooted clades (true) or unrooted splits (false).
+     */
+    TreeComparison(bool bRooted = false)
+        : m_bRooted(bRooted), m_numSharedTaxa(0), m_numSharedClades(0) { m_numClades[0] = m_numClades[1] = 0; }
+
+    /**
+     * @brief Compare two trees and annotate their nodes (see FIELD).
+     * @param first First tree.
+     * @param second Second tree.
+     * @return False if the trees share fewer than two leaves or leaf names are not unique.
+     */
+    bool Compare(utils::Tree<NodePhylo>::Ptr first, utils::Tree<NodePhylo>::Ptr second);
+
+    /** Flag indicating if clades are compared as rooted clades. */
+    bool IsRooted() const { return m_bRooted; }
+
+    /** Get the Robinson-Foulds distance (number of clades found in only one of the trees). */
+    uint GetDistance() const { return m_numClades[0] + m_numClades[1] - 2*m_numSharedClades; }
+
+    /** Get the Robinson-Foulds distance divided by the number of non-trivial clades of both trees. */
+    float GetNormalisedDistance() const
+    {
+        uint numClades = m_numClades[0] + m_numClades[1];
+        return numClades ? float(GetDistance()) / numClades : 0.0f;
+    }
+
+    /** Get number of distinct non-trivial clades of the first (0) or second (1) tree. */
+    uint GetNumberOfClades(uint tree) const { return m_numClades[tree]; }
+
+    /** Get number of non-trivial clades found in both trees. */
+    uint GetNumberOfSharedClades() const { return m_numSharedClades; }
+
+    /** Get number of leaves found in both trees. */
+    uint GetNumberOfSharedTaxa() const { return m_numSharedTaxa; }
+
+    /** Get description of the most recent error. */
+    QString GetError() const { return m_error; }
+
+protected:
+    /** Flag indicating if clades are compared as rooted clades. */
+    bool m_bRooted;
+
+    /** Number of leaves found in both trees. */
+    uint m_numSharedTaxa;
+
+    /** Number of distinct non-trivial clades of each tree. */
+    uint m_numClades[2];
+
+    /** Number of non-trivial clades found in both trees. */
+    uint m_numSharedClades;
+
+    /** Description of the most recent error. */
+    QString m_error;
+};
+
+}
+
+#endif
@@ -0,0 +1,182 @@
+#include "TreeEdit.hpp"
+#include "MemoryReport.hpp"
+
+using namespace pygmy;
+using namespace utils;
+
+TreeEdit::TreeEdit(const QString& description, Tree<NodePhylo>::Ptr tree)
+    : m_description(description),
+      m_treeBefore(tree),
+      m_treeAfter(tree),
+      m_rootBefore(tree->GetRootNode()),
+      m_rootAfter(tree->GetRootNode()),
+      m_bApplied(true)
+{
+}
+
+TreeEdit::~TreeEdit()
+{
+    // removed nodes are only part of the tree while the change is undone
+    if(m_bApplied)
+    {
+        for(NodePhylo* node : m_removed)
+            delete node;
+    }
+}
+
+TreeEdit::Links TreeEdit::GetLinks(NodePhylo* node)
+{
+    Links links;
+    links.parent = node->GetParent();
+    links.children = node->GetChildren();
+    links.distanceToParent = node->GetDistanceToParent();
+    links.bootstrap = node->GetBootstrapToParent();
+
+    return links;
+}
+
+void TreeEdit::Record(NodePhylo* node)
+{
+    if(!node || m_indices.contains(node))
+        return;
+
+    m_indices.insert(node, uint(m_nodes.size()));
+
+    ModifiedNode modifiedNode;
+    modifiedNode.node = node;
+    modifiedNode.before = GetLinks(node);
+    m_nodes.push_back(modifiedNode);
+}
+
+void TreeEdit::RecordAll()
+{
+    // iterative pre-order traversal, as trees may be too deep to recurse
+    m_nodes.reserve(m_treeBefore->GetNumberOfNodes());
+    m_indices.reserve(int(m_treeBefore->GetNumberOfNodes()));
+
+    std::vector<NodePhylo*> stack(1, m_treeBefore->GetRootNode());
+    while(!stack.empty())
+    {
+        NodePhylo* node = stack.back();
+        stack.pop_back();
+
+        Record(node);
+        for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
+            stack.push_back(node->GetChild(i));
+    }
+}
+
+void TreeEdit::Remove(const std::vector<NodePhylo*>& nodes)
+{
+    m_removed.insert(m_removed.end(), nodes.begin(), nodes.end());
+}
+
+void TreeEdit::Finish(Tree<NodePhylo>::Ptr tree)
+{
+    m_indices.clear();
+    m_indices.squeeze();
+
+    if(tree != m_treeBefore)
+    {
+        // the tree was replaced, so its nodes were not modified
+        m_treeAfter = tree;
+        m_rootAfter = tree->GetRootNode();
+        m_nodes.clear();
+        return;
+    }
+
+    m_rootAfter = tree->GetRootNode();
+
+    // keep only nodes whose links were modified
+    uint numModified = 0;
+    for(uint i = 0; i < m_nodes.size(); ++i)
+    {
+        m_nodes[i].after = GetLinks(m_nodes[i].node);
+        if(m_nodes[i].before == m_nodes[i].after)
+            continue;
+
+        if(numModified != i)
+            m_nodes[numModified] = m_nodes[i];
+        numModified++;
+    }
+
+    m_nodes.resize(numModified);
+    m_nodes.shrink_to_fit();
+    m_removed.shrink_to_fit();
+}
+
+bool TreeEdit::IsEmpty() const
+{
+    return m_treeBefore == m_treeAfter && m_rootBefore == m_rootAfter && m_nodes.empty() && m_removed.empty();
+}
+
+Tree<NodePhylo>::Ptr TreeEdit::Undo()
+{
+    if(m_bApplied)
+    {
+        Apply(true);
+        m_bApplied = false;
+    }
+
+    return m_treeBefore;
+}
+
+Tree<NodePhylo>::Ptr TreeEdit::Redo()
+{
+    if(!m_bApplied)
+    {
+        Apply(false);
+        m_bApplied = true;
+    }
+
+    return m_treeAfter;
+}
+
+void TreeEdit::Apply(bool bBefore)
+{
+    if(m_treeBefore != m_treeAfter)
+        return;
+
+    // children are set before parents as adding a child also sets its parent
+    for(ModifiedNode& modifiedNode : m_nodes)
+    {
+        const Links& links = bBefore ? modifiedNode.before : modifiedNode.after;
+
+        modifiedNode.node->RemoveChildren();
+        for(NodePhylo* child : links.children)
+            modifiedNode.node->AddChild(child);
+    }
+
+    for(ModifiedNode& modifiedNode : m_nodes)
+    {
+        const Links& links = bBefore ? modifiedNode.before : modifiedNode.after;
+
+        modifiedNode.node->SetParent(links.parent);
+        modifiedNode.node->SetDistanceToParent(links.distanceToParent);
+        modifiedNode.node->SetBootstrapToParent(links.bootstrap);
+    }
+
+    m_treeBefore->SetRootNode(bBefore ? m_rootBefore : m_rootAfter);
+    m_treeBefore->CalculateStatistics();
+}
+
+void TreeEdit::ReportMemory(MemoryReport& report) const
+{
+    quint64 bytes = MemoryReport::Allocation(sizeof(TreeEdit)) + MemoryReport::VectorBytes(m_nodes)
+                    + MemoryReport::VectorBytes(m_removed);
+    for(const ModifiedNode& modifiedNode : m_nodes)
+        bytes += MemoryReport::VectorBytes(modifiedNode.before.children) + MemoryReport::VectorBytes(modifiedNode.after.children);
+
+    report.Add(MemoryReport::EDIT_HISTORY, bytes);
+
+    // removed nodes are only outside of the tree while the change is applied
+    if(m_bApplied)
+    {
+        for(NodePhylo* node : m_removed)
+            report.AddNode(node, MemoryReport::EDIT_HISTORY);
+    }
+
+    // trees not shown are only kept so the change can be undone or redone
+    report.AddTree(m_treeBefore, MemoryReport::EDIT_HISTORY);
+    report.AddTree(m_treeAfter, MemoryReport::EDIT_HISTORY);
+}
@@ -0,0 +1,143 @@
+#ifndef _TREE_EDIT_HPP_
+#define _TREE_EDIT_HPP_
+
+#include "../core/NodePhylo.hpp"
+
+#include "../utils/Tree.hpp"
+
+#include <QHash>
+#include <QString>
+
+#include <vector>
+
+namespace pygmy
+{
+
+class MemoryReport;
+
+/**
+ * @brief Change to the structure of a tree which can be undone and redone.
+ *
+ * Rather than cloning the tree, an edit records the links of the nodes that
+ * are about to be modified (parent, children, branch length and support) and
+ * compares them with their links once the change has been made. Only nodes
+ * whose links differ are kept, and nodes removed from the tree are kept by the
+ * edit instead of being destroyed. Undoing or redoing a change, e.g. rerooting
+ * or collapsing nodes of a tree with a million leaves, therefore takes memory
+ * and time in proportion to the number of nodes it modified. An edit which
+ * replaces the tree with another keeps both trees instead.
+ */
+class TreeEdit
+{
+public:
+    /**
+     * @brief Constructor.
+     * @param description Short description of the change (e.g., "Reroot").
+     * @param tree Tree about to be changed.
+     */
+    TreeEdit(const QString& description, utils::Tree<NodePhylo>::Ptr tree);
+
+    /** Destructor. Nodes removed by the edit are destroyed unless it has been undone. */
+    ~TreeEdit();
+
+    /** Get description of change. */
+    QString GetDescription() const { return m_description; }
+
+    /**
+     * @brief Record the links of a node before it is modified. Nodes may be recorded more than once.
+     * @param node Node which may be modified.
+     */
+    void Record(NodePhylo* node);
+
+    /** Record the links of every node of the tree (e.g., when most nodes may be modified). */
+    void RecordAll();
+
+    /**
+     * @brief Keep nodes removed from the tree, rather than destroying them, so the change can be undone.
+     * @param nodes Nodes removed. Their links must be left as they were within the tree.
+     */
+    void Remove(const std::vector<NodePhylo*>& nodes);
+
+    /**
+     * @brief Finish recording the change, discarding nodes whose links have not been modified.
+     * @param tree Tree after the change. If this is a different tree, the tree before the change is kept.
+     */
+    void Finish(utils::Tree<NodePhylo>::Ptr tree);
+
+    /** Flag indicating if the change left the tree unmodified. */
+    bool IsEmpty() const;
+
+    /** Get number of nodes whose links are recorded. */
+    uint GetNumberOfNodes() const { return uint(m_nodes.size()); }
+
+    /** Add the memory used to undo or redo the change, including nodes and trees kept by it, to a report. */
+    void ReportMemory(MemoryReport& report) const;
+
+    /**
+     * @brief Undo the change.
+     * @return Tree as it was before the change.
+     */
+    utils::Tree<NodePhylo>::Ptr Undo();
+
+    /**
+     * @brief Redo the change.
+     * @return Tree as it was after the change.
+     */
+    utils::Tree<NodePhylo>::Ptr Redo();
+
+protected:
+    /** Links of a node to the rest of the tree. */
+    struct Links
+    {
+        NodePhylo* parent;
+        std::vector<NodePhylo*> children;
+        float distanceToParent;
+        float bootstrap;
+
+        bool operator==(const Links& links) const
+        {
+            return parent == links.parent && children == links.children
+                   && distanceToParent == links.distanceToParent && bootstrap == links.bootstrap;
+        }
+    };
+
+    /** Node modified by the change. */
+    struct ModifiedNode
+    {
+        NodePhylo* node;
+        Links before, after;
+    };
+
+protected:
+    /** Get the current links of a node. */
+    static Links GetLinks(NodePhylo* node);
+
+    /** Set the links of the recorded nodes and the root of the tree. */
+    void Apply(bool bBefore);
+
+protected:
+    /** Description of change. */
+    QString m_description;
+
+    /** Tree before and after the change. These are the same tree unless it was replaced. */
+    utils::Tree<NodePhylo>::Ptr m_treeBefore, m_treeAfter;
+
+    /** Root of the tree before and after the change. */
+    NodePhylo* m_rootBefore, * m_rootAfter;
+
+    /** Nodes modified by the change. */
+    std::vector<ModifiedNode> m_nodes;
+
+    /** Index of each recorded node while the change is being made. */
+    QHash<NodePhylo*, uint> m_indices;
+
+    /** Nodes removed from the tree by the change. */
+    std::vector<NodePhylo*> m_removed;
+
+    /** Flag indicating if the change is currently applied to the tree. */
+    bool m_bApplied;
+};
+
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include "TreeReader.hpp"
+
+#include "../core/MetadataInfo.hpp"
+#include "../core/NewickIO.hpp"
+#include "../core/NexusIO.hpp"
+#include "../core/PhyloXmlIO.hpp"
+
+#include "../utils/StreamReader.hpp"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+using namespace pygmy;
+using namespace utils;
+
+TreeReader::FORMAT TreeReader::DetectFormat(const QString& filename)
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+        return UNKNOWN_FORMAT;
+
+    // only the first block of the file is read
+    StreamReader reader(&file, 4096);
+
+    // skip a UTF-8 byte order mark and leading whitespace
+    int ch = reader.Peek();
+    while(ch == 0xef || ch == 0xbb || ch == 0xbf || ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')
+    {
+        reader.Get();
+        ch = reader.Peek();
+    }
+
+    if(ch == '<')
+        return PHYLOXML;
+
+    if(ch == '#')
+    {
+        QByteArray header;
+        while(header.size() < 6 && reader.Peek() != StreamReader::END_OF_STREAM)
+            header.append(char(reader.Get()));
+
+        if(qstricmp(header.constData(), "#NEXUS") == 0)
+            return NEXUS;
+    }
+
+    if(reader.HasError())
+        return UNKNOWN_FORMAT;
+
+    return NEWICK;
+}
+
+QString TreeReader::FormatName(FORMAT format)
+{
+    switch(format)
+    {
+    case NEWICK:
+        return "Newick";
+    case NEXUS:
+        return "NEXUS";
+    case PHYLOXML:
+        return "PhyloXML";
+    default:
+        return "unknown";
+    }
+}
+
+bool TreeReader::Read(Tree<NodePhylo>::Ptr tree, const QString& filename)
+{
+    m_error.clear();
+
+    m_format = DetectFormat(filename);
+    if(m_format == UNKNOWN_FORMAT)
+    {
+        QFile file(filename);
+        if(!file.open(QIODevice::ReadOnly))
+            m_error = "Failed to open " + filename + ": " + file.errorString();
+        else
+            m_error = "Failed to read " + filename + ".";
+
+        return false;
+    }
+
+    bool bLoaded = false;
+    if(m_format == NEXUS)
+    {
+        NexusIO nexusIO;
+        bLoaded = nexusIO.Read(tree, filename);
+        m_error = nexusIO.GetError();
+    }
+    else if(m_format == PHYLOXML)
+    {
+        PhyloXmlIO phyloXmlIO;
+        bLoaded = phyloXmlIO.Read(tree, filename);
+        m_error = phyloXmlIO.GetError();
+    }
+    else
+    {
+        NewickIO newickIO;
+        bLoaded = newickIO.Read(tree, filename);
+        m_error = newickIO.GetError();
+    }
+
+    // unnamed trees are named after the file, as Newick trees are
+    if(bLoaded && tree->GetName().isEmpty())
+        tree->SetName(QFileInfo(filename).baseName());
+
+    if(bLoaded && tree->GetNumberOfLeaves() == 0)
+    {
+        m_error = "The file does not contain any leaves.";
+        bLoaded = false;
+    }
+
+    return bLoaded;
+}
+
+bool TreeReader::ReadLeafNames(const QString& filename, std::vector<QString>& names)
+{
+    m_error.clear();
+    names.clear();
+
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        m_error = "Failed to open " + filename + ": " + file.errorString();
+        return false;
+    }
+
+    QTextStream stream(&file);
+    while(!stream.atEnd())
+    {
+        QString name = stream.readLine().section('\t', 0, 0).trimmed();
+        if(!name.isEmpty())
+            names.push_back(name);
+    }
+
+    if(names.empty())
+    {
+        m_error = filename + " does not contain any names.";
+        return false;
+    }
+
+    return true;
+}
+
+MetadataInfoPtr TreeReader::GetMetadataInfo(Tree<NodePhylo>::Ptr tree)
+{
+    MetadataInfoPtr metadataInfo(new MetadataInfo());
+    metadataInfo->SetMetadata(tree);
+
+    if(metadataInfo->GetFields().isEmpty())
+        return MetadataInfoPtr();
+
+    return metadataInfo;
+}
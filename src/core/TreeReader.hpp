@@ -0,0 +1,87 @@
+#ifndef _TREE_READER_HPP_
+#define _TREE_READER_HPP_
+
+#include "../core/DataTypes.hpp"
+#include "../core/NodePhylo.hpp"
+
+#include "../utils/Tree.hpp"
+
+#include <QString>
+
+#include <vector>
+
+namespace pygmy
+{
+
+/**
+ * @brief Read a tree from a file in any supported format.
+ *
+ * The format is determined from the start of the file rather than its
+ * extension: files starting with #NEXUS are read as NEXUS, files starting
+ * with an XML declaration or element as PhyloXML and all other files as
+ * Newick. Gzip compressed files are decompressed while being read.
+ *
+ * Code example:
+ * @code
+ * TreeReader treeReader;
+ * Tree<NodePhylo>::Ptr tree(new Tree<NodePhylo>());
+ * if(!treeReader.Read(tree, "posterior.trees.gz"))
+ *     qCritical() << treeReader.GetError();
+ * @endcode
+ */
+class TreeReader
+{
+public:
+    enum FORMAT { NEWICK, NEXUS, PHYLOXML, UNKNOWN_FORMAT };
+
+public:
+    /** Constructor. */
+    TreeReader(): m_format(UNKNOWN_FORMAT) {}
+
+    /** Determine format of a tree file from its contents. Returns UNKNOWN_FORMAT if the file can not be read. */
+    static FORMAT DetectFormat(const QString& filename);
+
+    /** Name of a format suitable for display (e.g., in error messages). */
+    static QString FormatName(FORMAT format);
+
+    /**
+     * @brief Read first tree in a file.
+     * @param tree Tree to populate from file.
+     * @param filename The file path.
+     * @return True if tree loaded successfully, else false.
+     */
+    bool Read(utils::Tree<NodePhylo>::Ptr tree, const QString& filename);
+
+    /**
+     * @brief Read names of leaves, one per line (e.g., to project a tree onto). Only the first
+     *        tab-separated column is used, so the leaves listed in an annotations file can be read.
+     * @param filename The file path.
+     * @param names Names read from file.
+     * @return True if at least one name was read, else false.
+     */
+    bool ReadLeafNames(const QString& filename, std::vector<QString>& names);
+
+    /**
+     * @brief Collect metadata read along with a tree (e.g., from NEXUS comments or PhyloXML properties).
+     * @param tree Tree which has been read.
+     * @return Information about the metadata fields of the leaves, or a null pointer if the tree has no metadata.
+     */
+    static MetadataInfoPtr GetMetadataInfo(utils::Tree<NodePhylo>::Ptr tree);
+
+    /** Format of the most recently read file. */
+    FORMAT GetFormat() const { return m_format; }
+
+    /** Get description of the most recent error. */
+    QString GetError() const { return m_error; }
+
+protected:
+    /** Format of the most recently read file. */
+    FORMAT m_format;
+
+    /** Description of the most recent error. */
+    QString m_error;
+};
+
+}
+
+#endif
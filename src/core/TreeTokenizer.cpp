@@ -0,0 +1,180 @@
+#include "TreeTokenizer.hpp"
+
+using namespace pygmy;
+using namespace utils;
+
+namespace
+{
+    inline bool IsSpace(int ch)
+    {
+        return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t' || ch == '\f' || ch == '\v';
+    }
+
+    inline bool IsPunctuation(int ch)
+    {
+        return ch == '(' || ch == ')' || ch == ',' || ch == ':' || ch == ';' || ch == '=';
+    }
+}
+
+bool TreeTokenizer::Next(Token& token)
+{
+    token.text.clear();
+    token.type = END_OF_INPUT;
+
+    if(!m_error.isEmpty())
+        return false;
+
+    // skip whitespace
+    int ch = m_reader.Get();
+    while(IsSpace(ch))
+    {
+        if(ch == '\n')
+            m_line++;
+
+        ch = m_reader.Get();
+    }
+
+    if(ch == StreamReader::END_OF_STREAM)
+        return false;
+
+    m_tokenPosition = m_reader.GetPosition() - 1;
+
+    if(IsPunctuation(ch))
+    {
+        token.type = PUNCTUATION;
+        token.text.append(char(ch));
+        return true;
+    }
+
+    if(ch == '\'' || ch == '"')
+        return ReadQuoted(token, ch);
+
+    if(ch == '[')
+        return ReadComment(token);
+
+    token.type = WORD;
+    token.text.append(char(ch));
+    for(;;)
+    {
+        ch = m_reader.Peek();
+        if(ch == StreamReader::END_OF_STREAM || IsSpace(ch) || IsPunctuation(ch)
+                || ch == '[' || ch == '\'' || ch == '"')
+            break;
+
+        token.text.append(char(m_reader.Get()));
+    }
+
+    return true;
+}
+
+bool TreeTokenizer::SkipTo(char punctuation)
+{
+    if(!m_error.isEmpty())
+        return false;
+
+    uint startLine = m_line;
+    int quote = 0;
+    uint depth = 0;
+    for(;;)
+    {
+        int ch = m_reader.Get();
+        if(ch == StreamReader::END_OF_STREAM)
+        {
+            if(quote)
+                m_error = QString("Unterminated quoted text starting on line %1.").arg(startLine);
+            else if(depth)
+                m_error = QString("Unterminated comment starting on line %1.").arg(startLine);
+
+            return false;
+        }
+
+        if(ch == '\n')
+        {
+            m_line++;
+        }
+        else if(quote)
+        {
+            // a doubled quote is a literal quote character
+            if(ch == quote && m_reader.Peek() != quote)
+                quote = 0;
+            else if(ch == quote)
+                m_reader.Get();
+        }
+        else if(depth)
+        {
+            if(ch == '[')
+                depth++;
+            else if(ch == ']')
+                depth--;
+        }
+        else if(ch == '\'' || ch == '"')
+        {
+            quote = ch;
+            startLine = m_line;
+        }
+        else if(ch == '[')
+        {
+            depth = 1;
+            startLine = m_line;
+        }
+        else if(ch == punctuation)
+        {
+            return true;
+        }
+    }
+}
+
+bool TreeTokenizer::ReadQuoted(Token& token, int quote)
+{
+    token.type = QUOTED_WORD;
+
+    uint startLine = m_line;
+    for(;;)
+    {
+        int ch = m_reader.Get();
+        if(ch == StreamReader::END_OF_STREAM)
+        {
+            m_error = QString("Unterminated quoted text starting on line %1.").arg(startLine);
+            return false;
+        }
+
+        if(ch == quote)
+        {
+            // a doubled quote is a literal quote character
+            if(m_reader.Peek() != quote)
+                return true;
+
+            m_reader.Get();
+        }
+        else if(ch == '\n')
+            m_line++;
+
+        token.text.append(char(ch));
+    }
+}
+
+bool TreeTokenizer::ReadComment(Token& token)
+{
+    token.type = COMMENT;
+
+    uint startLine = m_line;
+    uint depth = 1;
+    for(;;)
+    {
+        int ch = m_reader.Get();
+        if(ch == StreamReader::END_OF_STREAM)
+        {
+            m_error = QString("Unterminated comment starting on line %1.").arg(startLine);
+            return false;
+        }
+
+        if(ch == '[')
+            depth++;
+        else if(ch == ']' && --depth == 0)
+            return true;
+        else if(ch == '\n')
+            m_line++;
+
+        token.text.append(char(ch));
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef _TREE_TOKENIZER_HPP_
+#define _TREE_TOKENIZER_HPP_
+
+#include "../utils/StreamReader.hpp"
+
+#include <QByteArray>
+#include <QString>
+
+namespace pygmy
+{
+
+/**
+ * @brief Split Newick and NEXUS input into tokens.
+ *
+ * Input is consumed a byte at a time from a stream reader, so a file is
+ * tokenized in a single pass regardless of its size. Whitespace separates
+ * tokens and is otherwise ignored. The following tokens are produced:
+ *
+ * - PUNCTUATION: one of ( ) , : ; =
+ * - WORD: a run of characters not containing whitespace, punctuation, quotes or comments
+ * - QUOTED_WORD: text within single or double quotes (a doubled quote within the text is a literal quote)
+ * - COMMENT: text within square brackets, without the brackets (nested brackets are kept)
+ *
+ * Comments are returned rather than discarded, since they often carry node
+ * annotations (e.g., [&rate=0.5] or [&&NHX:S=human]).
+ *
+ * Text is returned as the raw (UTF-8) bytes of the input.
+ */
+class TreeTokenizer
+{
+public:
+    enum TOKEN_TYPE { END_OF_INPUT, PUNCTUATION, WORD, QUOTED_WORD, COMMENT };
+
+    /** Token read from the input. */
+    struct Token
+    {
+        Token(): type(END_OF_INPUT) {}
+
+        /** Check if token is the given punctuation character. */
+        bool Is(char ch) const { return type == PUNCTUATION && text.at(0) == ch; }
+
+        /** Check if token is a word matching the given keyword (case insensitive). */
+        bool IsKeyword(const char* keyword) const { return type == WORD && qstricmp(text.constData(), keyword) == 0; }
+
+        /** Check if token is a word or quoted word. */
+        bool IsWord() const { return type == WORD || type == QUOTED_WORD; }
+
+        /** Text of token. */
+        QString ToString() const { return QString::fromUtf8(text); }
+
+        /** Type of token. */
+        TOKEN_TYPE type;
+
+        /** Text of token. */
+        QByteArray text;
+    };
+
+public:
+    /**
+     * @brief Constructor.
+     * @param reader Reader to obtain input from.
+     */
+    TreeTokenizer(utils::StreamReader& reader): m_reader(reader), m_line(1), m_tokenPosition(0) {}
+
+    /**
+     * @brief Read the next token.
+     * @param token Set to the next token. The text of the token is reused between calls to avoid allocations.
+     * @return False at the end of the input or if an error occurred.
+     */
+    bool Next(Token& token);
+
+    /**
+     * @brief Skip input up to and including the next occurrence of a punctuation character.
+     *
+     * Quoted text and comments are skipped without the text of any tokens being
+     * stored, which makes this considerably faster than reading tokens.
+     *
+     * @param punctuation Character to skip to (e.g., ';' to skip the rest of a tree).
+     * @return True if the character was found, false at the end of the input or if an error occurred.
+     */
+    bool SkipTo(char punctuation);
+
+    /** Position of the first byte of the most recently read token within the input. */
+    qint64 GetTokenPosition() const { return m_tokenPosition; }
+
+    /** Line of input containing the most recently read token. */
+    uint GetLineNumber() const { return m_line; }
+
+    /** Check if reading the input has failed or the input is malformed. */
+    bool HasError() const { return !m_error.isEmpty() || m_reader.HasError(); }
+
+    /** Get description of the most recent error. */
+    QString GetError() const { return m_error.isEmpty() ? m_reader.GetError() : m_error; }
+
+protected:
+    /** Read text up to a closing quote. */
+    bool ReadQuoted(Token& token, int quote);
+
+    /** Read text up to the matching closing bracket. */
+    bool ReadComment(Token& token);
+
+protected:
+    /** Source of input. */
+    utils::StreamReader& m_reader;
+
+    /** Current line of input. */
+    uint m_line;
+
+    /** Position of the most recently read token. */
+    qint64 m_tokenPosition;
+
+    /** Description of the most recent error. */
+    QString m_error;
+};
+
+}
+
+#endif
@@ -0,0 +1,696 @@
+#include "VectorExporter.hpp"
+#include "NodePhylo.hpp"
+#include "State.hpp"
+#include "VisualTree.hpp"
+
+#include "../glUtils/Font.hpp"
+#include "../utils/BufferedWriter.hpp"
+#include "../utils/Colour.hpp"
+#include "../utils/Point.hpp"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QScopedPointer>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stack>
+
+using namespace pygmy;
+using namespace utils;
+
+namespace
+{
+
+/** Maximum number of segments written to a single path. */
+const uint MAX_PATH_SEGMENTS = 1000;
+
+/**
+ * @brief Interface for writing drawing primitives to a vector format.
+ *
+ * Coordinates are in pixels with the origin at the bottom-left of the page,
+ * as in the OpenGL viewport the tree is normally rendered to.
+ */
+class VectorWriter
+{
+public:
+    VectorWriter(double width, double height): m_width(width), m_height(height) {}
+    virtual ~VectorWriter() {}
+
+    virtual void Begin() = 0;
+    virtual bool End() = 0;
+
+    virtual void BeginLines(float lineWidth) = 0;
+    virtual void Line(double x1, double y1, double x2, double y2, const Colour& colour) = 0;
+    virtual void EndLines() = 0;
+
+    virtual void BeginText(uint size, const Colour& colour) = 0;
+    virtual void Text(const QString& text, double x, double y) = 0;
+    virtual void EndText() = 0;
+
+    virtual void Marker(double x, double y, double radius, const Colour& colour) = 0;
+
+protected:
+    double m_width;
+    double m_height;
+};
+
+/** Write primitives as Scalable Vector Graphics. */
+class SvgWriter: public VectorWriter
+{
+public:
+    SvgWriter(QIODevice* device, double width, double height)
+        : VectorWriter(width, height), m_out(device), m_segments(0) {}
+
+    void Begin()
+    {
+        m_out << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
+        m_out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" width=\"";
+        m_out.Number(m_width);
+        m_out << "\" height=\"";
+        m_out.Number(m_height);
+        m_out << "\" viewBox=\"0 0 ";
+        m_out.Number(m_width);
+        m_out << ' ';
+        m_out.Number(m_height);
+        m_out << "\">\n";
+        m_out << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n";
+    }
+
+    bool End()
+    {
+        m_out << "</svg>\n";
+        return m_out.Finish();
+    }
+
+    void BeginLines(float lineWidth)
+    {
+        m_out << "<g fill=\"none\" stroke-linecap=\"square\" stroke-width=\"";
+        m_out.Number(lineWidth);
+        m_out << "\">\n";
+        m_segments = 0;
+    }
+
+    void Line(double x1, double y1, double x2, double y2, const Colour& colour)
+    {
+        if(m_segments == 0 || m_segments >= MAX_PATH_SEGMENTS || colour != m_colour)
+        {
+            if(m_segments > 0)
+                m_out << "\"/>\n";
+
+            m_out << "<path stroke=\"";
+            WriteColour(colour);
+            m_out << "\" d=\"";
+            m_colour = colour;
+            m_segments = 0;
+        }
+
+        m_out << 'M';
+        m_out.Number(x1);
+        m_out << ' ';
+        m_out.Number(m_height - y1);
+
+        if(y1 == y2)
+        {
+            m_out << 'H';
+            m_out.Number(x2);
+        }
+        else if(x1 == x2)
+        {
+            m_out << 'V';
+            m_out.Number(m_height - y2);
+        }
+        else
+        {
+            m_out << 'L';
+            m_out.Number(x2);
+            m_out << ' ';
+            m_out.Number(m_height - y2);
+        }
+
+        m_segments++;
+    }
+
+    void EndLines()
+    {
+        if(m_segments > 0)
+            m_out << "\"/>\n";
+
+        m_out << "</g>\n";
+        m_segments = 0;
+    }
+
+    void BeginText(uint size, const Colour& colour)
+    {
+        m_out << "<g font-family=\"Arial, Helvetica, sans-serif\" font-size=\"" << size << "\" fill=\"";
+        WriteColour(colour);
+        m_out << "\">\n";
+    }
+
+    void Text(const QString& text, double x, double y)
+    {
+        m_out << "<text x=\"";
+        m_out.Number(x);
+        m_out << "\" y=\"";
+        m_out.Number(m_height - y);
+        m_out << "\">";
+
+        QByteArray utf8 = text.toUtf8();
+        for(int i = 0; i < utf8.size(); ++i)
+        {
+            char c = utf8.at(i);
+            if(c == '<')
+                m_out << "&lt;";
+            else if(c == '>')
+                m_out << "&gt;";
+            else if(c == '&')
+                m_out << "&amp;";
+            else
+                m_out << c;
+        }
+
+        m_out << "</text>\n";
+    }
+
+    void EndText()
+    {
+        m_out << "</g>\n";
+    }
+
+    void Marker(double x, double y, double radius, const Colour& colour)
+    {
+        m_out << "<circle cx=\"";
+        m_out.Number(x);
+        m_out << "\" cy=\"";
+        m_out.Number(m_height - y);
+        m_out << "\" r=\"";
+        m_out.Number(radius);
+        m_out << "\" fill=\"";
+        WriteColour(colour);
+        m_out << "\"/>\n";
+    }
+
+protected:
+    void WriteColour(const Colour& colour)
+    {
+        static const char hex[] = "0123456789abcdef";
+        int rgb[3] = { colour.GetRedInt(), colour.GetGreenInt(), colour.GetBlueInt() };
+
+        m_out << '#';
+        for(int i = 0; i < 3; ++i)
+        {
+            int value = std::max(0, std::min(255, rgb[i]));
+            m_out << hex[value >> 4] << hex[value & 0xf];
+        }
+    }
+
+protected:
+    BufferedWriter m_out;
+    Colour m_colour;
+    uint m_segments;
+};
+
+/**
+ * @brief Write primitives as a single page Portable Document Format file.
+ *
+ * The page content is deflate compressed and text uses the standard
+ * Helvetica font, so no fonts need to be embedded.
+ */
+class PdfWriter: public VectorWriter
+{
+public:
+    PdfWriter(QIODevice* device, double width, double height)
+        : VectorWriter(width, height), m_device(device), m_out(device), m_segments(0), m_contentStart(0)
+    {
+        // pages are limited to 200 inches unless a larger user unit is given
+        m_userUnit = std::max(1.0, ceil(std::max(width, height) / 14400.0));
+    }
+
+    void Begin()
+    {
+        double pageWidth = m_width / m_userUnit;
+        double pageHeight = m_height / m_userUnit;
+
+        m_out << "%PDF-1.6\n%\xe2\xe3\xcf\xd3\n";
+
+        BeginObject(1);
+        m_out << "<< /Type /Catalog /Pages 2 0 R >>\nendobj\n";
+
+        BeginObject(2);
+        m_out << "<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n";
+
+        BeginObject(3);
+        m_out << "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 ";
+        m_out.Number(pageWidth);
+        m_out << ' ';
+        m_out.Number(pageHeight);
+        m_out << "]";
+        if(m_userUnit > 1.0)
+        {
+            m_out << " /UserUnit ";
+            m_out.Number(m_userUnit);
+        }
+        m_out << " /Resources << /Font << /F1 4 0 R >> >> /Contents 5 0 R >>\nendobj\n";
+
+        BeginObject(4);
+        m_out << "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica /Encoding /WinAnsiEncoding >>\nendobj\n";
+
+        BeginObject(5);
+        m_out << "<< /Length 6 0 R /Filter /FlateDecode >>\nstream\n";
+        m_out.Flush();
+        m_contentStart = m_device->pos();
+
+        m_content.reset(new BufferedWriter(m_device, BufferedWriter::ZLIB_COMPRESSION));
+        if(m_userUnit > 1.0)
+        {
+            m_content->Number(1.0 / m_userUnit, 6);
+            *m_content << " 0 0 ";
+            m_content->Number(1.0 / m_userUnit, 6);
+            *m_content << " 0 0 cm\n";
+        }
+    }
+
+    bool End()
+    {
+        bool bOk = m_content->Finish();
+        qint64 length = m_device->pos() - m_contentStart;
+        m_content.reset();
+
+        m_out << "\nendstream\nendobj\n";
+
+        BeginObject(6);
+        m_out << QByteArray::number(length) << "\nendobj\n";
+
+        m_out.Flush();
+        qint64 xref = m_device->pos();
+        m_out << "xref\n0 7\n0000000000 65535 f \n";
+        for(int i = 0; i < 6; ++i)
+        {
+            m_out << QByteArray::number(m_offsets[i]).rightJustified(10, '0') << " 00000 n \n";
+        }
+        m_out << "trailer\n<< /Size 7 /Root 1 0 R >>\nstartxref\n" << QByteArray::number(xref) << "\n%%EOF\n";
+
+        return m_out.Finish() && bOk;
+    }
+
+    void BeginLines(float lineWidth)
+    {
+        *m_content << "2 J\n";
+        m_content->Number(lineWidth);
+        *m_content << " w\n";
+        m_segments = 0;
+    }
+
+    void Line(double x1, double y1, double x2, double y2, const Colour& colour)
+    {
+        if(m_segments == 0 || m_segments >= MAX_PATH_SEGMENTS || colour != m_colour)
+        {
+            if(m_segments > 0)
+                *m_content << "S\n";
+
+            WriteColour(colour);
+            *m_content << " RG\n";
+            m_colour = colour;
+            m_segments = 0;
+        }
+
+        m_content->Number(x1);
+        *m_content << ' ';
+        m_content->Number(y1);
+        *m_content << " m ";
+        m_content->Number(x2);
+        *m_content << ' ';
+        m_content->Number(y2);
+        *m_content << " l\n";
+
+        m_segments++;
+    }
+
+    void EndLines()
+    {
+        if(m_segments > 0)
+            *m_content << "S\n";
+
+        m_segments = 0;
+    }
+
+    void BeginText(uint size, const Colour& colour)
+    {
+        *m_content << "BT\n/F1 " << size << " Tf\n";
+        WriteColour(colour);
+        *m_content << " rg\n";
+    }
+
+    void Text(const QString& text, double x, double y)
+    {
+        *m_content << "1 0 0 1 ";
+        m_content->Number(x);
+        *m_content << ' ';
+        m_content->Number(y);
+        *m_content << " Tm (";
+
+        // WinAnsiEncoding matches Latin-1 for all printable characters except 128-159
+        for(int i = 0; i < text.size(); ++i)
+        {
+            ushort c = text.at(i).unicode();
+            if(c == '(' || c == ')' || c == '\\')
+                *m_content << '\\' << char(c);
+            else if(c < 32 || (c >= 127 && c < 160) || c > 255)
+                *m_content << '?';
+            else
+                *m_content << char(c);
+        }
+
+        *m_content << ") Tj\n";
+    }
+
+    void EndText()
+    {
+        *m_content << "ET\n";
+    }
+
+    void Marker(double x, double y, double radius, const Colour& colour)
+    {
+        // approximate circle with four Bezier curves
+        const double k = 0.5523 * radius;
+
+        WriteColour(colour);
+        *m_content << " rg\n";
+
+        double points[] = { x + radius, y,
+                            x + radius, y + k,  x + k, y + radius,  x, y + radius,
+                            x - k, y + radius,  x - radius, y + k,  x - radius, y,
+                            x - radius, y - k,  x - k, y - radius,  x, y - radius,
+                            x + k, y - radius,  x + radius, y - k,  x + radius, y };
+
+        m_content->Number(points[0]);
+        *m_content << ' ';
+        m_content->Number(points[1]);
+        *m_content << " m\n";
+        for(int curve = 0; curve < 4; ++curve)
+        {
+            for(int i = 0; i < 3; ++i)
+            {
+                m_content->Number(points[2 + 6*curve + 2*i]);
+                *m_content << ' ';
+                m_content->Number(points[3 + 6*curve + 2*i]);
+                *m_content << ' ';
+            }
+            *m_content << "c\n";
+        }
+        *m_content << "f\n";
+    }
+
+protected:
+    void BeginObject(int id)
+    {
+        m_out.Flush();
+        m_offsets[id-1] = m_device->pos();
+        m_out << QByteArray::number(id) << " 0 obj\n";
+    }
+
+    void WriteColour(const Colour& colour)
+    {
+        m_content->Number(colour.GetRed(), 3);
+        *m_content << ' ';
+        m_content->Number(colour.GetGreen(), 3);
+        *m_content << ' ';
+        m_content->Number(colour.GetBlue(), 3);
+    }
+
+protected:
+    QIODevice* m_device;
+    BufferedWriter m_out;
+    QScopedPointer<BufferedWriter> m_content;
+    Colour m_colour;
+    uint m_segments;
+    double m_userUnit;
+    qint64 m_contentStart;
+    qint64 m_offsets[6];
+};
+
+/** Mapping from the normalized layout of a clade to page coordinates. */
+struct PageTransform
+{
+    double x(const Point& pos) const { return dx + (pos.x - minX)*sx; }
+    double y(const Point& pos) const { return dy + (pos.y - minY)*sy; }
+
+    double dx, dy, sx, sy;
+    double minX, minY;
+};
+
+}
+
+VectorExporter::FORMAT VectorExporter::FormatFromFilename(const QString& filename)
+{
+    QString suffix = QFileInfo(filename).suffix().toLower();
+    if(suffix == "svg")
+        return SVG;
+    else if(suffix == "pdf")
+        return PDF;
+
+    return UNKNOWN_FORMAT;
+}
+
+bool VectorExporter::Export(const QString& filename, uint width, float zoom, NodePhylo* subtree)
+{
+    m_error.clear();
+
+    FORMAT format = FormatFromFilename(filename);
+    if(format == UNKNOWN_FORMAT)
+    {
+        m_error = "Unknown vector format. Files must be saved as SVG (.svg) or PDF (.pdf).";
+        return false;
+    }
+
+    if(width == 0 || zoom <= 0.0f)
+    {
+        m_error = "Page width and zoom must be greater than zero.";
+        return false;
+    }
+
+    if(m_visualTree->GetLayoutStyle() != VisualTree::RECTANGULAR_LAYOUT)
+    {
+        m_error = "Circular and radial trees can only be exported as PNG or TIFF images.";
+        return false;
+    }
+
+    NodePhylo* root = subtree ? subtree : m_visualTree->GetTree()->GetRootNode();
+    State& state = State::Inst();
+    Point border = state.GetBorderSize();
+    float lineWidth = state.GetLineWidth();
+
+    // children of folded clades are not drawn (see FoldedClades)
+    const FoldedClades& foldedClades = m_visualTree->GetFoldedClades();
+
+    // find extent of clade so it can be scaled to the page
+    double maxX = root->GetPosition().x;
+    std::stack<NodePhylo*> stack;
+    stack.push(root);
+    while(!stack.empty())
+    {
+        NodePhylo* node = stack.top();
+        stack.pop();
+
+        maxX = std::max(maxX, double(node->GetPosition().x));
+        if(foldedClades.IsFolded(node))
+        {
+            maxX = std::max(maxX, double(foldedClades.GetFoldedExtent(node)));
+            continue;
+        }
+
+        for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
+            stack.push(node->GetChild(i));
+    }
+
+    // the spacing between leaves is the same as when the entire tree is rendered
+    m_visualTree->CalculateTreeDimensions(width, 1, zoom);
+    uint treeRows = m_visualTree->GetNumberOfRows();
+    double treeHeight = m_visualTree->GetTreeHeight() * zoom;
+
+    Interval interval = m_visualTree->GetNodeInterval(root);
+    uint rows = uint((interval.end - interval.start) * treeRows + 1.5f);
+
+    PageTransform transform;
+    transform.minX = root->GetPosition().x;
+    transform.minY = interval.start;
+    transform.sx = maxX > transform.minX ? m_visualTree->GetTreeWidth() / (maxX - transform.minX) : 0.0;
+    transform.sy = treeHeight;
+    transform.dx = border.x;
+    transform.dy = border.y;
+
+    double height = ceil(rows * treeHeight / treeRows + 2*border.y);
+
+    QFile file(filename);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        m_error = "Failed to open file: " + file.errorString();
+        return false;
+    }
+
+    QScopedPointer<VectorWriter> writer;
+    if(format == SVG)
+        writer.reset(new SvgWriter(&file, width, height));
+    else
+        writer.reset(new PdfWriter(&file, width, height));
+
+    writer->Begin();
+
+    // *** Branches ***
+    // Each internal node has a single vertical line spanning its children. Horizontal lines
+    // through chains of nodes with a single child are collinear and written as one segment.
+    writer->BeginLines(lineWidth);
+    stack.push(root);
+    while(!stack.empty())
+    {
+        NodePhylo* node = stack.top();
+        stack.pop();
+
+        if(node->IsLeaf())
+            continue;
+
+        Point pos = m_visualTree->GetNodePosition(node);
+        double x = transform.x(pos);
+
+        if(foldedClades.IsFolded(node))
+        {
+            // outline of the triangle spanning the rows of the clade
+            Interval folded = m_visualTree->GetNodeInterval(node);
+            double extentX = transform.x(Point(foldedClades.GetFoldedExtent(node), 0.0f));
+            double startY = transform.y(Point(0.0f, folded.start));
+            double endY = transform.y(Point(0.0f, folded.end));
+
+            writer->Line(x, transform.y(pos), extentX, startY, node->GetColour());
+            writer->Line(extentX, startY, extentX, endY, node->GetColour());
+            writer->Line(extentX, endY, x, transform.y(pos), node->GetColour());
+            continue;
+        }
+
+        double minY = DBL_MAX, maxY = -DBL_MAX;
+        for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
+        {
+            NodePhylo* child = node->GetChild(i);
+            double childY = transform.y(m_visualTree->GetNodePosition(child));
+            minY = std::min(minY, childY);
+            maxY = std::max(maxY, childY);
+
+            NodePhylo* end = child;
+            while(end->GetNumberOfChildren() == 1 && !foldedClades.IsFolded(end) && end->GetChild(0)->GetColour() == child->GetColour())
+                end = end->GetChild(0);
+
+            writer->Line(x, childY, transform.x(end->GetPosition()), childY, child->GetColour());
+
+            stack.push(end);
+        }
+
+        if(maxY > minY)
+            writer->Line(x, minY, x, maxY, node->GetColour());
+    }
+    writer->EndLines();
+
+    // *** Markers of selected nodes ***
+    double radius = 0.5*(lineWidth + 10);
+    stack.push(root);
+    while(!stack.empty())
+    {
+        NodePhylo* node = stack.top();
+        stack.pop();
+
+        if(node->IsSelected())
+        {
+            Point pos = m_visualTree->GetNodePosition(node);
+            writer->Marker(transform.x(pos), transform.y(pos), radius, node->GetColour());
+        }
+
+        if(foldedClades.IsFolded(node))
+            continue;
+
+        for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
+            stack.push(node->GetChild(i));
+    }
+
+    glUtils::FontPtr font = state.GetFont();
+
+    // *** Leaf labels ***
+    if(state.GetShowLeafLabels() || state.GetShowMetadataLabels())
+    {
+        font->SetSize(state.GetTreeFontSize());
+        float offsetY = 0.2f * (font->GetSize() - font->GetDescender());
+
+        const LabelCache& labels = m_visualTree->GetLabelCache();
+        writer->BeginText(state.GetTreeFontSize(), state.GetTreeFontColour());
+        stack.push(root);
+        while(!stack.empty())
+        {
+            NodePhylo* node = stack.top();
+            stack.pop();
+
+            Point pos = m_visualTree->GetNodePosition(node);
+            if(node->IsLeaf())
+            {
+                writer->Text(labels.GetLabel(node), transform.x(pos) + state.GetLabelOffset(), transform.y(pos) - offsetY);
+            }
+            else if(foldedClades.IsFolded(node))
+            {
+                // folded clades are labelled beyond the end of their triangle
+                pos.x = foldedClades.GetFoldedExtent(node);
+                writer->Text(foldedClades.GetFoldedLabel(node), transform.x(pos) + state.GetLabelOffset(), transform.y(pos) - offsetY);
+                continue;
+            }
+
+            for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
+                stack.push(node->GetChild(i));
+        }
+        writer->EndText();
+    }
+
+    // *** Internal labels ***
+    if(state.GetShowInternalLabels())
+    {
+        font->SetSize(state.GetInternalNodeFontSize());
+        float offsetY = 0.2f * (font->GetSize() - font->GetDescender());
+        bool bRight = state.GetInternalLabelPos() == "Right";
+        bool bLeafLabels = state.GetInternalNodeField() == "Distance";
+
+        writer->BeginText(state.GetInternalNodeFontSize(), state.GetInternalNodeFontColour());
+        stack.push(root);
+        while(!stack.empty())
+        {
+            NodePhylo* node = stack.top();
+            stack.pop();
+
+            if(!foldedClades.IsFolded(node))
+            {
+                for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
+                    stack.push(node->GetChild(i));
+            }
+
+            if(node->IsLeaf() && !bLeafLabels)
+                continue;
+
+            QString label = m_visualTree->InternalLabel(node);
+            Point pos = m_visualTree->GetNodePosition(node);
+            if(bRight)
+            {
+                writer->Text(label, transform.x(pos) + lineWidth + 1.5, transform.y(pos) - offsetY);
+            }
+            else
+            {
+                BBox bb = font->GetBoundingBox(label);
+                writer->Text(label, transform.x(pos) - bb.Width() - lineWidth + 0.5,
+                             transform.y(pos) - offsetY + bb.Height()*0.5 + lineWidth + 0.5);
+            }
+        }
+        writer->EndText();
+    }
+
+    if(!writer->End())
+    {
+        m_error = "Failed to write file: " + file.errorString();
+        file.remove();
+        return false;
+    }
+
+    return true;
+}
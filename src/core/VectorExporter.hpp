@@ -0,0 +1,75 @@
+#ifndef _VECTOR_EXPORTER_HPP_
+#define _VECTOR_EXPORTER_HPP_
+
+#include "../core/DataTypes.hpp"
+
+#include <QString>
+
+namespace pygmy
+{
+
+class NodePhylo;
+
+/**
+ * @brief Write a tree, or a single clade of it, to a vector graphics file.
+ *
+ * The layout of the visual tree is walked directly and branches, node markers
+ * and labels are streamed to the file through a buffered writer, so no copy of
+ * the tree or list of drawing primitives is built in memory. Horizontal branches
+ * through chains of single child nodes are merged into a single segment and
+ * segments of the same colour are grouped into a single path, which keeps files
+ * of trees with 100,000 leaves small enough to be opened by common viewers.
+ *
+ * Exporting a clade only visits the nodes within the clade. The clade is scaled
+ * to the full width of the page and the page height is set by the number of
+ * leaves in the clade.
+ *
+ * Labels are measured with the tree font, so the OpenGL context used to render
+ * the tree should be current when Export() is called.
+ *
+ * Code example:
+ * @code
+ * VectorExporter exporter(visualTree);
+ * if(!exporter.Export("clade.svg", 1000, 1.0f, visualTree->GetActiveNode()->node))
+ *     qCritical() << exporter.GetError();
+ * @endcode
+ */
+class VectorExporter
+{
+public:
+    enum FORMAT { SVG, PDF, UNKNOWN_FORMAT };
+
+public:
+    /**
+     * @brief Constructor.
+     * @param visualTree Tree to export. Layout() and LabelBoundingBoxes() must have been called.
+     */
+    VectorExporter(VisualTreePtr visualTree): m_visualTree(visualTree) {}
+
+    /** Determine vector format from the extension of a filename. */
+    static FORMAT FormatFromFilename(const QString& filename);
+
+    /**
+     * @brief Write tree to a vector graphics file.
+     * @param filename Output file. Format is determined by the extension (.svg, .pdf).
+     * @param width Width of page in pixels (1 pixel = 1 point in PDF files).
+     * @param zoom Zoom level of tree (1 = leaf labels just touch each other).
+     * @param subtree Root of clade to export. The entire tree is exported if NULL.
+     * @return True if file was written successfully, else false.
+     */
+    bool Export(const QString& filename, uint width, float zoom, NodePhylo* subtree = NULL);
+
+    /** Get description of the most recent error. */
+    QString GetError() const { return m_error; }
+
+protected:
+    /** Tree to export. */
+    VisualTreePtr m_visualTree;
+
+    /** Description of the most recent error. */
+    QString m_error;
+};
+
+}
+
+#endif
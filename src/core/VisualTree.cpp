@@ -12,7 +12,9 @@
 #include "VisualColourMap.hpp"
 #include "NodePhylo.hpp"
 #include "State.hpp"
+#include "MemoryReport.hpp"
 #include "MetadataInfo.hpp"
+#include "SplitHash.hpp"
 
 #include "../glUtils/ErrorGL.hpp"
 #include "../glUtils/Font.hpp"
@@ -28,17 +30,46 @@
 #include "../utils/ParsimonyCalculator.hpp"
 
 #include <QtDebug>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QOpenGLContext>
 
+#include <algorithm>
+#include <climits>
+
 using namespace pygmy;
 using namespace utils;
 
+const qint64 VisualTree::FRAME_BUDGET_NS = 8000000;
+const uint VisualTree::MIN_NODE_BUDGET = 1024;
+const uint VisualTree::REFINEMENT_FACTOR = 4;
+const uint VisualTree::MAX_EDITS = 100;
+
 VisualTree::VisualTree(utils::Tree<NodePhylo>::Ptr tree)
     : m_originalTree(tree),
+      m_numAppliedEdits(0),
+      m_renderTranslation(0),
+      m_renderZoom(1),
+      m_labelBaseline(0),
+      m_hoverNode(NULL),
       m_activeNode(VisualNode(VisualMarker(), NULL)),
       m_branchStyle(CLADOGRAM_BRANCHES),
+      m_layoutStyle(RECTANGULAR_LAYOUT),
+      m_bPolarLayoutChanged(true),
+      m_horizontalOffset(0),
       m_colourMapSpacing(10),
-      m_subtreeSortStyle(UNSORTED)
+      m_subtreeSortStyle(UNSORTED),
+      m_subtreeSortKey(SubtreeSorter::SORT_BY_HEIGHT),
+      m_nodeBudget(UINT_MAX),
+      m_progressiveBudget(MIN_NODE_BUDGET),
+      m_nodeCostNs(1000),
+      m_bRefining(false),
+      m_bLayoutChanged(true),
+      m_progressiveWidth(0),
+      m_progressiveHeight(0),
+      m_progressiveTranslation(0),
+      m_progressiveZoom(0),
+      m_progressiveRows(0)
 {	
 	m_tree = m_originalTree->Clone();
 
@@ -63,16 +94,48 @@ void VisualTree::LayoutBranchStyle()
 			curNode->SetXPos(curNode->GetDistanceToRoot() / m_tree->GetLengthOfTree());
 		else if(m_branchStyle == EQUAL_BRANCHES)
 			curNode->SetXPos(float(curNode->GetDepth()) / m_tree->GetRootNode()->GetHeight());
-		else if(m_branchStyle == CLADOGRAM_BRANCHES)
+		else if(m_branchStyle == CLADOGRAM_BRANCHES || m_branchStyle == SLANTED_CLADOGRAM)
 			curNode->SetXPos(1.0f - float(curNode->GetHeight()) / m_tree->GetRootNode()->GetHeight());
 
 		for(uint i = 0; i < curNode->GetNumberOfChildren(); ++i)
 			queue.push(curNode->GetChild(i));		
 	}
+
+	m_bLayoutChanged = true;
+	m_bPolarLayoutChanged = true;
+}
+
+void VisualTree::LayoutExtents()
+{
+	// flatten tree into pre-order so extents can be propagated from the leaves in a single reverse pass
+	std::vector<NodePhylo*> nodes;
+	nodes.reserve(m_tree->GetNumberOfNodes());
+	std::vector<NodePhylo*> stack(1, m_tree->GetRootNode());
+	while(!stack.empty())
+	{
+		NodePhylo* node = stack.back();
+		stack.pop_back();
+
+		node->SetExtent(node->GetPosition().x);
+		nodes.push_back(node);
+		for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
+			stack.push_back(node->GetChild(i));
+	}
+
+	for(uint i = uint(nodes.size()); i > 1; --i)
+	{
+		NodePhylo* parent = nodes[i-1]->GetParent();
+		if(parent->GetExtent() < nodes[i-1]->GetExtent())
+			parent->SetExtent(nodes[i-1]->GetExtent());
+	}
 }
 
 void VisualTree::LayoutY()
 {
+	// children are only reordered if the tree or the sort order changed since they were last sorted
+	if(GetSubtreeSortStyle() != UNSORTED)
+		m_subtreeSorter.Sort(m_tree, m_subtreeSortKey, m_subtreeSortField, GetSubtreeSortStyle() == ASCENDING);
+
 	// set y-position of nodes via a post-order traversal
 	uint yLeafPosition = 0;
 	LayoutY(m_tree->GetRootNode(), yLeafPosition);
@@ -95,6 +158,8 @@ void VisualTree::LayoutY()
 		for(uint i = 0; i < curNode->GetNumberOfChildren(); ++i)
 			queue.push(curNode->GetChild(i));		
 	}
+
+	m_bPolarLayoutChanged = true;
 }
 
 void VisualTree::LayoutY(NodePhylo* node, uint& yLeafPosition)
@@ -107,14 +172,6 @@ void VisualTree::LayoutY(NodePhylo* node, uint& yLeafPosition)
 		float startInterval = FLT_MAX;
 		float endInterval = 0.0f;
 
-        if(GetSubtreeSortStyle() != UNSORTED)
-        {
-            if(GetSubtreeSortStyle() == ASCENDING)
-                node->sortChildren(true);
-            else
-                node->sortChildren();
-        }
-
 		for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
 		{
 			if(node->GetChild(i)->IsLeaf())
@@ -149,13 +206,25 @@ void VisualTree::LayoutY(NodePhylo* node, uint& yLeafPosition)
 
 void VisualTree::CalculateTreeDimensions(uint width, uint height, float zoom)
 {
-	// calculate tree height such that labels are as close together as possible without overlapping
 	Point border = State::Inst().GetBorderSize();
-	m_treeHeight = m_tree->GetNumberOfLeaves()*m_highestLabel;
+	if(m_polarLayout)
+	{
+		// the disc spans the width of the viewport at a zoom of 1
+		m_treeWidth = width - 2*border.x;
+		if(m_visualColourMap)
+			m_treeWidth -= (m_visualColourMap->GetWidth() + m_colourMapSpacing);
+
+		m_treeHeight = std::max(m_treeWidth, 1.0f);
+		m_viewportHeightFrac = std::min(height / (m_treeHeight * zoom), 1.0f);
+		return;
+	}
+
+	// calculate tree height such that labels are as close together as possible without overlapping
+	m_treeHeight = GetNumberOfRows()*m_highestLabel;
 
 	// if there are no labels, than ensure branches do not overlap
 	if(!State::Inst().GetShowLeafLabels() && !State::Inst().GetShowMetadataLabels())
-		m_treeHeight = m_tree->GetNumberOfLeaves();
+		m_treeHeight = GetNumberOfRows();
 
 	// set width of tree so colour map and labels have enough room
 	m_treeWidth = width - m_widestLabel - 2*border.x;
@@ -170,24 +239,214 @@ void VisualTree::CalculateTreeDimensions(uint width, uint height, float zoom)
 void VisualTree::Render(int width, int height, float translation, float zoom)
 {
 	glUtils::ErrorGL::Check();
+
+	// time each stage of rendering so the cause of slow frames can be identified
+	QElapsedTimer timer;
+	timer.start();
+	m_renderStats = RenderStats();
+
 	CalculateTreeDimensions(width, height, zoom);
+
+	// elements are only indexed once they are needed for hit testing
+	m_renderTranslation = translation;
+	m_renderZoom = zoom;
+	m_hitTestIndex.Clear(height);
+
+	// branches and labels of circular and radial trees are drawn in a single pass
+	if(m_polarLayout)
+	{
+		RenderPolar(width, height, translation, zoom);
+		m_renderStats.treeNs = timer.nsecsElapsed();
+		m_renderStats.renderNs = m_renderStats.treeNs;
+
+		RenderHoverNode(translation, zoom);
+
+		glUtils::ErrorGL::Check();
+		return;
+	}
+
 	// *** Render tree. ***
 	RenderTree(translation, zoom);
+	qint64 elapsed = timer.nsecsElapsed();
+	m_renderStats.treeNs = elapsed;
 
 	// *** Render any label selection heighlights. ***
     RenderTextSearch(translation, zoom);
+	m_renderStats.textSearchNs = timer.nsecsElapsed() - elapsed;
+	elapsed += m_renderStats.textSearchNs;
 	
 	// *** Render leaf node labels ***
 	RenderLeafNodeLabels(translation, zoom);
+	m_renderStats.leafLabelsNs = timer.nsecsElapsed() - elapsed;
+	elapsed += m_renderStats.leafLabelsNs;
 
 	//** Render internal node labels ***
 	RenderInternalLabels(translation, zoom);
+	m_renderStats.internalLabelsNs = timer.nsecsElapsed() - elapsed;
+
+	m_renderStats.renderNs = timer.nsecsElapsed();
+	m_renderStats.visibleBranches = m_visibleBranches.size();
+	m_renderStats.visibleNodes = m_visibleNodes.size();
+	if(State::Inst().GetShowLeafLabels() || State::Inst().GetShowMetadataLabels())
+		m_renderStats.leafLabels = m_visibleLeafNodes.size();
 
 	// *** Render the active node. ***
     // This renders slightly weird as it's
     // y-pos is always slightly below the position
     // that it should be
     //RenderActiveNode(translation, zoom);
+	RenderHoverNode(translation, zoom);
+
+	glUtils::ErrorGL::Check();
+}
+
+void VisualTree::RenderProgressive(int width, int height, float translation, float zoom)
+{
+	// trees read from a snapshot keep their layout, so extents are set when first needed
+	bool bLayoutChanged = m_bLayoutChanged;
+	if(m_bLayoutChanged)
+	{
+		LayoutExtents();
+		m_bLayoutChanged = false;
+	}
+
+	// start again from a coarse frame whenever the view changes, e.g. as the user scrolls
+	uint rows = GetNumberOfRows();
+	bool bViewChanged = bLayoutChanged || width != m_progressiveWidth || height != m_progressiveHeight
+		|| translation != m_progressiveTranslation || zoom != m_progressiveZoom || rows != m_progressiveRows;
+
+	if(bViewChanged)
+		m_progressiveBudget = std::max(MIN_NODE_BUDGET, uint(std::min(FRAME_BUDGET_NS / m_nodeCostNs, double(UINT_MAX / REFINEMENT_FACTOR))));
+	else if(m_bRefining && m_progressiveBudget <= UINT_MAX / REFINEMENT_FACTOR)
+		m_progressiveBudget *= REFINEMENT_FACTOR;
+	else if(m_bRefining)
+		m_progressiveBudget = UINT_MAX;
+
+	m_progressiveWidth = width;
+	m_progressiveHeight = height;
+	m_progressiveTranslation = translation;
+	m_progressiveZoom = zoom;
+	m_progressiveRows = rows;
+
+	m_nodeBudget = m_progressiveBudget;
+	Render(width, height, translation, zoom);
+	m_nodeBudget = UINT_MAX;
+
+	m_bRefining = m_renderStats.deferredNodes > 0;
+
+	// the cost of a node is only measured over enough nodes to be meaningful
+	if(m_renderStats.traversedNodes >= MIN_NODE_BUDGET)
+		m_nodeCostNs = 0.5*m_nodeCostNs + 0.5*double(m_renderStats.treeNs) / m_renderStats.traversedNodes;
+}
+
+void VisualTree::SetLayoutStyle(LAYOUT_STYLE layoutStyle)
+{
+	m_layoutStyle = layoutStyle;
+	m_horizontalOffset = 0;
+
+	if(layoutStyle == CIRCULAR_LAYOUT)
+		m_polarLayout = PolarLayoutPtr(new CircularLayout());
+	else if(layoutStyle == RADIAL_LAYOUT)
+		m_polarLayout = PolarLayoutPtr(new RadialLayout());
+	else
+		m_polarLayout.clear();
+
+	// elements drawn with the previous layout can no longer be picked
+	m_bPolarLayoutChanged = true;
+	m_hitTestIndex.Clear(0);
+	m_hoverNode = NULL;
+}
+
+void VisualTree::UpdatePolarLayout()
+{
+	if(m_polarLayout && m_bPolarLayoutChanged)
+	{
+		m_polarLayout->Layout(m_tree, m_foldedClades);
+		m_bPolarLayoutChanged = false;
+	}
+}
+
+float VisualTree::PolarRadius() const
+{
+	// labels are given room around the disc, but never more than half of its radius
+	float labelSpace = 0.5f*(State::Inst().GetLineWidth() + 10);
+	if(State::Inst().GetShowLeafLabels() || State::Inst().GetShowMetadataLabels())
+		labelSpace = std::max(labelSpace, State::Inst().GetLabelOffset() + m_widestLabel);
+
+	return std::max(0.0f, 0.5f*m_treeWidth - std::min(labelSpace, 0.25f*m_treeWidth));
+}
+
+float VisualTree::GetPolarLabelZoom() const
+{
+	float radius = PolarRadius();
+	if(radius <= 0)
+		return 1.0f;
+
+	// leaves of a cladogram are one row apart on the circumference of the disc
+	return std::max(1.0f, GetNumberOfRows()*m_highestLabel / (PI2*radius));
+}
+
+float VisualTree::GetNodeHeightFraction(const NodePhylo* node)
+{
+	if(!m_polarLayout)
+		return GetNodePosition(node).y;
+
+	UpdatePolarLayout();
+
+	Point pos;
+	if(m_treeHeight <= 0 || !m_polarLayout->GetPosition(node, pos))
+		return 0.5f;
+
+	return 0.5f + pos.y*PolarRadius()/m_treeHeight;
+}
+
+float VisualTree::GetNodeHorizontalOffset(const NodePhylo* node, float zoom)
+{
+	if(!m_polarLayout)
+		return 0.0f;
+
+	UpdatePolarLayout();
+
+	Point pos;
+	if(!m_polarLayout->GetPosition(node, pos))
+		return 0.0f;
+
+	return -pos.x*PolarRadius()*zoom;
+}
+
+void VisualTree::RenderPolar(int width, int height, float translation, float zoom)
+{
+	glUtils::ErrorGL::Check();
+
+	UpdatePolarLayout();
+
+	// the disc can only be moved sideways once it is wider than the space for the tree
+	float maxOffset = std::max(0.0f, 0.5f*(m_treeHeight*zoom - m_treeWidth));
+	m_horizontalOffset = std::min(std::max(m_horizontalOffset, -maxOffset), maxOffset);
+
+	Point border = State::Inst().GetBorderSize();
+	bool bLabels = State::Inst().GetShowLeafLabels() || State::Inst().GetShowMetadataLabels();
+	if(bLabels)
+	{
+		State::Inst().GetFont()->SetSize(State::Inst().GetTreeFontSize());
+
+		float fontHeight = (float)State::Inst().GetFont()->GetSize();
+		float descender = (float)State::Inst().GetFont()->GetDescender();
+		m_labelBaseline = 0.2f * (fontHeight-descender);
+	}
+
+	m_polarView.centre = Point(border.x + 0.5f*m_treeWidth + m_horizontalOffset, border.y + 0.5f*m_treeHeight*zoom - translation);
+	m_polarView.radius = PolarRadius()*zoom;
+	m_polarView.viewport = BBox(0, 0, width, height);
+	m_polarView.labelOffset = State::Inst().GetLabelOffset();
+	m_polarView.labelBaseline = m_labelBaseline;
+	m_polarView.labelHeight = m_highestLabel;
+	m_polarView.markerSize = State::Inst().GetLineWidth()+10;
+	m_polarView.bLabels = bLabels;
+	m_polarView.margin = m_polarView.markerSize + (bLabels ? m_polarView.labelOffset + m_widestLabel : 0);
+
+	m_labelCache.Update(m_tree);
+	m_polarLayout->Render(m_polarView, m_bboxMap, m_labelCache, m_renderStats);
 
 	glUtils::ErrorGL::Check();
 }
@@ -223,8 +482,13 @@ void VisualTree::RenderTree(float translation, float zoom)
 		// Keep track of all visible elements
 		m_visibleBranches.clear();
 		m_visibleLeafNodes.clear();
+		m_visibleFoldedNodes.clear();
+		m_visibleFoldedLabels.clear();
 		m_visibleNodes.clear();
 
+		// folded clades are drawn as a triangle spanning their rows, padded so a single row is still visible
+		float halfRow = 0.4f / GetNumberOfRows();
+
 		// Render tree in breadth-first search order. A branch and bound algorithm is used
 		// to render only those elements (nodes and edges) contained within the current viewport.
 		// Specifically, if the y interval extents covered by the children of a given node are
@@ -236,26 +500,71 @@ void VisualTree::RenderTree(float translation, float zoom)
 		while(!queue.empty())
 		{
 			NodePhylo* curNode = queue.front();
-			Point curNodePos = curNode->GetPosition();
+			Point curNodePos = GetNodePosition(curNode);
+			bool bFolded = m_foldedClades.IsFolded(curNode);
 
 			int curNodeX = int(curNodePos.x*sx + dx + 0.5);
 			int curNodeY = int(curNodePos.y*sy + dy + 0.5);
 
+			// Once the node budget of a progressive frame is reached, the remaining clades are outlined
+			// by a triangle reaching their furthest leaf. The branches leading to them have already been
+			// drawn and, as the tree is traversed breadth-first, only the deepest clades are outlined.
+			if(m_renderStats.traversedNodes >= m_nodeBudget)
+			{
+				if(!curNode->IsLeaf())
+				{
+					Interval interval = GetNodeInterval(curNode);
+					int extentX = int(curNode->GetExtent()*sx + dx + 0.5);
+
+					curNode->GetColour().SetColourGL();
+					glBegin(GL_TRIANGLES);
+						glVertex2i(curNodeX, curNodeY);
+						glVertex2i(extentX, int((interval.start - halfRow)*sy + dy + 0.5));
+						glVertex2i(extentX, int((interval.end + halfRow)*sy + dy + 0.5));
+					glEnd();
+
+				}
+
+				m_renderStats.deferredNodes++;
+				queue.pop();
+				continue;
+			}
+
+			m_renderStats.traversedNodes++;
+
 			VisualMarker visualMarker(curNode->GetColour(), pointSize, VisualMarker::CIRCLE, VisualMarker::FILL, Point(curNodeX, curNodeY));
 			visualMarker.SetVisibility(curNode->IsSelected());
 			visualMarker.SetSelected(curNode->IsSelected());
 
+			if(bFolded)
+			{
+				Interval interval = GetNodeInterval(curNode);
+				int extentX = int(m_foldedClades.GetFoldedExtent(curNode)*sx + dx + 0.5);
+
+				curNode->GetColour().SetColourGL();
+				glBegin(GL_TRIANGLES);
+					glVertex2i(curNodeX, curNodeY);
+					glVertex2i(extentX, int((interval.start - halfRow)*sy + dy + 0.5));
+					glVertex2i(extentX, int((interval.end + halfRow)*sy + dy + 0.5));
+				glEnd();
+			}
+
+			// the children of folded clades are not drawn
 			float yMin = 1000.0f, yMax = 0.0f;
-			std::vector<NodePhylo*> children = curNode->GetChildren();
+			std::vector<NodePhylo*> children;
+			if(!bFolded)
+				children = curNode->GetChildren();
+
             for(NodePhylo* child : children)
 			{	
-				Point childPos = child->GetPosition();
+				Point childPos = GetNodePosition(child);
 
 				int childNodeX = int(childPos.x*sx + dx + 0.5);
 				int childNodeY = int(childPos.y*sy + dy + 0.5);
 
 				// check if child node need to be rendered
-				if(child->GetInterval().start <= viewportMax && child->GetInterval().end >= viewportMin)
+				Interval childInterval = GetNodeInterval(child);
+				if(childInterval.start <= viewportMax && childInterval.end >= viewportMin)
 					queue.push(child);
 
 				// Draw branches from parent to child node	
@@ -286,7 +595,7 @@ void VisualTree::RenderTree(float translation, float zoom)
 
 			// Draw vertical line adjusting for the width of the line being drawn. For some reason, the offset
 			// needed to account for the line width is different for the start and end of the line (???).
-			if(!curNode->IsLeaf())
+			if(!curNode->IsLeaf() && !bFolded)
 			{
 				Rect top;
 				top.ll = Point(int(curNodeX + thicknessMajor), int(curNodeY - thicknessMinor));
@@ -321,9 +630,11 @@ void VisualTree::RenderTree(float translation, float zoom)
 				// Track all visible nodes
 				m_visibleNodes.push_back(VisualNode(visualMarker, curNode));
 
-				// Track visible leaf nodes
+				// Track visible leaf nodes and folded clades, which are labelled in the same way
 				if(curNode->IsLeaf())
 					m_visibleLeafNodes.push_back(curNode);
+				else if(bFolded)
+					m_visibleFoldedNodes.push_back(curNode);
 			}
 
 			// Remove current parent node
@@ -339,6 +650,10 @@ void VisualTree::RenderTree(float translation, float zoom)
 
 void VisualTree::RenderTextSearch(float translation, float zoom)
 {
+	// no search filter is set when rendering without a user interface (e.g., image export)
+	if(!m_searchFilter)
+		return;
+
 	glUtils::ErrorGL::Check();
 
 	// Get size of border (in pixels)
@@ -354,7 +669,7 @@ void VisualTree::RenderTextSearch(float translation, float zoom)
 
         for(NodePhylo* leaf: m_visibleLeafNodes)
 		{
-			Point childPos = leaf->GetPosition();
+			Point childPos = GetNodePosition(leaf);
 
 			// calculate position of label
 			BBox bbox = m_bboxMap[leaf->GetId()];
@@ -401,17 +716,36 @@ void VisualTree::RenderLeafNodeLabels(float translation, float zoom)
 
 		float height = (float)State::Inst().GetFont()->GetSize();
 		float descender = (float)State::Inst().GetFont()->GetDescender();
+		m_labelBaseline = 0.2f * (height-descender);
 
+		m_labelCache.Update(m_tree);
         for(NodePhylo* leaf : m_visibleLeafNodes)
 		{
 			// adjust position of nodes based on desired orientation
-			Point childPos = leaf->GetPosition();
+			Point childPos = GetNodePosition(leaf);
 
 			int fontY = int(border.y + childPos.y * m_treeHeight * zoom - 0.2f * (height-descender) + 0.5);	
 			int fontX = int(border.x + childPos.x * m_treeWidth + State::Inst().GetLabelOffset() + 0.5);
 
             // render label
-            State::Inst().GetFont()->Render(leaf->GetLabel(), fontX, int(fontY - translation + 0.5));
+            State::Inst().GetFont()->Render(m_labelCache.GetText(m_labelCache.GetLabelId(leaf)), fontX, int(fontY - translation + 0.5));
+		}
+
+		// folded clades are labelled beyond the end of their triangle
+		for(NodePhylo* node : m_visibleFoldedNodes)
+		{
+			Point pos = GetNodePosition(node);
+
+			int fontY = int(border.y + pos.y * m_treeHeight * zoom - 0.2f * (height-descender) + 0.5);
+			int fontX = int(border.x + m_foldedClades.GetFoldedExtent(node) * m_treeWidth + State::Inst().GetLabelOffset() + 0.5);
+
+			QString label = m_foldedClades.GetFoldedLabel(node);
+			State::Inst().GetFont()->Render(label, fontX, int(fontY - translation + 0.5));
+
+			// unlike leaf labels, the bounding box of these labels is not known in advance
+			BBox bbox = State::Inst().GetFont()->GetBoundingBox(label);
+			int y = int(fontY - translation + 0.5);
+			m_visibleFoldedLabels.push_back(BBox(fontX + bbox.x, y + bbox.y, fontX + bbox.dx, y + bbox.dy));
 		}
 	}
 	glPopMatrix();
@@ -448,74 +782,9 @@ void VisualTree::RenderInternalLabels(float translation, float zoom)
 				continue;
 
 			// set position of label
-			Point pos = node->GetPosition();
+			Point pos = GetNodePosition(node);
 
-            QString label;
-            if(State::Inst().GetInternalNodeField() == "Bootstrap")
-			{
-                label = "N/A" ;
-				if(node->GetBootstrapToParent() != Node::NO_DISTANCE)
-				{
-                    label = QString::number(node->GetBootstrapToParent()/*,
-                                            State::Inst().GetInternalNodeFontPrecision(),
-                                            State::Inst().GetInternalNodeFontScientific()*/);
-				}
-			}
-            else if(State::Inst().GetInternalNodeField() == "Distance")
-			{
-                label = "N/A";
-				if(node->GetDistanceToParent() != Node::NO_DISTANCE)
-				{
-                    label = QString::number(node->GetDistanceToParent())/*,
-                                            State::Inst().GetInternalNodeFontPrecision(),
-                                            State::Inst().GetInternalNodeFontScientific()*/;
-				}
-			}
-            else if(State::Inst().GetInternalNodeField() == "Height")
-			{
-                label = QString::number(TreeTools<NodePhylo>::GetDepth(node));
-			}
-            else if(State::Inst().GetInternalNodeField() == "Name")
-			{
-				label = node->GetName();
-			}
-            else if(State::Inst().GetInternalNodeField() == "Number of Leaves")
-			{
-                label = QString::number(TreeTools<NodePhylo>::GetNumberOfLeaves(node));
-			}
-            else if(State::Inst().GetInternalNodeField() == "Parsimony Data")
-			{
-                label = "N/A";
-				if(m_parsimonyCalculator)
-				{
-					ParsimonyData data;
-					m_parsimonyCalculator->GetData(node, data);
-
-                    label = QString::number(data.nodeScore) + ": ";
-
-                    std::map<QString, uint>::iterator it;
-					for ( it=data.characterScores.begin() ; it != data.characterScores.end(); it++ )
-					{
-                        label += it->first + "(" + QString::number(it->second) + "), ";
-					}
-
-                    label = label.mid(0, label.length()-2);
-                    label += " : ";
-
-                    std::set<QString>::iterator itSet;
-					for(itSet=data.parsimoniousCharacters.begin(); itSet != data.parsimoniousCharacters.end(); itSet++)
-					{
-                        label += (*itSet) + ",";
-					}
-
-                    label = label.mid(0,label.length()-1);
-				}
-			}
-
-            if(label.toInt())
-			{
-                label = label.mid(0, label.indexOf("."));
-			}
+            QString label = InternalLabel(node);
 
 			BBox bb = State::Inst().GetFont()->GetBoundingBox(label);
 			int fontY, fontX;
@@ -532,6 +801,7 @@ void VisualTree::RenderInternalLabels(float translation, float zoom)
 			}
 
 			State::Inst().GetFont()->Render(label, fontX, int(fontY - translation + 0.5));
+			m_renderStats.internalLabels++;
 		}
 	}
 	glPopMatrix();
@@ -539,6 +809,86 @@ void VisualTree::RenderInternalLabels(float translation, float zoom)
 	glUtils::ErrorGL::Check();
 }
 
+QString VisualTree::InternalLabel(NodePhylo* node)
+{
+    QString label;
+    if(State::Inst().GetInternalNodeField() == "Bootstrap")
+	{
+        label = "N/A" ;
+		if(node->GetBootstrapToParent() != Node::NO_DISTANCE)
+		{
+            label = QString::number(node->GetBootstrapToParent()/*,
+                                    State::Inst().GetInternalNodeFontPrecision(),
+                                    State::Inst().GetInternalNodeFontScientific()*/);
+		}
+	}
+    else if(State::Inst().GetInternalNodeField() == "Distance")
+	{
+        label = "N/A";
+		if(node->GetDistanceToParent() != Node::NO_DISTANCE)
+		{
+            label = QString::number(node->GetDistanceToParent())/*,
+                                    State::Inst().GetInternalNodeFontPrecision(),
+                                    State::Inst().GetInternalNodeFontScientific()*/;
+		}
+	}
+    else if(State::Inst().GetInternalNodeField() == "Height")
+	{
+        label = QString::number(TreeTools<NodePhylo>::GetDepth(node));
+	}
+    else if(State::Inst().GetInternalNodeField() == "Name")
+	{
+		label = node->GetName();
+	}
+    else if(State::Inst().GetInternalNodeField() == "Number of Leaves")
+	{
+        label = QString::number(TreeTools<NodePhylo>::GetNumberOfLeaves(node));
+	}
+    else if(State::Inst().GetInternalNodeField() == "Parsimony Data")
+	{
+        label = "N/A";
+		if(m_parsimonyCalculator)
+		{
+			ParsimonyData data;
+			m_parsimonyCalculator->GetData(node, data);
+
+            label = QString::number(data.nodeScore) + ": ";
+
+            std::map<QString, uint>::iterator it;
+			for ( it=data.characterScores.begin() ; it != data.characterScores.end(); it++ )
+			{
+                label += it->first + "(" + QString::number(it->second) + "), ";
+			}
+
+            label = label.mid(0, label.length()-2);
+            label += " : ";
+
+            std::set<QString>::iterator itSet;
+			for(itSet=data.parsimoniousCharacters.begin(); itSet != data.parsimoniousCharacters.end(); itSet++)
+			{
+                label += (*itSet) + ",";
+			}
+
+            label = label.mid(0,label.length()-1);
+		}
+	}
+    else
+	{
+		// fields read with the tree or calculated for it (e.g., clade frequencies)
+        std::map<QString, QString> metadata = node->GetMetadata();
+        std::map<QString, QString>::const_iterator it = metadata.find(State::Inst().GetInternalNodeField());
+		if(it != metadata.end())
+			label = it->second;
+	}
+
+    if(label.toInt())
+	{
+        label = label.mid(0, label.indexOf("."));
+	}
+
+	return label;
+}
+
 void VisualTree::RenderActiveNode(float translation, float zoom)
 {
 
@@ -554,16 +904,19 @@ void VisualTree::RenderActiveNode(float translation, float zoom)
 			glTranslatef(border.x, border.y - translation, 0.0f);
 			glScalef(m_treeWidth, m_treeHeight * zoom, 1.0f);
 
-			Point activePos = m_activeNode.node->GetPosition();
+			Point activePos = GetNodePosition(m_activeNode.node);
 
 			glLineWidth(State::Inst().GetLineWidth()+2);
 			glColor3f(1.0f, 0.48f, 0.14f);
 
 			// highlight all lines going to children nodes
-			std::vector<NodePhylo*> children = m_activeNode.node->GetChildren();
+			std::vector<NodePhylo*> children;
+			if(!m_foldedClades.IsFolded(m_activeNode.node))
+				children = m_activeNode.node->GetChildren();
+
 			foreach(NodePhylo* child, children)
 			{
-				Point childPos = child->GetPosition();
+				Point childPos = GetNodePosition(child);
 
                 if(GetBranchStyle() == VisualTree::SLANTED_CLADOGRAM)
 				{
@@ -586,7 +939,7 @@ void VisualTree::RenderActiveNode(float translation, float zoom)
 			Point parentPos = Point(0.0f, 0.0f);
 			if(!m_activeNode.node->IsRoot())
 			{
-				parentPos = m_activeNode.node->GetParent()->GetPosition();
+				parentPos = GetNodePosition(m_activeNode.node->GetParent());
 
                 if(GetBranchStyle() == VisualTree::SLANTED_CLADOGRAM)
 				{
@@ -609,13 +962,14 @@ void VisualTree::RenderActiveNode(float translation, float zoom)
 			glLineWidth(State::Inst().GetLineWidth());
 			glColor3f(0.8f, 0.56f, 0.28f);
 			float yLabelSpacing = m_highestLabel / m_treeHeight;
+			Interval interval = GetNodeInterval(m_activeNode.node);
 
 			glBegin(GL_LINE_STRIP);
-				glVertex2f(parentPos.x, m_activeNode.node->GetInterval().start - 0.5 * yLabelSpacing);
-				glVertex2f(parentPos.x, m_activeNode.node->GetInterval().end + 0.5 * yLabelSpacing);
-				glVertex2f(1.0f, m_activeNode.node->GetInterval().end + 0.5 * yLabelSpacing);
-				glVertex2f(1.0f, m_activeNode.node->GetInterval().start - 0.5 * yLabelSpacing);
-				glVertex2f(parentPos.x, m_activeNode.node->GetInterval().start - 0.5 * yLabelSpacing);
+				glVertex2f(parentPos.x, interval.start - 0.5 * yLabelSpacing);
+				glVertex2f(parentPos.x, interval.end + 0.5 * yLabelSpacing);
+				glVertex2f(1.0f, interval.end + 0.5 * yLabelSpacing);
+				glVertex2f(1.0f, interval.start - 0.5 * yLabelSpacing);
+				glVertex2f(parentPos.x, interval.start - 0.5 * yLabelSpacing);
 			glEnd();
 		}
 		glPopMatrix();
@@ -625,6 +979,49 @@ void VisualTree::RenderActiveNode(float translation, float zoom)
 
 }
 
+void VisualTree::RenderHoverNode(float translation, float zoom)
+{
+	if(!m_hoverNode || m_foldedClades.IsHidden(m_hoverNode))
+		return;
+
+	if(m_polarLayout)
+	{
+		m_polarLayout->RenderHover(m_hoverNode, m_polarView);
+		return;
+	}
+
+	glUtils::ErrorGL::Check();
+
+	// same transformation as RenderTree()
+	Point border = State::Inst().GetBorderSize();
+	float sx = m_treeWidth;
+	float sy = m_treeHeight * zoom;
+	float dx = border.x;
+	float dy = border.y - translation;
+
+	Point pos = GetNodePosition(m_hoverNode);
+	Point hoverPos(int(pos.x*sx + dx + 0.5), int(pos.y*sy + dy + 0.5));
+	Colour colour(1.0f, 0.48f, 0.14f);
+
+	if(!m_hoverNode->IsRoot())
+	{
+		Point parentPos = GetNodePosition(m_hoverNode->GetParent());
+
+		glLineWidth(State::Inst().GetLineWidth()+2);
+		colour.SetColourGL();
+		glBegin(GL_LINES);
+			glVertex2f(int(parentPos.x*sx + dx + 0.5), hoverPos.y);
+			glVertex2f(hoverPos.x, hoverPos.y);
+		glEnd();
+		glLineWidth(State::Inst().GetLineWidth());
+	}
+
+	VisualMarker marker(colour, State::Inst().GetLineWidth()+10, VisualMarker::CIRCLE, VisualMarker::FILL, hoverPos);
+	marker.Render();
+
+	glUtils::ErrorGL::Check();
+}
+
 void VisualTree::LabelBoundingBoxes()
 {
 	if(!State::Inst().GetShowLeafLabels() && !State::Inst().GetShowMetadataLabels())
@@ -639,13 +1036,23 @@ void VisualTree::LabelBoundingBoxes()
 	m_widestLabel = 0;
 	m_bboxMap.clear();
 
+	// leaves sharing a label (e.g., when labelled by a metadata field) are only measured once
+	m_labelCache.Update(m_tree);
+	std::vector<BBox> labelBoxes(m_labelCache.GetNumberOfLabels());
+	std::vector<bool> bMeasured(m_labelCache.GetNumberOfLabels(), false);
+
 	std::vector<NodePhylo*> leafNodes = m_tree->GetLeaves();
 	State::Inst().GetFont()->SetSize(State::Inst().GetTreeFontSize());
     for(NodePhylo* leaf : leafNodes)
 	{
-        QString label = leaf->GetLabel();
+		uint labelId = m_labelCache.GetLabelId(leaf);
+		if(!bMeasured[labelId])
+		{
+			labelBoxes[labelId] = State::Inst().GetFont()->GetBoundingBox(m_labelCache.GetText(labelId));
+			bMeasured[labelId] = true;
+		}
 
-		BBox bbox = State::Inst().GetFont()->GetBoundingBox(label);
+		BBox bbox = labelBoxes[labelId];
 		mapItem item = mapItem(leaf->GetId(), bbox);
 
 		m_bboxMap.insert(item);
@@ -659,264 +1066,509 @@ void VisualTree::LabelBoundingBoxes()
 	m_highestLabel = bbox.Height();
 }
 
+void VisualTree::ReportMemory(MemoryReport& report) const
+{
+	// trees kept by the edit history are only counted there if they are not also shown
+	report.AddTree(m_tree);
+	report.AddTree(m_originalTree);
+
+	report.Add(MemoryReport::EDIT_HISTORY, MemoryReport::VectorBytes(m_edits));
+	for(const Edit& edit : m_edits)
+		edit.treeEdit->ReportMemory(report);
+
+	if(m_metadataInfo)
+		m_metadataInfo->ReportMemory(report);
+
+	m_labelCache.ReportMemory(report);
+
+	report.Add(MemoryReport::LAYOUT, MemoryReport::MapBytes(m_bboxMap)
+		+ MemoryReport::VectorBytes(m_visibleBranches) + MemoryReport::VectorBytes(m_visibleNodes)
+		+ MemoryReport::VectorBytes(m_visibleLeafNodes) + MemoryReport::VectorBytes(m_visibleFoldedNodes)
+		+ MemoryReport::VectorBytes(m_visibleFoldedLabels));
+	m_foldedClades.ReportMemory(report);
+	m_hitTestIndex.ReportMemory(report);
+	m_subtreeSorter.ReportMemory(report);
+	if(m_polarLayout)
+		m_polarLayout->ReportMemory(report);
+}
+
 void VisualTree::PropagateColours(const QString& field, ColourMapPtr colourMap)
 {
-/*	FieldInfo fieldInfo = m_metadataInfo->GetInfo(field);
+	// flatten tree into pre-order so leaf colours can be assigned in bulk
+	// and then propagated up the tree in a single post-order pass
+	std::vector<NodePhylo*> nodes;
+	std::vector<int> parents;
+	std::vector<uint> leaves;
+	nodes.reserve(m_tree->GetNumberOfNodes());
+	parents.reserve(m_tree->GetNumberOfNodes());
+	std::vector< std::pair<NodePhylo*, int> > stack(1, std::make_pair(m_tree->GetRootNode(), -1));
+	while(!stack.empty())
+	{
+		NodePhylo* node = stack.back().first;
+		parents.push_back(stack.back().second);
+		stack.pop_back();
+
+		int index = int(nodes.size());
+		nodes.push_back(node);
+		if(node->IsLeaf())
+			leaves.push_back(uint(index));
+
+		for(uint i = node->GetNumberOfChildren(); i > 0; --i)
+			stack.push_back(std::make_pair(node->GetChild(i-1), index));
+	}
+
+	if(field.isEmpty() || !colourMap || !m_metadataInfo)
+	{
+		// without a field the entire tree is drawn in the default colour
+		foreach(NodePhylo* node, nodes)
+		{
+			node->SetColour(State::Inst().GetDefaultTreeColour());
+			node->SetMissingData(false);
+		}
+
+		return;
+	}
+
+	FieldInfo fieldInfo = m_metadataInfo->GetInfo(field);
+
+	// read the value of each leaf node once, parsing numbers in bulk
+	uint numLeaves = uint(leaves.size());
+	std::vector<QString> values(numLeaves);
+	std::vector<float> numbers(numLeaves, 0.0f);
+	std::vector<char> bNumber(numLeaves, false);
+	std::vector<char> bMissingData(numLeaves, false);
+	for(uint i = 0; i < numLeaves; ++i)
+	{
+		values[i] = nodes[leaves[i]]->GetData(field);
+		bMissingData[i] = MetadataInfo::IsMissingData(values[i]);
+	}
+
+	if(colourMap->GetType() != ColourMap::CATEGORICAL)
+	{
+		for(uint i = 0; i < numLeaves; ++i)
+		{
+			bool bOk = false;
+			if(!bMissingData[i])
+				numbers[i] = values[i].toFloat(&bOk);
+			bNumber[i] = bOk;
+		}
+	}
+
+	// position of each value of the field, so categorical values are mapped without repeated lookups
+	QHash<QString, uint> valueIndices;
+	valueIndices.reserve(int(fieldInfo.values.size()));
+	foreach(const QString& value, fieldInfo.values)
+		valueIndices.insert(value, uint(valueIndices.size()));
 
+	std::vector<Colour> colours(numLeaves, State::Inst().GetColourMissingData());
+	bool bMixColour = true;
 	if(colourMap->GetType() == ColourMap::CATEGORICAL
 			|| (colourMap->GetType() == ColourMap::DISCRETE && fieldInfo.dataType == FieldInfo::CATEGORICAL))
 	{
-        ColourMapDiscretePtr discreteMap = colourMap.dynamicCast<ColourMapDiscretePtr>();
+		ColourMapDiscretePtr discreteMap = colourMap.dynamicCast<ColourMapDiscrete>();
 
-		std::vector<NodePhylo*> nodes = m_tree->GetLeaves();
-        for(NodePhylo* node : nodes)
+		// values without an assigned colour cycle through the colour map
+		std::vector<Colour> valueColours;
+		valueColours.reserve(valueIndices.size());
+		foreach(const QString& value, fieldInfo.values)
 		{
-			if(!MetadataInfo::IsMissingData(node->GetData(field)))
-			{
-				Colour colour;
-				discreteMap->GetColour(node->GetData(field), colour);
-				node->SetColour(colour);
-				node->SetMissingData(false);
-			}
-			else
-			{
-				node->SetColour(State::Inst().GetColourMissingData());
-				node->SetMissingData(true);
-			}
+			Colour colour;
+			if(!discreteMap->GetColour(value, colour) && discreteMap->GetSize() > 0)
+				colour = discreteMap->GetColour(uint(valueColours.size()) % discreteMap->GetSize());
+			valueColours.push_back(colour);
 		}
 
-		PropagateLeafNodeColours(false);
+		for(uint i = 0; i < numLeaves; ++i)
+		{
+			if(!bMissingData[i])
+				colours[i] = valueColours[valueIndices.value(values[i])];
+		}
+
+		bMixColour = false;
 	}
 	else if(colourMap->GetType() == ColourMap::DISCRETE && fieldInfo.dataType == FieldInfo::NUMERICAL)
 	{
-        ColourMapDiscretePtr discreteMap = colourMap.dynamicCast<ColourMapDiscrete>();
+		ColourMapDiscretePtr discreteMap = colourMap.dynamicCast<ColourMapDiscrete>();
 
 		// determine number of colour bins
-		uint bins = fieldInfo.values.size();
+		uint bins = uint(fieldInfo.values.size());
 		if(discreteMap->GetSize() < bins)
 			bins = discreteMap->GetSize();
+		bins = qMax(1u, bins);
 
-		// calculate bin boundries
-		float dValue = (fieldInfo.maxValue - fieldInfo.minValue) / bins;
-		float value = fieldInfo.minValue;
-		std::vector<double> binBoundries;
-		for(uint i = 0; i < bins+1; ++i)
-		{
-			binBoundries.push_back(value);
-			value += dValue;
-		}
-
-		// assign each leaf node to a bin
-		std::vector<NodePhylo*> nodes = m_tree->GetLeaves();
-        for(NodePhylo* node : nodes)
+		// assign each leaf node to one of the equally sized bins spanning the values of the field
+		float range = fieldInfo.maxValue - fieldInfo.minValue;
+		float scale = (range > 0) ? bins / range : 0.0f;
+		for(uint i = 0; i < numLeaves; ++i)
 		{
-            QString nodeValue = node->GetData(field);
-			if(!MetadataInfo::IsMissingData(nodeValue))
+			if(bNumber[i])
 			{
-                float value = nodeValue.toFloat();
-				uint bin = 0;
-                for(double boundry : binBoundries)
-				{
-					if(value <= boundry)
-						break;
-
-					bin++;
-				}
-
-				if(value == fieldInfo.maxValue)
-					bin = binBoundries.size()-2;
-
-				node->SetColour(discreteMap->GetColour(bin));
-				node->SetMissingData(false);
+				uint bin = uint(qMax(0.0f, (numbers[i] - fieldInfo.minValue) * scale));
+				colours[i] = discreteMap->GetColour(qMin(bin, bins-1));
 			}
 			else
 			{
-				node->SetColour(State::Inst().GetColourMissingData());
-				node->SetMissingData(true);
+				// values which are not numbers can not be placed in a bin
+				bMissingData[i] = true;
 			}
 		}
-
-		PropagateLeafNodeColours(true);
 	}
 	else if(colourMap->GetType() == ColourMap::CONTINUOUS)
 	{
-        ColourMapContinuousPtr continuousMap = colourMap.dynamicCast<ColourMapContinuous>();
+		ColourMapContinuousPtr continuousMap = colourMap.dynamicCast<ColourMapContinuous>();
 
-		std::vector<NodePhylo*> nodes = m_tree->GetLeaves();
-        for(NodePhylo* node : nodes)
+		uint lastIndex = qMax(1u, uint(fieldInfo.values.size())) - 1;
+		for(uint i = 0; i < numLeaves; ++i)
 		{
-            QString nodeValue = node->GetData(field);
-			if(!MetadataInfo::IsMissingData(nodeValue))
+			if(bNumber[i])
 			{
-                bool convOk;
-                float value = nodeValue.toFloat(&convOk);
-                if(convOk)
-				{
-					// handle a numerical field using a continuous colour map
-					node->SetColour(continuousMap->GetColour(value, fieldInfo.minValue, fieldInfo.maxValue));
-				}
-				else
-				{
-					// handle a categorical field using a continuous colour map
-					uint pos = 0;
-                    for(const QString& value : fieldInfo.values)
-					{
-						if(nodeValue == value)
-							break;
-
-						pos++;
-					}
-
-					node->SetColour(continuousMap->GetColour(pos, 0, fieldInfo.values.size()-1));
-				}
-
-				node->SetMissingData(false);
+				// handle a numerical field using a continuous colour map
+				colours[i] = continuousMap->GetColour(numbers[i], fieldInfo.minValue, fieldInfo.maxValue);
 			}
-			else
+			else if(!bMissingData[i])
 			{
-				node->SetColour(State::Inst().GetColourMissingData());
-				node->SetMissingData(true);
+				// handle a categorical field using a continuous colour map
+				colours[i] = continuousMap->GetColour(float(valueIndices.value(values[i])), 0.0f, float(lastIndex));
 			}
 		}
+	}
 
-		PropagateLeafNodeColours(true);
+	for(uint i = 0; i < numLeaves; ++i)
+	{
+		NodePhylo* leaf = nodes[leaves[i]];
+		leaf->SetColour(colours[i]);
+		leaf->SetMissingData(bMissingData[i]);
 	}
-    */
+
+	PropagateLeafNodeColours(nodes, parents, bMixColour);
 }
 
-void VisualTree::PropagateLeafNodeColours(bool bMixColour)
+void VisualTree::ColourNodes(const QString& field, const std::map<QString, Colour>& colours)
 {
-	// mark all internal nodes as unprocessed and leaf nodes as processed
 	std::vector<NodePhylo*> nodes = m_tree->GetNodes();
     for(NodePhylo* node : nodes)
-		node->SetProcessed(node->IsLeaf());
-
-	// queue of nodes that need to be assigned a colour
-	std::queue<NodePhylo*> queue;	
-	std::vector<NodePhylo*> leafNodes = m_tree->GetLeaves();
-    for(NodePhylo* leaf : leafNodes)
-		queue.push(leaf->GetParent());
-
-	while(!queue.empty())
 	{
-		NodePhylo* node = queue.front();
+		std::map<QString, Colour>::const_iterator it = colours.find(node->GetData(field));
+		if(it != colours.end())
+			node->SetColour(it->second);
+	}
+}
 
-		if(node->IsProcessed())
+void VisualTree::PropagateLeafNodeColours(const std::vector<NodePhylo*>& nodes, const std::vector<int>& parents, bool bMixColour)
+{
+	bool bIgnoreMissingData = State::Inst().GetIgnoreMissingData();
+	Colour missingDataColour = State::Inst().GetColourMissingData();
+	Colour defaultColour = State::Inst().GetDefaultTreeColour();
+
+	// colours of the children of each node, accumulated as the children are processed
+	uint numNodes = uint(nodes.size());
+	std::vector<float> red(numNodes, 0.0f);
+	std::vector<float> green(numNodes, 0.0f);
+	std::vector<float> blue(numNodes, 0.0f);
+	std::vector<uint> numChildrenWithData(numNodes, 0);
+	std::vector<Colour> firstColour(numNodes);
+	std::vector<char> bMultipleColours(numNodes, false);
+
+	// nodes are in pre-order, so visiting them in reverse processes every child before its parent
+	for(uint i = numNodes; i > 0; --i)
+	{
+		uint index = i-1;
+		NodePhylo* node = nodes[index];
+		if(!node->IsLeaf())
 		{
-			queue.pop();
-			continue;
-		}
+			uint numWithData = numChildrenWithData[index];
+			if(numWithData == 0)
+				node->SetColour(missingDataColour);
+			else if(bMixColour)
+				node->SetColour(Colour(red[index]/numWithData, green[index]/numWithData, blue[index]/numWithData));
+			else if(bMultipleColours[index])
+				node->SetColour(defaultColour);
+			else
+				node->SetColour(firstColour[index]);
 
-		std::vector<NodePhylo*> children = node->GetChildren();
-		float red = 0, green = 0, blue = 0;
-		bool bMultipleColours = false;
-		bool bProcessed = true;
-		bool bAllLeavesMissingData = true;
-		uint numChildrenWithData = 0;
-		Colour colour;
-        for(NodePhylo* child : children)
-		{
-			if(!child->IsProcessed())
-			{
-				// put node on back of queue for later processing
-				queue.push(node);
-				bProcessed = false;
-				break;
-			}
+			node->SetMissingData(numWithData == 0);
+		}
 
-			if(!State::Inst().GetIgnoreMissingData()
-						|| (State::Inst().GetIgnoreMissingData() && !child->IsMissingData()))
-			{
-				bAllLeavesMissingData = false;
-				numChildrenWithData++;
+		int parent = parents[index];
+		if(parent < 0 || (bIgnoreMissingData && node->IsMissingData()))
+			continue;
 
-				if(bMixColour)
-				{
-					red += child->GetColour().GetRed();
-					green += child->GetColour().GetGreen();
-					blue += child->GetColour().GetBlue();
-				}
-				else
-				{
-					if(numChildrenWithData == 1)
-					{
-						colour = child->GetColour();
-					}
-					else if(child->GetColour() != colour)
-					{
-						bMultipleColours = true;
-						break;
-					}
-				}
-			}
+		const Colour& colour = node->GetColour();
+		if(bMixColour)
+		{
+			red[parent] += colour.GetRed();
+			green[parent] += colour.GetGreen();
+			blue[parent] += colour.GetBlue();
 		}
-
-		if(bProcessed)
+		else if(numChildrenWithData[parent] == 0)
 		{
-			if(bAllLeavesMissingData)
-			{
-				node->SetColour(State::Inst().GetColourMissingData());
-				node->SetMissingData(true);
-			}
-			else if(bMixColour)
-			{
-				node->SetColour(Colour(red/numChildrenWithData, green/numChildrenWithData, blue/numChildrenWithData));
-				node->SetMissingData(false);
-			}
-			else
-			{
-				if(bMultipleColours)
-					node->SetColour(State::Inst().GetDefaultTreeColour());
-				else
-					node->SetColour(colour);
-				node->SetMissingData(false);
-			}
-
-			if(!node->IsRoot())
-				queue.push(node->GetParent());
-
-			node->SetProcessed(true);
+			firstColour[parent] = colour;
+		}
+		else if(colour != firstColour[parent])
+		{
+			bMultipleColours[parent] = true;
 		}
 
-		queue.pop();
+		numChildrenWithData[parent]++;
 	}
 }
 
 void VisualTree::ProjectTree(std::vector<QString>& names)
 {
-	//m_tree = m_originalTree->Clone();
-    /*m_tree->ProjectTree(names);
-	
+	// nodes removed from the tree may be folded or selected
+	m_foldedClades.Clear();
+	ClearActiveNode();
+
+	// every remaining node is relinked, although most keep the same links
+	BeginEdit("Project onto Leaves");
+	m_pendingEdit.treeEdit->RecordAll();
+
+	std::vector<NodePhylo*> removed;
+	m_tree->ProjectTree(names, &removed);
+	m_pendingEdit.treeEdit->Remove(removed);
+
 	if(m_metadataInfo)
-	{
 		m_metadataInfo->SetMetadata(m_tree);
-		wxCommandEvent tmp;
-		((PygmyFrame*)App::Inst().GetMainFrame())->OnChangeColourMap(tmp);
-	}
 
-    Layout();*/
+	Layout();
+	EndEdit(true);
 }
 
 void VisualTree::CollapseNodes(float support)
 {
-	//m_tree = m_originalTree->Clone();
-	m_tree->CollapseNodes(support);
+	m_foldedClades.Clear();
+	ClearActiveNode();
+
+	// record each node that will be collapsed along with its parent and children
+	BeginEdit("Collapse Nodes");
+	std::vector<NodePhylo*> stack(1, m_tree->GetRootNode());
+	while(!stack.empty())
+	{
+		NodePhylo* node = stack.back();
+		stack.pop_back();
+
+		for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
+			stack.push_back(node->GetChild(i));
+
+		if(node->IsRoot() || node->IsLeaf() || node->GetBootstrapToParent() >= support)
+			continue;
+
+		m_pendingEdit.treeEdit->Record(node);
+		m_pendingEdit.treeEdit->Record(node->GetParent());
+		for(uint i = 0; i < node->GetNumberOfChildren(); ++i)
+			m_pendingEdit.treeEdit->Record(node->GetChild(i));
+	}
+
+	std::vector<NodePhylo*> removed;
+	m_tree->CollapseNodes(support, &removed);
+	m_pendingEdit.treeEdit->Remove(removed);
+	m_tree->CalculateStatistics();
 
 	Layout();
+	EndEdit(false);
 }
 
-void VisualTree::RestoreTree() 
-{ 
-    /*m_tree = m_originalTree->Clone();
+bool VisualTree::ToggleFold(NodePhylo* node)
+{
+	if(!node || node->IsLeaf())
+		return false;
+
+	// the layout of trees read from a snapshot is not indexed until a clade is folded
+	if(m_foldedClades.GetTree() != m_tree)
+		m_foldedClades.SetLayout(m_tree);
+
+	m_bPolarLayoutChanged = true;
+
+	if(m_foldedClades.Unfold(node))
+		return false;
+
+	return m_foldedClades.Fold(node);
+}
+
+uint VisualTree::FoldByField(const QString& field)
+{
+	if(m_foldedClades.GetTree() != m_tree)
+		m_foldedClades.SetLayout(m_tree);
+
+	m_bPolarLayoutChanged = true;
+	return m_foldedClades.FoldByField(field);
+}
+
+void VisualTree::UnfoldAll()
+{
+	m_foldedClades.Clear();
+	m_bPolarLayoutChanged = true;
+}
+
+uint VisualTree::GetNumberOfRows() const
+{
+	if(!m_foldedClades.HasFolds())
+		return m_tree->GetNumberOfLeaves();
+
+	return m_foldedClades.GetNumberOfRows();
+}
+
+void VisualTree::RestoreTree()
+{
+	m_foldedClades.Clear();
+	ClearActiveNode();
+
+	// the modified tree is kept by the history so restoring can be undone
+	BeginEdit("Restore Original Tree");
+	m_tree = m_originalTree->Clone();
 
 	if(m_metadataInfo)
+		m_metadataInfo->SetMetadata(m_tree);
+
+	Layout();
+	EndEdit(true);
+}
+
+void VisualTree::SortSubtrees(SUBTREE_SORT sortStyle, SubtreeSorter::SORT_KEY sortKey, const QString& sortField)
+{
+	if(sortStyle == m_subtreeSortStyle && sortKey == m_subtreeSortKey && sortField == m_subtreeSortField)
+		return;
+
+	QString description = "Unsort Subtrees";
+	if(sortStyle == ASCENDING)
+		description = "Sort Ascending";
+	else if(sortStyle == DESCENDING)
+		description = "Sort Descending";
+
+	// only nodes whose children are reordered are kept
+	BeginEdit(description);
+	m_pendingEdit.treeEdit->RecordAll();
+
+	m_subtreeSortStyle = sortStyle;
+	m_subtreeSortKey = sortKey;
+	m_subtreeSortField = sortField;
+	Layout();
+	EndEdit(false);
+}
+
+void VisualTree::BeginEdit(const QString& description)
+{
+	m_pendingEdit.treeEdit = TreeEditPtr(new TreeEdit(description, m_tree));
+	m_pendingEdit.sortBefore = m_subtreeSortStyle;
+	m_pendingEdit.sortKeyBefore = m_subtreeSortKey;
+	m_pendingEdit.sortFieldBefore = m_subtreeSortField;
+
+	// the change is laid out before it ends, so subtrees are sorted again from fresh keys
+	m_subtreeSorter.Invalidate();
+}
+
+void VisualTree::EndEdit(bool bLeavesChanged)
+{
+	Edit edit = m_pendingEdit;
+	m_pendingEdit.treeEdit.clear();
+
+	edit.treeEdit->Finish(m_tree);
+	edit.sortAfter = m_subtreeSortStyle;
+	edit.sortKeyAfter = m_subtreeSortKey;
+	edit.sortFieldAfter = m_subtreeSortField;
+	edit.bLeavesChanged = bLeavesChanged;
+	if(bLeavesChanged)
+		m_labelCache.Invalidate();
+
+	if(edit.treeEdit->IsEmpty() && edit.sortBefore == edit.sortAfter
+			&& edit.sortKeyBefore == edit.sortKeyAfter && edit.sortFieldBefore == edit.sortFieldAfter)
+		return;
+
+	// undone changes can no longer be redone
+	m_edits.erase(m_edits.begin() + m_numAppliedEdits, m_edits.end());
+	m_edits.push_back(edit);
+	if(m_edits.size() > MAX_EDITS)
+		m_edits.erase(m_edits.begin());
+
+	m_numAppliedEdits = uint(m_edits.size());
+}
+
+QString VisualTree::GetUndoText() const
+{
+	if(!CanUndo())
+		return QString();
+
+	return m_edits[m_numAppliedEdits-1].treeEdit->GetDescription();
+}
+
+QString VisualTree::GetRedoText() const
+{
+	if(!CanRedo())
+		return QString();
+
+	return m_edits[m_numAppliedEdits].treeEdit->GetDescription();
+}
+
+bool VisualTree::Undo()
+{
+	if(!CanUndo())
+		return false;
+
+	m_foldedClades.Clear();
+	ClearActiveNode();
+
+	m_numAppliedEdits--;
+	const Edit& edit = m_edits[m_numAppliedEdits];
+	m_tree = edit.treeEdit->Undo();
+	m_subtreeSortStyle = edit.sortBefore;
+	m_subtreeSortKey = edit.sortKeyBefore;
+	m_subtreeSortField = edit.sortFieldBefore;
+	EditApplied(edit);
+
+	return true;
+}
+
+bool VisualTree::Redo()
+{
+	if(!CanRedo())
+		return false;
+
+	m_foldedClades.Clear();
+	ClearActiveNode();
+
+	const Edit& edit = m_edits[m_numAppliedEdits];
+	m_numAppliedEdits++;
+	m_tree = edit.treeEdit->Redo();
+	m_subtreeSortStyle = edit.sortAfter;
+	m_subtreeSortKey = edit.sortKeyAfter;
+	m_subtreeSortField = edit.sortFieldAfter;
+	EditApplied(edit);
+
+	return true;
+}
+
+void VisualTree::EditApplied(const Edit& edit)
+{
+	// the order of children was restored along with their links
+	m_subtreeSorter.Invalidate();
+
+	if(edit.bLeavesChanged)
 	{
-		m_metadataInfo->SetMetadata(m_tree);	
-		wxCommandEvent tmp;
-		((PygmyFrame*)App::Inst().GetMainFrame())->OnChangeColourMap(tmp);
+		if(m_metadataInfo)
+			m_metadataInfo->SetMetadata(m_tree);
+
+		m_labelCache.Invalidate();
+		LabelBoundingBoxes();
 	}
 
-    Layout();*/
+	Layout();
+}
+
+void VisualTree::ClearActiveNode()
+{
+	m_activeNode = VisualNode(VisualMarker(), NULL);
+	m_visibleBranches.clear();
+	m_visibleNodes.clear();
+	m_visibleLeafNodes.clear();
+	m_visibleFoldedNodes.clear();
+	m_visibleFoldedLabels.clear();
+	m_hitTestIndex.Clear(0);
+	m_hoverNode = NULL;
+
+	// the nodes captured by a polar layout may no longer exist
+	if(m_polarLayout)
+		m_polarLayout->ClearVisibleElements();
+	m_bPolarLayoutChanged = true;
 }
 
 bool VisualTree::MouseLeftDown(const utils::Point& mousePt)
@@ -925,124 +1577,189 @@ bool VisualTree::MouseLeftDown(const utils::Point& mousePt)
 	if(m_activeNode.node != NULL)
 		m_activeNode.node->SetSelected(false);		
 
-	// check if user has clicked on a node
-	bool bSelected = false;
-    for(VisualNode& visNode : m_visibleNodes)
-	{
-		visNode.visualMarker.SetVisibility(true);
-		if(visNode.visualMarker.MouseLeftDown(mousePt))
-		{
-            bSelected = true;
-			visNode.node->SetSelected(true);
-			m_activeNode = visNode;
+	// check if user has clicked on a node, its label or the branch leading to it
+	HitTestIndex::Hit hit = HitTest(mousePt);
+	if(!hit.node)
+		return false;
 
-			break;
-		}
-	}
+	hit.node->SetSelected(true);
+	m_activeNode = VisualNode(VisualMarker(), hit.node);
 
-	return bSelected;
+	return true;
 }
 
-void VisualTree::Reroot()
+HitTestIndex::Hit VisualTree::HitTest(const utils::Point& pt)
 {
-	m_tree->Reroot(m_activeNode.node);
-    m_tree->CalculateStatistics();
+	if(!m_hitTestIndex.IsBuilt())
+		BuildHitTestIndex();
+
+	return m_hitTestIndex.Find(pt);
+}
+
+bool VisualTree::SetHoverPoint(const utils::Point& pt)
+{
+	NodePhylo* node = HitTest(pt).node;
+	if(node == m_hoverNode)
+		return false;
+
+	m_hoverNode = node;
+	return true;
+}
+
+bool VisualTree::ClearHover()
+{
+	bool bHover = (m_hoverNode != NULL);
+	m_hoverNode = NULL;
+
+	return bHover;
+}
+
+void VisualTree::BuildHitTestIndex()
+{
+	if(m_polarLayout)
+	{
+		m_polarLayout->AddToHitTestIndex(m_hitTestIndex);
+		m_hitTestIndex.Build();
+		return;
+	}
+
+	// same transformation as RenderTree()
+	Point border = State::Inst().GetBorderSize();
+	float sx = m_treeWidth;
+	float sy = m_treeHeight * m_renderZoom;
+	float dx = border.x;
+	float dy = border.y - m_renderTranslation;
 
-	// There is a bit of a complication here. If the root of a tree is changed,
-	// some bootstrap values may be lost (i.e., because the split induced by the
-	// previous root no longer exists). If the original rooting of the tree is 
-	// later restored this data will be missing. As such, we explicitly restore
-	// bootstrap values from the original tree here.
-	std::vector< NodePhylo* > rootChildren = m_tree->GetRootNode()->GetChildren();
-    for(NodePhylo* node : rootChildren)
+	for(const VisualNode& visNode : m_visibleNodes)
 	{
-		std::vector< NodePhylo* > children = node->GetChildren();
+		Point pos = visNode.visualMarker.GetPosition();
+		float size = 0.5f * visNode.visualMarker.GetSize();
+		m_hitTestIndex.Add(BBox(pos.x - size, pos.y - size, pos.x + size, pos.y + size), visNode.node, HitTestIndex::NODE);
+	}
+
+	for(VisualBranch& visBranch : m_visibleBranches)
+	{
+		const Point& ll = visBranch.visualBranch.GetLowerLeftPt();
+		const Point& ur = visBranch.visualBranch.GetUpperRightPt();
+		m_hitTestIndex.Add(BBox(ll.x, ll.y, ur.x, ur.y), visBranch.node, HitTestIndex::BRANCH);
+	}
 
-		std::vector< NodePhylo* > originalNodes = m_originalTree->GetRootNode()->GetChildren();
-        for(NodePhylo* originalNode : originalNodes)
+	// labels are only measured when they are shown
+	if(State::Inst().GetShowLeafLabels() || State::Inst().GetShowMetadataLabels())
+	{
+		for(NodePhylo* leaf : m_visibleLeafNodes)
 		{
-			std::vector< NodePhylo* > originalChildren = originalNode->GetChildren();
+			std::map<utils::Node::NodeId, utils::BBox>::const_iterator it = m_bboxMap.find(leaf->GetId());
+			if(it == m_bboxMap.end())
+				continue;
 
-			bool bIdentical = true;
-            for(NodePhylo* child : children)
-			{
-				bool bMatch = false;
-                for(NodePhylo* originalChild : originalChildren)
-				{
-					if(child->GetId() == originalChild->GetId())
-					{
-						bMatch = true;
-						break;
-					}
-				}
+			Point pos = GetNodePosition(leaf);
+			float fontX = pos.x * sx + dx + State::Inst().GetLabelOffset();
+			float fontY = pos.y * sy + dy - m_labelBaseline;
 
-				if(!bMatch)
-				{
-					bIdentical = false;
-					break;
-				}
-			}
-
-			if(bIdentical)
-			{
-				node->SetBootstrapToParent(originalNode->GetBootstrapToParent());
-				break;
-			}
+			const BBox& bbox = it->second;
+			m_hitTestIndex.Add(BBox(fontX + bbox.x, fontY + bbox.y, fontX + bbox.dx, fontY + bbox.dy), leaf, HitTestIndex::LABEL);
 		}
+
+		for(uint i = 0; i < m_visibleFoldedLabels.size() && i < m_visibleFoldedNodes.size(); ++i)
+			m_hitTestIndex.Add(m_visibleFoldedLabels[i], m_visibleFoldedNodes[i], HitTestIndex::LABEL);
 	}
 
-	Layout();
+	float halfRow = 0.4f / GetNumberOfRows();
+	for(NodePhylo* node : m_visibleFoldedNodes)
+	{
+		Point pos = GetNodePosition(node);
+		Interval interval = GetNodeInterval(node);
+		m_hitTestIndex.Add(BBox(pos.x * sx + dx, (interval.start - halfRow) * sy + dy,
+			m_foldedClades.GetFoldedExtent(node) * sx + dx, (interval.end + halfRow) * sy + dy), node, HitTestIndex::CLADE);
+	}
+
+	m_hitTestIndex.Build();
+}
+
+void VisualTree::Reroot()
+{
+	Reroot(m_activeNode.node);
 }
 
 void VisualTree::Reroot(NodePhylo * node)
 {
+    if(!node || node->IsRoot())
+        return;
+
+    m_foldedClades.Clear();
+
+    // only the nodes between the new and previous root, and the children of the previous root, are relinked
+    BeginEdit("Reroot");
+    std::vector<NodePhylo*> path;
+    for(NodePhylo* pathNode = node; pathNode; pathNode = pathNode->GetParent())
+    {
+        m_pendingEdit.treeEdit->Record(pathNode);
+        path.push_back(pathNode);
+    }
+
+    std::vector< NodePhylo* > previousRootChildren = m_tree->GetRootNode()->GetChildren();
+    for(NodePhylo* child : previousRootChildren)
+        m_pendingEdit.treeEdit->Record(child);
+
+    // Rerooting reverses the branches between the new and previous root, and the
+    // branches to the children of a bifurcating root are merged. Support values
+    // belong to splits rather than to the nodes below them, so the support of each
+    // split is found before rerooting and restored to the branch defining the same
+    // split afterwards. Other branches keep their split and their support. Leaf
+    // names must be unique to identify splits; otherwise only the values carried
+    // along the path by Tree::Reroot() are kept.
+    SplitHash splitHash;
+    QHash<SplitKey, float> splitSupport;
+    std::vector<NodePhylo*> nodes;
+    std::vector<SplitKey> keys;
+    std::vector<uint> numLeaves;
+    bool bSplits = splitHash.SetTaxa(m_tree->GetLeafNames())
+                   && splitHash.GetNodeClades(m_tree->GetRootNode(), false, nodes, keys, numLeaves);
+    if(bSplits)
+    {
+        splitSupport.reserve(int(nodes.size()));
+        for(uint i = 0; i < nodes.size(); ++i)
+        {
+            // nodes with a single child share the split of their child, as do the children of a bifurcating root
+            float bootstrap = nodes[i]->GetBootstrapToParent();
+            QHash<SplitKey, float>::iterator it = splitSupport.find(keys[i]);
+            if(it == splitSupport.end())
+                splitSupport.insert(keys[i], bootstrap);
+            else if(it.value() == Node::NO_DISTANCE)
+                it.value() = bootstrap;
+        }
+    }
+
     m_tree->Reroot(node);
     m_tree->CalculateStatistics();
 
-    // There is a bit of a complication here. If the root of a tree is changed,
-    // some bootstrap values may be lost (i.e., because the split induced by the
-    // previous root no longer exists). If the original rooting of the tree is
-    // later restored this data will be missing. As such, we explicitly restore
-    // bootstrap values from the original tree here.
-    std::vector< NodePhylo* > rootChildren = m_tree->GetRootNode()->GetChildren();
-    for(NodePhylo* node : rootChildren)
+    if(bSplits && splitHash.GetNodeClades(m_tree->GetRootNode(), false, nodes, keys, numLeaves))
     {
-        std::vector< NodePhylo* > children = node->GetChildren();
-
-        std::vector< NodePhylo* > originalNodes = m_originalTree->GetRootNode()->GetChildren();
-        for(NodePhylo* originalNode : originalNodes)
+        QHash<NodePhylo*, SplitKey> relinkedKeys;
+        for(uint i = 0; i < nodes.size(); ++i)
         {
-            std::vector< NodePhylo* > originalChildren = originalNode->GetChildren();
+            if(!nodes[i]->IsRoot() && !nodes[i]->IsLeaf())
+                relinkedKeys.insert(nodes[i], keys[i]);
+        }
 
-            bool bIdentical = true;
-            for(NodePhylo* child : children)
-            {
-                bool bMatch = false;
-                for(NodePhylo* originalChild : originalChildren)
-                {
-                    if(child->GetId() == originalChild->GetId())
-                    {
-                        bMatch = true;
-                        break;
-                    }
-                }
-
-                if(!bMatch)
-                {
-                    bIdentical = false;
-                    break;
-                }
-            }
+        // only the recorded nodes were relinked
+        std::vector<NodePhylo*> relinkedNodes = previousRootChildren;
+        relinkedNodes.insert(relinkedNodes.end(), path.begin(), path.end());
+        for(NodePhylo* relinkedNode : relinkedNodes)
+        {
+            QHash<NodePhylo*, SplitKey>::const_iterator keyIt = relinkedKeys.constFind(relinkedNode);
+            if(keyIt == relinkedKeys.constEnd())
+                continue;
 
-            if(bIdentical)
-            {
-                node->SetBootstrapToParent(originalNode->GetBootstrapToParent());
-                break;
-            }
+            QHash<SplitKey, float>::const_iterator it = splitSupport.constFind(keyIt.value());
+            if(it != splitSupport.constEnd())
+                relinkedNode->SetBootstrapToParent(it.value());
         }
     }
 
     Layout();
+    EndEdit(false);
 }
 
 void VisualTree::MidpointRoot()
@@ -1102,25 +1819,15 @@ uint VisualTree::Parsimony()
 
 utils::Tree<NodePhylo>::Ptr VisualTree::GetSelectedSubtree()
 {
-	// Clone tree as this subtree may be destroyed at any time
-	utils::Tree<NodePhylo>::Ptr subtree = m_tree->Clone();
-
-	// Find selected node in newly cloned tree
-	NodePhylo* activeNode;
-	std::vector<NodePhylo*> nodes = subtree->GetNodes();
-    for(NodePhylo* node : nodes)
-	{
-		if(node->GetId() == m_activeNode.node->GetId())
-		{
-			activeNode = node;
-			break;
-		}
-	}
-
-	// create selected subtree
-	subtree->SetRootNode(activeNode);
+	// Clone only the selected subtree as it may be destroyed at any time. Cloning
+	// the entire tree and re-rooting it leaked all nodes outside the subtree.
+	NodePhylo* activeNode = TreeTools<NodePhylo>::CloneSubtree(m_activeNode.node);
 	activeNode->SetDistanceToParent(Node::NO_DISTANCE);
 	activeNode->SetParent(NULL);
 
+	utils::Tree<NodePhylo>::Ptr subtree(new utils::Tree<NodePhylo>());
+	subtree->SetRootNode(activeNode);
+	subtree->CalculateStatistics();
+
 	return subtree;
 }
@@ -15,6 +15,13 @@
 #include "../core/VisualObject.hpp"
 #include "../core/VisualMarker.hpp"
 #include "../core/VisualRect.hpp"
+#include "../core/RenderStats.hpp"
+#include "../core/FoldedClades.hpp"
+#include "../core/HitTestIndex.hpp"
+#include "../core/LabelCache.hpp"
+#include "../core/PolarLayout.hpp"
+#include "../core/SubtreeSorter.hpp"
+#include "../core/TreeEdit.hpp"
 
 #include "../utils/Colour.hpp"
 #include "../utils/Tree.hpp"
@@ -57,6 +64,19 @@ class VisualTree: public VisualObject
 public:
     enum BRANCH_STYLE { PHYLOGRAM_BRANCHES, CLADOGRAM_BRANCHES, EQUAL_BRANCHES, SLANTED_CLADOGRAM };
     enum SUBTREE_SORT { UNSORTED, ASCENDING, DESCENDING };
+    enum LAYOUT_STYLE { RECTANGULAR_LAYOUT, CIRCULAR_LAYOUT, RADIAL_LAYOUT };
+
+	/** Time a progressive frame aims to spend rendering the tree (ns), leaving the rest of a 60 fps frame for labels. */
+	static const qint64 FRAME_BUDGET_NS;
+
+	/** Fewest nodes traversed by a progressive frame. */
+	static const uint MIN_NODE_BUDGET;
+
+	/** Factor the node budget grows by with each frame refining an unchanged view. */
+	static const uint REFINEMENT_FACTOR;
+
+	/** Most changes to the tree which can be undone. */
+	static const uint MAX_EDITS;
 
 public:
 	/** 
@@ -77,10 +97,23 @@ public:
 	 */
 	void Render(int width, int height, float translation, float zoom);
 
+	/**
+	 * @brief Render portion of tree visible within the viewport, refining it over several frames.
+	 *
+	 * Whenever the view changes, only as many nodes are traversed as can be rendered within
+	 * FRAME_BUDGET_NS and clades beyond this budget are drawn in outline. While the view is
+	 * unchanged, each frame traverses more nodes until the tree is drawn in full. Parameters
+	 * are as for Render().
+	 */
+	void RenderProgressive(int width, int height, float translation, float zoom);
+
+	/** Flag indicating if the most recent frame was not drawn in full, so another frame should be rendered. */
+	bool IsRefining() const { return m_bRefining; }
+
 	/**
 	 * @brieft Layout tree.
 	 */
-	void Layout() { LayoutBranchStyle(); LayoutY(); }
+	void Layout() { LayoutBranchStyle(); LayoutY(); m_foldedClades.SetLayout(m_tree); }
 
 	/**
 	 * @brief Layout tree with a given branch style.
@@ -96,12 +129,19 @@ public:
 	void SetVisualColourMap(VisualColourMapPtr visualColourMap) { m_visualColourMap = visualColourMap; }
 
 	/**
-	 * @brief Layout tree.
-	 * @param field Field to base colours on.
+	 * @brief Colour leaf nodes by their value for a metadata field and propagate these colours up the tree.
+	 * @param field Field to base colours on. If empty, all nodes are given the default tree colour.
 	 * @param colourMap Colour map to associate with tree. 
 	 */
     void PropagateColours(const QString& field, utils::ColourMapPtr colourMap);
 
+	/**
+	 * @brief Colour each node by its value for a metadata field.
+	 * @param field Field to base colours on.
+	 * @param colours Colour of each value. Nodes with any other value keep their current colour.
+	 */
+	void ColourNodes(const QString& field, const std::map<QString, utils::Colour>& colours);
+
 	/**
 	 * @brief Calculate dimensions of tree.
 	 * @param width Current width of viewport tree is being displayed in.
@@ -117,7 +157,7 @@ public:
 	virtual void SetSearchFilter(FilterPtr filter) { m_searchFilter = filter; }
 
 	/** Set metadata info object. */
-	void SetMetadataInfo(MetadataInfoPtr metadataInfo) { m_metadataInfo = metadataInfo; }
+	void SetMetadataInfo(MetadataInfoPtr metadataInfo) { m_metadataInfo = metadataInfo; m_labelCache.Invalidate(); m_subtreeSorter.Invalidate(); }
 
 	/** Get metadata info object. */
 	MetadataInfoPtr GetMetadataInfo() { return m_metadataInfo; }
@@ -132,6 +172,7 @@ public:
 	 * @brief Project tree onto a set of leaf nodes.
 	 * @param names Names of leaf nodes to project tree onto.
 	 * Note: names will contain a list of all the names not found in the tree after function returns.
+	 * The original tree is kept so it can be restored with RestoreTree().
 	 */
     void ProjectTree(std::vector<QString>& names);
 
@@ -141,6 +182,35 @@ public:
 	 */
 	void CollapseNodes(float support);
 
+	/**
+	 * @brief Fold or unfold a clade so it is drawn as a triangle. Unlike CollapseNodes(), the tree is not modified.
+	 * @param node Root of clade.
+	 * @return True if the clade is now folded.
+	 */
+	bool ToggleFold(NodePhylo* node);
+
+	/**
+	 * @brief Fold every largest clade whose leaves share a value for a metadata field (e.g., a taxonomic rank).
+	 * @param field Metadata field.
+	 * @return Number of clades folded.
+	 */
+	uint FoldByField(const QString& field);
+
+	/** Unfold all clades. */
+	void UnfoldAll();
+
+	/** Get clades folded into triangles. */
+	const FoldedClades& GetFoldedClades() const { return m_foldedClades; }
+
+	/** Get position of a node, with nodes below folded clades moved up. */
+	utils::Point GetNodePosition(const NodePhylo* node) const { return utils::Point(node->GetPosition().x, m_foldedClades.GetYPos(node)); }
+
+	/** Get interval spanned by the children of a node, with nodes below folded clades moved up. */
+	utils::Interval GetNodeInterval(const NodePhylo* node) const { return m_foldedClades.GetInterval(node); }
+
+	/** Get number of rows taken by leaf nodes and folded clades. */
+	uint GetNumberOfRows() const;
+
 	/**
 	 * @brief Reroot a tree to the user selected branch.
 	 */
@@ -162,6 +232,30 @@ public:
 	 */
 	void RestoreTree();
 
+	/** Flag indicating if there is a change to the tree which can be undone. */
+	bool CanUndo() const { return m_numAppliedEdits > 0; }
+
+	/** Flag indicating if there is an undone change to the tree which can be redone. */
+	bool CanRedo() const { return m_numAppliedEdits < m_edits.size(); }
+
+	/** Get description of the change which would be undone, or an empty string. */
+	QString GetUndoText() const;
+
+	/** Get description of the change which would be redone, or an empty string. */
+	QString GetRedoText() const;
+
+	/**
+	 * @brief Undo the most recent change to the tree (e.g., rerooting, collapsing nodes or sorting subtrees).
+	 * @return False if there is nothing to undo.
+	 */
+	bool Undo();
+
+	/**
+	 * @brief Redo the most recently undone change to the tree.
+	 * @return False if there is nothing to redo.
+	 */
+	bool Redo();
+
 	/**
 	 * @brief Get current tree.
 	 */
@@ -187,6 +281,31 @@ public:
 	/** Get current branch style. */
 	BRANCH_STYLE GetBranchStyle() { return m_branchStyle; }
 
+	/**
+	 * @brief Set whether the tree is drawn in rows or about a centre. The branch style still sets
+	 *        the distance of nodes from the root.
+	 * @param layoutStyle Desired layout style.
+	 */
+	void SetLayoutStyle(LAYOUT_STYLE layoutStyle);
+
+	/** Get current layout style. */
+	LAYOUT_STYLE GetLayoutStyle() const { return m_layoutStyle; }
+
+	/** Set horizontal offset of a circular or radial tree wider than the viewport (in pixels). */
+	void SetHorizontalOffset(float offset) { m_horizontalOffset = offset; }
+
+	/** Get horizontal offset of a circular or radial tree (in pixels). */
+	float GetHorizontalOffset() const { return m_horizontalOffset; }
+
+	/** Get height of a node as a fraction of the tree height, for the current layout style. */
+	float GetNodeHeightFraction(const NodePhylo* node);
+
+	/** Get horizontal offset centring a node in the viewport, for the current layout style and zoom (in pixels). */
+	float GetNodeHorizontalOffset(const NodePhylo* node, float zoom);
+
+	/** Get zoom at which labels of adjacent leaves of a circular or radial tree no longer overlap. */
+	float GetPolarLabelZoom() const;
+
     /**
      * @brief Set the style of ordering the subrees on the y-axis
      * @param desired sorting style
@@ -199,9 +318,44 @@ public:
      */
     SUBTREE_SORT GetSubtreeSortStyle() { return m_subtreeSortStyle; }
 
+	/** Get key subtrees are ordered by. */
+	SubtreeSorter::SORT_KEY GetSubtreeSortKey() const { return m_subtreeSortKey; }
+
+	/** Get metadata field subtrees are ordered by when sorting by field. */
+	const QString& GetSubtreeSortField() const { return m_subtreeSortField; }
+
+	/**
+	 * @brief Sort subtrees and lay out the tree, recording the new order of children so it can be undone.
+	 * @param sortStyle Desired sorting style.
+	 * @param sortKey Key subtrees are ordered by.
+	 * @param sortField Metadata field subtrees are ordered by when sorting by field.
+	 */
+	void SortSubtrees(SUBTREE_SORT sortStyle, SubtreeSorter::SORT_KEY sortKey, const QString& sortField = QString());
+
 	/** Calculate bounding boxes for all leaf node labels. */
 	void LabelBoundingBoxes();
 
+	/** Get display labels of leaf nodes, rebuilding them if the label mode or metadata field has changed. */
+	const LabelCache& GetLabelCache() { m_labelCache.Update(m_tree); return m_labelCache; }
+
+	/** Get bounding boxes of leaf node labels calculated by LabelBoundingBoxes(). */
+	const std::map<utils::Node::NodeId, utils::BBox>& GetLabelBoundingBoxes() const { return m_bboxMap; }
+
+	/**
+	 * @brief Set bounding boxes of leaf node labels instead of calculating them (e.g., when read from a file).
+	 * @param bboxMap Bounding box of each leaf node label.
+	 * @param widestLabel Width of the widest label (in pixels).
+	 * @param highestLabel Height of the highest label (in pixels).
+	 */
+	void SetLabelBoundingBoxes(std::map<utils::Node::NodeId, utils::BBox> bboxMap, float widestLabel, float highestLabel)
+		{ m_bboxMap.swap(bboxMap); m_widestLabel = widestLabel; m_highestLabel = highestLabel; }
+
+	/**
+	 * @brief Add the memory used by the tree, its metadata, labels, layout and edit history to a report.
+	 * @param report Report to add to. Trees already counted by the report are not counted again.
+	 */
+	void ReportMemory(MemoryReport& report) const;
+
 	/** Get height of tree when labels just touch each other (in pixels). */
 	float GetTreeHeight() { return m_treeHeight; }
 
@@ -214,6 +368,12 @@ public:
 	/** Get height of the highest label (in pixels). */
 	float GetHighestLabel() { return m_highestLabel; }
 
+	/**
+	 * @brief Get label shown on a node for the current internal label field.
+	 * @param node Node to label.
+	 */
+	QString InternalLabel(NodePhylo* node);
+
 	/** Perform parsimony analysis. */
 	uint Parsimony();
 
@@ -224,14 +384,57 @@ public:
 	 */
 	bool MouseLeftDown(const utils::Point& mousePt);
 
+	/**
+	 * @brief Find the node, label, folded clade or branch drawn at a point by the most recent call to Render().
+	 * @param pt Point in viewport coordinates.
+	 */
+	HitTestIndex::Hit HitTest(const utils::Point& pt);
+
+	/**
+	 * @brief Highlight the node under the cursor.
+	 * @param pt Position of cursor in viewport coordinates.
+	 * @return True if a different node is now under the cursor.
+	 */
+	bool SetHoverPoint(const utils::Point& pt);
+
+	/**
+	 * @brief Remove highlight from the node under the cursor (e.g., when the cursor leaves the viewport).
+	 * @return True if a node was highlighted.
+	 */
+	bool ClearHover();
+
+	/** Get node under the cursor, or NULL. */
+	NodePhylo* GetHoverNode() const { return m_hoverNode; }
+
+	/** Get timing and element counts of the most recent call to Render(). */
+	const RenderStats& GetRenderStats() const { return m_renderStats; }
+
+protected:
+	/** Change to the tree in the history of changes. */
+	struct Edit
+	{
+		/** Nodes modified by the change. */
+		TreeEditPtr treeEdit;
+
+		/** Sorting of subtrees before and after the change. */
+		SUBTREE_SORT sortBefore, sortAfter;
+		SubtreeSorter::SORT_KEY sortKeyBefore, sortKeyAfter;
+		QString sortFieldBefore, sortFieldAfter;
+
+		/** Flag indicating if leaves were added to or removed from the tree. */
+		bool bLeavesChanged;
+	};
+
 protected:
 	/**
 	 * @brief Propogate colours assigned to leaf nodes up tree.
+	 * @param nodes Nodes of tree in pre-order.
+	 * @param parents Index of the parent of each node (-1 for the root).
 	 * @param bMixColour Flag indicating if the colour of a parent node should be a mixture of the
 	 *									 colours of its children or set to a default value if all children are not the
 	 *									 same colour.
 	 */
-	void PropagateLeafNodeColours(bool bMixColour);
+	void PropagateLeafNodeColours(const std::vector<NodePhylo*>& nodes, const std::vector<int>& parents, bool bMixColour);
 
 	/** Render tree. */
 	virtual void RenderTree(float translation, float zoom);
@@ -248,8 +451,45 @@ protected:
 	/** Render the active node (i.e., node under the cursor). */
 	virtual void RenderActiveNode(float translation, float zoom);
 
+	/** Render highlight of the node under the cursor and the branch leading to it. */
+	virtual void RenderHoverNode(float translation, float zoom);
+
+	/** Add the elements drawn by the most recent call to Render() to the hit test index. */
+	void BuildHitTestIndex();
+
+	/** Render tree about a centre with the current polar layout. Parameters are as for Render(). */
+	void RenderPolar(int width, int height, float translation, float zoom);
+
+	/** Capture the polar layout if the tree has been laid out or clades folded since it was last captured. */
+	void UpdatePolarLayout();
+
+	/** Get radius of a circular or radial tree at a zoom of 1, leaving room for labels around it (in pixels). */
+	float PolarRadius() const;
+
 	void LayoutY(NodePhylo* node, uint& yLeafPosition);
 
+	/** Set the x-position of the furthest leaf below each node, used to outline clades. */
+	void LayoutExtents();
+
+	/** Forget the active node and the elements drawn by the last call to Render(), e.g. before nodes are deleted. */
+	void ClearActiveNode();
+
+	/**
+	 * @brief Start recording a change to the tree. Nodes about to be modified must then be recorded by m_pendingEdit.
+	 * @param description Short description of the change.
+	 */
+	void BeginEdit(const QString& description);
+
+	/**
+	 * @brief Finish recording a change to the tree and add it to the history, discarding any undone changes.
+	 *        Must be called after the tree is laid out, as sorting subtrees may reorder children.
+	 * @param bLeavesChanged Flag indicating if leaves were added to or removed from the tree.
+	 */
+	void EndEdit(bool bLeavesChanged);
+
+	/** Lay out the tree after a change has been undone or redone. */
+	void EditApplied(const Edit& edit);
+
 protected:
 	/** Active geographic tree model. May be subject to modification (e.g., projection onto a set of leaf nodes). */
 	utils::Tree<NodePhylo>::Ptr m_tree;
@@ -257,6 +497,15 @@ protected:
 	/** Original tree model. */
 	utils::Tree<NodePhylo>::Ptr m_originalTree;
 
+	/** Changes to the tree which can be undone, followed by those which have been undone and can be redone. */
+	std::vector<Edit> m_edits;
+
+	/** Number of changes in the history which are applied to the tree. */
+	uint m_numAppliedEdits;
+
+	/** Change being recorded. Its tree edit is NULL unless a change is being made. */
+	Edit m_pendingEdit;
+
 	/** Object indicating metadata associated with tree. */
 	MetadataInfoPtr m_metadataInfo;
 
@@ -266,6 +515,21 @@ protected:
 	/** Current branch style of tree. */
 	BRANCH_STYLE m_branchStyle;
 
+	/** Current layout style of tree. */
+	LAYOUT_STYLE m_layoutStyle;
+
+	/** Layout of a circular or radial tree, or NULL for a rectangular tree. */
+	PolarLayoutPtr m_polarLayout;
+
+	/** Transformation of the polar layout in the most recent call to Render(). */
+	PolarLayout::View m_polarView;
+
+	/** Flag indicating if the tree has been laid out or clades folded since the polar layout was captured. */
+	bool m_bPolarLayoutChanged;
+
+	/** Horizontal offset of a circular or radial tree (in pixels). */
+	float m_horizontalOffset;
+
 	/** List of all branches within the viewport. */
 	std::vector<VisualBranch> m_visibleBranches;
 
@@ -275,6 +539,28 @@ protected:
 	/** List of all leaf nodes currently within the viewport. */
 	std::vector<NodePhylo*> m_visibleLeafNodes;
 
+	/** List of all folded clades currently within the viewport. */
+	std::vector<NodePhylo*> m_visibleFoldedNodes;
+
+	/** Clades drawn as triangles. */
+	FoldedClades m_foldedClades;
+
+	/** Bounding boxes of the labels of folded clades currently within the viewport, in viewport coordinates. */
+	std::vector<utils::BBox> m_visibleFoldedLabels;
+
+	/** Index of the elements drawn by the most recent call to Render(). Built when first needed. */
+	HitTestIndex m_hitTestIndex;
+
+	/** Translation and zoom of the most recent call to Render(). */
+	float m_renderTranslation;
+	float m_renderZoom;
+
+	/** Offset of leaf labels below their node in the most recent call to Render(). */
+	float m_labelBaseline;
+
+	/** Node under the cursor. */
+	NodePhylo* m_hoverNode;
+
 	/** Node currently under cursor. */
 	VisualNode m_activeNode;
 	
@@ -287,6 +573,9 @@ protected:
 	/** Bounding boxes for all leaf node labels. */
 	std::map<utils::Node::NodeId, utils::BBox> m_bboxMap;
 
+	/** Display label of each leaf node. */
+	LabelCache m_labelCache;
+
 	/** Width of the widest label (in pixels). */
 	float m_widestLabel;
 
@@ -307,6 +596,38 @@ protected:
 
     /** the way that subtrees should be sorted for rendering */
     SUBTREE_SORT m_subtreeSortStyle;
+
+	/** Key and metadata field subtrees are ordered by. */
+	SubtreeSorter::SORT_KEY m_subtreeSortKey;
+	QString m_subtreeSortField;
+
+	/** Key of each subtree, kept until the tree changes so it is only sorted again when the order changes. */
+	SubtreeSorter m_subtreeSorter;
+
+	/** Timing and element counts of the most recent call to Render(). */
+	RenderStats m_renderStats;
+
+	/** Most nodes to traverse while rendering the tree. Clades beyond this are drawn in outline. */
+	uint m_nodeBudget;
+
+	/** Node budget of the most recent progressive frame. */
+	uint m_progressiveBudget;
+
+	/** Estimated time to traverse and render a node (ns). */
+	double m_nodeCostNs;
+
+	/** Flag indicating if the most recent progressive frame was not drawn in full. */
+	bool m_bRefining;
+
+	/** Flag indicating if the tree has been laid out since the most recent progressive frame. */
+	bool m_bLayoutChanged;
+
+	/** View of the most recent progressive frame. */
+	int m_progressiveWidth;
+	int m_progressiveHeight;
+	float m_progressiveTranslation;
+	float m_progressiveZoom;
+	uint m_progressiveRows;
 };
 
 }
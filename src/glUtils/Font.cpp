@@ -73,9 +73,14 @@ void Font::SetTypeface(const QString& fontFile)
 }
 
 void Font::Render(const QString& text, uint x, uint y)
+{
+    Render(text.toLatin1().constData(), x, y);
+}
+
+void Font::Render(const char* text, uint x, uint y)
 {
 	glUtils::ErrorGL::Check();
-    m_font->Render(text.toLatin1().data(), -1, FTPoint(x, y), FTPoint(), FTGL::RENDER_FRONT);
+    m_font->Render(text, -1, FTPoint(x, y), FTPoint(), FTGL::RENDER_FRONT);
 	glUtils::ErrorGL::Check();
 }
 
@@ -86,9 +91,14 @@ void glUtils::Font::SetSize(uint size)
 }
 
 BBox Font::GetBoundingBox(const QString& text)
+{
+    return GetBoundingBox(text.toLatin1().constData());
+}
+
+BBox Font::GetBoundingBox(const char* text)
 { 
 	glUtils::ErrorGL::Check();
-    FTBBox bbox = m_font->BBox(text.toLatin1().data());
+    FTBBox bbox = m_font->BBox(text);
 	glUtils::ErrorGL::Check();
 
 	return BBox(bbox.Lower().Xf(), bbox.Lower().Yf(), 
@@ -45,6 +45,13 @@ public:
 	 */
     void Render(const QString& text, uint x, uint y);
 
+	/**
+	 * @brief Render Latin-1 encoded text to current GL canvas (e.g., labels encoded once by LabelCache).
+	 * @param text Text to render.
+	 * @param x,y Location to render bottom, left corner of text.
+	 */
+    void Render(const char* text, uint x, uint y);
+
 	/**
 	 * @brief Set size of font.
 	 * @param size Desired size of font.
@@ -77,6 +84,13 @@ public:
 	 */
     utils::BBox GetBoundingBox(const QString& text);
 
+	/**
+	 * @brief Get bounding box of Latin-1 encoded text.
+	 * @param text Text to determine bounding box of.
+	 * @return Bounding box.
+	 */
+    utils::BBox GetBoundingBox(const char* text);
+
 	/**
 	 * @brief Type of font (e.g., Times.ttf, Arial.ttf).
 	 * @return TrueType filename.
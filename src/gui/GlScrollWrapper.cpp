@@ -55,10 +55,26 @@ void GLScrollWrapper::mousePressEvent(QMouseEvent * event)
     glw->mousePressEvent(event);
 }
 
-void GLScrollWrapper::SetVerticalPosition(int position)
+void GLScrollWrapper::mouseMoveEvent(QMouseEvent * event)
 {
-    qDebug()<<__FILE__<<__LINE__<<__PRETTY_FUNCTION__<<position;
+    GLWidget * glw = dynamic_cast<GLWidget *>(viewport());
+    glw->mouseMoveEvent(event);
+}
+
+void GLScrollWrapper::mouseReleaseEvent(QMouseEvent * event)
+{
+    GLWidget * glw = dynamic_cast<GLWidget *>(viewport());
+    glw->mouseReleaseEvent(event);
+}
 
+void GLScrollWrapper::wheelEvent(QWheelEvent * event)
+{
+    GLWidget * glw = dynamic_cast<GLWidget *>(viewport());
+    glw->wheelEvent(event);
+}
+
+void GLScrollWrapper::SetVerticalPosition(int position)
+{
     verticalScrollBar()->setValue(position);
 }
 
@@ -27,6 +27,11 @@ protected:
     void resizeEvent(QResizeEvent *);
     void paintEvent(QPaintEvent *);
     void mousePressEvent(QMouseEvent *);
+    void mouseMoveEvent(QMouseEvent *);
+    void mouseReleaseEvent(QMouseEvent *);
+
+    /** The tree is scrolled and zoomed by the GLWidget rather than moving the scrollbar directly. */
+    void wheelEvent(QWheelEvent *);
 
 private:
 };
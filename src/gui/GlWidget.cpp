@@ -42,17 +42,34 @@
 #include "GlWidgetOverview.hpp"
 #include <QMouseEvent>
 #include <QOpenGLShaderProgram>
+#include <QApplication>
 #include <QCoreApplication>
 #include <math.h>
+#include <algorithm>
 #include <QtDebug>
 #include <QMenu>
+#include <QOpenGLTimerQuery>
+#include <QHelpEvent>
+#include <QToolTip>
+#include <QWheelEvent>
 
 #include "../utils/Point.hpp"
 #include "../core/State.hpp"
+#include "../core/ImageExporter.hpp"
+#include "../core/MetadataInfo.hpp"
+#include "../core/VectorExporter.hpp"
+#include "../glUtils/Font.hpp"
 
 using namespace utils;
 using namespace pygmy;
 
+const float GLWidget::ZOOM_STEP = 1.25f;
+const float GLWidget::ZOOM_TIME = 0.06f;
+const float GLWidget::FLING_TIME = 0.3f;
+const float GLWidget::MIN_FLING_SPEED = 20.0f;
+const float GLWidget::FLING_RELEASE_TIME = 0.05f;
+const float GLWidget::MAX_ANIMATION_STEP = 0.05f;
+
 GLWidget::GLWidget(QWidget *parent) : GLWidgetBase(parent)
 {
     m_core = QCoreApplication::arguments().contains(QStringLiteral("--coreprofile"));
@@ -67,10 +84,41 @@ GLWidget::GLWidget(QWidget *parent) : GLWidgetBase(parent)
     m_translateMin = 0.0f;
     m_translateMax = 0.0f;
     SetTranslation(0.0f);
+
+    // the node under the cursor is highlighted, even when no button is pressed
+    setMouseTracking(true);
+
+    m_frameCount = 0;
+    m_gpuTimerIndex = 0;
+    m_gpuTime = -1;
+    for(int i = 0; i < 2; ++i)
+    {
+        m_gpuTimers[i] = NULL;
+        m_gpuTimerPending[i] = false;
+    }
+
+    m_zoomTarget = 1.0f;
+    m_zoomAnchor = 0.0f;
+    m_bZoomAnimating = false;
+    m_flingVelocity = 0.0f;
+    m_dragVelocity = 0.0f;
+    m_bSyncingScrollBar = false;
+
+    // the next frame is requested once the previous one has been swapped to the screen,
+    // so animation is paced by the refresh of the display rather than a free running timer
+    connect(this, SIGNAL(frameSwapped()), this, SLOT(frameSwappedAnimate()));
 }
 
 GLWidget::~GLWidget()
-{}
+{
+    StopRenderTrace();
+
+    // timer queries must be destroyed while their context is current
+    makeCurrent();
+    for(int i = 0; i < 2; ++i)
+        delete m_gpuTimers[i];
+    doneCurrent();
+}
 
 QSize GLWidget::minimumSizeHint() const
 {
@@ -130,6 +178,20 @@ void GLWidget::initializeGL()
     glViewport(0, 0, (GLint) QOpenGLWidget::size().width(), (GLint) QOpenGLWidget::size().height());
     glLoadIdentity();
 
+    // GPU timer queries are used for render statistics when supported by the context
+    m_gpuTime = -1;
+    for(int i = 0; i < 2; ++i)
+    {
+        delete m_gpuTimers[i];
+        m_gpuTimers[i] = new QOpenGLTimerQuery();
+        m_gpuTimerPending[i] = false;
+        if(!m_gpuTimers[i]->create())
+        {
+            delete m_gpuTimers[i];
+            m_gpuTimers[i] = NULL;
+        }
+    }
+
     glUtils::ErrorGL::Check();
 
 }
@@ -140,17 +202,28 @@ void GLWidget::paintGL()
 {
     //qDebug() <<__FILE__<<" "<<__LINE__<<" "<<__PRETTY_FUNCTION__;
 
+    QElapsedTimer paintTimer;
+    paintTimer.start();
+
+    // GPU timing is only performed when the statistics are being used
+    bool bProfileGpu = State::Inst().GetShowRenderStats() || IsRecordingRenderTrace();
+
     glUtils::ErrorGL::Check();
 
+    if(bProfileGpu)
+        BeginGpuTimer();
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     /*if(m_visualColourMap)
         m_visualColourMap->Render(m_width, size().height());*/
 
+    m_renderStats = RenderStats();
     if(m_visualTree)
     {
-        m_visualTree->Render(QOpenGLWidget::size().width(), QOpenGLWidget::size().height(), GetTranslation(), GetZoom());
-
+        // large trees are drawn coarsely while navigating and refined once the view settles
+        m_visualTree->RenderProgressive(QOpenGLWidget::size().width(), QOpenGLWidget::size().height(), GetTranslation(), GetZoom());
+        m_renderStats = m_visualTree->GetRenderStats();
 
         emit TranslationFractionChanged(TranslationFraction());
         emit ViewportHeightFraction(m_visualTree->GetViewportHeightFraction());
@@ -158,10 +231,315 @@ void GLWidget::paintGL()
 
     }
 
+    if(bProfileGpu)
+        EndGpuTimer();
+
+    m_renderStats.frame = m_frameCount++;
+    m_renderStats.gpuNs = bProfileGpu ? m_gpuTime : -1;
+    if(m_frameTimer.isValid())
+        m_renderStats.frameIntervalNs = m_frameTimer.nsecsElapsed();
+    m_frameTimer.start();
+
+    // time spent drawing the overlay itself is not included in the paint time
+    m_renderStats.paintNs = paintTimer.nsecsElapsed();
+    if(State::Inst().GetShowRenderStats())
+        RenderStatsOverlay();
+
+    if(IsRecordingRenderTrace())
+        m_renderTrace << m_renderStats.ToCsv() << "\n";
+
     glUtils::ErrorGL::Check();
 
 }
 
+void GLWidget::frameSwappedAnimate()
+{
+    bool bAnimating = AdvanceAnimation();
+
+    // input is handled before the next frame, so scrolling interrupts refinement
+    if(bAnimating || (m_visualTree && m_visualTree->IsRefining()))
+        update();
+}
+
+bool GLWidget::AdvanceAnimation()
+{
+    if(!IsAnimating())
+        return false;
+
+    if(!m_visualTree)
+    {
+        StopAnimation();
+        return false;
+    }
+
+    float dt = std::min(m_animationTimer.nsecsElapsed()*1e-9f, MAX_ANIMATION_STEP);
+    m_animationTimer.restart();
+
+    // the scrollbar follows the view, without its integer positions being applied back to the view
+    m_bSyncingScrollBar = true;
+
+    if(m_bZoomAnimating)
+    {
+        // zoom is interpolated geometrically so zooming in and out appear equally fast
+        float zoom = m_zoomTarget * pow(GetZoom() / m_zoomTarget, exp(-dt / ZOOM_TIME));
+        if(fabs(zoom / m_zoomTarget - 1.0f) < 1e-3f)
+        {
+            zoom = m_zoomTarget;
+            m_bZoomAnimating = false;
+        }
+
+        SetZoom(zoom, m_zoomAnchor);
+    }
+
+    if(m_flingVelocity != 0.0f)
+    {
+        // move by the integral of the exponentially decaying speed over the frame
+        float decay = exp(-dt / FLING_TIME);
+        float previousTranslation = GetTranslation();
+        SetTranslation(previousTranslation + m_flingVelocity*FLING_TIME*(1.0f - decay));
+        m_flingVelocity *= decay;
+
+        // a fling also stops at the top or bottom of the tree
+        if(fabs(m_flingVelocity) < MIN_FLING_SPEED || GetTranslation() == previousTranslation)
+            m_flingVelocity = 0.0f;
+    }
+
+    emit TranslationChanged(static_cast<int>(m_translateMax - GetTranslation()));
+    m_bSyncingScrollBar = false;
+
+    return IsAnimating();
+}
+
+void GLWidget::AnimateZoom(float steps, float anchor)
+{
+    if(!m_visualTree)
+        return;
+
+    if(!IsAnimating())
+        m_animationTimer.start();
+
+    // steps taken before the previous ones have finished accumulate
+    float zoom = m_bZoomAnimating ? m_zoomTarget : GetZoom();
+    zoom *= pow(ZOOM_STEP, steps);
+    if(zoom > m_zoomMax)
+        zoom = m_zoomMax;
+    else if(zoom < m_zoomMin)
+        zoom = m_zoomMin;
+
+    m_zoomTarget = zoom;
+    m_zoomAnchor = anchor;
+    m_bZoomAnimating = zoom != GetZoom();
+
+    update();
+}
+
+void GLWidget::ScrollBy(float pixels)
+{
+    if(!m_visualTree)
+        return;
+
+    m_flingVelocity = 0.0f;
+
+    m_bSyncingScrollBar = true;
+    SetTranslation(GetTranslation() + pixels);
+    emit TranslationChanged(static_cast<int>(m_translateMax - GetTranslation()));
+    m_bSyncingScrollBar = false;
+
+    update();
+}
+
+void GLWidget::FlingBy(float pixels)
+{
+    if(!m_visualTree)
+        return;
+
+    if(!IsAnimating())
+        m_animationTimer.start();
+
+    // a fling of speed v travels v*FLING_TIME before stopping, so further flings in the
+    // same direction add to its distance while flinging the other way reverses it
+    float velocity = pixels / FLING_TIME;
+    if(velocity * m_flingVelocity > 0.0f)
+        m_flingVelocity += velocity;
+    else
+        m_flingVelocity = velocity;
+
+    update();
+}
+
+void GLWidget::StopAnimation()
+{
+    m_bZoomAnimating = false;
+    m_flingVelocity = 0.0f;
+}
+
+void GLWidget::BeginGpuTimer()
+{
+    if(!m_gpuTimers[0] || !m_gpuTimers[1])
+        return;
+
+    // read back the query issued for the previous frame if it has completed
+    int previous = 1 - m_gpuTimerIndex;
+    if(m_gpuTimerPending[previous] && m_gpuTimers[previous]->isResultAvailable())
+    {
+        m_gpuTime = m_gpuTimers[previous]->waitForResult();
+        m_gpuTimerPending[previous] = false;
+    }
+
+    // the query for this frame may still be outstanding from two frames ago
+    if(m_gpuTimerPending[m_gpuTimerIndex])
+    {
+        m_gpuTime = m_gpuTimers[m_gpuTimerIndex]->waitForResult();
+        m_gpuTimerPending[m_gpuTimerIndex] = false;
+    }
+
+    m_gpuTimers[m_gpuTimerIndex]->begin();
+}
+
+void GLWidget::EndGpuTimer()
+{
+    if(!m_gpuTimers[0] || !m_gpuTimers[1])
+        return;
+
+    m_gpuTimers[m_gpuTimerIndex]->end();
+    m_gpuTimerPending[m_gpuTimerIndex] = true;
+    m_gpuTimerIndex = 1 - m_gpuTimerIndex;
+}
+
+void GLWidget::RenderStatsOverlay()
+{
+    glUtils::ErrorGL::Check();
+
+    const RenderStats& stats = m_renderStats;
+    double intervalMs = stats.frameIntervalNs * 1e-6;
+
+    QStringList lines;
+    lines << QString("Frame: %1 ms (%2 fps)").arg(intervalMs, 0, 'f', 1).arg(intervalMs > 0 ? 1000.0 / intervalMs : 0.0, 0, 'f', 1);
+    lines << QString("Paint: %1 ms").arg(stats.paintNs * 1e-6, 0, 'f', 2);
+    lines << QString("GPU: %1").arg(stats.gpuNs < 0 ? QString("n/a") : QString::number(stats.gpuNs * 1e-6, 'f', 2) + " ms");
+    lines << QString("Tree: %1 ms").arg(stats.treeNs * 1e-6, 0, 'f', 2);
+    lines << QString("Text search: %1 ms").arg(stats.textSearchNs * 1e-6, 0, 'f', 2);
+    lines << QString("Leaf labels: %1 ms").arg(stats.leafLabelsNs * 1e-6, 0, 'f', 2);
+    lines << QString("Internal labels: %1 ms").arg(stats.internalLabelsNs * 1e-6, 0, 'f', 2);
+    lines << QString("Branches: %1  Nodes: %2").arg(stats.visibleBranches).arg(stats.visibleNodes);
+    lines << QString("Labels: %1 leaf, %2 internal").arg(stats.leafLabels).arg(stats.internalLabels);
+    lines << QString("Traversed: %1  Deferred: %2").arg(stats.traversedNodes).arg(stats.deferredNodes);
+
+    // the font size is shared with the tree so it is restored once the overlay is drawn
+    glUtils::FontPtr font = State::Inst().GetFont();
+    uint fontSize = font->GetSize();
+    font->SetSize(11);
+
+    float width = 0;
+    for(const QString& line : lines)
+    {
+        BBox bbox = font->GetBoundingBox(line);
+        if(bbox.Width() > width)
+            width = bbox.Width();
+    }
+
+    const int margin = 8;
+    const int lineHeight = 14;
+    int left = margin;
+    int top = QOpenGLWidget::size().height() - margin;
+    int bottom = top - lines.size()*lineHeight - margin;
+
+    glColor4f(1.0f, 1.0f, 1.0f, 0.85f);
+    glBegin(GL_QUADS);
+        glVertex2f(left, bottom);
+        glVertex2f(left + width + 2*margin, bottom);
+        glVertex2f(left + width + 2*margin, top);
+        glVertex2f(left, top);
+    glEnd();
+
+    glColor3f(0.15f, 0.15f, 0.15f);
+    for(int i = 0; i < lines.size(); ++i)
+        font->Render(lines.at(i), left + margin, top - (i+1)*lineHeight);
+
+    font->SetSize(fontSize);
+
+    glUtils::ErrorGL::Check();
+}
+
+void GLWidget::setShowRenderStats(bool state)
+{
+    State::Inst().SetShowRenderStats(state);
+    update();
+}
+
+bool GLWidget::StartRenderTrace(const QString& filename)
+{
+    StopRenderTrace();
+
+    QSharedPointer<QFile> file(new QFile(filename));
+    if(!file->open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+
+    m_renderTraceFile = file;
+    m_renderTrace.setDevice(m_renderTraceFile.data());
+    m_renderTrace << RenderStats::CsvHeader() << "\n";
+
+    update();
+    return true;
+}
+
+void GLWidget::StopRenderTrace()
+{
+    if(!m_renderTraceFile)
+        return;
+
+    m_renderTrace.flush();
+    m_renderTrace.setDevice(NULL);
+    m_renderTraceFile->close();
+    m_renderTraceFile.reset();
+}
+
+bool GLWidget::ExportImage(const QString& filename, bool bSelectedClade, QString& error)
+{
+    if(!m_visualTree)
+    {
+        error = tr("No tree has been loaded.");
+        return false;
+    }
+
+    NodePhylo* clade = NULL;
+    if(bSelectedClade)
+    {
+        clade = m_visualTree->GetActiveNode()->node;
+        if(!clade || !clade->IsSelected())
+        {
+            error = tr("No clade has been selected.");
+            return false;
+        }
+    }
+
+    bool bSuccess;
+    makeCurrent();
+    if(VectorExporter::FormatFromFilename(filename) != VectorExporter::UNKNOWN_FORMAT)
+    {
+        VectorExporter exporter(m_visualTree);
+        bSuccess = exporter.Export(filename, QOpenGLWidget::size().width(), GetZoom(), clade);
+        error = exporter.GetError();
+    }
+    else if(clade)
+    {
+        bSuccess = false;
+        error = tr("Clades can only be exported as SVG or PDF files.");
+    }
+    else
+    {
+        ImageExporter exporter(m_visualTree);
+        bSuccess = exporter.Export(filename, QOpenGLWidget::size().width(), GetZoom());
+        error = exporter.GetError();
+    }
+    doneCurrent();
+
+    // exporting renders the tree with different viewport dimensions
+    update();
+
+    return bSuccess;
+}
+
 void GLWidget::resizeEvent(QResizeEvent *e)
 {
     QOpenGLWidget::resizeEvent(e);
@@ -205,6 +583,12 @@ void GLWidget::mousePressEvent(QMouseEvent *event)
 {
     qDebug() << __FILE__ << __LINE__ << event;
     m_lastMousePos = event->pos();
+
+    // pressing a button catches the tree if it is being flung
+    StopAnimation();
+    m_dragVelocity = 0.0f;
+    m_dragTimer.start();
+
     // do nothing if the tree has yet to be set
     if(m_visualTree == NULL) {
         return;
@@ -225,6 +609,142 @@ void GLWidget::mousePressEvent(QMouseEvent *event)
     }
 }
 
+void GLWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    if(m_visualTree == NULL)
+        return;
+
+    if(event->buttons() == Qt::LeftButton)
+    {
+        // the tree follows the cursor, with its speed smoothed over the last few movements
+        float dy = event->y() - m_lastMousePos.y();
+        float dt = m_dragTimer.nsecsElapsed()*1e-9f;
+        m_dragTimer.restart();
+        if(dt > 0.0f)
+            m_dragVelocity = 0.5f*m_dragVelocity + 0.5f*dy/dt;
+
+        // circular and radial trees wider than the viewport are also dragged sideways
+        if(m_visualTree->GetLayoutStyle() != VisualTree::RECTANGULAR_LAYOUT)
+            m_visualTree->SetHorizontalOffset(m_visualTree->GetHorizontalOffset() + event->x() - m_lastMousePos.x());
+
+        m_lastMousePos = event->pos();
+        ScrollBy(dy);
+        return;
+    }
+
+    if(event->buttons() != Qt::NoButton)
+        return;
+
+    // the tree is only redrawn when a different node is under the cursor
+    if(m_visualTree->SetHoverPoint(utils::Point(event->x(), size().height() - event->y())))
+        update();
+}
+
+void GLWidget::mouseReleaseEvent(QMouseEvent *event)
+{
+    if(m_visualTree == NULL || event->button() != Qt::LeftButton || !m_dragTimer.isValid())
+        return;
+
+    // a drag which came to rest before the button was released does not fling
+    if(m_dragTimer.nsecsElapsed()*1e-9f < FLING_RELEASE_TIME && fabs(m_dragVelocity) > MIN_FLING_SPEED)
+        FlingBy(m_dragVelocity*FLING_TIME);
+
+    m_dragTimer.invalidate();
+}
+
+void GLWidget::wheelEvent(QWheelEvent *event)
+{
+    // wheels report steps of 1/8 degree, with a typical step of the wheel being 15 degrees
+    float steps = event->angleDelta().y() / 120.0f;
+
+    if(event->modifiers() & Qt::ControlModifier)
+    {
+        AnimateZoom(steps, size().height() - event->pos().y());
+    }
+    else if(!event->pixelDelta().isNull())
+    {
+        // touchpads report smooth scrolling of their own, which is followed directly
+        ScrollBy(event->pixelDelta().y());
+    }
+    else if(m_visualTree != NULL)
+    {
+        // each step flings the tree as far as the scrollbar would move for it
+        FlingBy(steps * QApplication::wheelScrollLines() * m_visualTree->GetHighestLabel());
+    }
+
+    event->accept();
+}
+
+void GLWidget::leaveEvent(QEvent *)
+{
+    if(m_visualTree != NULL && m_visualTree->ClearHover())
+        update();
+}
+
+bool GLWidget::event(QEvent *event)
+{
+    if(event->type() != QEvent::ToolTip)
+        return GLWidgetBase::event(event);
+
+    QHelpEvent * helpEvent = static_cast<QHelpEvent *>(event);
+    NodePhylo * node = NULL;
+    if(m_visualTree != NULL)
+        node = m_visualTree->HitTest(utils::Point(helpEvent->x(), size().height() - helpEvent->y())).node;
+
+    if(node)
+        QToolTip::showText(helpEvent->globalPos(), NodeToolTip(node), this);
+    else
+        QToolTip::hideText();
+
+    return true;
+}
+
+QString GLWidget::NodeToolTip(NodePhylo* node) const
+{
+    QStringList lines;
+    const FoldedClades& foldedClades = m_visualTree->GetFoldedClades();
+    if(foldedClades.IsFolded(node))
+        lines << foldedClades.GetFoldedLabel(node);
+    else if(!node->GetName().isEmpty())
+        lines << node->GetName();
+
+    if(!node->IsLeaf())
+    {
+        // leaves below a node are consecutive in the unfolded layout
+        uint numLeaves = m_visualTree->GetTree()->GetNumberOfLeaves();
+        Interval interval = node->GetInterval();
+        uint first = uint(interval.start * numLeaves + 0.5f);
+        uint last = uint(interval.end * numLeaves + 0.5f);
+        lines << tr("Leaves: %1").arg(last - first + 1);
+    }
+
+    if(node->GetDistanceToParent() != Node::NO_DISTANCE)
+        lines << tr("Branch length: %1").arg(node->GetDistanceToParent());
+
+    if(!node->IsLeaf() && node->GetBootstrapToParent() != Node::NO_DISTANCE)
+        lines << tr("Support: %1").arg(node->GetBootstrapToParent());
+
+    // the tooltip is kept to a reasonable size for trees with many annotations
+    const int maxFields = 20;
+    int numFields = 0;
+    std::map<QString, QString> metadata = node->GetMetadata();
+    for(std::map<QString, QString>::const_iterator it = metadata.begin(); it != metadata.end(); ++it)
+    {
+        if(MetadataInfo::IsMissingData(it->second))
+            continue;
+
+        if(++numFields > maxFields)
+        {
+            lines << tr("...");
+            break;
+        }
+
+        lines << it->first + ": " + it->second;
+    }
+
+    return lines.join("\n");
+}
+
 void GLWidget::ShowContextMenu(const QPoint& pos) // this is a slot
 {
     // for most widgets
@@ -235,13 +755,28 @@ void GLWidget::ShowContextMenu(const QPoint& pos) // this is a slot
     QMenu myMenu;
     QAction * rerootAct = myMenu.addAction(tr("&Reroot"));
 
+    // the clicked clade can be folded into a triangle, or unfolded if it already is
+    NodePhylo* activeNode = m_visualTree->GetActiveNode()->node;
+    QAction * foldAct = NULL;
+    if(activeNode && activeNode->IsSelected() && !activeNode->IsLeaf())
+    {
+        bool bFolded = m_visualTree->GetFoldedClades().IsFolded(activeNode);
+        foldAct = myMenu.addAction(bFolded ? tr("&Expand Clade") : tr("&Collapse Clade"));
+    }
+
     QAction* selectedItem = myMenu.exec(globalPos);
     if (selectedItem == rerootAct)
     {
         m_visualTree->Reroot();
         emit ShouldRedrawOverviewTree();
+        emit EditHistoryChanged();
         update();
     }
+    else if (selectedItem && selectedItem == foldAct)
+    {
+        m_visualTree->ToggleFold(activeNode);
+        TreeHeightChanged();
+    }
     else
     {
         // nothing was chosen
@@ -250,11 +785,18 @@ void GLWidget::ShowContextMenu(const QPoint& pos) // this is a slot
 
 void GLWidget::setTree(utils::Tree<pygmy::NodePhylo>::Ptr tree)
 {
-    m_visualTree.reset(new pygmy::VisualTree(tree));
-    m_visualTree->Layout();
+    VisualTreePtr visualTree(new pygmy::VisualTree(tree));
+    visualTree->Layout();
 
     // calculate bounding boxes for all leaf node labels
-    m_visualTree->LabelBoundingBoxes();
+    visualTree->LabelBoundingBoxes();
+
+    setVisualTree(visualTree);
+}
+
+void GLWidget::setVisualTree(VisualTreePtr visualTree)
+{
+    m_visualTree = visualTree;
     m_visualTree->CalculateTreeDimensions(QOpenGLWidget::size().width(), QOpenGLWidget::size().height(), GetZoom());
     // set min/max values for zoom
     SetDefaultZoom();
@@ -281,6 +823,7 @@ void GLWidget::setTree(utils::Tree<pygmy::NodePhylo>::Ptr tree)
 
     emit TranslationChanged(static_cast<int>(GetTranslation()));
     emit LargestLabelHeight(static_cast<int>(m_visualTree->GetHighestLabel()));
+    emit EditHistoryChanged();
     // Rebuild any display lists and render the scene
     QOpenGLWidget::update();
 }
@@ -289,13 +832,28 @@ void GLWidget::sortSubtrees(pygmy::VisualTree::SUBTREE_SORT sortStyle)
 {
     if(m_visualTree->GetSubtreeSortStyle() != sortStyle)
     {
-        m_visualTree->SetSubtreeSortStyle(sortStyle);
-        m_visualTree->Layout();
+        m_visualTree->SortSubtrees(sortStyle, m_visualTree->GetSubtreeSortKey(), m_visualTree->GetSubtreeSortField());
         emit ShouldRedrawOverviewTree();
+        emit EditHistoryChanged();
         update();
     }
 }
 
+void GLWidget::sortSubtreesBy(pygmy::SubtreeSorter::SORT_KEY sortKey, const QString& sortField)
+{
+    if(!m_visualTree)
+        return;
+
+    pygmy::VisualTree::SUBTREE_SORT sortStyle = m_visualTree->GetSubtreeSortStyle();
+    if(sortStyle == pygmy::VisualTree::UNSORTED)
+        sortStyle = pygmy::VisualTree::ASCENDING;
+
+    m_visualTree->SortSubtrees(sortStyle, sortKey, sortField);
+    emit ShouldRedrawOverviewTree();
+    emit EditHistoryChanged();
+    update();
+}
+
 void GLWidget::changeTreeBranchStyle(pygmy::VisualTree::BRANCH_STYLE branchStyle)
 {
     if(m_visualTree->GetBranchStyle() != branchStyle)
@@ -307,6 +865,98 @@ void GLWidget::changeTreeBranchStyle(pygmy::VisualTree::BRANCH_STYLE branchStyle
     }
 }
 
+void GLWidget::changeTreeLayoutStyle(pygmy::VisualTree::LAYOUT_STYLE layoutStyle)
+{
+    if(!m_visualTree || m_visualTree->GetLayoutStyle() == layoutStyle)
+        return;
+
+    StopAnimation();
+    m_visualTree->SetLayoutStyle(layoutStyle);
+
+    // the height of the tree depends on its layout, so it is shown in full again
+    m_visualTree->CalculateTreeDimensions(QOpenGLWidget::size().width(), QOpenGLWidget::size().height(), GetZoom());
+    ZoomExtents();
+    SetDefaultZoom();
+    TranslationExtents();
+
+    emit TranslationChanged(static_cast<int>(m_translateMax - GetTranslation()));
+    update();
+}
+
+uint GLWidget::foldByField(const QString& field)
+{
+    if(!m_visualTree)
+        return 0;
+
+    uint numFolded = m_visualTree->FoldByField(field);
+    TreeHeightChanged();
+
+    return numFolded;
+}
+
+void GLWidget::unfoldAll()
+{
+    if(!m_visualTree)
+        return;
+
+    m_visualTree->UnfoldAll();
+    TreeHeightChanged();
+}
+
+void GLWidget::projectTree(std::vector<QString>& names)
+{
+    if(!m_visualTree)
+        return;
+
+    m_visualTree->ProjectTree(names);
+
+    // the widest label may have been removed
+    m_visualTree->LabelBoundingBoxes();
+    TreeHeightChanged();
+    emit EditHistoryChanged();
+}
+
+void GLWidget::restoreTree()
+{
+    if(!m_visualTree)
+        return;
+
+    m_visualTree->RestoreTree();
+
+    // nodes of the restored tree are new, so their labels have not been measured
+    m_visualTree->LabelBoundingBoxes();
+    TreeHeightChanged();
+    emit EditHistoryChanged();
+}
+
+void GLWidget::undo()
+{
+    if(!m_visualTree || !m_visualTree->Undo())
+        return;
+
+    TreeHeightChanged();
+    emit EditHistoryChanged();
+}
+
+void GLWidget::redo()
+{
+    if(!m_visualTree || !m_visualTree->Redo())
+        return;
+
+    TreeHeightChanged();
+    emit EditHistoryChanged();
+}
+
+void GLWidget::TreeHeightChanged()
+{
+    m_visualTree->CalculateTreeDimensions(QOpenGLWidget::size().width(), QOpenGLWidget::size().height(), GetZoom());
+    ZoomExtents();
+    TranslationExtents();
+
+    emit ShouldRedrawOverviewTree();
+    update();
+}
+
 void GLWidget::SetTranslation(float translation)
 {
 
@@ -325,6 +975,12 @@ void GLWidget::SetTranslation(float translation)
 
 void GLWidget::translate(int position)
 {
+    // positions the scrollbar reports while following the view are already applied
+    if(m_bSyncingScrollBar)
+        return;
+
+    // moving the scrollbar stops the tree if it is being flung
+    m_flingVelocity = 0.0f;
     SetTranslation(m_translateMax - position);
     update();
 }
@@ -346,6 +1002,12 @@ void GLWidget::ScaleView(int dx, int dy)
 }
 
 void GLWidget::SetZoom(float zoom)
+{
+    // the middle line of the viewport does not move during zooming
+    SetZoom(zoom, QOpenGLWidget::size().height()*0.5f);
+}
+
+void GLWidget::SetZoom(float zoom, float anchor)
 {
     //qDebug() << __FILE__ << ":"<<__LINE__<<" "<<m_zoom<<" "<<m_translate << " "<<zoom << " "<<m_zoomMin << " "<<m_zoomMax;
 
@@ -359,8 +1021,12 @@ void GLWidget::SetZoom(float zoom)
     m_zoom = zoom;
     ZoomChanged();
 
-    // modify translation so the middle line does not move during zooming
-    SetTranslation(previousTranslation + (previousTranslation+QOpenGLWidget::size().height()*0.5)*(GetZoom()-previousZoom)/previousZoom);
+    // modify translation so the anchor line does not move during zooming
+    SetTranslation(previousTranslation + (previousTranslation+anchor)*(GetZoom()-previousZoom)/previousZoom);
+
+    // circular and radial trees are zoomed about the middle of the viewport horizontally
+    if(m_visualTree)
+        m_visualTree->SetHorizontalOffset(m_visualTree->GetHorizontalOffset()*GetZoom()/previousZoom);
 
     //qDebug() << __FILE__ << " "<<__LINE__<<" "<<m_zoom<<" "<<m_translate << " "<<zoom << " "<<m_zoomMin << " "<<m_zoomMax;
     //QOpenGLWidget::update();
@@ -370,6 +1036,14 @@ void GLWidget::SetDefaultZoom()
 {
     // reset zooming factor to default value
     float targetZoom;
+    if(m_visualTree->GetLayoutStyle() != VisualTree::RECTANGULAR_LAYOUT)
+    {
+        // circular and radial trees are shown in full, as far as their labels remain within the viewport
+        targetZoom = (QOpenGLWidget::size().height()-2*State::Inst().GetBorderSize().y)/m_visualTree->GetTreeHeight();
+        SetZoom(std::min(targetZoom, 1.0f));
+        return;
+    }
+
     //qDebug() <<__FILE__<<" "<<__LINE__<<" "<< size().height() << " "<< State::Inst().GetBorderSize().y <<" "<< m_visualTree->GetTreeHeight();
     if((QOpenGLWidget::size().height()-2*State::Inst().GetBorderSize().y) > m_visualTree->GetTreeHeight())
         targetZoom = (QOpenGLWidget::size().height()-2*State::Inst().GetBorderSize().y)/m_visualTree->GetTreeHeight();
@@ -416,6 +1090,15 @@ void GLWidget::ZoomExtents()
             m_zoomMax = (QOpenGLWidget::size().height()-2*State::Inst().GetBorderSize().y)/m_visualTree->GetTreeHeight();
         }
 
+        if(m_visualTree->GetLayoutStyle() != VisualTree::RECTANGULAR_LAYOUT)
+        {
+            // a circular or radial tree may be shrunk to fit the viewport, and is enlarged until
+            // its leaf labels are spaced as far apart as in a rectangular tree at the maximum zoom
+            float fitZoom = (QOpenGLWidget::size().height()-2*State::Inst().GetBorderSize().y)/m_visualTree->GetTreeHeight();
+            m_zoomMin = std::max(std::min(1.0f, fitZoom), 0.01f);
+            m_zoomMax = std::max(m_visualTree->GetPolarLabelZoom()*State::Inst().GetZoomMax(), m_zoomMin);
+        }
+
         // make sure zoom factor is within allowable range
         //SetZoom(m_zoom);
 
@@ -476,7 +1159,9 @@ void GLWidget::CenterNode(uint id)
         }
     }
 
-    float posY = node->GetPosition().y * m_visualTree->GetTreeHeight() * GetZoom() + State::Inst().GetBorderSize().y;
+    // leaves within a folded clade are drawn as part of the clade
+    const NodePhylo* shownNode = m_visualTree->GetFoldedClades().GetShownNode(node);
+    float posY = m_visualTree->GetNodeHeightFraction(shownNode) * m_visualTree->GetTreeHeight() * GetZoom() + State::Inst().GetBorderSize().y;
     float translatedY = posY-GetTranslation();
 
     if(translatedY < 0 || translatedY > QOpenGLWidget::size().height())
@@ -486,6 +1171,13 @@ void GLWidget::CenterNode(uint id)
         //SetTranslation(posY-0.5*QOpenGLWidget::size().height());
     }
 
+    // circular and radial trees wider than the viewport are also moved sideways
+    if(m_visualTree->GetLayoutStyle() != VisualTree::RECTANGULAR_LAYOUT)
+    {
+        m_visualTree->SetHorizontalOffset(m_visualTree->GetNodeHorizontalOffset(shownNode, GetZoom()));
+        update();
+    }
+
     //update();
 }
 
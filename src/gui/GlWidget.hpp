@@ -43,10 +43,17 @@
 
 #include "GlWidgetBase.hpp"
 #include "GlWidgetOverview.hpp"
+#include "../core/RenderStats.hpp"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSharedPointer>
+#include <QTextStream>
 
 using namespace pygmy;
 
 QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
+QT_FORWARD_DECLARE_CLASS(QOpenGLTimerQuery)
 
 class GLScrollWrapper;
 
@@ -66,9 +73,13 @@ signals:
     void LargestLabelHeight(int height);
     void ShouldRedrawOverviewTree();
 
+    /** Emitted when a change to the tree is made, undone or redone, or a new tree is shown. */
+    void EditHistoryChanged();
+
 
 public slots:
     void setTree(utils::Tree<pygmy::NodePhylo>::Ptr tree);
+    void setVisualTree(VisualTreePtr visualTree);
 
     void translate(int position);
     void sortSubtreesAscending()
@@ -81,6 +92,21 @@ public slots:
         sortSubtrees(pygmy::VisualTree::DESCENDING);
     }
 
+    void sortSubtreesByHeight()
+    {
+        sortSubtreesBy(pygmy::SubtreeSorter::SORT_BY_HEIGHT);
+    }
+
+    void sortSubtreesByLeaves()
+    {
+        sortSubtreesBy(pygmy::SubtreeSorter::SORT_BY_LEAVES);
+    }
+
+    void sortSubtreesByName()
+    {
+        sortSubtreesBy(pygmy::SubtreeSorter::SORT_BY_NAME);
+    }
+
     void setPhylogramBranchStyle()
     {
         changeTreeBranchStyle(pygmy::VisualTree::PHYLOGRAM_BRANCHES);
@@ -91,10 +117,26 @@ public slots:
         changeTreeBranchStyle(pygmy::VisualTree::CLADOGRAM_BRANCHES);
     }
 
+    void setRectangularLayout()
+    {
+        changeTreeLayoutStyle(pygmy::VisualTree::RECTANGULAR_LAYOUT);
+    }
+
+    void setCircularLayout()
+    {
+        changeTreeLayoutStyle(pygmy::VisualTree::CIRCULAR_LAYOUT);
+    }
+
+    void setRadialLayout()
+    {
+        changeTreeLayoutStyle(pygmy::VisualTree::RADIAL_LAYOUT);
+    }
+
     void midpointRoot()
     {
         m_visualTree->MidpointRoot();
         emit ShouldRedrawOverviewTree();
+        emit EditHistoryChanged();
         update();
     }
 
@@ -103,10 +145,76 @@ public slots:
         m_visualTree->LabelBoundingBoxes();
     }
 
+    /** Colour nodes by the value of a metadata field (see VisualTree::ColourNodes). */
+    void colourNodes(const QString& field, const std::map<QString, utils::Colour>& colours)
+    {
+        m_visualTree->ColourNodes(field, colours);
+        emit ShouldRedrawOverviewTree();
+        update();
+    }
+
+    /** Colour leaf nodes by a metadata field and propagate colours up the tree (see VisualTree::PropagateColours). */
+    void colourByField(const QString& field, utils::ColourMapPtr colourMap)
+    {
+        m_visualTree->PropagateColours(field, colourMap);
+        emit ShouldRedrawOverviewTree();
+        update();
+    }
+
+    /** Fold every largest clade whose leaves share a value for a metadata field (see VisualTree::FoldByField). */
+    uint foldByField(const QString& field);
+
+    /** Order subtrees by a key in the current direction, or ascending if they are unsorted (see VisualTree::SortSubtrees). */
+    void sortSubtreesBy(pygmy::SubtreeSorter::SORT_KEY sortKey, const QString& sortField = QString());
+
+    /** Unfold all clades. */
+    void unfoldAll();
+
+    /**
+     * @brief Project tree onto a set of leaves (see VisualTree::ProjectTree).
+     * @param names Names of leaves. Contains the names not found in the tree on return.
+     */
+    void projectTree(std::vector<QString>& names);
+
+    /** Restore the tree as it was read, undoing any projection or rerooting. */
+    void restoreTree();
+
+    /** Undo the most recent change to the tree (see VisualTree::Undo). */
+    void undo();
+
+    /** Redo the most recently undone change to the tree (see VisualTree::Redo). */
+    void redo();
+
     /** Indicate that the font size or style has been modified and that any values
             dependent on the font should be recalculated. */
     void ModifiedFont();
 
+    /** Show or hide the render statistics overlay. */
+    void setShowRenderStats(bool state);
+
+protected slots:
+    /** Advance any animation once the previous frame is on screen and request the next frame. */
+    void frameSwappedAnimate();
+
+public:
+    /** Factor the zoom changes by with each step of the mouse wheel. */
+    static const float ZOOM_STEP;
+
+    /** Time for an animated zoom to cover all but 1/e of the remaining distance to its target (s). */
+    static const float ZOOM_TIME;
+
+    /** Time for the speed of a fling to decay by a factor of e (s). */
+    static const float FLING_TIME;
+
+    /** Speed below which a fling stops (pixels/s). */
+    static const float MIN_FLING_SPEED;
+
+    /** Longest time between the last movement of a drag and releasing the button for the drag to fling (s). */
+    static const float FLING_RELEASE_TIME;
+
+    /** Longest time an animation is advanced by in a single frame (s), so a slow frame does not cause a jump. */
+    static const float MAX_ANIMATION_STEP;
+
 public:
     GLWidget(QWidget *parent = 0);
     ~GLWidget();
@@ -118,8 +226,35 @@ public:
     void ScaleView(int dx, int dy);
 
     void SetZoom(float zoom);
+
+    /**
+     * @brief Set zoom, keeping a line of the viewport fixed.
+     * @param zoom Desired zoom. Clamped to the allowed range.
+     * @param anchor Height of line in viewport (from the bottom) which does not move.
+     */
+    void SetZoom(float zoom, float anchor);
+
     void SetTranslation(float translation);
 
+    /**
+     * @brief Zoom smoothly over the following frames.
+     * @param steps Number of zoom steps, positive to zoom in and negative to zoom out.
+     * @param anchor Height of line in viewport (from the bottom) which does not move.
+     */
+    void AnimateZoom(float steps, float anchor);
+
+    /** Scroll immediately by a number of pixels, positive to scroll up. Stops any fling. */
+    void ScrollBy(float pixels);
+
+    /** Scroll smoothly, coasting to a stop after moving approximately a number of pixels (positive to scroll up). */
+    void FlingBy(float pixels);
+
+    /** Stop any animated zoom or fling where it is. */
+    void StopAnimation();
+
+    /** Flag indicating if the zoom or translation is being animated. */
+    bool IsAnimating() const { return m_bZoomAnimating || m_flingVelocity != 0.0f; }
+
     void SetDefaultZoom();
 
     void TranslateViewWheel(int dWheel);
@@ -149,6 +284,31 @@ public:
         m_overview.reset(overview);
     }
 
+    /**
+     * @brief Write render statistics of every frame to a CSV file.
+     * @param filename File to write trace to. Any existing file is overwritten.
+     * @return True if the trace file could be opened, else false.
+     */
+    bool StartRenderTrace(const QString& filename);
+
+    /** Stop writing render statistics to the trace file. */
+    void StopRenderTrace();
+
+    /** Check if render statistics are being written to a trace file. */
+    bool IsRecordingRenderTrace() const { return !m_renderTraceFile.isNull(); }
+
+    /** Get render statistics of the most recently painted frame. */
+    const RenderStats& GetRenderStats() const { return m_renderStats; }
+
+    /**
+     * @brief Render the tree to an image at the current zoom level and viewport width.
+     * @param filename Image file (.png, .tif, .tiff, .svg or .pdf).
+     * @param bSelectedClade Export only the selected clade. Only supported for SVG and PDF files.
+     * @param error Set to a description of the problem if the image could not be written.
+     * @return True if the image was written successfully, else false.
+     */
+    bool ExportImage(const QString& filename, bool bSelectedClade, QString& error);
+
 protected:
     /** Sets up the OpenGL resources and state.
       * Gets called once before the first time resizeGL() or paintGL() is called.
@@ -167,6 +327,22 @@ protected:
     void resizeGL(int width, int height) Q_DECL_OVERRIDE;
     void resizeEvent(QResizeEvent *e);
     void mousePressEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
+
+    /** Highlight the node under the cursor, or scroll the tree while the left button is held. */
+    void mouseMoveEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
+
+    /** Fling the tree if it was being dragged when the left button was released. */
+    void mouseReleaseEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
+
+    /** Fling the tree, or zoom about the cursor while Ctrl is held. */
+    void wheelEvent(QWheelEvent *event) Q_DECL_OVERRIDE;
+    void leaveEvent(QEvent *event) Q_DECL_OVERRIDE;
+
+    /** Show the metadata of the node under the cursor as a tooltip. */
+    bool event(QEvent *event) Q_DECL_OVERRIDE;
+
+    /** Text of tooltip describing a node. */
+    QString NodeToolTip(NodePhylo* node) const;
     void ShowContextMenu(const QPoint& pos);
 
     void ZoomChanged();
@@ -175,6 +351,27 @@ protected:
     void sortSubtrees(pygmy::VisualTree::SUBTREE_SORT sortStyle);
     void changeTreeBranchStyle(pygmy::VisualTree::BRANCH_STYLE branchStyle);
 
+    /** Draw the tree in rows or about a centre, showing it in full. */
+    void changeTreeLayoutStyle(pygmy::VisualTree::LAYOUT_STYLE layoutStyle);
+
+    /** Update the viewport after the height of the tree has changed (e.g., clades folded or leaves removed). */
+    void TreeHeightChanged();
+
+    /** Start GPU timer query for the current frame and collect the result of the previous frame. */
+    void BeginGpuTimer();
+
+    /** End GPU timer query for the current frame. */
+    void EndGpuTimer();
+
+    /** Render statistics of the current frame in the top, left corner of the viewport. */
+    void RenderStatsOverlay();
+
+    /**
+     * @brief Advance the animated zoom and fling by the time since the previous frame.
+     * @return True if the animation has not finished.
+     */
+    bool AdvanceAnimation();
+
 
 protected:
 
@@ -187,6 +384,57 @@ protected:
     /** previous position of the mouse. */
     QPoint m_lastMousePos;
 
+    /** Render statistics of the most recently painted frame. */
+    RenderStats m_renderStats;
+
+    /** Number of frames painted. */
+    quint64 m_frameCount;
+
+    /** Time since the previous frame was painted. */
+    QElapsedTimer m_frameTimer;
+
+    /** GPU timer queries. Two queries are alternated so results can be read back without stalling. */
+    QOpenGLTimerQuery* m_gpuTimers[2];
+
+    /** Flag indicating if a GPU timer query has been issued but its result not yet read. */
+    bool m_gpuTimerPending[2];
+
+    /** Index of GPU timer query to use for the current frame. */
+    int m_gpuTimerIndex;
+
+    /** Most recent GPU time (ns), or -1 if GPU timer queries are unsupported. */
+    qint64 m_gpuTime;
+
+    /** File render statistics are traced to. */
+    QSharedPointer<QFile> m_renderTraceFile;
+
+    /** Stream render statistics are traced to. */
+    QTextStream m_renderTrace;
+
+    /** Zoom an animated zoom is moving towards. */
+    float m_zoomTarget;
+
+    /** Height of line in viewport (from the bottom) which does not move during the animated zoom. */
+    float m_zoomAnchor;
+
+    /** Flag indicating if the zoom is being animated. */
+    bool m_bZoomAnimating;
+
+    /** Speed of fling (pixels/s), positive when scrolling up, or 0 if the tree is not being flung. */
+    float m_flingVelocity;
+
+    /** Time since the animation was last advanced. */
+    QElapsedTimer m_animationTimer;
+
+    /** Speed the tree is being dragged at (pixels/s). */
+    float m_dragVelocity;
+
+    /** Time since the tree was last moved by dragging. */
+    QElapsedTimer m_dragTimer;
+
+    /** Flag indicating if the scrollbar is being moved to follow the view, so its changes are not applied to the view. */
+    bool m_bSyncingScrollBar;
+
 private:
 
     bool m_core;
@@ -8,9 +8,12 @@
 //=======================================================================
 
 #include "GlWidgetOverview.hpp"
+#include "../core/MemoryReport.hpp"
 #include "../core/State.hpp"
 #include <QDebug>
 #include <QMouseEvent>
+#include <QOpenGLTexture>
+#include <QtConcurrent>
 
 
 using namespace pygmy;
@@ -19,16 +22,25 @@ using namespace utils;
 //*** Member Functions***
 
 GLWidgetOverview::GLWidgetOverview(QWidget * parent)
-    : GLWidgetBase(parent), m_borderX(5), m_borderY(5)
+    : GLWidgetBase(parent), m_borderX(5), m_borderY(5), m_bRasterPending(false), m_bTreeImageChanged(false), m_treeTexture(NULL), m_textSearchQuads(0)
 {
     m_zoomMin = 1.0f;
     m_zoomMax = 1.0f;
     m_translateMin = 0.0f;
     m_translateMax = 0.0f;
+
+    m_rasterWatcher = new QFutureWatcher<QImage>(this);
+    connect(m_rasterWatcher, SIGNAL(finished()), this, SLOT(TreeRasterized()));
 }
 
 GLWidgetOverview::~GLWidgetOverview()
 {
+    m_rasterWatcher->waitForFinished();
+
+    // textures must be destroyed while their context is current
+    makeCurrent();
+    delete m_treeTexture;
+    doneCurrent();
 }
 
 void GLWidgetOverview::initializeGL()
@@ -71,9 +83,13 @@ void GLWidgetOverview::initializeGL()
     glLoadIdentity();
 
     glUtils::ErrorGL::Check();
-    m_treeList = glGenLists(1);
     m_textSearchList = glGenLists(1);
 
+    // the texture is recreated from the rasterized tree whenever the context is
+    delete m_treeTexture;
+    m_treeTexture = NULL;
+    m_bTreeImageChanged = true;
+
 }
 
 void GLWidgetOverview::SetTree(VisualTreePtr visualTree)
@@ -151,99 +167,52 @@ void GLWidgetOverview::Redraw()
 
 void GLWidgetOverview::RedrawTree()
 {
-	glUtils::ErrorGL::Check();
-
 	if(!m_visualTree)
 		return;
 
-	// *** Draw the tree. ***
-	glNewList(m_treeList, GL_COMPILE);
-	{
-		glDisable(GL_LINE_SMOOTH);
+	// the tree is captured so it can be rasterized while being modified
+	OverviewRasterPtr overviewRaster(new OverviewRaster());
+	overviewRaster->Capture(m_visualTree);
+	m_overviewRaster = overviewRaster;
 
-		glLineWidth(State::Inst().GetOverviewLineWidth());
-        int thicknessMajor = static_cast<int>(1 + State::Inst().GetOverviewLineWidth()*0.5);
-        int thicknessMinor = static_cast<int>((State::Inst().GetOverviewLineWidth()-0.5)*0.5);
+	RasterizeTree();
+}
 
-		// scale factor for tree (Note: glScalef() is not used as we want lines to be pixel aligned)
-        float sx = size().width() - 2*m_borderX;
-        float sy = size().height() - 2*m_borderY;
+void GLWidgetOverview::RasterizeTree()
+{
+	if(!m_overviewRaster)
+		return;
 
-		// translation factor for tree (Note: glTranslatef() is not used as we want lines to be pixel aligned)
-		float dx = m_borderX + 0.5;
-		float dy = m_borderY + 0.5;
-		
-		// *** Draw overview tree
-		std::vector<NodePhylo*> nodes = m_visualTree->GetTree()->GetNodes();
-        for(NodePhylo* node : nodes)
-		{			
-			// adjust position of nodes based on desired orientation
-			Point parentPos = node->GetPosition();
-
-			// Draw branches
-			float yMin = 1000.0f, yMax = 0.0f;
-			std::vector<NodePhylo*> children = node->GetChildren();
-            for(NodePhylo* child : children)
-			{				
-				Point childPos = child->GetPosition();
-				
-				// draw horizontal line
-				glBegin(GL_QUADS);
-					if(State::Inst().GetColourOverviewTree())
-						node->GetColour().SetColourGL();
-					else
-						glColor3f(0.5f, 0.5f, 0.5f);
-					glVertex2i(int(parentPos.x*sx + dx), int(childPos.y*sy + dy + thicknessMajor));
-					glVertex2i(int(parentPos.x*sx + dx), int(childPos.y*sy + dy - thicknessMinor));
-
-					if(State::Inst().GetColourOverviewTree())
-							child->GetColour().SetColourGL();
-						else
-							glColor3f(0.5f, 0.5f, 0.5f);
-					glVertex2i(int(childPos.x*sx + dx), int(childPos.y*sy + dy - thicknessMinor));
-					glVertex2i(int(childPos.x*sx + dx), int(childPos.y*sy + dy + thicknessMajor));						
-				glEnd();
-
-				if(yMin > childPos.y) 
-					yMin = childPos.y;
-
-				if(yMax < childPos.y) 
-					yMax = childPos.y;
-			}
+	if(m_rasterWatcher->isRunning())
+	{
+		m_bRasterPending = true;
+		return;
+	}
 
-			// It is better to draw a single vertical line as this reduces the number of line segments
-			// that must be rendered and ensures that only a single crisp line is drawn (as opposed to multiple
-			// overlapping lines which can cause strange visual artifacts).
-			if(!node->IsLeaf())
-			{
-				if(State::Inst().GetColourOverviewTree())
-					node->GetColour().SetColourGL();
-				else
-					glColor3f(0.5f, 0.5f, 0.5f);
-
-				// Draw vertical line adjusting for the width of the line being drawn. For some reason, the offset
-				// needed to account for the line width is different for the start and end of the line (???).
-				glBegin(GL_QUADS); 
-					glVertex2i(int(parentPos.x*sx + dx + thicknessMajor), int(parentPos.y*sy + dy - thicknessMinor));
-					glVertex2i(int(parentPos.x*sx + dx - thicknessMinor), int(parentPos.y*sy + dy - thicknessMinor));
-					glVertex2i(int(parentPos.x*sx + dx - thicknessMinor), int(yMax*sy + dy + thicknessMajor));
-					glVertex2i(int(parentPos.x*sx + dx + thicknessMajor), int(yMax*sy + dy + thicknessMajor));
-				glEnd();
-
-				glBegin(GL_QUADS); 
-					glVertex2i(int(parentPos.x*sx + dx + thicknessMajor), int(yMin*sy + dy - thicknessMinor));
-					glVertex2i(int(parentPos.x*sx + dx - thicknessMinor), int(yMin*sy + dy - thicknessMinor));
-					glVertex2i(int(parentPos.x*sx + dx - thicknessMinor), int(parentPos.y*sy + dy + thicknessMajor));
-					glVertex2i(int(parentPos.x*sx + dx + thicknessMajor), int(parentPos.y*sy + dy + thicknessMajor));
-				glEnd();
-			}
-		}		
+	OverviewRaster::Settings settings;
+	settings.width = size().width();
+	settings.height = size().height();
+	settings.borderX = m_borderX;
+	settings.borderY = m_borderY;
+	settings.lineWidth = State::Inst().GetOverviewLineWidth();
+	settings.bColour = State::Inst().GetColourOverviewTree();
 
-		glEnable(GL_LINE_SMOOTH);
+	OverviewRasterPtr overviewRaster = m_overviewRaster;
+	m_rasterWatcher->setFuture(QtConcurrent::run([overviewRaster, settings]() { return overviewRaster->Rasterize(settings); }));
+}
+
+void GLWidgetOverview::TreeRasterized()
+{
+	m_treeImage = m_rasterWatcher->result();
+	m_bTreeImageChanged = true;
+
+	if(m_bRasterPending)
+	{
+		m_bRasterPending = false;
+		RasterizeTree();
 	}
-  glEndList();
 
-	glUtils::ErrorGL::Check();
+	update();
 }
 
 void GLWidgetOverview::RedrawTextSearch()
@@ -253,6 +222,7 @@ void GLWidgetOverview::RedrawTextSearch()
 	if(!m_visualTree)
 		return;
 
+	m_textSearchQuads = 0;
 	glNewList(m_textSearchList, GL_COMPILE);
 	{
         float adjHeight = size().height() - 2*m_borderY;
@@ -262,7 +232,9 @@ void GLWidgetOverview::RedrawTextSearch()
 		{
 			if(m_searchFilter->Filtered(node->GetId()))
 			{
-				Point parentPos = node->GetPosition();
+				// nodes within a folded clade are marked at the clade
+				const NodePhylo* shownNode = m_visualTree->GetFoldedClades().GetShownNode(node);
+				Point parentPos = m_visualTree->GetNodePosition(shownNode);
 
 				glColor3f(0.9f, 0.1f, 0.14f);
 
@@ -273,6 +245,7 @@ void GLWidgetOverview::RedrawTextSearch()
                     glVertex2f(size().width(), yPos + 2);
                     glVertex2f(size().width() - m_borderX, yPos + 2);
 				glEnd();		
+				m_textSearchQuads++;
 			
 			}
 		}
@@ -282,6 +255,20 @@ void GLWidgetOverview::RedrawTextSearch()
 	glUtils::ErrorGL::Check();
 }
 
+void GLWidgetOverview::ReportMemory(MemoryReport& report) const
+{
+	if(m_treeTexture)
+		report.Add(MemoryReport::GPU_BUFFERS, quint64(m_treeTexture->width())*m_treeTexture->height()*4);
+
+	// drivers store display lists in their own format, so only the vertices and colour of each quad are counted
+	report.Add(MemoryReport::GPU_BUFFERS, quint64(m_textSearchQuads)*(4*2 + 3)*sizeof(float));
+
+	// the rasterized image is kept so the texture can be recreated with the context
+	report.Add(MemoryReport::LAYOUT, MemoryReport::Allocation(m_treeImage.byteCount()));
+	if(m_overviewRaster)
+		m_overviewRaster->ReportMemory(report);
+}
+
 void GLWidgetOverview::paintGL()
 {
 	const float MIN_POS_INDICATOR_HEIGHT = 5.0f;
@@ -295,15 +282,38 @@ void GLWidgetOverview::paintGL()
 	{		
         //qDebug() <<__FILE__<<__LINE__<<__PRETTY_FUNCTION__;
 
-        //RedrawTree();
-        //RedrawTextSearch();
+        // *** Upload rasterized tree. ***
+		if(m_bTreeImageChanged)
+		{
+			delete m_treeTexture;
+			m_treeTexture = NULL;
+			m_bTreeImageChanged = false;
 
-        // *** Render overview tree. ***
-		glPushMatrix();	
-		{			
-			glCallList(m_treeList);
+			if(!m_treeImage.isNull())
+			{
+				m_treeTexture = new QOpenGLTexture(m_treeImage, QOpenGLTexture::DontGenerateMipMaps);
+				m_treeTexture->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
+			}
+		}
+
+        // *** Render overview tree as a single textured quad. ***
+		if(m_treeTexture)
+		{
+			glEnable(GL_TEXTURE_2D);
+			m_treeTexture->bind();
+			glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+
+			// the first scan line of the image is the top of the panel
+			glBegin(GL_QUADS);
+				glTexCoord2f(0.0f, 1.0f); glVertex2f(0.0f, 0.0f);
+				glTexCoord2f(1.0f, 1.0f); glVertex2f(size().width(), 0.0f);
+				glTexCoord2f(1.0f, 0.0f); glVertex2f(size().width(), size().height());
+				glTexCoord2f(0.0f, 0.0f); glVertex2f(0.0f, size().height());
+			glEnd();
+
+			m_treeTexture->release();
+			glDisable(GL_TEXTURE_2D);
 		}
-		glPopMatrix();
 
 		// *** Highlight text search results
 		glPushMatrix();		
@@ -374,6 +384,8 @@ void GLWidgetOverview::resizeGL(int w, int h)
         m_previousSize.setWidth(w);
         m_previousSize.setHeight(h);
 
+        // the captured tree is rasterized again at the new size
+        RasterizeTree();
     }
 
     glUtils::ErrorGL::Check();
@@ -11,13 +11,20 @@
 #define _OVERVIEW_TREE_H_
 
 #include "../core/NodePhylo.hpp"
+#include "../core/OverviewRaster.hpp"
 
+#include <QFutureWatcher>
+#include <QImage>
 
 #include "GlWidgetBase.hpp"
 
+QT_FORWARD_DECLARE_CLASS(QOpenGLTexture)
+
 namespace pygmy
 {
 
+class MemoryReport;
+
 /**
  * @brief Overview tree.
  */
@@ -40,7 +47,7 @@ public slots:
 
     void Redraw();
    /**
-    * @brief Reconstruct tree display lists.
+    * @brief Capture the tree and rasterize it into the overview texture on a worker thread.
     */
    void RedrawTree();
 
@@ -49,6 +56,10 @@ public slots:
     */
    void RedrawTextSearch();
 
+protected slots:
+    /** Upload the rasterized tree once the worker thread has finished. */
+    void TreeRasterized();
+
 public:
 	/** Constructor. */
     GLWidgetOverview(QWidget * parent);
@@ -79,6 +90,9 @@ public:
 	 */
 	virtual VisualTreePtr GetTree() { return m_visualTree; }
 
+	/** Add the memory used by the overview texture, text search display list and captured tree to a report. */
+	void ReportMemory(MemoryReport& report) const;
+
     virtual void SetSearchFilter(pygmy::FilterPtr filter);
 
 
@@ -130,6 +144,12 @@ protected:
 	 */
     void LeftClick(const utils::Point& mousePt);
 
+    /**
+     * @brief Rasterize the captured tree at the current size of the panel. If the tree is
+     *        already being rasterized, it is rasterized again once the worker thread has finished.
+     */
+    void RasterizeTree();
+
 protected:
 	/** Fraction of tree's height below the translation. */
 	float m_translationFrac;
@@ -140,12 +160,30 @@ protected:
 	/** Border around overview map. */
 	uint m_borderX, m_borderY;
 
-	/** Display list used to render tree. */
-	uint m_treeList;
+	/** Tree captured for rasterizing. */
+	OverviewRasterPtr m_overviewRaster;
+
+	/** Watcher of the worker thread rasterizing the tree. */
+	QFutureWatcher<QImage>* m_rasterWatcher;
+
+	/** Flag indicating if the tree must be rasterized again once the worker thread has finished. */
+	bool m_bRasterPending;
+
+	/** Most recently rasterized tree. */
+	QImage m_treeImage;
+
+	/** Flag indicating if the rasterized tree has yet to be uploaded to the texture. */
+	bool m_bTreeImageChanged;
+
+	/** Texture used to render tree. */
+	QOpenGLTexture* m_treeTexture;
 
 	/** Display list used to render results of text search. */
 	uint m_textSearchList;
 
+	/** Number of quads compiled into the text search display list. */
+	uint m_textSearchQuads;
+
 
 
 
@@ -39,12 +39,21 @@
 ****************************************************************************/
 
 #include "MainWindow.hpp"
-#include "../core/NewickIO.hpp"
 #include "../core/NodePhylo.hpp"
 #include "../utils/Tree.hpp"
 #include "../core/VisualTree.hpp"
 #include "../core/State.hpp"
 #include "../core/MetadataIO.hpp"
+#include "../core/SnapshotIO.hpp"
+#include "../core/TreeReader.hpp"
+#include "../core/TreeCollection.hpp"
+#include "../core/CladeFrequencies.hpp"
+#include "../core/ConsensusTree.hpp"
+#include "../core/TreeComparison.hpp"
+#include "../core/MemoryReport.hpp"
+#include "TanglegramWidget.hpp"
+#include "../utils/ColourMap.hpp"
+#include "../utils/ColourMapManager.hpp"
 
 
 #include <QMenuBar>
@@ -57,6 +66,16 @@
 #include <QScrollBar>
 #include <QPushButton>
 #include <QKeySequence>
+#include <QApplication>
+#include <QInputDialog>
+#include <QStatusBar>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTableWidget>
+#include <QVBoxLayout>
+#include <QtConcurrent>
 
 void MainWindow::createMenus()
 {
@@ -64,6 +83,7 @@ void MainWindow::createMenus()
     QMenu *menuFile = menuBar->addMenu(tr("&File"));
     QMenu *menuEdit = menuBar->addMenu(tr("&Edit"));
     QMenu *menuTree = menuBar->addMenu(tr("&Tree"));
+    QMenu *menuView = menuBar->addMenu(tr("&View"));
     QMenu *helpMenu = new QMenu(tr("&Help"), this);
     QToolBar * treeToolBar = addToolBar(tr("Tree"));
 
@@ -79,7 +99,35 @@ void MainWindow::createMenus()
     menuFile->addAction(openAnnotationsAct);
     connect(openAnnotationsAct, SIGNAL(triggered()), this, SLOT(openAnnotationsFile()));
 
+    QAction *saveSnapshotAct = new QAction(menuFile);
+    saveSnapshotAct->setText(tr("Save Snapshot..."));
+    menuFile->addAction(saveSnapshotAct);
+    connect(saveSnapshotAct, SIGNAL(triggered()), this, SLOT(saveSnapshot()));
+
+    menuFile->addSeparator();
+    QAction *exportImageAct = new QAction(menuFile);
+    exportImageAct->setText(tr("Export Image..."));
+    menuFile->addAction(exportImageAct);
+    connect(exportImageAct, SIGNAL(triggered()), this, SLOT(exportImage()));
+
+    QAction *exportCladeAct = new QAction(menuFile);
+    exportCladeAct->setText(tr("Export Selected Clade..."));
+    menuFile->addAction(exportCladeAct);
+    connect(exportCladeAct, SIGNAL(triggered()), this, SLOT(exportSelectedClade()));
+
     //menuEdit actions
+    m_undoAct = new QAction(tr("&Undo"), menuEdit);
+    m_undoAct->setShortcuts(QKeySequence::Undo);
+    menuEdit->addAction(m_undoAct);
+    connect(m_undoAct, SIGNAL(triggered()), m_glTreeWidget, SLOT(undo()));
+
+    m_redoAct = new QAction(tr("&Redo"), menuEdit);
+    m_redoAct->setShortcuts(QKeySequence::Redo);
+    menuEdit->addAction(m_redoAct);
+    connect(m_redoAct, SIGNAL(triggered()), m_glTreeWidget, SLOT(redo()));
+    connect(m_glTreeWidget, &GLWidget::EditHistoryChanged, this, &MainWindow::updateUndoActions);
+
+    menuEdit->addSeparator();
     QAction * findAct = new QAction(tr("&Find"), menuEdit);
     findAct->setShortcuts(QKeySequence::Find);
     menuEdit->addAction(findAct);
@@ -98,12 +146,39 @@ void MainWindow::createMenus()
     treeToolBar->addAction(sortDescendingAct);
     connect(sortDescendingAct, SIGNAL(triggered()), m_glTreeWidget, SLOT(sortSubtreesDescending()));
 
+    QMenu * sortByMenu = menuTree->addMenu(tr("Sort Subtrees &By"));
+    QAction * sortByHeightAct = sortByMenu->addAction(tr("&Height"));
+    connect(sortByHeightAct, SIGNAL(triggered()), m_glTreeWidget, SLOT(sortSubtreesByHeight()));
+    QAction * sortByLeavesAct = sortByMenu->addAction(tr("Number of &Leaves"));
+    connect(sortByLeavesAct, SIGNAL(triggered()), m_glTreeWidget, SLOT(sortSubtreesByLeaves()));
+    QAction * sortByNameAct = sortByMenu->addAction(tr("&Name"));
+    connect(sortByNameAct, SIGNAL(triggered()), m_glTreeWidget, SLOT(sortSubtreesByName()));
+    QAction * sortByFieldAct = sortByMenu->addAction(tr("&Field..."));
+    connect(sortByFieldAct, SIGNAL(triggered()), this, SLOT(sortSubtreesByField()));
+
     QAction * midpointRootAct = new QAction(tr("&Midpoint Root"), menuTree);
     midpointRootAct->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_M));
     menuTree->addAction(midpointRootAct);
     treeToolBar->addAction(midpointRootAct);
     connect(midpointRootAct, SIGNAL(triggered()), m_glTreeWidget, SLOT(midpointRoot()));
 
+    QAction * foldByFieldAct = new QAction(tr("C&ollapse Clades by Field..."), menuTree);
+    menuTree->addAction(foldByFieldAct);
+    connect(foldByFieldAct, SIGNAL(triggered()), this, SLOT(foldCladesByField()));
+
+    QAction * unfoldAllAct = new QAction(tr("E&xpand All Clades"), menuTree);
+    menuTree->addAction(unfoldAllAct);
+    connect(unfoldAllAct, SIGNAL(triggered()), m_glTreeWidget, SLOT(unfoldAll()));
+
+    QAction * projectAct = new QAction(tr("Pro&ject onto Leaves..."), menuTree);
+    projectAct->setStatusTip(tr("Remove all leaves not listed in a file"));
+    menuTree->addAction(projectAct);
+    connect(projectAct, SIGNAL(triggered()), this, SLOT(projectOntoLeaves()));
+
+    QAction * restoreTreeAct = new QAction(tr("Res&tore Original Tree"), menuTree);
+    menuTree->addAction(restoreTreeAct);
+    connect(restoreTreeAct, SIGNAL(triggered()), this, SLOT(restoreTree()));
+
     const QIcon phylogramBranchesIcon = QIcon("://resources/images/phylogram.xpm");
     QAction * phylogramBranchesAct = new QAction(phylogramBranchesIcon, tr("&Phylogram"), menuTree);
     menuTree->addAction(phylogramBranchesAct);
@@ -116,6 +191,70 @@ void MainWindow::createMenus()
     treeToolBar->addAction(cladogramBranchesAct);
     connect(cladogramBranchesAct, SIGNAL(triggered()), m_glTreeWidget, SLOT(setCladogramBranchStyle()));
 
+    menuTree->addSeparator();
+    QAction * rectangularLayoutAct = new QAction(tr("&Rectangular Layout"), menuTree);
+    menuTree->addAction(rectangularLayoutAct);
+    connect(rectangularLayoutAct, SIGNAL(triggered()), m_glTreeWidget, SLOT(setRectangularLayout()));
+
+    QAction * circularLayoutAct = new QAction(tr("Circ&ular Layout"), menuTree);
+    menuTree->addAction(circularLayoutAct);
+    connect(circularLayoutAct, SIGNAL(triggered()), m_glTreeWidget, SLOT(setCircularLayout()));
+
+    QAction * radialLayoutAct = new QAction(tr("Ra&dial Layout"), menuTree);
+    radialLayoutAct->setStatusTip(tr("Draw the tree unrooted, with each clade given an angle in proportion to its number of leaves"));
+    menuTree->addAction(radialLayoutAct);
+    connect(radialLayoutAct, SIGNAL(triggered()), m_glTreeWidget, SLOT(setRadialLayout()));
+
+    menuTree->addSeparator();
+    m_previousTreeAct = new QAction(tr("&Previous Tree"), menuTree);
+    m_previousTreeAct->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_PageUp));
+    menuTree->addAction(m_previousTreeAct);
+    connect(m_previousTreeAct, SIGNAL(triggered()), this, SLOT(previousTree()));
+
+    m_nextTreeAct = new QAction(tr("&Next Tree"), menuTree);
+    m_nextTreeAct->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_PageDown));
+    menuTree->addAction(m_nextTreeAct);
+    connect(m_nextTreeAct, SIGNAL(triggered()), this, SLOT(nextTree()));
+
+    m_goToTreeAct = new QAction(tr("&Go to Tree..."), menuTree);
+    m_goToTreeAct->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_G));
+    menuTree->addAction(m_goToTreeAct);
+    connect(m_goToTreeAct, SIGNAL(triggered()), this, SLOT(goToTree()));
+
+    m_cladeFrequenciesAct = new QAction(tr("Calculate Clade &Frequencies"), menuTree);
+    menuTree->addAction(m_cladeFrequenciesAct);
+    connect(m_cladeFrequenciesAct, SIGNAL(triggered()), this, SLOT(calculateCladeFrequencies()));
+
+    m_consensusAct = new QAction(tr("&Majority-Rule Consensus"), menuTree);
+    menuTree->addAction(m_consensusAct);
+    connect(m_consensusAct, SIGNAL(triggered()), this, SLOT(buildConsensus()));
+
+    m_extendedConsensusAct = new QAction(tr("&Extended Majority-Rule Consensus"), menuTree);
+    menuTree->addAction(m_extendedConsensusAct);
+    connect(m_extendedConsensusAct, SIGNAL(triggered()), this, SLOT(buildExtendedConsensus()));
+
+    menuTree->addSeparator();
+    QAction * compareAct = new QAction(tr("&Compare with Tree..."), menuTree);
+    menuTree->addAction(compareAct);
+    connect(compareAct, SIGNAL(triggered()), this, SLOT(compareWithTree()));
+
+    menuTree->addSeparator();
+    QAction * aboutTreeAct = new QAction(tr("&About this Tree..."), menuTree);
+    menuTree->addAction(aboutTreeAct);
+    connect(aboutTreeAct, SIGNAL(triggered()), this, SLOT(aboutTree()));
+
+    //menuView actions
+    m_showRenderStatsAct = new QAction(tr("Show &Render Statistics"), menuView);
+    m_showRenderStatsAct->setCheckable(true);
+    m_showRenderStatsAct->setShortcut(QKeySequence(Qt::Key_F12));
+    menuView->addAction(m_showRenderStatsAct);
+    connect(m_showRenderStatsAct, SIGNAL(toggled(bool)), m_glTreeWidget, SLOT(setShowRenderStats(bool)));
+
+    m_recordRenderTraceAct = new QAction(tr("Record Render &Trace..."), menuView);
+    m_recordRenderTraceAct->setCheckable(true);
+    menuView->addAction(m_recordRenderTraceAct);
+    connect(m_recordRenderTraceAct, SIGNAL(toggled(bool)), this, SLOT(recordRenderTrace(bool)));
+
     //menuHelp actions
     QAction *aboutAction = helpMenu->addAction(tr("&About"));
     connect(aboutAction, SIGNAL(triggered()), this, SLOT(about()));
@@ -144,7 +283,7 @@ void MainWindow::createDocks()
     addDockWidget(Qt::LeftDockWidgetArea, treeSettingsDockWidget);
 }
 
-MainWindow::MainWindow() : m_textSearch(new TextSearch)
+MainWindow::MainWindow() : m_textSearch(new TextSearch), m_currentTree(0)
 {
     QWidget * window = new QWidget(this);
     QGridLayout *main_window_layout = new QGridLayout(window);
@@ -160,7 +299,18 @@ MainWindow::MainWindow() : m_textSearch(new TextSearch)
 
     m_textSearch->DataFilter()->SetColour(utils::Colour(0.8f, 0.9f, 0.9f, 1.0f));
 
+    m_colourMapManager.reset(new utils::ColourMapManager());
+    m_colourMapManager->LoadColourMaps(utils::ColourMapManager::DEFAULT_PATH);
+
+    m_cladeFrequenciesWatcher = new QFutureWatcher<bool>(this);
+    connect(m_cladeFrequenciesWatcher, SIGNAL(finished()), this, SLOT(cladeFrequenciesCalculated()));
+
+    m_consensusWatcher = new QFutureWatcher<bool>(this);
+    connect(m_consensusWatcher, SIGNAL(finished()), this, SLOT(consensusBuilt()));
+
     createMenus();
+    updateTreeActions();
+    updateUndoActions();
 
 
     main_window_layout->setContentsMargins(0,0,0,0);
@@ -193,23 +343,26 @@ MainWindow::MainWindow() : m_textSearch(new TextSearch)
     connect(m_treeOptions, &TreeOptions::leafFontChanged, m_glTreeWidget, &GLWidget::ModifiedFont);
     connect(m_treeOptions, SIGNAL(leafLabelsChanged()), m_glTreeWidget, SLOT(updateLeafWidths()));
     connect(m_treeOptions, &TreeOptions::leafLabelsChanged, this, &MainWindow::updateSearchFields);
+    connect(m_treeOptions, &TreeOptions::colourFieldChanged, this, &MainWindow::colourByField);
 
 
     createDocks();
 
     readSettings();
 
+    m_showRenderStatsAct->setChecked(State::Inst().GetShowRenderStats());
 }
 
 void MainWindow::updateSearchFields()
 {
-    utils::Tree<NodePhylo>::Ptr tree = m_glTreeWidget->GetVisualTree()->GetTree();
+    VisualTreePtr visualTree = m_glTreeWidget->GetVisualTree();
+    const LabelCache& labels = visualTree->GetLabelCache();
     // set up the text search object
-    std::vector<NodePhylo *> leaf_nodes = tree->GetLeaves();
+    std::vector<NodePhylo *> leaf_nodes = visualTree->GetTree()->GetLeaves();
     m_textSearch->Clear();
     for(NodePhylo * leaf : leaf_nodes)
     {
-        m_textSearch->Add(leaf->GetLabel(), leaf->GetId());
+        m_textSearch->Add(labels.GetLabel(leaf), leaf->GetId());
     }
 }
 
@@ -218,7 +371,7 @@ void MainWindow::open()
     QString fileName = QFileDialog::getOpenFileName(this,
                                             tr("Open Tree file"),
                                             (State::Inst().GetPreviousDirectory().isEmpty()) ? QDir::homePath() : State::Inst().GetPreviousDirectory(),
-                                            tr("Tree Files (*.tree *.tre);;All Files (*)")
+                                            tr("Tree Files (*.tree *.tre *.nwk *.nex *.nexus *.trees *.xml *.gz *.pygmy);;All Files (*)")
                                             );
     // The user did not choose a file - clicked cancel
     if(fileName.isNull())
@@ -227,17 +380,110 @@ void MainWindow::open()
     }
     QFileInfo file_info(fileName);
     State::Inst().SetPreviousDirectory(file_info.absoluteDir().absolutePath());
-    pygmy::NewickIO newickIO;
+
+    if(pygmy::SnapshotIO::IsSnapshot(fileName))
+    {
+        // snapshots already contain the layout and label sizes of the tree
+        pygmy::SnapshotIO snapshotIO;
+        VisualTreePtr visualTree;
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        bool readOk = snapshotIO.Read(fileName, visualTree);
+        QApplication::restoreOverrideCursor();
+        if(!readOk)
+        {
+            QMessageBox::critical(this, tr("Pygmy: Error"), tr("Failed to read snapshot: %1").arg(snapshotIO.GetError()));
+            return;
+        }
+        setWindowTitle(visualTree->GetTree()->GetName());
+
+        m_treeCollection.clear();
+        m_cladeFrequencies.clear();
+        m_glTreeWidget->setVisualTree(visualTree);
+        if(visualTree->GetMetadataInfo())
+        {
+            m_metadataInfo = visualTree->GetMetadataInfo();
+            QStringList metadata_fields = m_metadataInfo->GetFields();
+            m_treeOptions->loadMetadataKeys(metadata_fields);
+        }
+        treeChanged();
+        return;
+    }
+
+    // files containing several trees are browsed as a collection, with each tree parsed when it is shown
+    TreeCollectionPtr collection(new pygmy::TreeCollection());
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool bCollection = collection->Open(fileName) && collection->GetNumberOfTrees() > 1;
+    QApplication::restoreOverrideCursor();
+    if(bCollection)
+    {
+        m_treeCollection = collection;
+        m_cladeFrequencies.clear();
+        showTree(0);
+        return;
+    }
+
+    pygmy::TreeReader treeReader;
     utils::Tree<pygmy::NodePhylo>::Ptr tree(new utils::Tree<pygmy::NodePhylo>());
-    bool readOk = newickIO.Read(tree, fileName);
-    if(! readOk || tree->GetNumberOfLeaves() == 0)
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool readOk = treeReader.Read(tree, fileName);
+    QApplication::restoreOverrideCursor();
+    if(! readOk)
     {
-        QMessageBox::critical(this, tr("Pygmy: Error"), tr("Failed to read Newick file, or the file was empty"));
+        QMessageBox::critical(this, tr("Pygmy: Error"), tr("Failed to read %1 file: %2")
+                              .arg(pygmy::TreeReader::FormatName(treeReader.GetFormat()))
+                              .arg(treeReader.GetError()));
         return;
     }
     setWindowTitle(tree->GetName());
 
+    m_treeCollection.clear();
+    m_cladeFrequencies.clear();
     m_glTreeWidget->setTree(tree);
+    setTreeMetadata(tree);
+    treeChanged();
+}
+
+void MainWindow::showTree(uint index)
+{
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    utils::Tree<pygmy::NodePhylo>::Ptr tree = m_treeCollection->GetTree(index);
+    QApplication::restoreOverrideCursor();
+    if(!tree)
+    {
+        QMessageBox::critical(this, tr("Pygmy: Error"), tr("Failed to read tree: %1").arg(m_treeCollection->GetError()));
+        return;
+    }
+    m_currentTree = index;
+
+    if(m_cladeFrequencies)
+        m_cladeFrequencies->Annotate(tree);
+
+    setWindowTitle(tr("%1 - %2 (%3 of %4)")
+                   .arg(QFileInfo(m_treeCollection->GetFilename()).fileName())
+                   .arg(tree->GetName())
+                   .arg(index + 1)
+                   .arg(m_treeCollection->GetNumberOfTrees()));
+
+    m_glTreeWidget->setTree(tree);
+    setTreeMetadata(tree);
+    treeChanged();
+}
+
+void MainWindow::setTreeMetadata(utils::Tree<pygmy::NodePhylo>::Ptr tree)
+{
+    // annotations read with the tree (e.g., NEXUS comments or PhyloXML properties)
+    MetadataInfoPtr metadataInfo = pygmy::TreeReader::GetMetadataInfo(tree);
+    if(metadataInfo)
+    {
+        m_metadataInfo = metadataInfo;
+        m_glTreeWidget->GetVisualTree()->SetMetadataInfo(m_metadataInfo);
+        QStringList metadata_fields = m_metadataInfo->GetFields();
+        m_treeOptions->loadMetadataKeys(metadata_fields);
+    }
+}
+
+void MainWindow::treeChanged()
+{
     m_textSearch->Clear();
     m_glTreeWidget->SetSearchFilter(m_textSearch->DataFilter());
     VisualTreePtr ptr = m_glTreeWidget->GetVisualTree();
@@ -247,6 +493,355 @@ void MainWindow::open()
     m_simpleSearch->SetTextSearch(m_textSearch);
     updateSearchFields();
     m_treeOptions->setupFromState();
+    updateTreeActions();
+}
+
+void MainWindow::updateTreeActions()
+{
+    bool bCollection = !m_treeCollection.isNull();
+    m_previousTreeAct->setEnabled(bCollection && m_currentTree > 0);
+    m_nextTreeAct->setEnabled(bCollection && m_currentTree + 1 < m_treeCollection->GetNumberOfTrees());
+    m_goToTreeAct->setEnabled(bCollection);
+    m_cladeFrequenciesAct->setEnabled(bCollection && !m_cladeFrequenciesWatcher->isRunning());
+    m_consensusAct->setEnabled(bCollection && !m_consensusWatcher->isRunning());
+    m_extendedConsensusAct->setEnabled(bCollection && !m_consensusWatcher->isRunning());
+}
+
+void MainWindow::updateUndoActions()
+{
+    VisualTreePtr visualTree = m_glTreeWidget->GetVisualTree();
+
+    bool bUndo = visualTree && visualTree->CanUndo();
+    m_undoAct->setEnabled(bUndo);
+    m_undoAct->setText(bUndo ? tr("&Undo %1").arg(visualTree->GetUndoText()) : tr("&Undo"));
+
+    bool bRedo = visualTree && visualTree->CanRedo();
+    m_redoAct->setEnabled(bRedo);
+    m_redoAct->setText(bRedo ? tr("&Redo %1").arg(visualTree->GetRedoText()) : tr("&Redo"));
+}
+
+void MainWindow::previousTree()
+{
+    if(m_treeCollection && m_currentTree > 0)
+        showTree(m_currentTree - 1);
+}
+
+void MainWindow::nextTree()
+{
+    if(m_treeCollection && m_currentTree + 1 < m_treeCollection->GetNumberOfTrees())
+        showTree(m_currentTree + 1);
+}
+
+void MainWindow::goToTree()
+{
+    if(!m_treeCollection)
+        return;
+
+    bool ok;
+    int index = QInputDialog::getInt(this, tr("Go to Tree"),
+                                     tr("Tree (1 - %1):").arg(m_treeCollection->GetNumberOfTrees()),
+                                     m_currentTree + 1, 1, m_treeCollection->GetNumberOfTrees(), 1, &ok);
+    if(ok)
+        showTree(uint(index - 1));
+}
+
+void MainWindow::calculateCladeFrequencies()
+{
+    if(!m_treeCollection || m_cladeFrequenciesWatcher->isRunning())
+        return;
+
+    // trees are read and counted on worker threads, so the viewer remains responsive
+    CladeFrequenciesPtr frequencies(new pygmy::CladeFrequencies());
+    TreeCollectionPtr collection = m_treeCollection;
+    m_pendingCladeFrequencies = frequencies;
+    m_pendingCladeFrequenciesCollection = collection;
+
+    statusBar()->showMessage(tr("Calculating clade frequencies over %1 trees...").arg(collection->GetNumberOfTrees()));
+    m_cladeFrequenciesWatcher->setFuture(QtConcurrent::run([frequencies, collection]() { return frequencies->Calculate(*collection); }));
+    updateTreeActions();
+}
+
+void MainWindow::cladeFrequenciesCalculated()
+{
+    CladeFrequenciesPtr frequencies = m_pendingCladeFrequencies;
+    TreeCollectionPtr collection = m_pendingCladeFrequenciesCollection;
+    m_pendingCladeFrequencies.clear();
+    m_pendingCladeFrequenciesCollection.clear();
+    updateTreeActions();
+
+    // results for a collection which has since been closed are discarded
+    if(collection != m_treeCollection)
+    {
+        statusBar()->clearMessage();
+        return;
+    }
+
+    if(!m_cladeFrequenciesWatcher->result())
+    {
+        statusBar()->clearMessage();
+        QMessageBox::critical(this, tr("Pygmy: Error"), tr("Failed to calculate clade frequencies: %1").arg(frequencies->GetError()));
+        return;
+    }
+
+    m_cladeFrequencies = frequencies;
+    statusBar()->showMessage(tr("Clade frequencies calculated over %1 trees (%2 skipped)")
+                             .arg(frequencies->GetNumberOfTrees())
+                             .arg(frequencies->GetNumberOfSkippedTrees()));
+
+    // annotate the cached tree and the copy of it being displayed
+    utils::Tree<pygmy::NodePhylo>::Ptr tree = m_treeCollection->GetTree(m_currentTree);
+    if(tree)
+        m_cladeFrequencies->Annotate(tree);
+    m_cladeFrequencies->Annotate(m_glTreeWidget->GetVisualTree()->GetTree());
+
+    State::Inst().SetInternalNodeField(pygmy::CladeFrequencies::FIELD);
+    State::Inst().SetShowInternalLabels(true);
+    m_treeOptions->setupFromState();
+    m_glTreeWidget->update();
+}
+
+void MainWindow::buildConsensus()
+{
+    startConsensus(false);
+}
+
+void MainWindow::buildExtendedConsensus()
+{
+    startConsensus(true);
+}
+
+void MainWindow::startConsensus(bool bExtended)
+{
+    if(!m_treeCollection || m_consensusWatcher->isRunning())
+        return;
+
+    ConsensusTreePtr consensus(new pygmy::ConsensusTree());
+    consensus->SetExtended(bExtended);
+    utils::Tree<pygmy::NodePhylo>::Ptr tree(new utils::Tree<pygmy::NodePhylo>());
+    TreeCollectionPtr collection = m_treeCollection;
+    m_pendingConsensus = consensus;
+    m_pendingConsensusTree = tree;
+    m_pendingConsensusCollection = collection;
+
+    statusBar()->showMessage(tr("Building consensus of %1 trees...").arg(collection->GetNumberOfTrees()));
+    m_consensusWatcher->setFuture(QtConcurrent::run([consensus, collection, tree]() { return consensus->Build(*collection, tree); }));
+    updateTreeActions();
+}
+
+void MainWindow::consensusBuilt()
+{
+    ConsensusTreePtr consensus = m_pendingConsensus;
+    utils::Tree<pygmy::NodePhylo>::Ptr tree = m_pendingConsensusTree;
+    TreeCollectionPtr collection = m_pendingConsensusCollection;
+    m_pendingConsensus.clear();
+    m_pendingConsensusTree.clear();
+    m_pendingConsensusCollection.clear();
+    updateTreeActions();
+    statusBar()->clearMessage();
+
+    if(collection != m_treeCollection)
+        return;
+
+    if(!m_consensusWatcher->result())
+    {
+        QMessageBox::critical(this, tr("Pygmy: Error"), tr("Failed to build consensus tree: %1").arg(consensus->GetError()));
+        return;
+    }
+
+    statusBar()->showMessage(tr("Consensus of %1 trees (%2 skipped)")
+                             .arg(consensus->GetNumberOfTrees())
+                             .arg(consensus->GetNumberOfSkippedTrees()));
+    setWindowTitle(tr("%1 - %2").arg(QFileInfo(m_treeCollection->GetFilename()).fileName()).arg(tree->GetName()));
+
+    // the support of each clade is shown as its bootstrap value
+    m_glTreeWidget->setTree(tree);
+    treeChanged();
+
+    State::Inst().SetInternalNodeField("Bootstrap");
+    State::Inst().SetShowInternalLabels(true);
+    m_treeOptions->setupFromState();
+    m_glTreeWidget->update();
+}
+
+void MainWindow::compareWithTree()
+{
+    if(!m_glTreeWidget->GetVisualTree())
+    {
+        QMessageBox::critical(this, tr("Pygmy: Error"), tr("A tree must be opened before it can be compared"));
+        return;
+    }
+
+    QString fileName = QFileDialog::getOpenFileName(this,
+                                            tr("Compare with Tree"),
+                                            (State::Inst().GetPreviousDirectory().isEmpty()) ? QDir::homePath() : State::Inst().GetPreviousDirectory(),
+                                            tr("Tree Files (*.tree *.tre *.nwk *.nex *.nexus *.trees *.xml *.gz);;All Files (*)")
+                                            );
+    // The user did not choose a file - clicked cancel
+    if(fileName.isNull())
+    {
+        return;
+    }
+
+    pygmy::TreeReader treeReader;
+    utils::Tree<pygmy::NodePhylo>::Ptr other(new utils::Tree<pygmy::NodePhylo>());
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool readOk = treeReader.Read(other, fileName);
+    QApplication::restoreOverrideCursor();
+    if(!readOk)
+    {
+        QMessageBox::critical(this, tr("Pygmy: Error"), tr("Failed to read %1 file: %2")
+                              .arg(pygmy::TreeReader::FormatName(treeReader.GetFormat()))
+                              .arg(treeReader.GetError()));
+        return;
+    }
+
+    utils::Tree<pygmy::NodePhylo>::Ptr tree = m_glTreeWidget->GetVisualTree()->GetTree();
+    pygmy::TreeComparison comparison;
+    if(!comparison.Compare(tree, other))
+    {
+        QMessageBox::critical(this, tr("Pygmy: Error"), tr("Failed to compare trees: %1").arg(comparison.GetError()));
+        return;
+    }
+
+    // branches whose clade is not found in the other tree are highlighted
+    std::map<QString, utils::Colour> colours;
+    colours[pygmy::TreeComparison::PRESENT] = utils::Colour(0.0f, 0.0f, 0.0f);
+    colours[pygmy::TreeComparison::ABSENT] = utils::Colour(0.8f, 0.1f, 0.1f);
+    m_glTreeWidget->colourNodes(pygmy::TreeComparison::FIELD, colours);
+
+    statusBar()->showMessage(tr("Robinson-Foulds distance: %1 (normalised %2) over %3 shared leaves")
+                             .arg(comparison.GetDistance())
+                             .arg(comparison.GetNormalisedDistance(), 0, 'f', 3)
+                             .arg(comparison.GetNumberOfSharedTaxa()));
+
+    // the tanglegram reorders leaves, so it is given its own copy of the displayed tree
+    TanglegramWidget * tanglegram = new TanglegramWidget(this);
+    tanglegram->setAttribute(Qt::WA_DeleteOnClose);
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    tanglegram->SetTrees(tree->Clone(), other);
+    QApplication::restoreOverrideCursor();
+    tanglegram->setWindowTitle(tr("Tanglegram: %1 and %2 (%3 crossings)")
+                               .arg(tree->GetName())
+                               .arg(QFileInfo(fileName).fileName())
+                               .arg(tanglegram->GetNumberOfCrossings()));
+    tanglegram->show();
+}
+
+void MainWindow::colourByField(const QString& field)
+{
+    if(!m_glTreeWidget->GetVisualTree())
+        return;
+
+    // numerical fields are coloured along a continuous colour map and categorical fields by distinct colours
+    utils::ColourMapPtr colourMap;
+    if(!field.isEmpty() && m_metadataInfo)
+    {
+        if(m_metadataInfo->GetInfo(field).dataType == pygmy::FieldInfo::NUMERICAL)
+            colourMap = m_colourMapManager->GetDefaultContinuousMap();
+        else
+            colourMap = m_colourMapManager->GetDefaultCategoricalMap();
+    }
+
+    m_glTreeWidget->colourByField(field, colourMap);
+}
+
+void MainWindow::foldCladesByField()
+{
+    if(!m_glTreeWidget->GetVisualTree())
+        return;
+
+    if(!m_metadataInfo)
+    {
+        QMessageBox::information(this, tr("Pygmy"), tr("An annotations file must be opened before clades can be collapsed by a field."));
+        return;
+    }
+
+    // e.g., collapsing by a genus field draws each genus as a single triangle
+    bool bOk = false;
+    QString field = QInputDialog::getItem(this, tr("Collapse Clades by Field"),
+                                          tr("Collapse clades whose leaves all have the same value for:"),
+                                          m_metadataInfo->GetFields(), 0, false, &bOk);
+    if(!bOk || field.isEmpty())
+        return;
+
+    uint numFolded = m_glTreeWidget->foldByField(field);
+    statusBar()->showMessage(tr("Collapsed %1 clades by %2").arg(numFolded).arg(field));
+}
+
+void MainWindow::sortSubtreesByField()
+{
+    if(!m_glTreeWidget->GetVisualTree())
+        return;
+
+    if(!m_metadataInfo)
+    {
+        QMessageBox::information(this, tr("Pygmy"), tr("An annotations file must be opened before subtrees can be sorted by a field."));
+        return;
+    }
+
+    // subtrees are placed by the first value of their leaves, e.g. ordering by a date field
+    bool bOk = false;
+    QString field = QInputDialog::getItem(this, tr("Sort Subtrees by Field"),
+                                          tr("Order subtrees by the values of their leaves for:"),
+                                          m_metadataInfo->GetFields(), 0, false, &bOk);
+    if(!bOk || field.isEmpty())
+        return;
+
+    m_glTreeWidget->sortSubtreesBy(SubtreeSorter::SORT_BY_FIELD, field);
+}
+
+void MainWindow::projectOntoLeaves()
+{
+    if(!m_glTreeWidget->GetVisualTree())
+        return;
+
+    QString fileName = QFileDialog::getOpenFileName(this,
+                                            tr("Project onto Leaves"),
+                                            (State::Inst().GetPreviousDirectory().isEmpty()) ? QDir::homePath() : State::Inst().GetPreviousDirectory(),
+                                            tr("Leaf Names (*.txt *.tsv);;All Files (*)")
+                                            );
+    // The user did not choose a file - clicked cancel
+    if(fileName.isNull())
+    {
+        return;
+    }
+
+    pygmy::TreeReader treeReader;
+    std::vector<QString> names;
+    if(!treeReader.ReadLeafNames(fileName, names))
+    {
+        QMessageBox::critical(this, tr("Pygmy: Error"), treeReader.GetError());
+        return;
+    }
+
+    uint numNames = uint(names.size());
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    m_glTreeWidget->projectTree(names);
+    QApplication::restoreOverrideCursor();
+
+    // names not found in the tree are returned, in which case the tree is left unchanged if none were found
+    if(names.size() == numNames)
+    {
+        QMessageBox::information(this, tr("Pygmy"), tr("None of the names in %1 are leaves of the tree.").arg(QFileInfo(fileName).fileName()));
+        return;
+    }
+
+    treeChanged();
+    statusBar()->showMessage(tr("Projected tree onto %1 leaves (%2 names not found)")
+                             .arg(m_glTreeWidget->GetVisualTree()->GetTree()->GetNumberOfLeaves())
+                             .arg(uint(names.size())));
+}
+
+void MainWindow::restoreTree()
+{
+    if(!m_glTreeWidget->GetVisualTree())
+        return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    m_glTreeWidget->restoreTree();
+    QApplication::restoreOverrideCursor();
+
+    treeChanged();
 }
 
 void MainWindow::openAnnotationsFile()
@@ -272,6 +867,118 @@ void MainWindow::openAnnotationsFile()
     m_glTreeWidget->update();
 }
 
+void MainWindow::saveSnapshot()
+{
+    if(!m_glTreeWidget->GetVisualTree())
+    {
+        QMessageBox::critical(this, tr("Pygmy: Error"), tr("A tree must be opened before it can be saved"));
+        return;
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(this,
+                                            tr("Save Snapshot"),
+                                            (State::Inst().GetPreviousDirectory().isEmpty()) ? QDir::homePath() : State::Inst().GetPreviousDirectory(),
+                                            tr("Pygmy Snapshots (*.pygmy)")
+                                            );
+    // The user did not choose a file - clicked cancel
+    if(fileName.isNull())
+    {
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    pygmy::SnapshotIO snapshotIO;
+    bool saveOk = snapshotIO.Write(m_glTreeWidget->GetVisualTree(), fileName);
+    QApplication::restoreOverrideCursor();
+
+    if(!saveOk)
+    {
+        QMessageBox::critical(this, tr("Pygmy: Error"), tr("Failed to save snapshot: %1").arg(snapshotIO.GetError()));
+    }
+}
+
+void MainWindow::exportImage()
+{
+    exportTree(false);
+}
+
+void MainWindow::exportSelectedClade()
+{
+    exportTree(true);
+}
+
+void MainWindow::exportTree(bool bSelectedClade)
+{
+    if(!m_glTreeWidget->GetVisualTree())
+    {
+        QMessageBox::critical(this, tr("Pygmy: Error"), tr("A tree must be opened before it can be exported"));
+        return;
+    }
+
+    NodePhylo* clade = m_glTreeWidget->GetVisualTree()->GetActiveNode()->node;
+    if(bSelectedClade && (!clade || !clade->IsSelected()))
+    {
+        QMessageBox::critical(this, tr("Pygmy: Error"), tr("A clade must be selected before it can be exported"));
+        return;
+    }
+
+    QString filter = tr("SVG Images (*.svg);;PDF Documents (*.pdf)");
+    if(!bSelectedClade)
+        filter = tr("PNG Images (*.png);;TIFF Images (*.tif *.tiff);;") + filter;
+
+    QString fileName = QFileDialog::getSaveFileName(this,
+                                            bSelectedClade ? tr("Export Selected Clade") : tr("Export Image"),
+                                            (State::Inst().GetPreviousDirectory().isEmpty()) ? QDir::homePath() : State::Inst().GetPreviousDirectory(),
+                                            filter
+                                            );
+    // The user did not choose a file - clicked cancel
+    if(fileName.isNull())
+    {
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QString error;
+    bool exportOk = m_glTreeWidget->ExportImage(fileName, bSelectedClade, error);
+    QApplication::restoreOverrideCursor();
+
+    if(!exportOk)
+    {
+        QMessageBox::critical(this, tr("Pygmy: Error"), tr("Failed to export image: %1").arg(error));
+    }
+}
+
+void MainWindow::recordRenderTrace(bool state)
+{
+    if(!state)
+    {
+        m_glTreeWidget->StopRenderTrace();
+        return;
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(this,
+                                            tr("Save Render Trace"),
+                                            (State::Inst().GetPreviousDirectory().isEmpty()) ? QDir::homePath() : State::Inst().GetPreviousDirectory(),
+                                            tr("CSV Files (*.csv);;All Files (*)")
+                                            );
+
+    bool bRecording = false;
+    if(!fileName.isNull())
+    {
+        bRecording = m_glTreeWidget->StartRenderTrace(fileName);
+        if(!bRecording)
+            QMessageBox::critical(this, tr("Pygmy: Error"), tr("Failed to open render trace file for writing"));
+    }
+
+    // uncheck the action if no trace is being recorded
+    if(!bRecording)
+    {
+        m_recordRenderTraceAct->blockSignals(true);
+        m_recordRenderTraceAct->setChecked(false);
+        m_recordRenderTraceAct->blockSignals(false);
+    }
+}
+
 void MainWindow::writeSettings()
 {
     State::Inst().Save();
@@ -290,6 +997,73 @@ void MainWindow::about()
                ));
 }
 
+void MainWindow::aboutTree()
+{
+    VisualTreePtr visualTree = m_glTreeWidget->GetVisualTree();
+    if(!visualTree)
+    {
+        QMessageBox::critical(this, tr("Pygmy: Error"), tr("A tree must be opened before it can be described"));
+        return;
+    }
+
+    MemoryReport report;
+    visualTree->ReportMemory(report);
+    m_textSearch->ReportMemory(report);
+    m_glTreeWidgetOverview->ReportMemory(report);
+
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("About this Tree"));
+
+    utils::Tree<NodePhylo>::Ptr tree = visualTree->GetTree();
+    QLabel * summary = new QLabel(tr("%1 leaves, %2 nodes").arg(tree->GetNumberOfLeaves()).arg(tree->GetNumberOfNodes()), &dialog);
+
+    QTableWidget * table = new QTableWidget(MemoryReport::NUM_SUBSYSTEMS + 1, 3, &dialog);
+    table->setHorizontalHeaderLabels(QStringList() << tr("Subsystem") << tr("Memory") << tr("Share"));
+    table->verticalHeader()->hide();
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionMode(QAbstractItemView::NoSelection);
+
+    quint64 total = report.GetTotalBytes();
+    for(uint i = 0; i <= MemoryReport::NUM_SUBSYSTEMS; ++i)
+    {
+        // last row gives the total
+        bool bTotal = (i == MemoryReport::NUM_SUBSYSTEMS);
+        quint64 bytes = bTotal ? total : report.GetBytes(MemoryReport::SUBSYSTEM(i));
+        double share = total ? (100.0 * bytes) / total : 0.0;
+
+        QTableWidgetItem * nameItem = new QTableWidgetItem(bTotal ? tr("Total") : MemoryReport::GetName(MemoryReport::SUBSYSTEM(i)));
+        QTableWidgetItem * bytesItem = new QTableWidgetItem(MemoryReport::FormatBytes(bytes));
+        QTableWidgetItem * shareItem = new QTableWidgetItem(QString::number(share, 'f', 1) + "%");
+        bytesItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        shareItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        if(bTotal)
+        {
+            QFont font = nameItem->font();
+            font.setBold(true);
+            nameItem->setFont(font);
+            bytesItem->setFont(font);
+            shareItem->setFont(font);
+        }
+
+        table->setItem(i, 0, nameItem);
+        table->setItem(i, 1, bytesItem);
+        table->setItem(i, 2, shareItem);
+    }
+    table->resizeColumnsToContents();
+    table->horizontalHeader()->setStretchLastSection(true);
+
+    QDialogButtonBox * buttons = new QDialogButtonBox(QDialogButtonBox::Close, &dialog);
+    connect(buttons, SIGNAL(rejected()), &dialog, SLOT(reject()));
+
+    QVBoxLayout * layout = new QVBoxLayout(&dialog);
+    layout->addWidget(summary);
+    layout->addWidget(table);
+    layout->addWidget(buttons);
+
+    dialog.resize(400, 340);
+    dialog.exec();
+}
+
 void MainWindow::closeEvent(QCloseEvent *event)
 {
     writeSettings();
@@ -41,6 +41,7 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QFutureWatcher>
 #include <QMainWindow>
 #include "GlScrollWrapper.hpp"
 #include "GlWidget.hpp"
@@ -61,12 +62,38 @@ public:
 private slots:
     void open();
     void about();
+    void aboutTree();
     void openAnnotationsFile();
     void updateSearchFields();
+    void recordRenderTrace(bool state);
+    void saveSnapshot();
+    void exportImage();
+    void exportSelectedClade();
+    void previousTree();
+    void nextTree();
+    void goToTree();
+    void calculateCladeFrequencies();
+    void cladeFrequenciesCalculated();
+    void buildConsensus();
+    void buildExtendedConsensus();
+    void consensusBuilt();
+    void compareWithTree();
+    void colourByField(const QString& field);
+    void foldCladesByField();
+    void sortSubtreesByField();
+    void projectOntoLeaves();
+    void restoreTree();
+    void updateUndoActions();
 
 
 
 protected:
+    void exportTree(bool bSelectedClade);
+    void showTree(uint index);
+    void startConsensus(bool bExtended);
+    void setTreeMetadata(utils::Tree<pygmy::NodePhylo>::Ptr tree);
+    void treeChanged();
+    void updateTreeActions();
     void readSettings();
     void writeSettings();
     void closeEvent(QCloseEvent * event);
@@ -82,6 +109,28 @@ private:
     TreeOptions * m_treeOptions;
     TextSearchPtr m_textSearch;
     MetadataInfoPtr m_metadataInfo;
+    QAction * m_showRenderStatsAct;
+    QAction * m_recordRenderTraceAct;
+    QAction * m_previousTreeAct;
+    QAction * m_nextTreeAct;
+    QAction * m_goToTreeAct;
+    QAction * m_cladeFrequenciesAct;
+    QAction * m_consensusAct;
+    QAction * m_extendedConsensusAct;
+    QAction * m_undoAct;
+    QAction * m_redoAct;
+
+    TreeCollectionPtr m_treeCollection;
+    uint m_currentTree;
+    CladeFrequenciesPtr m_cladeFrequencies;
+    CladeFrequenciesPtr m_pendingCladeFrequencies;
+    TreeCollectionPtr m_pendingCladeFrequenciesCollection;
+    QFutureWatcher<bool> * m_cladeFrequenciesWatcher;
+    ConsensusTreePtr m_pendingConsensus;
+    utils::Tree<pygmy::NodePhylo>::Ptr m_pendingConsensusTree;
+    TreeCollectionPtr m_pendingConsensusCollection;
+    QFutureWatcher<bool> * m_consensusWatcher;
+    utils::ColourMapManagerPtr m_colourMapManager;
 
 };
 
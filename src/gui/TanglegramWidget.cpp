@@ -0,0 +1,195 @@
+#include "TanglegramWidget.hpp"
+#include "../core/OptimizeLeafOrder.hpp"
+#include "../core/TreeComparison.hpp"
+#include <QHash>
+#include <QPainter>
+
+#include <algorithm>
+
+TanglegramWidget::TanglegramWidget(QWidget * parent) : QWidget(parent), m_numCrossings(0)
+{
+    setWindowFlags(Qt::Window);
+}
+
+QSize TanglegramWidget::sizeHint() const
+{
+    return QSize(800, 600);
+}
+
+QSize TanglegramWidget::minimumSizeHint() const
+{
+    return QSize(300, 200);
+}
+
+void TanglegramWidget::SetTrees(utils::Tree<pygmy::NodePhylo>::Ptr left, utils::Tree<pygmy::NodePhylo>::Ptr right)
+{
+    m_trees[0] = left;
+    m_trees[1] = right;
+
+    // the leaves of the right tree are ordered to follow the leaves of the left tree
+    QHash<QString, uint> positions;
+    std::vector<pygmy::NodePhylo *> leaves = left->GetLeaves();
+    for(uint i = 0; i < leaves.size(); ++i)
+        positions.insert(leaves[i]->GetName(), i);
+
+    m_numCrossings = 0;
+    pygmy::OptimizeLeafOrder::OptimizeLeafNodeOrdering(right, positions, m_numCrossings, true);
+
+    std::vector<float> leafY[2];
+    LayoutTree(left, m_lines[0], leafY[0]);
+    LayoutTree(right, m_lines[1], leafY[1]);
+
+    m_links.clear();
+    leaves = right->GetLeaves();
+    for(uint i = 0; i < leaves.size(); ++i)
+    {
+        QHash<QString, uint>::const_iterator it = positions.constFind(leaves[i]->GetName());
+        if(it != positions.constEnd())
+            m_links.push_back(std::make_pair(leafY[0][it.value()], leafY[1][i]));
+    }
+
+    update();
+}
+
+void TanglegramWidget::LayoutTree(utils::Tree<pygmy::NodePhylo>::Ptr tree, std::vector<Line>& lines, std::vector<float>& leafY)
+{
+    lines.clear();
+    leafY.clear();
+
+    // pre-order traversal visiting children from first to last
+    std::vector<pygmy::NodePhylo *> nodes;
+    std::vector<int> parents;
+    std::vector< std::pair<pygmy::NodePhylo *, int> > stack(1, std::make_pair(tree->GetRootNode(), -1));
+    while(!stack.empty())
+    {
+        pygmy::NodePhylo * node = stack.back().first;
+        parents.push_back(stack.back().second);
+        stack.pop_back();
+
+        int index = int(nodes.size());
+        nodes.push_back(node);
+        for(uint i = node->GetNumberOfChildren(); i > 0; --i)
+            stack.push_back(std::make_pair(node->GetChild(i - 1), index));
+    }
+
+    // branches are drawn to scale if the tree has branch lengths, else leaves are aligned
+    bool bLengths = true;
+    for(uint i = 1; i < nodes.size(); ++i)
+    {
+        if(nodes[i]->GetDistanceToParent() == pygmy::NodePhylo::NO_DISTANCE)
+            bLengths = false;
+    }
+
+    uint numNodes = uint(nodes.size());
+    std::vector<float> x(numNodes, 0.0f);
+    std::vector<float> y(numNodes, 0.0f);
+    std::vector<float> yMin(numNodes, 1.0f);
+    std::vector<float> yMax(numNodes, 0.0f);
+    if(bLengths)
+    {
+        for(uint i = 1; i < numNodes; ++i)
+            x[i] = x[parents[i]] + std::max(0.0f, nodes[i]->GetDistanceToParent());
+    }
+    else
+    {
+        // x is the number of branches to the furthest leaf, reversed below
+        for(uint i = numNodes - 1; i > 0; --i)
+            x[parents[i]] = std::max(x[parents[i]], x[i] + 1.0f);
+
+        for(uint i = 1; i < numNodes; ++i)
+            x[i] = x[0] - x[i];
+        x[0] = 0.0f;
+    }
+
+    float maxX = *std::max_element(x.begin(), x.end());
+    uint numLeaves = 0;
+    for(pygmy::NodePhylo * node : nodes)
+    {
+        if(node->IsLeaf())
+            numLeaves++;
+    }
+
+    for(uint i = 0; i < numNodes; ++i)
+    {
+        if(maxX > 0.0f)
+            x[i] /= maxX;
+
+        if(nodes[i]->IsLeaf())
+        {
+            y[i] = (leafY.size() + 0.5f) / numLeaves;
+            leafY.push_back(y[i]);
+        }
+    }
+
+    // internal nodes are centred on the span of their children
+    for(uint i = numNodes; i > 0; --i)
+    {
+        uint index = i - 1;
+        if(!nodes[index]->IsLeaf())
+            y[index] = 0.5f * (yMin[index] + yMax[index]);
+
+        int parent = parents[index];
+        if(parent >= 0)
+        {
+            yMin[parent] = std::min(yMin[parent], y[index]);
+            yMax[parent] = std::max(yMax[parent], y[index]);
+        }
+    }
+
+    for(uint i = 0; i < numNodes; ++i)
+    {
+        Line line;
+        line.colour = (nodes[i]->GetData(pygmy::TreeComparison::FIELD) == pygmy::TreeComparison::ABSENT) ? QColor(204, 25, 25) : QColor(Qt::black);
+
+        if(parents[i] >= 0)
+        {
+            line.line = QLineF(x[parents[i]], y[i], x[i], y[i]);
+            lines.push_back(line);
+        }
+
+        if(!nodes[i]->IsLeaf())
+        {
+            line.line = QLineF(x[i], yMin[i], x[i], yMax[i]);
+            lines.push_back(line);
+        }
+    }
+}
+
+void TanglegramWidget::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::white);
+    if(!m_trees[0] || !m_trees[1])
+        return;
+
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    // each tree takes two fifths of the width, with the lines joining leaves between them
+    const qreal border = 10;
+    qreal treeWidth = 0.4 * (width() - 2*border);
+    qreal treeHeight = height() - 2*border;
+    qreal left = border;
+    qreal right = width() - border;
+
+    for(const Line& line : m_lines[0])
+    {
+        painter.setPen(line.colour);
+        painter.drawLine(QLineF(left + line.line.x1()*treeWidth, border + line.line.y1()*treeHeight,
+                                left + line.line.x2()*treeWidth, border + line.line.y2()*treeHeight));
+    }
+
+    // the right tree is mirrored so its leaves face those of the left tree
+    for(const Line& line : m_lines[1])
+    {
+        painter.setPen(line.colour);
+        painter.drawLine(QLineF(right - line.line.x1()*treeWidth, border + line.line.y1()*treeHeight,
+                                right - line.line.x2()*treeWidth, border + line.line.y2()*treeHeight));
+    }
+
+    painter.setPen(QColor(128, 128, 128));
+    for(const std::pair<float, float>& link : m_links)
+    {
+        painter.drawLine(QLineF(left + treeWidth, border + link.first*treeHeight,
+                                right - treeWidth, border + link.second*treeHeight));
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef TANGLEGRAMWIDGET_H
+#define TANGLEGRAMWIDGET_H
+
+#include <QColor>
+#include <QLineF>
+#include <QWidget>
+
+#include "../core/NodePhylo.hpp"
+#include "../utils/Tree.hpp"
+
+#include <vector>
+
+/**
+ * Shows two trees side by side, facing each other, with lines joining leaves of
+ * the same name. The leaves of the right tree are ordered to minimise the number
+ * of crossing lines (see OptimizeLeafOrder). Branches are coloured by the
+ * metadata set by TreeComparison.
+ */
+class TanglegramWidget : public QWidget
+{
+public:
+    TanglegramWidget(QWidget *parent);
+    QSize sizeHint() const Q_DECL_OVERRIDE;
+    QSize minimumSizeHint() const Q_DECL_OVERRIDE;
+
+    /**
+     * Set the trees to show. The leaves of the right tree are reordered, so
+     * neither tree should be displayed elsewhere.
+     */
+    void SetTrees(utils::Tree<pygmy::NodePhylo>::Ptr left, utils::Tree<pygmy::NodePhylo>::Ptr right);
+
+    /** Number of crossings between lines joining the leaves of the two trees. */
+    uint GetNumberOfCrossings() const { return m_numCrossings; }
+
+protected:
+    void paintEvent(QPaintEvent *);
+
+private:
+    /** Line of a tree drawing, with coordinates between 0 and 1. */
+    struct Line
+    {
+        QLineF line;
+        QColor colour;
+    };
+
+    void LayoutTree(utils::Tree<pygmy::NodePhylo>::Ptr tree, std::vector<Line>& lines, std::vector<float>& leafY);
+
+    utils::Tree<pygmy::NodePhylo>::Ptr m_trees[2];
+    std::vector<Line> m_lines[2];
+
+    /** Position of leaves joined between the two trees. */
+    std::vector< std::pair<float, float> > m_links;
+
+    uint m_numCrossings;
+};
+
+#endif // TANGLEGRAMWIDGET_H
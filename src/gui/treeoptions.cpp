@@ -13,6 +13,7 @@ TreeOptions::TreeOptions(QWidget *parent) :
     internal_labels.append("Name");
     internal_labels.append("Bootstrap");
     internal_labels.append("Number of Leaves");
+    internal_labels.append("Clade Frequency");
 
 
     ui->InternalMetadataField->addItems(internal_labels);
@@ -24,6 +25,12 @@ TreeOptions::TreeOptions(QWidget *parent) :
     connect(ui->MetadataField,
             static_cast<void(QComboBox::*)(const QString &)>(&QComboBox::currentIndexChanged),
             [=](const QString &text){ pygmy::State::Inst().SetMetadataField(text); emit leafLabelsChanged(); emit TreeOptionsChanged(); });
+
+    // the first item leaves the tree uncoloured
+    ui->ColourField->addItem(tr("None"));
+    connect(ui->ColourField,
+            static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [=](int index){ emit colourFieldChanged(index > 0 ? ui->ColourField->itemText(index) : QString()); });
 }
 
 void TreeOptions::setupFromState()
@@ -46,6 +53,10 @@ void TreeOptions::loadMetadataKeys(QStringList &labels)
 {
     ui->MetadataField->clear();
     ui->MetadataField->addItems(labels);
+
+    ui->ColourField->clear();
+    ui->ColourField->addItem(tr("None"));
+    ui->ColourField->addItems(labels);
 }
 
 void TreeOptions::on_ShowInternalLabel_stateChanged(int state)
@@ -20,6 +20,9 @@ signals:
     void leafFontSizeChanged(int);
     void leafFontChanged(void);
 
+    /** Emitted when the metadata field used to colour the tree changes (empty for none). */
+    void colourFieldChanged(const QString& field);
+
 public:
     explicit TreeOptions(QWidget *parent = 0);
     ~TreeOptions();
@@ -40,12 +40,22 @@
 
 #include <QApplication>
 #include <QDesktopWidget>
+#include <QGuiApplication>
 #include <QSurfaceFormat>
 
 #include "gui/MainWindow.hpp"
+#include "core/CommandLineTool.hpp"
 
 int main(int argc, char *argv[])
 {
+    // command line operations (e.g., image export) do not require a window system
+    if (pygmy::CommandLineTool::IsRequested(argc, argv)) {
+        pygmy::CommandLineTool::PrepareHeadless();
+        QGuiApplication app(argc, argv);
+        pygmy::CommandLineTool tool;
+        return tool.Run(app.arguments());
+    }
+
     QApplication app(argc, argv);
 
     QSurfaceFormat fmt;
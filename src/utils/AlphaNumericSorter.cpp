@@ -7,10 +7,9 @@
 // http://creativecommons.org/licenses/by-sa/3.0/
 //=======================================================================
 
-#include "../core/Precompiled.hpp"
-
 #include "../utils/AlphaNumericSorter.hpp"
-#include "../utils/StringTools.hpp"
+
+#include <algorithm>
 
 using namespace utils;
 using namespace std;
@@ -30,46 +29,56 @@ typedef struct sNUMERIC_STRING_SORTER
 } NumericStringSorter;
 
 
-void AlphaNumericSorter::Sort(std::vector<std::wstring>& values)
+void AlphaNumericSorter::Sort(std::vector<QString>& values)
 {
 	// if all data is numerical, than sort in numerical as opposed to lexigraphical order
 	bool bNumeric = true;
-	foreach(std::wstring str, values)
+	std::vector<NumericStringSorter> fieldNumeric;
+	fieldNumeric.reserve(values.size());
+	for(uint i = 0; i < values.size(); ++i)
 	{
-		if(!utils::StringTools::IsDecimalNumber(str))
-		{
-			bNumeric = false;
+		double value = values.at(i).toDouble(&bNumeric);
+		if(!bNumeric)
 			break;
-		}
+
+		fieldNumeric.push_back(NumericStringSorter(value, i));
 	}
 
 	// sort field values eith numerically or lexigraphically
 	if(bNumeric)
 	{
-		// convert all data to its numeric equivalent, sort, and put back into string vector
+		// sort numbers and put strings back into vector in this order
 		// Note: this somewhate convoluted way of doing a numerical sort of strings is done to
 		// ensure that at the end the field values strings are exactly as they originally appeared.
 		// Any added training zeros or rounding may cause problems later on when exact string matching
 		// is attempted.
-		std::vector<NumericStringSorter> fieldNumeric;
-		for(uint i = 0; i < values.size(); ++i)
-		{
-			fieldNumeric.push_back(NumericStringSorter(utils::StringTools::ToDouble(values.at(i)), i));
-		}
-
-		std::sort(fieldNumeric.begin(), fieldNumeric.end(), NumericStringSorter::NumericStringPredicate); 
+		std::stable_sort(fieldNumeric.begin(), fieldNumeric.end(), NumericStringSorter::NumericStringPredicate); 
 
-		std::vector<std::wstring> sortedFieldValues;
-		foreach(NumericStringSorter numeric, fieldNumeric)
+		std::vector<QString> sortedFieldValues;
+		sortedFieldValues.reserve(values.size());
+		for(const NumericStringSorter& numeric : fieldNumeric)
 		{
 			sortedFieldValues.push_back(values.at(numeric.index));
 		}
 
-		values = sortedFieldValues;
+		values.swap(sortedFieldValues);
 	}
 	else
 	{
 		// sort in lexigraphical order
 		std::sort(values.begin(), values.end());
 	}
-}
\ No newline at end of file
+}
+
+void AlphaNumericSorter::Sort(std::vector<std::wstring>& values)
+{
+	std::vector<QString> strings;
+	strings.reserve(values.size());
+	for(const std::wstring& value : values)
+		strings.push_back(QString::fromStdWString(value));
+
+	Sort(strings);
+
+	for(uint i = 0; i < strings.size(); ++i)
+		values[i] = strings[i].toStdWString();
+}
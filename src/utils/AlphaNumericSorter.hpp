@@ -10,7 +10,10 @@
 #ifndef _ALPHA_NUMERIC_SORTER_HPP_
 #define _ALPHA_NUMERIC_SORTER_HPP_
 
-#include "../core/Precompiled.hpp"
+#include <QString>
+
+#include <string>
+#include <vector>
 
 namespace utils
 {
@@ -22,6 +25,12 @@ class AlphaNumericSorter
 {
 public:
 
+	/** 
+	 * @brief Sort field values either in lexigraphically or numerically. 
+	 * @param values Vector of values to be sorted.
+	 */
+	static void Sort(std::vector<QString>& values);
+
 	/** 
 	 * @brief Sort field values either in lexigraphically or numerically. 
 	 * @param values Vector of values to be sorted.
@@ -0,0 +1,211 @@
+#include "BufferedWriter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace utils;
+
+BufferedWriter::BufferedWriter(QIODevice* device, COMPRESSION compression, int bufferSize)
+    : m_device(device), m_compression(compression), m_bufferSize(bufferSize),
+      m_bFinished(false), m_bError(false), m_bytesWritten(0)
+{
+    m_buffer.reserve(bufferSize + 64);
+
+    memset(&m_zstream, 0, sizeof(m_zstream));
+    if(m_compression != NO_COMPRESSION)
+    {
+        // a window size of 15 + 16 produces a gzip header and trailer rather than a zlib one
+        int windowBits = (m_compression == GZIP_COMPRESSION) ? 15 + 16 : 15;
+        if(deflateInit2(&m_zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            m_bError = true;
+
+        m_deflated.resize(qMax(bufferSize / 2, 4096));
+    }
+}
+
+BufferedWriter::~BufferedWriter()
+{
+    if(!m_bFinished)
+        Finish();
+}
+
+void BufferedWriter::Write(const char* data, int length)
+{
+    if(m_buffer.size() + length > m_bufferSize)
+    {
+        Flush();
+
+        // write large blocks directly rather than copying them into the buffer
+        if(length > m_bufferSize)
+        {
+            Output(data, length, false);
+            return;
+        }
+    }
+
+    m_buffer.append(data, length);
+}
+
+void BufferedWriter::Number(double value, int precision)
+{
+    // fixed point formatting is considerably faster than QByteArray::number()
+    // and avoids the allocation of a temporary for every number written
+    char digits[64];
+    int pos = sizeof(digits);
+
+    if(!std::isfinite(value))
+        value = 0;
+
+    bool bNegative = value < 0;
+    if(bNegative)
+        value = -value;
+
+    double scale = pow(10.0, precision);
+    quint64 scaled = quint64(value * scale + 0.5);
+    quint64 integer = scaled / quint64(scale);
+    quint64 fraction = scaled % quint64(scale);
+
+    // fractional digits without trailing zeros
+    int fractionDigits = precision;
+    while(fractionDigits > 0 && fraction % 10 == 0)
+    {
+        fraction /= 10;
+        fractionDigits--;
+    }
+
+    if(fractionDigits > 0)
+    {
+        for(int i = 0; i < fractionDigits; ++i)
+        {
+            digits[--pos] = char('0' + fraction % 10);
+            fraction /= 10;
+        }
+        digits[--pos] = '.';
+    }
+
+    do
+    {
+        digits[--pos] = char('0' + integer % 10);
+        integer /= 10;
+    } while(integer > 0);
+
+    if(bNegative && (scaled > 0))
+        digits[--pos] = '-';
+
+    Write(digits + pos, int(sizeof(digits)) - pos);
+}
+
+void BufferedWriter::Significant(double value, int digits)
+{
+    if(value == 0 || !std::isfinite(value))
+    {
+        Number(value, 0);
+        return;
+    }
+
+    // values with a small exponent are written in fixed point notation which avoids
+    // the considerably slower general purpose formatting of snprintf()
+    int exponent = int(floor(log10(fabs(value))));
+    if(exponent >= -5 && exponent < digits && digits - 1 - exponent <= 15)
+    {
+        Number(value, std::max(0, digits - 1 - exponent));
+        return;
+    }
+
+    char str[32];
+    int length = snprintf(str, sizeof(str), "%.*g", digits, value);
+    Write(str, length);
+}
+
+void BufferedWriter::Write(const QString& str)
+{
+    if(m_buffer.size() + str.size() > m_bufferSize)
+        Flush();
+
+    // ASCII strings are copied directly to avoid converting each string to a temporary byte array
+    const QChar* data = str.constData();
+    int length = str.size();
+    for(int i = 0; i < length; ++i)
+    {
+        if(data[i].unicode() >= 0x80)
+        {
+            QByteArray utf8 = str.mid(i).toUtf8();
+            Write(utf8.constData(), utf8.size());
+            return;
+        }
+
+        m_buffer.append(char(data[i].unicode()));
+    }
+}
+
+bool BufferedWriter::Flush()
+{
+    if(m_buffer.isEmpty())
+        return !m_bError;
+
+    bool bOk = Output(m_buffer.constData(), m_buffer.size(), false);
+    m_buffer.clear();
+
+    return bOk;
+}
+
+bool BufferedWriter::Finish()
+{
+    if(m_bFinished)
+        return !m_bError;
+
+    bool bOk = Output(m_buffer.constData(), m_buffer.size(), true);
+    m_buffer.clear();
+    m_bFinished = true;
+
+    if(m_compression != NO_COMPRESSION)
+        deflateEnd(&m_zstream);
+
+    return bOk && !m_bError;
+}
+
+bool BufferedWriter::Output(const char* data, int length, bool bFinish)
+{
+    if(m_bError || m_bFinished)
+        return false;
+
+    if(m_compression == NO_COMPRESSION)
+        return length == 0 || WriteDevice(data, length);
+
+    m_zstream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    m_zstream.avail_in = uInt(length);
+
+    int result = Z_OK;
+    do
+    {
+        m_zstream.next_out = reinterpret_cast<Bytef*>(m_deflated.data());
+        m_zstream.avail_out = uInt(m_deflated.size());
+
+        result = deflate(&m_zstream, bFinish ? Z_FINISH : Z_NO_FLUSH);
+        if(result == Z_STREAM_ERROR)
+        {
+            m_bError = true;
+            return false;
+        }
+
+        qint64 bytes = m_deflated.size() - m_zstream.avail_out;
+        if(bytes > 0 && !WriteDevice(m_deflated.constData(), bytes))
+            return false;
+    } while(m_zstream.avail_in > 0 || m_zstream.avail_out == 0 || (bFinish && result != Z_STREAM_END));
+
+    return true;
+}
+
+bool BufferedWriter::WriteDevice(const char* data, qint64 length)
+{
+    if(m_device->write(data, length) != length)
+    {
+        m_bError = true;
+        return false;
+    }
+
+    m_bytesWritten += length;
+    return true;
+}
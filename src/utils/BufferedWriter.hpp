@@ -0,0 +1,130 @@
+#ifndef _BUFFERED_WRITER_HPP_
+#define _BUFFERED_WRITER_HPP_
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+
+#include <cstring>
+#include <zlib.h>
+
+namespace utils
+{
+
+/**
+ * @brief Buffered, optionally compressed, writer for large text output.
+ *
+ * Output is accumulated in a fixed size buffer and passed to the device
+ * (compressing it first if requested) only when the buffer is full. This
+ * avoids the per-call overhead of QTextStream and allows files to be written
+ * in a single pass with bounded memory.
+ *
+ * Code example:
+ * @code
+ * QFile file("tree.svg");
+ * file.open(QIODevice::WriteOnly);
+ * BufferedWriter writer(&file);
+ * writer << "<svg>" << '\n';
+ * writer.Number(10.25f);
+ * if(!writer.Finish())
+ *     qWarning() << "failed to write file";
+ * @endcode
+ */
+class BufferedWriter
+{
+public:
+    enum COMPRESSION { NO_COMPRESSION, ZLIB_COMPRESSION, GZIP_COMPRESSION };
+
+public:
+    /**
+     * @brief Constructor.
+     * @param device Open device to write to. Not owned by the writer.
+     * @param compression Compression applied to data before it is written to the device.
+     * @param bufferSize Number of bytes buffered before data is written to the device.
+     */
+    BufferedWriter(QIODevice* device, COMPRESSION compression = NO_COMPRESSION, int bufferSize = 1 << 20);
+
+    /** Destructor. Finishes writing if Finish() has not been called. */
+    ~BufferedWriter();
+
+    /** Append raw bytes. */
+    void Write(const char* data, int length);
+
+    /**
+     * @brief Append a number in fixed point notation without trailing zeros.
+     * @param value Value to write.
+     * @param precision Maximum number of digits after the decimal point.
+     */
+    void Number(double value, int precision = 2);
+
+    /**
+     * @brief Append a number with a fixed number of significant digits (i.e., as printf's %g would).
+     * @param value Value to write.
+     * @param digits Number of significant digits.
+     */
+    void Significant(double value, int digits = 6);
+
+    /** Append a string encoded as UTF-8. */
+    void Write(const QString& str);
+
+    BufferedWriter& operator<<(const char* str) { Write(str, int(strlen(str))); return *this; }
+    BufferedWriter& operator<<(const QByteArray& data) { Write(data.constData(), data.size()); return *this; }
+    BufferedWriter& operator<<(const QString& str) { Write(str); return *this; }
+    BufferedWriter& operator<<(char c) { if(m_buffer.size() >= m_bufferSize) Flush(); m_buffer.append(c); return *this; }
+    BufferedWriter& operator<<(int value) { return *this << QByteArray::number(value); }
+    BufferedWriter& operator<<(uint value) { return *this << QByteArray::number(value); }
+
+    /** Pass all buffered data to the device. Compressed data may be held back by the compressor until Finish() is called. */
+    bool Flush();
+
+    /**
+     * @brief Write all remaining data and end the compressed stream.
+     * @return True if all data was successfully written, else false.
+     */
+    bool Finish();
+
+    /** Check if writing to the device has failed. */
+    bool HasError() const { return m_bError; }
+
+    /** Number of bytes passed to the device (i.e., after compression). */
+    qint64 GetBytesWritten() const { return m_bytesWritten; }
+
+protected:
+    /** Compress or write a block of data. */
+    bool Output(const char* data, int length, bool bFinish);
+
+    /** Write data to the device, recording any error. */
+    bool WriteDevice(const char* data, qint64 length);
+
+protected:
+    /** Device data is written to. */
+    QIODevice* m_device;
+
+    /** Compression applied to data. */
+    COMPRESSION m_compression;
+
+    /** Uncompressed data waiting to be written. */
+    QByteArray m_buffer;
+
+    /** Number of bytes buffered before data is written. */
+    int m_bufferSize;
+
+    /** Compressed data waiting to be written. */
+    QByteArray m_deflated;
+
+    /** Compression state. */
+    z_stream m_zstream;
+
+    /** Flag indicating if writing has finished. */
+    bool m_bFinished;
+
+    /** Flag indicating if writing to the device has failed. */
+    bool m_bError;
+
+    /** Number of bytes passed to the device. */
+    qint64 m_bytesWritten;
+};
+
+}
+
+#endif
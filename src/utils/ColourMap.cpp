@@ -7,16 +7,37 @@
 // http://creativecommons.org/licenses/by-sa/3.0/
 //=======================================================================
 
-#include "../core/Precompiled.hpp"
-
 #include "../utils/ColourMap.hpp"
-#include "../utils/Log.hpp"
-#include "../utils/StringTools.hpp"
+
+#include <QFile>
+#include <QTextStream>
 
 using namespace utils;
 
 Colour ColourMap::m_defaultColour = Colour(0,0,0);
 
+namespace
+{
+	/** Read the value of a "Name: value" line of a colour map file. */
+	QString ReadField(QTextStream& stream)
+	{
+		QString line = stream.readLine();
+		return line.mid(line.indexOf(':')+1).trimmed();
+	}
+
+	ColourMap::TYPE ParseType(const QString& type)
+	{
+		if(type == "DISCRETE")
+			return ColourMap::DISCRETE;
+		else if(type == "CONTINUOUS")
+			return ColourMap::CONTINUOUS;
+		else if(type == "CATEGORICAL")
+			return ColourMap::CATEGORICAL;
+
+		return ColourMap::UNKNOWN;
+	}
+}
+
 ColourMap::ColourMap(ColourMapPtr colourMap)
 {
 	CopyColourMap(colourMap);
@@ -56,80 +77,47 @@ uint ColourMap::GetSize() const
   return m_colourMap.size();
 }
 
-ColourMap::TYPE ColourMap::ReadType(const std::wstring& filename)
+ColourMap::TYPE ColourMap::ReadType(const QString& filename)
 {
-	std::string tmp(filename.begin(), filename.end());
-	std::wifstream file(tmp.c_str());
-	if(!file)
-	{
-		utils::Log::Inst().Error(_T("(Error) ColourMap::ReadType(): invalid colour map file."));
+	QFile file(filename);
+	if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
 		return UNKNOWN;
-	}
-
-	const uint DATA_SIZE = 256;
-	wchar_t data[DATA_SIZE];
-	std::wstring dataStr;
 
 	// read type of colour map
-	file.getline(data, DATA_SIZE);
-	dataStr = data;
-	uint pos = dataStr.find(_T(":"));	
-	std::wstring type = dataStr.substr(pos+1);
-	type = utils::StringTools::RemoveSurroundingWhiteSpaces(type);
-	if(type == _T("DISCRETE"))
-		return DISCRETE;
-	else if(type == _T("CONTINUOUS"))
-		return CONTINUOUS;
-	else if(type == _T("CATEGORICAL"))
-		return CATEGORICAL;
-
-	return UNKNOWN;
+	QTextStream stream(&file);
+	return ParseType(ReadField(stream));
 }
 
-
-bool ColourMap::Load(const std::wstring& filename)
+bool ColourMap::Load(const QString& filename)
 {
-	std::string tmp(filename.begin(), filename.end());
-	std::wifstream file(tmp.c_str());
-	if(!file)
+	QFile file(filename);
+	if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
 		return false;
 
-	const uint DATA_SIZE = 256;
-	wchar_t data[DATA_SIZE];
-	std::wstring dataStr;
+	QTextStream stream(&file);
 
 	// read type of colour map
-	file.getline(data, DATA_SIZE);
-	dataStr = data;
-	uint pos = dataStr.find(_T(":"));	
-	std::wstring type = dataStr.substr(pos+1);
-	type = utils::StringTools::RemoveSurroundingWhiteSpaces(type);
-	if(type == _T("DISCRETE"))
-		m_type = DISCRETE;
-	else if(type == _T("CONTINUOUS"))
-		m_type = CONTINUOUS;
-	else if(type == _T("CATEGORICAL"))
-		m_type = CATEGORICAL;
+	TYPE type = ParseType(ReadField(stream));
+	if(type != UNKNOWN)
+		m_type = type;
 
 	// read name of colour map
-	file.getline(data, DATA_SIZE);
-	dataStr = data;
-	pos = dataStr.find(_T(":"));	
-	m_name = dataStr.substr(pos+1);
-	m_name = utils::StringTools::RemoveSurroundingWhiteSpaces(m_name);
+	m_name = ReadField(stream);
 
 	// read number of colours in colour map
-	file.getline(data, DATA_SIZE);
-	dataStr = data;
-	pos = dataStr.find(_T(":"));	
-	std::wstring numColoursStr = dataStr.substr(pos+1);
-	uint numColours = utils::StringTools::ToInt(utils::StringTools::RemoveSurroundingWhiteSpaces(numColoursStr));
+	bool bOk;
+	uint numColours = ReadField(stream).toUInt(&bOk);
+	if(!bOk)
+		return false;
 
 	// read in colours
 	int red, green, blue;
 	for(uint i = 0; i < numColours; ++i)
 	{
-		file >> red >> green >> blue;
+		stream >> red >> green >> blue;
+		if(stream.status() != QTextStream::Ok)
+			return false;
+
 		m_colourMap.push_back(Colour(red, green, blue));
 	}
 
@@ -142,5 +130,5 @@ void ColourMap::SetCustom(bool custom)
 	m_type = DISCRETE;
 
 	if(m_bCustom)
-		m_name = _T("Custom");
+		m_name = "Custom";
 }
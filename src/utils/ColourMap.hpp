@@ -13,6 +13,10 @@
 
 #include "../utils/Colour.hpp"
 
+#include <QString>
+
+#include <vector>
+
 namespace utils
 {
 
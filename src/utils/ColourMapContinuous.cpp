@@ -7,28 +7,28 @@
 // http://creativecommons.org/licenses/by-sa/3.0/
 //=======================================================================
 
-#include "../core/Precompiled.hpp"
-
 #include "../utils/ColourMapContinuous.hpp"
-#include "../utils/Log.hpp"
-#include "../utils/StringTools.hpp"
+
+#include <algorithm>
+#include <cmath>
 
 using namespace utils;
 
 Colour ColourMapContinuous::GetColour(float value, float minValue, float maxValue) const
 {
-	if(maxValue == minValue)
+	if(maxValue == minValue || m_colourMap.size() < 2)
 	{
-		return m_colourMap.at(0);
+		return GetColour(0);
 	}
 
 	// determine offset of desired colour between [0, 1]
 	float delta = (value - minValue) / (maxValue - minValue);
+	delta = std::min(1.0f, std::max(0.0f, delta));
 
 	// determine colour "bin" to interpolate colour over
 	float binSize = 1.0 / (m_colourMap.size()-1);
 	uint binIndex = floor(delta / binSize);
-	if(value == maxValue)
+	if(binIndex >= m_colourMap.size()-1)
 	{
 		// degenerate case that doesn't work with above formula
 		binIndex = m_colourMap.size()-2;
@@ -7,11 +7,7 @@
 // http://creativecommons.org/licenses/by-sa/3.0/
 //=======================================================================
 
-#include "../core/Precompiled.hpp"
-
 #include "../utils/ColourMapDiscrete.hpp"
-#include "../utils/Log.hpp"
-#include "../utils/StringTools.hpp"
 
 using namespace utils;
 
@@ -50,9 +46,9 @@ void ColourMapDiscrete::CopyColourMap(ColourMapDiscretePtr colourMap)
 	m_type = colourMap->GetType();
 }
 
-void ColourMapDiscrete::SetColour(const std::wstring& name, const Colour& colour) 
+void ColourMapDiscrete::SetColour(const QString& name, const Colour& colour) 
 { 
-	std::map<std::wstring, Colour>::iterator it = m_colourNames.find(name);
+	std::map<QString, Colour>::iterator it = m_colourNames.find(name);
 	if(it != m_colourNames.end())
 	{
 		it->second = colour;
@@ -63,9 +59,9 @@ void ColourMapDiscrete::SetColour(const std::wstring& name, const Colour& colour
 	}
 }
 
-bool ColourMapDiscrete::GetColour(const std::wstring& name, Colour& colour) const
+bool ColourMapDiscrete::GetColour(const QString& name, Colour& colour) const
 {
-	std::map<std::wstring, Colour>::const_iterator it = m_colourNames.find(name);
+	std::map<QString, Colour>::const_iterator it = m_colourNames.find(name);
 	if(it == m_colourNames.end())
 	{
 		colour = ColourMap::GetDefaultColour();
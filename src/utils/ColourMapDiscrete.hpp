@@ -14,6 +14,8 @@
 
 #include "../utils/Colour.hpp"
 
+#include <map>
+
 namespace utils
 {
 
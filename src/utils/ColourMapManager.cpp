@@ -7,48 +7,50 @@
 // http://creativecommons.org/licenses/by-sa/3.0/
 //=======================================================================
 
-#include "../core/Precompiled.hpp"
-
 #include "../utils/ColourMapManager.hpp"
 #include "../utils/ColourMap.hpp"
 #include "../utils/ColourMapContinuous.hpp"
 #include "../utils/ColourMapDiscrete.hpp"
 
-#include "../utils/Log.hpp"
+#include <QDir>
+#include <QtDebug>
 
 using namespace utils;
 
-const std::wstring& ColourMapManager::GetLastSelectedCategorical() 
+const char* ColourMapManager::DEFAULT_PATH = ":/resources/colourMaps";
+
+const QString& ColourMapManager::GetLastSelectedCategorical() 
 { 
-	if(m_lastCategoricalMap.empty())
-		m_lastCategoricalMap = _T("Ware [9]");
+	if(m_lastCategoricalMap.isEmpty())
+		m_lastCategoricalMap = "Ware [9]";
 
 	return m_lastCategoricalMap; 
 }
 
-const std::wstring& ColourMapManager::GetLastSelectedContinuous() 
+const QString& ColourMapManager::GetLastSelectedContinuous() 
 { 
-	if(m_lastContinuousMap.empty())
-		m_lastContinuousMap = _T("Spectral");
+	if(m_lastContinuousMap.isEmpty())
+		m_lastContinuousMap = "Spectral";
 
 	return m_lastContinuousMap; 
 }
 
-const std::wstring& ColourMapManager::GetLastSelectedDiscrete() 
+const QString& ColourMapManager::GetLastSelectedDiscrete() 
 { 
-	if(m_lastDiscreteMap.empty())
-		m_lastDiscreteMap = _T("Diverging Spectral [8]");
+	if(m_lastDiscreteMap.isEmpty())
+		m_lastDiscreteMap = "Diverging Spectral [8]";
 
 	return m_lastDiscreteMap; 
 }
 
-void ColourMapManager::SetLastSelected(const std::wstring mapName)
+void ColourMapManager::SetLastSelected(const QString& mapName)
 {
-	std::map<std::wstring, ColourMapPtr>::const_iterator it;
+	std::map<QString, ColourMapPtr>::const_iterator it;
 	it = m_colourMaps.find(mapName);
 	if(it == m_colourMaps.end())
 	{
-		utils::Log::Inst().Error(_T("(Error) ColourMapManager::SetLastSelected: Failed to locate colour map with specified name."));
+		qWarning() << "ColourMapManager::SetLastSelected: Failed to locate colour map with specified name.";
+		return;
 	}
 
 	if(it->second->GetType() == ColourMap::CATEGORICAL)
@@ -61,112 +63,82 @@ void ColourMapManager::SetLastSelected(const std::wstring mapName)
 
 ColourMapPtr ColourMapManager::GetDefaultDiscreteMap()
 {
-	ColourMapConstIter it = m_colourMaps.find(_T("Diverging Spectral [8]"));
-	if(it == m_colourMaps.end())
-	{
-		utils::Log::Inst().Error(_T("ColourMapManager::GetDefaultDiscreteMap: default discrete map is missing."));
-		return m_colourMaps.begin()->second;
-	}
-
-	return it->second;
+	return GetColourMap("Diverging Spectral [8]");
 }
 
 ColourMapPtr ColourMapManager::GetDefaultContinuousMap()
 {
-	ColourMapConstIter it = m_colourMaps.find(_T("Spectral"));
-	if(it == m_colourMaps.end())
-	{
-		utils::Log::Inst().Error(_T("ColourMapManager::GetDefaultContinuousMap: default continuous map is missing."));
-		return m_colourMaps.begin()->second;
-	}
-
-	return it->second;
+	return GetColourMap("Spectral");
 }
 
 ColourMapPtr ColourMapManager::GetDefaultCategoricalMap()
 {
-	ColourMapConstIter it = m_colourMaps.find(_T("Ware [9]"));
-	if(it == m_colourMaps.end())
-	{
-		utils::Log::Inst().Error(_T("ColourMapManager::GetDefaultCategoricalColour: default categorical map is missing."));
-		return m_colourMaps.begin()->second;
-	}
-
-	return it->second;
+	return GetColourMap("Ware [9]");
 }
 
-ColourMapPtr ColourMapManager::GetColourMap(const std::wstring& name)
+ColourMapPtr ColourMapManager::GetColourMap(const QString& name)
 {
 	ColourMapConstIter it = m_colourMaps.find(name);
 	if(it == m_colourMaps.end())
 	{
-		utils::Log::Inst().Error(_T("ColourMapManager::GetColourMap: unrecognized colour map name."));
+		qWarning() << "ColourMapManager::GetColourMap: unrecognized colour map name" << name;
+		if(m_colourMaps.empty())
+			return ColourMapPtr();
+
 		return m_colourMaps.begin()->second;
 	}
 
 	return it->second;
 }
 
-bool ColourMapManager::LoadColourMaps(const std::wstring& colorMapPath)
+bool ColourMapManager::LoadColourMaps(const QString& colorMapPath)
 {
-	using namespace boost::filesystem; 
-	
 	// check if colour map directory exists
-	path colorMapDir(colorMapPath);
-	if(!exists(colorMapDir)) 
+	QDir colorMapDir(colorMapPath);
+	if(!colorMapDir.exists()) 
 	{
-		utils::Log::Inst().Error(_T("ColourMapManager::LoadColourMaps(): failed to open colour map directory."));
+		qWarning() << "ColourMapManager::LoadColourMaps(): failed to open colour map directory" << colorMapPath;
 		return false;
 	}
 
 	// iterate over all files in colour map directory
-	directory_iterator end_itr; 
-	ColourMapPtr tempColourMap(new ColourMap());
-	bool bSuccess;
-  for(directory_iterator itr(colorMapDir); itr != end_itr; ++itr)
-  {
-		if (!is_directory(itr->status()))
+	ColourMap tempColourMap;
+	foreach(const QString& name, colorMapDir.entryList(QDir::Files, QDir::Name))
+	{
+		QString filename = colorMapDir.filePath(name);
+		ColourMap::TYPE type = tempColourMap.ReadType(filename);
+		ColourMapPtr colourMap;
+		if(type == ColourMap::CONTINUOUS)
+		{
+			colourMap.reset(new ColourMapContinuous());
+		}
+		else if(type == ColourMap::DISCRETE || type == ColourMap::CATEGORICAL)
 		{
-			std::wstring filename = itr->path().wstring();
-			ColourMap::TYPE type = tempColourMap->ReadType(filename);
-			ColourMapPtr colourMap;
-			if(type == ColourMap::CONTINUOUS)
-			{
-				colourMap.reset(new ColourMapContinuous());
-				bSuccess = colourMap->Load(filename);
-			}
-			else if(type == ColourMap::DISCRETE || type == ColourMap::CATEGORICAL)
-			{
-				colourMap.reset(new ColourMapDiscrete());
-				bSuccess = colourMap->Load(filename);
-			}
-			else
-			{
-				utils::Log::Inst().Error(_T("ColourMapManager::LoadColourMaps(): invalid colour map found in colour map directory."));
-				return false;
-			}
-
-
-			if(bSuccess)
-			{
-				m_colourMaps[colourMap->GetName()] = colourMap;
-			}
-			else
-			{
-				utils::Log::Inst().Error(_T("ColourMapManager::LoadColourMaps(): failed to parse colour map found in colour map directory."));
-				return false;
-			}
+			colourMap.reset(new ColourMapDiscrete());
 		}
-  }
+		else
+		{
+			qWarning() << "ColourMapManager::LoadColourMaps(): invalid colour map found in colour map directory:" << name;
+			return false;
+		}
+
+		if(!colourMap->Load(filename))
+		{
+			qWarning() << "ColourMapManager::LoadColourMaps(): failed to parse colour map found in colour map directory:" << name;
+			return false;
+		}
+
+		m_colourMaps[colourMap->GetName()] = colourMap;
+	}
 
 	return true;
 }
 
-std::vector<std::wstring> ColourMapManager::GetCategoricalMaps() const
+std::vector<QString> ColourMapManager::GetCategoricalMaps() const
 {
-	std::vector<std::wstring> maps;
+	std::vector<QString> maps;
 
-	typedef std::pair<std::wstring, ColourMapPtr> pair_t;
+	typedef std::pair<QString, ColourMapPtr> pair_t;
 	foreach(pair_t map, m_colourMaps)
 	{
 		if(map.second->GetType() == ColourMap::CATEGORICAL)
@@ -176,11 +148,11 @@ std::vector<std::wstring> ColourMapManager::GetCategoricalMaps() const
 	return maps;
 }
 
-std::vector<std::wstring> ColourMapManager::GetContinuousMaps() const
+std::vector<QString> ColourMapManager::GetContinuousMaps() const
 {
-	std::vector<std::wstring> maps;
+	std::vector<QString> maps;
 
-	typedef std::pair<std::wstring, ColourMapPtr> pair_t;
+	typedef std::pair<QString, ColourMapPtr> pair_t;
 	foreach(pair_t map, m_colourMaps)
 	{
 		if(map.second->GetType() == ColourMap::CONTINUOUS)
@@ -190,11 +162,11 @@ std::vector<std::wstring> ColourMapManager::GetContinuousMaps() const
 	return maps;
 }
 
-std::vector<std::wstring> ColourMapManager::GetDiscreteMaps() const
+std::vector<QString> ColourMapManager::GetDiscreteMaps() const
 {
-	std::vector<std::wstring> maps;
+	std::vector<QString> maps;
 
-	typedef std::pair<std::wstring, ColourMapPtr> pair_t;
+	typedef std::pair<QString, ColourMapPtr> pair_t;
 	foreach(pair_t map, m_colourMaps)
 	{
 		if(map.second->GetType() == ColourMap::DISCRETE)
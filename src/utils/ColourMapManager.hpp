@@ -10,6 +10,13 @@
 #ifndef _COLOUR_MAP_MANAGER_
 #define _COLOUR_MAP_MANAGER_
 
+#include "../core/DataTypes.hpp"
+
+#include <QString>
+
+#include <map>
+#include <vector>
+
 namespace utils
 {
 
@@ -20,8 +27,12 @@ namespace utils
 class ColourMapManager
 {
 public:
-	typedef std::map<std::wstring, ColourMapPtr>::const_iterator ColourMapConstIter;
-	typedef std::pair<std::wstring, ColourMapPtr> ColourMapPair;
+	/** Directory of the colour maps distributed with pygmy. */
+	static const char* DEFAULT_PATH;
+
+public:
+	typedef std::map<QString, ColourMapPtr>::const_iterator ColourMapConstIter;
+	typedef std::pair<QString, ColourMapPtr> ColourMapPair;
 
 public:
 	/** Constructor. */
@@ -31,7 +42,7 @@ public:
 	virtual ~ColourMapManager() {}
 
 	/** Get colour map with the provided name. */
-	ColourMapPtr GetColourMap(const std::wstring& name);
+	ColourMapPtr GetColourMap(const QString& name);
 
 	/** Get default discrete colour map. */
 	ColourMapPtr GetDefaultDiscreteMap();
@@ -44,47 +55,47 @@ public:
 
 	/** 
 	 * @brief Load all colour maps in a directory. 
-	 * @param colorMapPath Path to directory containing predefined colour maps.
+	 * @param colorMapPath Path to directory containing predefined colour maps (e.g., DEFAULT_PATH).
 	 * @return True if colour maps loaded successfully, otherwise False.
 	 */
-	bool LoadColourMaps(const std::wstring& colorMapPath);
+	bool LoadColourMaps(const QString& colorMapPath);
 
 	/** Get all colour maps. */
-	const std::map<std::wstring, ColourMapPtr>& GetMaps() const { return m_colourMaps; }
+	const std::map<QString, ColourMapPtr>& GetMaps() const { return m_colourMaps; }
 
 	/** Get categorical colour maps. */
-	std::vector<std::wstring> GetCategoricalMaps() const;
+	std::vector<QString> GetCategoricalMaps() const;
 
 	/** Get continuous colour maps. */
-	std::vector<std::wstring> GetContinuousMaps() const;
+	std::vector<QString> GetContinuousMaps() const;
 
 	/** Get discrete colour maps. */
-	std::vector<std::wstring> GetDiscreteMaps() const;
+	std::vector<QString> GetDiscreteMaps() const;
 
 	/** Get last selected categorical colour map. */
-	const std::wstring& GetLastSelectedCategorical();
+	const QString& GetLastSelectedCategorical();
 
 	/** Get last selected continuous colour map. */
-	const std::wstring& GetLastSelectedContinuous();
+	const QString& GetLastSelectedContinuous();
 
 	/** Get last selected discrete colour map. */
-	const std::wstring& GetLastSelectedDiscrete();
+	const QString& GetLastSelectedDiscrete();
 
 	/** Set last selected colour map. */
-	void SetLastSelected(const std::wstring mapName);
+	void SetLastSelected(const QString& mapName);
 	
 protected:
 	/** All supported colour maps. */
-	std::map<std::wstring, ColourMapPtr> m_colourMaps;
+	std::map<QString, ColourMapPtr> m_colourMaps;
 
 	/** Last selected categorical colour map. */
-	std::wstring m_lastCategoricalMap;
+	QString m_lastCategoricalMap;
 
 	/** Last selected continuous colour map. */
-	std::wstring m_lastContinuousMap; 
+	QString m_lastContinuousMap; 
 
 	/** Last selected discrete colour map. */
-	std::wstring m_lastDiscreteMap; 
+	QString m_lastDiscreteMap; 
 };
 
 }
@@ -7,11 +7,14 @@
 // http://creativecommons.org/licenses/by-sa/3.0/
 //=======================================================================
 
-#include "../core/Precompiled.hpp"
-
+#include "../utils/Common.hpp"
 #include "../utils/Geometry.hpp"
 #include "../utils/Error.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
 using namespace utils;
 
 const double eps = 1e-6;
@@ -0,0 +1,392 @@
+#include "ImageStreamWriter.hpp"
+
+#include <QByteArray>
+#include <QFileInfo>
+
+#include <cstring>
+
+using namespace utils;
+
+namespace
+{
+    /** Size of compressed data written in each PNG IDAT chunk. */
+    const uint PNG_CHUNK_SIZE = 256*1024;
+
+    /** Approximate size of each uncompressed TIFF strip. */
+    const uint TIFF_STRIP_SIZE = 64*1024;
+
+    /** Number of entries in the TIFF image file directory. */
+    const uint TIFF_DIRECTORY_ENTRIES = 13;
+
+    enum TIFF_TYPE { TIFF_SHORT = 3, TIFF_LONG = 4, TIFF_RATIONAL = 5 };
+
+    void AppendBigEndian32(QByteArray& buffer, quint32 value)
+    {
+        buffer.append(char((value >> 24) & 0xFF));
+        buffer.append(char((value >> 16) & 0xFF));
+        buffer.append(char((value >> 8) & 0xFF));
+        buffer.append(char(value & 0xFF));
+    }
+
+    void AppendLittleEndian16(QByteArray& buffer, quint16 value)
+    {
+        buffer.append(char(value & 0xFF));
+        buffer.append(char((value >> 8) & 0xFF));
+    }
+
+    void AppendLittleEndian32(QByteArray& buffer, quint32 value)
+    {
+        buffer.append(char(value & 0xFF));
+        buffer.append(char((value >> 8) & 0xFF));
+        buffer.append(char((value >> 16) & 0xFF));
+        buffer.append(char((value >> 24) & 0xFF));
+    }
+
+    void AppendTiffEntry(QByteArray& buffer, quint16 tag, quint16 type, quint32 count, quint32 value)
+    {
+        AppendLittleEndian16(buffer, tag);
+        AppendLittleEndian16(buffer, type);
+        AppendLittleEndian32(buffer, count);
+        AppendLittleEndian32(buffer, value);
+    }
+
+    /** Offset of the TIFF image file directory, which directly follows the image data. */
+    quint64 TiffDirectoryOffset(uint width, uint height)
+    {
+        quint64 dataSize = quint64(width) * height * 3;
+        return 8 + dataSize + (dataSize & 1);
+    }
+
+    uint TiffRowsPerStrip(uint width)
+    {
+        return qMax(1u, TIFF_STRIP_SIZE / (width*3));
+    }
+}
+
+ImageStreamWriter::ImageStreamWriter()
+    : m_format(UNKNOWN_FORMAT), m_width(0), m_height(0), m_rowsWritten(0), m_bDeflating(false)
+{
+    memset(&m_zstream, 0, sizeof(m_zstream));
+}
+
+ImageStreamWriter::~ImageStreamWriter()
+{
+    // an image which was never closed is incomplete
+    if(m_file.isOpen())
+        Abort("Image was not closed.");
+}
+
+ImageStreamWriter::FORMAT ImageStreamWriter::FormatFromFilename(const QString& filename)
+{
+    QString suffix = QFileInfo(filename).suffix().toLower();
+    if(suffix == "png")
+        return PNG;
+    else if(suffix == "tif" || suffix == "tiff")
+        return TIFF;
+
+    return UNKNOWN_FORMAT;
+}
+
+bool ImageStreamWriter::Open(const QString& filename, uint width, uint height, FORMAT format)
+{
+    if(m_file.isOpen())
+        Abort("Image was not closed.");
+
+    m_error.clear();
+    m_format = format;
+    m_width = width;
+    m_height = height;
+    m_rowsWritten = 0;
+
+    if(width == 0 || height == 0)
+    {
+        m_error = "Image must be at least 1 pixel wide and high.";
+        return false;
+    }
+
+    if(format == UNKNOWN_FORMAT)
+    {
+        m_error = "Unknown image format. Images must be saved as PNG or TIFF.";
+        return false;
+    }
+
+    if(format == TIFF)
+    {
+        // image data, directory and strip tables must all be addressable with 32-bit offsets
+        quint64 strips = (height + TiffRowsPerStrip(width) - 1) / TiffRowsPerStrip(width);
+        quint64 fileSize = TiffDirectoryOffset(width, height) + 2 + TIFF_DIRECTORY_ENTRIES*12 + 4 + 24 + 8*strips;
+        if(fileSize > 0xFFFFFFFFull)
+        {
+            m_error = "Image is too large to be saved as an uncompressed TIFF. Save the image as a PNG instead.";
+            return false;
+        }
+    }
+
+    m_file.setFileName(filename);
+    if(!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    QByteArray header;
+    if(format == PNG)
+    {
+        m_scanline.assign(1 + width*3, 0);
+        m_previousRow.assign(width*3, 0);
+        m_deflated.resize(PNG_CHUNK_SIZE);
+
+        memset(&m_zstream, 0, sizeof(m_zstream));
+        if(deflateInit(&m_zstream, Z_DEFAULT_COMPRESSION) != Z_OK)
+        {
+            Abort("Failed to initialize PNG compression.");
+            return false;
+        }
+        m_bDeflating = true;
+        m_zstream.next_out = &m_deflated[0];
+        m_zstream.avail_out = m_deflated.size();
+
+        if(!Write("\x89PNG\r\n\x1a\n", 8))
+            return false;
+
+        // 8-bit RGB, no interlacing
+        AppendBigEndian32(header, width);
+        AppendBigEndian32(header, height);
+        header.append(char(8));
+        header.append(char(2));
+        header.append(char(0));
+        header.append(char(0));
+        header.append(char(0));
+        return WritePngChunk("IHDR", reinterpret_cast<const uchar*>(header.constData()), header.size());
+    }
+
+    // little-endian TIFF with the image file directory following the image data
+    header.append("II");
+    AppendLittleEndian16(header, 42);
+    AppendLittleEndian32(header, quint32(TiffDirectoryOffset(width, height)));
+    return Write(header.constData(), header.size());
+}
+
+bool ImageStreamWriter::WriteRows(const uchar* rgb, uint rows)
+{
+    if(!m_file.isOpen())
+    {
+        if(m_error.isEmpty())
+            m_error = "Image has not been opened.";
+        return false;
+    }
+
+    if(m_rowsWritten + rows > m_height)
+    {
+        Abort("More rows written than the height of the image.");
+        return false;
+    }
+
+    uint rowBytes = m_width*3;
+    if(m_format == TIFF)
+    {
+        if(!Write(reinterpret_cast<const char*>(rgb), qint64(rowBytes)*rows))
+            return false;
+    }
+    else
+    {
+        // the 'up' filter is used since trees consist largely of vertical lines and
+        // flat backgrounds which become runs of zeros that compress well
+        for(uint r = 0; r < rows; ++r)
+        {
+            const uchar* row = rgb + qint64(r)*rowBytes;
+            m_scanline[0] = 2;
+            for(uint i = 0; i < rowBytes; ++i)
+                m_scanline[i+1] = uchar(row[i] - m_previousRow[i]);
+            memcpy(&m_previousRow[0], row, rowBytes);
+
+            if(!DeflatePngData(&m_scanline[0], m_scanline.size(), false))
+                return false;
+        }
+    }
+
+    m_rowsWritten += rows;
+    return true;
+}
+
+bool ImageStreamWriter::Close()
+{
+    if(!m_file.isOpen())
+    {
+        if(m_error.isEmpty())
+            m_error = "Image has not been opened.";
+        return false;
+    }
+
+    if(m_rowsWritten != m_height)
+    {
+        Abort(QString("Only %1 of %2 rows were written.").arg(m_rowsWritten).arg(m_height));
+        return false;
+    }
+
+    if(m_format == PNG)
+    {
+        if(!DeflatePngData(NULL, 0, true))
+            return false;
+
+        deflateEnd(&m_zstream);
+        m_bDeflating = false;
+
+        if(!WritePngChunk("IEND", NULL, 0))
+            return false;
+    }
+    else
+    {
+        if(!WriteTiffDirectory())
+            return false;
+    }
+
+    m_file.close();
+    if(m_file.error() != QFileDevice::NoError)
+    {
+        m_error = m_file.errorString();
+        m_file.remove();
+        return false;
+    }
+
+    return true;
+}
+
+bool ImageStreamWriter::WritePngChunk(const char* type, const uchar* data, uint length)
+{
+    QByteArray header;
+    AppendBigEndian32(header, length);
+    header.append(type, 4);
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(type), 4);
+    if(length > 0)
+        crc = crc32(crc, data, length);
+
+    QByteArray footer;
+    AppendBigEndian32(footer, quint32(crc));
+
+    return Write(header.constData(), header.size())
+            && (length == 0 || Write(reinterpret_cast<const char*>(data), length))
+            && Write(footer.constData(), footer.size());
+}
+
+bool ImageStreamWriter::DeflatePngData(const uchar* data, uint length, bool bFinish)
+{
+    m_zstream.next_in = const_cast<Bytef*>(data);
+    m_zstream.avail_in = length;
+
+    int result = Z_OK;
+    do
+    {
+        result = deflate(&m_zstream, bFinish ? Z_FINISH : Z_NO_FLUSH);
+        if(result == Z_STREAM_ERROR)
+        {
+            Abort("Failed to compress PNG image data.");
+            return false;
+        }
+
+        // write a chunk whenever the output buffer is full and once all data has been compressed
+        uint bytes = m_deflated.size() - m_zstream.avail_out;
+        if(m_zstream.avail_out == 0 || (result == Z_STREAM_END && bytes > 0))
+        {
+            if(!WritePngChunk("IDAT", &m_deflated[0], bytes))
+                return false;
+
+            m_zstream.next_out = &m_deflated[0];
+            m_zstream.avail_out = m_deflated.size();
+        }
+    } while(m_zstream.avail_in > 0 || (bFinish && result != Z_STREAM_END));
+
+    return true;
+}
+
+bool ImageStreamWriter::WriteTiffDirectory()
+{
+    quint64 dataSize = quint64(m_width) * m_height * 3;
+    if(dataSize & 1)
+    {
+        if(!Write("\0", 1))
+            return false;
+    }
+
+    uint rowsPerStrip = TiffRowsPerStrip(m_width);
+    uint strips = (m_height + rowsPerStrip - 1) / rowsPerStrip;
+    quint32 stripBytes = rowsPerStrip * m_width * 3;
+
+    // values which do not fit within a directory entry directly follow the directory
+    quint32 directoryOffset = quint32(TiffDirectoryOffset(m_width, m_height));
+    quint32 bitsPerSampleOffset = directoryOffset + 2 + TIFF_DIRECTORY_ENTRIES*12 + 4;
+    quint32 xResolutionOffset = bitsPerSampleOffset + 8;
+    quint32 yResolutionOffset = xResolutionOffset + 8;
+    quint32 stripOffsetsOffset = yResolutionOffset + 8;
+    quint32 stripByteCountsOffset = stripOffsetsOffset + 4*strips;
+
+    quint32 lastStripBytes = quint32(dataSize - quint64(strips-1)*stripBytes);
+
+    QByteArray directory;
+    AppendLittleEndian16(directory, TIFF_DIRECTORY_ENTRIES);
+    AppendTiffEntry(directory, 256, TIFF_LONG, 1, m_width);                 // ImageWidth
+    AppendTiffEntry(directory, 257, TIFF_LONG, 1, m_height);                // ImageLength
+    AppendTiffEntry(directory, 258, TIFF_SHORT, 3, bitsPerSampleOffset);    // BitsPerSample
+    AppendTiffEntry(directory, 259, TIFF_SHORT, 1, 1);                      // Compression: none
+    AppendTiffEntry(directory, 262, TIFF_SHORT, 1, 2);                      // PhotometricInterpretation: RGB
+    AppendTiffEntry(directory, 273, TIFF_LONG, strips, strips == 1 ? 8 : stripOffsetsOffset);                 // StripOffsets
+    AppendTiffEntry(directory, 277, TIFF_SHORT, 1, 3);                      // SamplesPerPixel
+    AppendTiffEntry(directory, 278, TIFF_LONG, 1, rowsPerStrip);            // RowsPerStrip
+    AppendTiffEntry(directory, 279, TIFF_LONG, strips, strips == 1 ? lastStripBytes : stripByteCountsOffset); // StripByteCounts
+    AppendTiffEntry(directory, 282, TIFF_RATIONAL, 1, xResolutionOffset);   // XResolution
+    AppendTiffEntry(directory, 283, TIFF_RATIONAL, 1, yResolutionOffset);   // YResolution
+    AppendTiffEntry(directory, 284, TIFF_SHORT, 1, 1);                      // PlanarConfiguration: interleaved
+    AppendTiffEntry(directory, 296, TIFF_SHORT, 1, 2);                      // ResolutionUnit: inch
+    AppendLittleEndian32(directory, 0);                                     // no further images
+
+    for(uint i = 0; i < 3; ++i)
+        AppendLittleEndian16(directory, 8);
+    AppendLittleEndian16(directory, 0);
+
+    for(uint i = 0; i < 2; ++i)
+    {
+        AppendLittleEndian32(directory, 72);
+        AppendLittleEndian32(directory, 1);
+    }
+
+    if(strips > 1)
+    {
+        for(uint i = 0; i < strips; ++i)
+            AppendLittleEndian32(directory, 8 + i*stripBytes);
+
+        for(uint i = 0; i < strips; ++i)
+            AppendLittleEndian32(directory, i == strips-1 ? lastStripBytes : stripBytes);
+    }
+
+    return Write(directory.constData(), directory.size());
+}
+
+bool ImageStreamWriter::Write(const char* data, qint64 length)
+{
+    if(m_file.write(data, length) != length)
+    {
+        Abort(m_file.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+void ImageStreamWriter::Abort(const QString& error)
+{
+    m_error = error;
+
+    if(m_bDeflating)
+    {
+        deflateEnd(&m_zstream);
+        m_bDeflating = false;
+    }
+
+    if(m_file.isOpen())
+    {
+        m_file.close();
+        m_file.remove();
+    }
+}
@@ -0,0 +1,120 @@
+#ifndef _IMAGE_STREAM_WRITER_HPP_
+#define _IMAGE_STREAM_WRITER_HPP_
+
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+#include <vector>
+#include <zlib.h>
+
+namespace utils
+{
+
+/**
+ * @brief Write an RGB image to file a block of rows at a time.
+ *
+ * Unlike QImage::save() the entire image never has to be held in memory,
+ * so images far larger than the available memory or the maximum size of a
+ * QImage can be written. Rows must be written from the top of the image
+ * to the bottom as tightly packed 8-bit RGB triplets.
+ *
+ * PNG files are deflate compressed. TIFF files are written uncompressed
+ * and are therefore limited to 4 GB.
+ */
+class ImageStreamWriter
+{
+public:
+    enum FORMAT { PNG, TIFF, UNKNOWN_FORMAT };
+
+public:
+    /** Constructor. */
+    ImageStreamWriter();
+
+    /** Destructor. Closes any open image. */
+    ~ImageStreamWriter();
+
+    /** Determine image format from the extension of a file. */
+    static FORMAT FormatFromFilename(const QString& filename);
+
+    /**
+     * @brief Create image file and write its header.
+     * @param filename Name of image file.
+     * @param width Width of image in pixels.
+     * @param height Height of image in pixels.
+     * @param format Format of image.
+     * @return True if file was successfully created, else false.
+     */
+    bool Open(const QString& filename, uint width, uint height, FORMAT format);
+
+    /**
+     * @brief Append rows to image.
+     * @param rgb Pixels of rows in top to bottom order.
+     * @param rows Number of rows to write.
+     * @return True if rows were successfully written, else false.
+     */
+    bool WriteRows(const uchar* rgb, uint rows);
+
+    /**
+     * @brief Finish writing image.
+     * @return True if all rows of the image were written successfully, else false.
+     */
+    bool Close();
+
+    /** Get description of the most recent error. */
+    QString GetError() const { return m_error; }
+
+protected:
+    /** Write a single PNG chunk. */
+    bool WritePngChunk(const char* type, const uchar* data, uint length);
+
+    /** Compress PNG image data and write it as IDAT chunks. */
+    bool DeflatePngData(const uchar* data, uint length, bool bFinish);
+
+    /** Write TIFF image file directory describing the image data. */
+    bool WriteTiffDirectory();
+
+    /** Write data to file, setting an error on failure. */
+    bool Write(const char* data, qint64 length);
+
+    /** Discard partially written image. */
+    void Abort(const QString& error);
+
+protected:
+    /** Image file. */
+    QFile m_file;
+
+    /** Format of image. */
+    FORMAT m_format;
+
+    /** Width of image in pixels. */
+    uint m_width;
+
+    /** Height of image in pixels. */
+    uint m_height;
+
+    /** Number of rows written so far. */
+    uint m_rowsWritten;
+
+    /** Compression state of PNG image data. */
+    z_stream m_zstream;
+
+    /** Flag indicating if m_zstream has been initialized. */
+    bool m_bDeflating;
+
+    /** Buffer for a single filtered PNG scanline. */
+    std::vector<uchar> m_scanline;
+
+    /** Previous row of PNG image, used for filtering. */
+    std::vector<uchar> m_previousRow;
+
+    /** Buffer for compressed PNG image data. */
+    std::vector<uchar> m_deflated;
+
+    /** Description of the most recent error. */
+    QString m_error;
+};
+
+}
+
+#endif
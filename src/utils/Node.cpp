@@ -77,8 +77,7 @@ void Node::RemoveChild(unsigned int pos)
 
 void Node::RemoveChildren() 
 {  
-	while(m_children.size() != 0) 
-		m_children.erase(m_children.begin()); 
+	m_children.clear();
 }
 
 void Node::RemoveChild(Node* node)
@@ -0,0 +1,160 @@
+#include "StreamReader.hpp"
+
+#include <cstring>
+
+using namespace utils;
+
+StreamReader::StreamReader(QIODevice* device, int bufferSize)
+    : m_device(device), m_pos(0), m_end(0), m_offset(0),
+      m_bInitialized(false), m_bCompressed(false), m_bMemberEnd(false)
+{
+    m_buffer.resize(bufferSize);
+    memset(&m_zstream, 0, sizeof(m_zstream));
+}
+
+StreamReader::~StreamReader()
+{
+    if(m_bCompressed)
+        inflateEnd(&m_zstream);
+}
+
+bool StreamReader::IsCompressed()
+{
+    if(!m_bInitialized)
+        Initialize();
+
+    return m_bCompressed;
+}
+
+bool StreamReader::ReadChunk(QByteArray& chunk)
+{
+    if(m_pos == m_end && !Fill())
+    {
+        chunk.clear();
+        return false;
+    }
+
+    chunk = QByteArray(m_buffer.constData() + m_pos, m_end - m_pos);
+    m_pos = m_end;
+
+    return true;
+}
+
+bool StreamReader::Initialize()
+{
+    m_bInitialized = true;
+    m_pos = m_end = 0;
+
+    m_compressed.resize(m_buffer.size());
+    qint64 bytes = m_device->read(m_compressed.data(), m_compressed.size());
+    if(bytes < 0)
+    {
+        m_error = "Failed to read input: " + m_device->errorString();
+        return false;
+    }
+
+    if(bytes >= 2 && uchar(m_compressed.at(0)) == 0x1f && uchar(m_compressed.at(1)) == 0x8b)
+    {
+        // a window size of 15 + 16 only accepts a gzip header and trailer
+        if(inflateInit2(&m_zstream, 15 + 16) != Z_OK)
+        {
+            m_error = "Failed to initialize decompression.";
+            return false;
+        }
+
+        m_bCompressed = true;
+        m_zstream.next_in = (Bytef*)m_compressed.data();
+        m_zstream.avail_in = uInt(bytes);
+
+        return true;
+    }
+
+    // uncompressed input is used directly and the compressed buffer is no longer required
+    memcpy(m_buffer.data(), m_compressed.constData(), size_t(bytes));
+    m_end = int(bytes);
+    m_compressed.clear();
+
+    return true;
+}
+
+bool StreamReader::Fill()
+{
+    if(!m_error.isEmpty())
+        return false;
+
+    if(!m_bInitialized)
+    {
+        if(!Initialize())
+            return false;
+
+        if(m_end > 0)
+            return true;
+    }
+
+    m_offset += m_end;
+    m_pos = m_end = 0;
+
+    if(m_bCompressed)
+        return Inflate();
+
+    qint64 bytes = m_device->read(m_buffer.data(), m_buffer.size());
+    if(bytes < 0)
+    {
+        m_error = "Failed to read input: " + m_device->errorString();
+        return false;
+    }
+
+    m_end = int(bytes);
+
+    return m_end > 0;
+}
+
+bool StreamReader::Inflate()
+{
+    while(m_end == 0)
+    {
+        if(m_zstream.avail_in == 0)
+        {
+            qint64 bytes = m_device->read(m_compressed.data(), m_compressed.size());
+            if(bytes < 0)
+            {
+                m_error = "Failed to read input: " + m_device->errorString();
+                return false;
+            }
+
+            if(bytes == 0)
+            {
+                if(!m_bMemberEnd)
+                    m_error = "Compressed input is truncated.";
+
+                return false;
+            }
+
+            m_zstream.next_in = (Bytef*)m_compressed.data();
+            m_zstream.avail_in = uInt(bytes);
+        }
+
+        if(m_bMemberEnd)
+        {
+            // further data after the end of a gzip member is another member (e.g., appended output)
+            inflateReset(&m_zstream);
+            m_bMemberEnd = false;
+        }
+
+        m_zstream.next_out = (Bytef*)m_buffer.data();
+        m_zstream.avail_out = uInt(m_buffer.size());
+
+        int result = inflate(&m_zstream, Z_NO_FLUSH);
+        if(result == Z_STREAM_END)
+            m_bMemberEnd = true;
+        else if(result != Z_OK && result != Z_BUF_ERROR)
+        {
+            m_error = "Failed to decompress input: " + QString(m_zstream.msg ? m_zstream.msg : "corrupt data");
+            return false;
+        }
+
+        m_end = m_buffer.size() - int(m_zstream.avail_out);
+    }
+
+    return true;
+}
@@ -0,0 +1,125 @@
+#ifndef _STREAM_READER_HPP_
+#define _STREAM_READER_HPP_
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+
+#include <zlib.h>
+
+namespace utils
+{
+
+/**
+ * @brief Buffered, single-pass reader for large text input.
+ *
+ * Data is read from the device in fixed size blocks, so files of any size
+ * can be parsed with bounded memory. Gzip compressed input (including
+ * files built from several concatenated gzip members) is detected from
+ * its leading bytes and decompressed transparently.
+ *
+ * Code example:
+ * @code
+ * QFile file("trees.nex.gz");
+ * file.open(QIODevice::ReadOnly);
+ * StreamReader reader(&file);
+ * int ch;
+ * while((ch = reader.Get()) != StreamReader::END_OF_STREAM)
+ *     ...
+ * if(reader.HasError())
+ *     qWarning() << reader.GetError();
+ * @endcode
+ */
+class StreamReader
+{
+public:
+    /** Value returned by Get() and Peek() once all data has been read. */
+    static const int END_OF_STREAM = -1;
+
+public:
+    /**
+     * @brief Constructor.
+     * @param device Open device to read from. Not owned by the reader.
+     * @param bufferSize Number of bytes read from the device at a time.
+     */
+    StreamReader(QIODevice* device, int bufferSize = 1 << 18);
+
+    /** Destructor. */
+    ~StreamReader();
+
+    /** Get next byte of (decompressed) input, or END_OF_STREAM. */
+    int Get() { return (m_pos < m_end || Fill()) ? uchar(m_buffer.at(m_pos++)) : END_OF_STREAM; }
+
+    /** Get next byte of input without consuming it, or END_OF_STREAM. */
+    int Peek() { return (m_pos < m_end || Fill()) ? uchar(m_buffer.at(m_pos)) : END_OF_STREAM; }
+
+    /**
+     * @brief Get all buffered input, reading a new block if the buffer is empty.
+     * @param chunk Set to the next block of input.
+     * @return False once all data has been read.
+     */
+    bool ReadChunk(QByteArray& chunk);
+
+    /** Number of (decompressed) bytes consumed by Get() so far. */
+    qint64 GetPosition() const { return m_offset + m_pos; }
+
+    /** Check if all input has been read. */
+    bool AtEnd() { return Peek() == END_OF_STREAM; }
+
+    /** Check if input is gzip compressed. */
+    bool IsCompressed();
+
+    /** Check if reading or decompressing the input has failed. */
+    bool HasError() const { return !m_error.isEmpty(); }
+
+    /** Get description of the most recent error. */
+    QString GetError() const { return m_error; }
+
+protected:
+    /** Refill buffer from the device. Returns false if no further data is available. */
+    bool Fill();
+
+    /** Read first block from the device and check for compression. */
+    bool Initialize();
+
+    /** Decompress the next block of data into the buffer. */
+    bool Inflate();
+
+protected:
+    /** Device data is read from. */
+    QIODevice* m_device;
+
+    /** Decompressed data. */
+    QByteArray m_buffer;
+
+    /** Position of next byte in buffer. */
+    int m_pos;
+
+    /** Number of valid bytes in buffer. */
+    int m_end;
+
+    /** Position of the first byte in buffer within the (decompressed) input. */
+    qint64 m_offset;
+
+    /** Compressed data read from the device. */
+    QByteArray m_compressed;
+
+    /** Decompression state. */
+    z_stream m_zstream;
+
+    /** Flag indicating if the first block has been read. */
+    bool m_bInitialized;
+
+    /** Flag indicating if input is gzip compressed. */
+    bool m_bCompressed;
+
+    /** Flag indicating if the end of a gzip member has been reached. */
+    bool m_bMemberEnd;
+
+    /** Description of the most recent error. */
+    QString m_error;
+};
+
+}
+
+#endif
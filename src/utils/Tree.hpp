@@ -15,6 +15,7 @@
 
 #include "../utils/TreeTools.hpp"
 
+#include <QSet>
 #include <QSharedPointer>
 #include <QString>
 #include <queue>
@@ -152,19 +153,24 @@ public:
 	/**
 	 * @brief Collapse all nodes with a bootstrap value less than the specified value. 
 	 * @param support Collapse all nodes with support less than this value.
+	 * @param removed If given, collapsed nodes are added to it rather than destroyed.
 	 */
-	void CollapseNodes(float support);
+	void CollapseNodes(float support, std::vector<N*>* removed = NULL);
 
 	/** 
 	 * @brief Project tree onto a set of leaf nodes.
 	 * @param names Names of leaf nodes to project tree onto.
 	 * Note: names will contain a list of all the names not found in the tree after function returns.
+	 * Unary nodes are removed, with their branch length added to that of their child. If none of
+	 * the names are found the tree is left unchanged. Takes O(n) time for a tree with n nodes.
+	 * @param removed If given, nodes removed from the tree are added to it rather than destroyed.
 	 */
-    void ProjectTree(std::vector<QString>& names);
+    void ProjectTree(std::vector<QString>& names, std::vector<N*>* removed = NULL);
 
 	/** 
 	 * @brief Set a new root for the tree.
 	 * @param node The new root will be placed half way along the branch leading from this node to its parent.
+	 * The node object of the previous root is reused as the new root, so no nodes are created or destroyed.
 	 */
 	void Reroot(N* node);
 
@@ -175,6 +181,14 @@ public:
 
 	/** Get distance from root to furthest leaf node. */
 	float GetLengthOfTree() const { return m_lengthOfTree; }
+
+	/**
+	 * @brief Set statistics normally calculated by CalculateStatistics() (e.g., when they have been read from a file).
+	 * @param numLeaves Number of leaf nodes in tree.
+	 * @param numNodes Number of nodes in tree.
+	 * @param lengthOfTree Distance from root to furthest leaf node.
+	 */
+	void SetStatistics(uint numLeaves, uint numNodes, float lengthOfTree) { m_numLeaves = numLeaves; m_numNodes = numNodes; m_lengthOfTree = lengthOfTree; }
  
 protected:		
 	void DestroySubtree(N* node);
@@ -338,18 +352,21 @@ void Tree<N>::ScaleTree(float factor)
 }
 
 template <class N>
-void Tree<N>::CollapseNodes(float support)
+void Tree<N>::CollapseNodes(float support, std::vector<N*>* removed)
 {
+	// leaves have no clade to collapse
 	std::queue<N*> queue;
 	std::vector<N*> children = GetRootNode()->GetChildren();
     for(N* child : children)
 	{
-		queue.push(child);
+		if(!child->IsLeaf())
+			queue.push(child);
 	}
 
 	while(!queue.empty())
 	{
 		N* curNode = queue.front();
+		queue.pop();
 
 		// check support of current node
 		if(curNode->GetBootstrapToParent() < support)
@@ -374,6 +391,11 @@ void Tree<N>::CollapseNodes(float support)
 			}
 
 			curNode->GetParent()->RemoveChild(curNode);
+
+			if(removed)
+				removed->push_back(curNode);
+			else
+				delete curNode;
 		}
 		else
 		{
@@ -385,105 +407,127 @@ void Tree<N>::CollapseNodes(float support)
 					queue.push(child);
 			}
 		}
-
-		// Remove current parent node
-		queue.pop();
 	}	
 }
 
 template <class N>
-void Tree<N>::ProjectTree(std::vector<QString>& names)
+void Tree<N>::ProjectTree(std::vector<QString>& names, std::vector<N*>* removed)
 {
-	// mark all internal node as unprocessed so we can distinguish them for 
-	// true leaf nodes
-	std::vector<N*> nodes = GetNodes();
-    for(N* node : nodes)
+	QSet<QString> keep;
+	keep.reserve(int(names.size()));
+	for(const QString& name : names)
+		keep.insert(name);
+
+	// flatten tree into pre-order so the induced subtree is found without recursion
+	std::vector<N*> nodes;
+	std::vector<int> parents;
+	nodes.reserve(m_numNodes);
+	parents.reserve(m_numNodes);
+	std::vector< std::pair<N*, int> > stack(1, std::make_pair(m_root, -1));
+	while(!stack.empty())
 	{
-		node->SetProcessed(!node->IsLeaf());
+		N* node = stack.back().first;
+		parents.push_back(stack.back().second);
+		stack.pop_back();
+
+		int index = int(nodes.size());
+		nodes.push_back(node);
+		for(uint i = node->GetNumberOfChildren(); i > 0; --i)
+			stack.push_back(std::make_pair(node->GetChild(i-1), index));
 	}
 
-	// Remove all leaf nodes not in projection set.
-
-	// 1. Create dictionary mapping names to leaf nodes.
-	std::vector<N*> leafNodes = GetLeaves();
-    std::map<QString, N*> namesToNodes;
-    for(N* leaf : leafNodes)
+	// count children with a kept leaf below them, visiting children before their parent
+	uint numNodes = uint(nodes.size());
+	std::vector<uint> keptChildren(numNodes, 0);
+	QSet<QString> found;
+	for(uint i = numNodes; i > 0; --i)
 	{
-        namesToNodes.insert(std::pair<QString, N*>(leaf->GetName(), leaf));
-	}
+		uint index = i-1;
+		if(nodes[index]->IsLeaf())
+		{
+			if(!keep.contains(nodes[index]->GetName()))
+				continue;
 
-	// 2. Remove all nodes contained in the projection set.
-    typename std::map<QString, N*>::iterator it;
-    for(const QString& name : names)
-	{
-		it = namesToNodes.find(name);
-		if(it != namesToNodes.end())
-			namesToNodes.erase(it);
+			found.insert(nodes[index]->GetName());
+			keptChildren[index] = 1;
+		}
+
+		if(keptChildren[index] > 0 && parents[index] >= 0)
+			keptChildren[parents[index]]++;
 	}
 
-	// 3. Delete all remaining nodes in the dictionary.
-	for(it = namesToNodes.begin(); it != namesToNodes.end(); ++it)
+	std::vector<QString> missing;
+	for(const QString& name : names)
 	{
-		N* deadNode = it->second;
-		deadNode->GetParent()->RemoveChild(deadNode);
+		if(!found.contains(name))
+			missing.push_back(name);
 	}
+	names.swap(missing);
 
-	// collapse any internal nodes that have less than 2 children. This is 
-	// done in a breadth first manner from the leaf nodes to the root node.
-	std::vector<N*> curNodes = GetLeaves();
-	std::set<N*> nextNodes;
-	while(!curNodes.empty())
+	// leave the tree as it is rather than removing every node
+	if(found.isEmpty())
+		return;
+
+	// kept leaves and nodes with at least two kept children form the projected tree. Each is
+	// attached to its nearest such ancestor, with the length of any unary nodes in between
+	// added to its branch.
+	std::vector<int> ancestors(numNodes, -1);
+	std::vector<float> distances(numNodes, float(Node::NO_DISTANCE));
+	N* root = NULL;
+	for(uint i = 0; i < numNodes; ++i)
 	{
-		nextNodes.clear();
-        for(N* node : curNodes)
+		N* node = nodes[i];
+		int parent = parents[i];
+		if(keptChildren[i] == 0)
 		{
-			if(!node->IsRoot())
-				nextNodes.insert(node->GetParent());
+			if(removed)
+				removed->push_back(node);
+			else
+				delete node;
+			continue;
+		}
 
-			if(node->IsProcessed() && node->GetNumberOfChildren() == 0)
+		distances[i] = node->GetDistanceToParent();
+		if(parent >= 0)
+		{
+			if(keptChildren[parent] > 1)
 			{
-				if(node->IsRoot())
-				{
-					// we have a root with no children so just leave it as the sole node in the tree
-				}
-				else
-				{
-					// remove this node from the tree
-					node->GetParent()->RemoveChild(node);
-					nextNodes.erase(node);
-				}
+				ancestors[i] = parent;
+			}
+			else
+			{
+				ancestors[i] = ancestors[parent];
+				if(distances[parent] != Node::NO_DISTANCE && distances[i] != Node::NO_DISTANCE)
+					distances[i] += distances[parent];
 			}
-			else if(node->IsProcessed() && node->GetNumberOfChildren() == 1)
-			{		
-				if(node->IsRoot())
-				{
-					// the root is degenerate so we must make its sole child the new root
-					node->GetChild(0)->SetParent(NULL);
-					node->GetChild(0)->SetDistanceToParent(Node::NO_DISTANCE);
-					SetRootNode(node->GetChild(0));
-					nextNodes.erase(node);
-					delete node;
-				}
-				else
-				{
-					// remove node from tree after assigning its sole child to its parent
-					node->GetParent()->AddChild(node->GetChild(0));	
-					
-					if(node->GetChild(0)->GetDistanceToParent() != Node::NO_DISTANCE)
-					{
-						// keep track of branch lengths
-						node->GetChild(0)->SetDistanceToParent(node->GetChild(0)->GetDistanceToParent() 
-																											+ node->GetDistanceToParent()); 
-					}
-
-					node->GetParent()->RemoveChild(node);
-					nextNodes.erase(node);
-				}
-			}	
 		}
 
-		curNodes.assign(nextNodes.begin(), nextNodes.end());
+		bool bKept = node->IsLeaf() || keptChildren[i] > 1;
+		if(!bKept)
+		{
+			if(removed)
+				removed->push_back(node);
+			else
+				delete node;
+			continue;
+		}
+
+		node->RemoveChildren();
+		node->SetDistanceToParent(distances[i]);
+		if(ancestors[i] >= 0)
+		{
+			nodes[ancestors[i]]->AddChild(node);
+		}
+		else
+		{
+			node->SetParent(NULL);
+			node->SetDistanceToParent(Node::NO_DISTANCE);
+			root = node;
+		}
 	}
+
+	SetRootNode(root);
+	CalculateStatistics();
 }
 
 template <class N>
@@ -492,9 +536,12 @@ void Tree<N>::Reroot(N* node)
 	if(node->IsRoot())
 		return;
 
-	N* newRoot = new N(m_root->GetId());
+	// reuse the previous root, and add selected subtree as a child
+	N* newRoot = m_root;
+	std::vector<N*> rootChildren = m_root->GetChildren();
+	m_root->RemoveChildren();
+	m_root->SetBootstrapToParent(Node::NO_DISTANCE);
 
-	// create new root and add selected subtree as a child
 	N* parentNode = node->GetParent();
 	newRoot->AddChild(node);
 	if(node->GetDistanceToParent() != Node::NO_DISTANCE)
@@ -529,9 +576,8 @@ void Tree<N>::Reroot(N* node)
 		}
 
 		// add children of previous root to newly rooted tree
-		for(uint i = 0; i < m_root->GetNumberOfChildren(); ++i)
+		for(N* child : rootChildren)
 		{
-			N* child = m_root->GetChild(i);
 			if(child != prevNode)
 			{
 				prevNode->AddChild(child);
@@ -545,9 +591,8 @@ void Tree<N>::Reroot(N* node)
 	}
 	else
 	{
-		for(uint i = 0; i < m_root->GetNumberOfChildren(); ++i)
+		for(N* child : rootChildren)
 		{
-			N* child = m_root->GetChild(i);
 			if(child != node)
 			{
 				newRoot->AddChild(child);
@@ -560,16 +605,12 @@ void Tree<N>::Reroot(N* node)
 		}
 	}
 
-	delete m_root;
-
 	std::vector<N*> children = newRoot->GetChildren();
     for(N* child : children)
 	{
 		if(!child->IsLeaf())
 			child->SetBootstrapToParent(node->GetBootstrapToParent());
 	}
-
-	m_root = newRoot;
 }
 
 template <class N>
@@ -590,6 +631,7 @@ void Tree<N>::CalculateStatistics()
 
 	m_numNodes = 1;	// remember to count the root node
 	m_numLeaves = 0;
+	m_lengthOfTree = 0;
 	while(!stack.empty())
 	{
 		N* curNode = stack.top();
@@ -0,0 +1,77 @@
+#include <QBuffer>
+#include <QtTest>
+
+#include "../src/core/NewickIO.hpp"
+
+using namespace pygmy;
+using namespace utils;
+
+/**
+ * Check that trees written in Newick format are read back unchanged.
+ */
+class TestNewickIO : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void RoundTripQuotedNames_data();
+
+    /** Names containing quotes or Newick punctuation survive writing and reading. */
+    void RoundTripQuotedNames();
+};
+
+namespace
+{
+    QStringList NodeNames(Tree<NodePhylo>::Ptr tree)
+    {
+        QStringList names;
+        std::vector<NodePhylo*> nodes = tree->GetNodes();
+        for(uint i = 0; i < nodes.size(); ++i)
+            names.append(nodes[i]->GetName());
+
+        return names;
+    }
+}
+
+void TestNewickIO::RoundTripQuotedNames_data()
+{
+    QTest::addColumn<QString>("name");
+
+    QTest::newRow("quote") << QString("O'Brien");
+    QTest::newRow("punctuation") << QString("E. coli (strain K-12, MG1655):1");
+}
+
+void TestNewickIO::RoundTripQuotedNames()
+{
+    QFETCH(QString, name);
+
+    NewickIO newickIO;
+    Tree<NodePhylo>::Ptr tree(new Tree<NodePhylo>());
+    QVERIFY(newickIO.ParseNewickString(tree, "((A:0.1,B:0.2):0.3,C:0.4);"));
+    tree->CalculateStatistics();
+
+    // the root, internal nodes and leaves are each written by a different path
+    std::vector<NodePhylo*> nodes = tree->GetNodes();
+    for(uint i = 0; i < nodes.size(); ++i)
+    {
+        if(!nodes[i]->IsLeaf() || nodes[i]->GetName() == "A")
+            nodes[i]->SetName(name);
+    }
+
+    QByteArray data;
+    QBuffer output(&data);
+    QVERIFY(output.open(QIODevice::WriteOnly));
+    QVERIFY(newickIO.Write(tree, &output));
+    output.close();
+
+    QBuffer input(&data);
+    QVERIFY(input.open(QIODevice::ReadOnly));
+    Tree<NodePhylo>::Ptr copy(new Tree<NodePhylo>());
+    QVERIFY2(newickIO.Read(copy, &input), qPrintable(newickIO.GetError()));
+
+    QCOMPARE(NodeNames(copy), NodeNames(tree));
+}
+
+QTEST_APPLESS_MAIN(TestNewickIO)
+
+#include "TestNewickIO.moc"
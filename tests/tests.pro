@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# Unit tests for core tree operations. Build and run with:
+#
+#   qmake tests.pro && make && make check
+#
+#-------------------------------------------------
+QT       += core gui opengl testlib
+
+TARGET = pygmy-tests
+TEMPLATE = app
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+LIBS += -lz
+
+SOURCES += \
+    TestNewickIO.cpp \
+    ../src/core/NewickIO.cpp \
+    ../src/core/TreeTokenizer.cpp \
+    ../src/utils/BufferedWriter.cpp \
+    ../src/utils/StreamReader.cpp \
+    ../src/utils/Colour.cpp \
+    ../src/utils/Node.cpp